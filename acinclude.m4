@@ -190,5 +190,16 @@ AC_DEFUN([GPROF_CHECK],[
 	AC_SUBST(enable_gprof)
 	])
 
+AC_DEFUN([TELEMETRY_CHECK],[
+	AC_ARG_ENABLE(telemetry, AC_HELP_STRING([--enable-telemetry], [enable the battle engine counters of osim -b (default=no)])
+	    ,[enable_telemetry="$enableval"],[enable_telemetry="no"])
+
+	if test "x$enable_telemetry" = xyes; then
+	AC_DEFINE(HAVE_TELEMETRY, 1, [enabled if battle engine counters are compiled in])
+	fi
+
+	AC_SUBST(enable_telemetry)
+	])
+
 
 
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <apr_pools.h>
+
+#include "napr_cache.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+static void sum_merge(void *stored, void *value)
+{
+    *(unsigned int *) value += *(const unsigned int *) stored;
+}
+
+START_TEST(test_napr_cache_merge)
+{
+    napr_cache_t *cache;
+    apr_uint64_t hits, misses;
+    unsigned int key[4] = { 1, 2, 3, 4 }, value;
+    apr_status_t status;
+
+    status = napr_cache_init(&cache, 16UL, sizeof(key), sizeof(unsigned int), pool);
+    fail_unless(APR_SUCCESS == status, "Unable to make cache.");
+
+    fail_unless(0 == napr_cache_get(cache, key, &value), "Empty cache returned a value.");
+    value = 3;
+    napr_cache_merge(cache, key, &value, sum_merge);
+    fail_unless(3 == value, "Bad value after first merge.");
+    value = 4;
+    napr_cache_merge(cache, key, &value, sum_merge);
+    fail_unless(7 == value, "Bad value after second merge.");
+    value = 0;
+    fail_unless(1 == napr_cache_get(cache, key, &value), "Key not found.");
+    fail_unless(7 == value, "Bad stored value.");
+
+    key[3] = 5;
+    fail_unless(0 == napr_cache_get(cache, key, &value), "Another key returned a value.");
+
+    napr_cache_get_stats(cache, &hits, &misses);
+    fail_unless((1ULL == hits) && (2ULL == misses), "Bad stats.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_napr_cache_eviction)
+{
+    napr_cache_t *cache;
+    unsigned int key, value, nb_found;
+    apr_status_t status;
+
+    /* Only one set of 4 ways */
+    status = napr_cache_init(&cache, 4UL, sizeof(unsigned int), sizeof(unsigned int), pool);
+    fail_unless(APR_SUCCESS == status, "Unable to make cache.");
+
+    for (key = 0; key < 4; key++) {
+	value = key;
+	napr_cache_merge(cache, &key, &value, sum_merge);
+    }
+    /* Use key 0, thus key 1 is the least recently used */
+    key = 0;
+    fail_unless(1 == napr_cache_get(cache, &key, &value), "Key 0 not found.");
+    key = 4;
+    value = 4;
+    napr_cache_merge(cache, &key, &value, sum_merge);
+
+    key = 1;
+    fail_unless(0 == napr_cache_get(cache, &key, &value), "Least recently used key not evicted.");
+    for (key = 0, nb_found = 0; key < 5; key++) {
+	if (napr_cache_get(cache, &key, &value)) {
+	    fail_unless(key == value, "Bad value for key %u.", key);
+	    nb_found++;
+	}
+    }
+    fail_unless(4 == nb_found, "Cache is not full.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+static void max_merge(void *stored, void *value)
+{
+    if (*(const unsigned int *) stored > *(unsigned int *) value)
+	*(unsigned int *) value = *(const unsigned int *) stored;
+}
+
+START_TEST(test_napr_cache_commit)
+{
+    napr_cache_t *cache[2];
+    unsigned int key, value, other, values[6] = { 5, 2, 9, 3, 7, 1 };
+    unsigned int expected[5] = { 5, 1, 7, 3, 9 };
+    apr_status_t status;
+    int i, j, nb_found;
+
+    for (i = 0; i < 2; i++) {
+	/* A single set, more keys than ways: what gets evicted depends on the order of the merges */
+	status = napr_cache_init(&(cache[i]), 4UL, sizeof(unsigned int), sizeof(unsigned int), pool);
+	fail_unless(APR_SUCCESS == status, "Unable to make cache.");
+	for (j = 0; j < 6; j++) {
+	    key = values[(0 == i) ? j : 5 - j] % 5;
+	    value = values[(0 == i) ? j : 5 - j];
+	    fail_unless(APR_SUCCESS == napr_cache_defer(cache[i], &key, &value), "Unable to defer.");
+	}
+	key = 4;
+	fail_unless(0 == napr_cache_get(cache[i], &key, &value), "Deferred value visible before the commit.");
+	napr_cache_commit(cache[i], max_merge);
+    }
+
+    for (key = 0, nb_found = 0; key < 5; key++) {
+	i = napr_cache_get(cache[0], &key, &value);
+	j = napr_cache_get(cache[1], &key, &other);
+	fail_unless(i == j, "Key %u kept in one order only.", key);
+	if (i) {
+	    fail_unless(value == other, "Value of key %u depends on the order.", key);
+	    fail_unless(value == expected[key], "Bad value for key %u.", key);
+	    nb_found++;
+	}
+    }
+    fail_unless(4 == nb_found, "Cache is not full.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *napr_cache_tcase(void)
+{
+    TCase *tc_core = tcase_create("napr_cache_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_napr_cache_merge);
+    tcase_add_test(tc_core, test_napr_cache_eviction);
+    tcase_add_test(tc_core, test_napr_cache_commit);
+
+    return tc_core;
+}
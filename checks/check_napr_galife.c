@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <values.h>
+#include <apr_pools.h>
+#include <apr_thread_proc.h>
+
+#include "napr_galife.h"
+
+apr_pool_t *pool;
+
+#define TOY_GENES 8
+#define TOY_MAX 100U
+
+/* Maximize the sum of the genes, each evaluation lasts eval_time */
+typedef struct toy_t
+{
+    napr_galife_t *ga;
+    apr_interval_time_t eval_time;
+    float score;		/* best so far, read by the canceller thread */
+    unsigned long nb_checkpoints;
+    int bad_checkpoint;		/* a saved individual whose score is not the one of its genes */
+} toy_t;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+static void toy_allocat(void *rec, apr_pool_t *pool, void **chromosome)
+{
+    *chromosome = apr_pcalloc(pool, TOY_GENES * sizeof(unsigned int));
+}
+
+static void toy_randomz(void *rec, void *chromosome, unsigned long idx, unsigned int *seed)
+{
+    unsigned int *genes = chromosome;
+    int i;
+
+    for (i = 0; i < TOY_GENES; i++)
+	genes[i] = rand_r(seed) % TOY_MAX;
+}
+
+static float toy_sum(const unsigned int *genes)
+{
+    float sum = 0.0f;
+    int i;
+
+    for (i = 0; i < TOY_GENES; i++)
+	sum += genes[i];
+
+    return sum;
+}
+
+static float toy_fitness(void *rec, void *worker, void *chromosome)
+{
+    toy_t *toy = rec;
+    apr_interval_time_t slept;
+
+    /* A slow evaluation that gives up once the run is over */
+    for (slept = 0; slept < toy->eval_time; slept += 1000) {
+	if (napr_galife_is_over(toy->ga))
+	    return -FLT_MAX;
+	apr_sleep(1000);
+    }
+
+    return toy_sum(chromosome);
+}
+
+static void toy_crossvr(void *rec, float crossover_p, const void *father, void *mother, unsigned int *seed)
+{
+    const unsigned int *genes_father = father;
+    unsigned int *genes_mother = mother;
+    int i;
+
+    for (i = 0; i < TOY_GENES; i++)
+	if (crossover_p > ((float) rand_r(seed) / (RAND_MAX + 1.0f)))
+	    genes_mother[i] = genes_father[i];
+}
+
+static void toy_mutation(void *rec, float mutation_p, void *chromosome, unsigned int *seed)
+{
+    unsigned int *genes = chromosome;
+
+    genes[rand_r(seed) % TOY_GENES] = rand_r(seed) % TOY_MAX;
+}
+
+static void toy_copy(void *rec, const void *src, void *dst)
+{
+    memcpy(dst, src, TOY_GENES * sizeof(unsigned int));
+}
+
+/* The score is linear in the genes, the surrogate model can learn it exactly */
+static void toy_features(void *rec, const void *chromosome, float *features)
+{
+    const unsigned int *genes = chromosome;
+    int i;
+
+    for (i = 0; i < TOY_GENES; i++)
+	features[i] = (float) genes[i] / TOY_MAX;
+}
+
+static apr_status_t toy_checkpoint(void *rec, const napr_galife_state_t *state)
+{
+    toy_t *toy = rec;
+    unsigned long l;
+
+    toy->nb_checkpoints++;
+    if (32UL != state->nb_members)
+	toy->bad_checkpoint = 1;
+    for (l = 0; l < state->nb_members; l++)
+	if ((-FLT_MAX != state->scores[l]) && (state->scores[l] != toy_sum(state->chromosomes[l])))
+	    toy->bad_checkpoint = 1;
+
+    return APR_SUCCESS;
+}
+
+/* Run 2 seconds with a checkpoint every second, the last one at the end */
+static void toy_run_checkpointed(int nb_islands, int steady_state)
+{
+    toy_t toy;
+    napr_galife_tuning_t tuning;
+    apr_status_t status;
+
+    toy.eval_time = apr_time_from_msec(2);
+    toy.nb_checkpoints = 0UL;
+    toy.bad_checkpoint = 0;
+    status = napr_galife_init(pool, 32UL, 100000UL, 0UL, 2UL, 2UL, 42U, &toy, toy_allocat, toy_randomz, NULL,
+			      toy_fitness, NULL, toy_copy, 0.5f, toy_crossvr, 0.5f, toy_mutation, NULL, &(toy.ga));
+    fail_unless(APR_SUCCESS == status, "Unable to init the genetic algorithm.");
+    napr_galife_tuning_default(&tuning);
+    tuning.nb_islands = nb_islands;
+    tuning.steady_state = steady_state;
+    status = napr_galife_set_tuning(toy.ga, &tuning);
+    fail_unless(APR_SUCCESS == status, "Unable to tune the genetic algorithm.");
+    napr_galife_set_checkpoint(toy.ga, 1UL, toy_checkpoint);
+
+    status = ga_run(toy.ga);
+    fail_unless(APR_SUCCESS == status, "Error running the genetic algorithm.");
+    fail_unless(toy.nb_checkpoints >= 2UL, "Only %lu checkpoints.", toy.nb_checkpoints);
+    fail_unless(0 == toy.bad_checkpoint, "Bad individual saved.");
+}
+
+static void *APR_THREAD_FUNC toy_canceller(apr_thread_t *thd, void *rec)
+{
+    toy_t *toy = rec;
+    unsigned int genes[TOY_GENES];
+
+    apr_sleep(apr_time_from_msec(300));
+    toy->score = napr_galife_get_best_so_far(toy->ga, genes);
+    if ((-FLT_MAX != toy->score) && (toy->score != toy_sum(genes)))
+	toy->score = -1.0f;
+    napr_galife_cancel(toy->ga);
+    apr_thread_exit(thd, APR_SUCCESS);
+
+    return NULL;
+}
+
+START_TEST(test_napr_galife_fixed_timeout)
+{
+    toy_t toy;
+    napr_galife_stats_t stats;
+    apr_status_t status;
+
+    /* 32 evaluations of 100ms on 2 threads: the initial population alone lasts past the timeout */
+    toy.eval_time = apr_time_from_msec(100);
+    status = napr_galife_init(pool, 32UL, 100000UL, 0UL, 1UL, 2UL, 42U, &toy, toy_allocat, toy_randomz, NULL,
+			      toy_fitness, NULL, toy_copy, 0.5f, toy_crossvr, 0.5f, toy_mutation, NULL, &(toy.ga));
+    fail_unless(APR_SUCCESS == status, "Unable to init the genetic algorithm.");
+    status = ga_run(toy.ga);
+    fail_unless(APR_SUCCESS == status, "Error running the genetic algorithm.");
+
+    napr_galife_get_stats(toy.ga, FLT_MAX, &stats);
+    fail_unless(stats.run_time < apr_time_from_msec(1200), "Timeout of 1 sec overshot: %" APR_TIME_T_FMT " usec.",
+		stats.run_time);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_napr_galife_cancel)
+{
+    toy_t toy;
+    napr_galife_stats_t stats;
+    apr_thread_t *thread;
+    unsigned int genes[TOY_GENES];
+    float score;
+    apr_status_t status, thread_status;
+
+    toy.eval_time = apr_time_from_msec(2);
+    toy.score = -FLT_MAX;
+    status = napr_galife_init(pool, 32UL, 100000UL, 0UL, 0UL, 2UL, 42U, &toy, toy_allocat, toy_randomz, NULL,
+			      toy_fitness, NULL, toy_copy, 0.5f, toy_crossvr, 0.5f, toy_mutation, NULL, &(toy.ga));
+    fail_unless(APR_SUCCESS == status, "Unable to init the genetic algorithm.");
+    status = napr_galife_keep_best(toy.ga);
+    fail_unless(APR_SUCCESS == status, "Unable to keep the best.");
+
+    status = apr_thread_create(&thread, NULL, toy_canceller, &toy, pool);
+    fail_unless(APR_SUCCESS == status, "Unable to create the canceller thread.");
+    /* Without timeout, only the cancel stops the run */
+    status = ga_run(toy.ga);
+    fail_unless(APR_SUCCESS == status, "Error running the genetic algorithm.");
+    apr_thread_join(&thread_status, thread);
+
+    napr_galife_get_stats(toy.ga, FLT_MAX, &stats);
+    fail_unless(stats.run_time < apr_time_from_msec(600), "Cancel ignored: %" APR_TIME_T_FMT " usec.", stats.run_time);
+    fail_unless(toy.score > 0.0f, "Bad best so far while running.");
+    score = napr_galife_get_best_so_far(toy.ga, genes);
+    fail_unless(score == stats.best_score, "Best so far %f is not the best %f.", score, stats.best_score);
+    fail_unless(score == toy_sum(genes), "Best so far %f is not the score of its genes.", score);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_napr_galife_checkpoint_islands)
+{
+    toy_run_checkpointed(2, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_napr_galife_checkpoint_steady)
+{
+    toy_run_checkpointed(1, 1);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_napr_galife_resume)
+{
+    toy_t toy;
+    napr_galife_state_t state;
+    napr_galife_stats_t stats;
+    unsigned int genes[16][TOY_GENES];
+    void *chromosomes[16];
+    float scores[16];
+    unsigned long l;
+    apr_status_t status;
+
+    memset(&state, 0, sizeof(napr_galife_state_t));
+    for (l = 0; l < 16UL; l++) {
+	memset(genes[l], 0, sizeof(genes[l]));
+	genes[l][0] = l;
+	chromosomes[l] = genes[l];
+	scores[l] = toy_sum(genes[l]);
+    }
+    state.chromosomes = chromosomes;
+    state.scores = scores;
+    state.nb_members = 16UL;
+    state.nb_ages = 7UL;
+    state.nb_evaluations = 1000UL;
+    state.best_score = 15.0f;
+
+    /* Only the 16 missing individuals are evaluated */
+    toy.eval_time = 0;
+    status = napr_galife_init(pool, 32UL, 100000UL, 0UL, 0UL, 2UL, 42U, &toy, toy_allocat, toy_randomz, NULL,
+			      toy_fitness, NULL, toy_copy, 0.5f, toy_crossvr, 0.5f, toy_mutation, &state, &(toy.ga));
+    fail_unless(APR_SUCCESS == status, "Unable to init the genetic algorithm.");
+    napr_galife_get_stats(toy.ga, FLT_MAX, &stats);
+    fail_unless(1016UL == stats.nb_evaluations, "%lu evaluations instead of 1016.", stats.nb_evaluations);
+    fail_unless(7UL == stats.nb_ages, "Resumed at generation %lu instead of 7.", stats.nb_ages);
+
+    state.nb_members = 0UL;
+    status = napr_galife_init(pool, 32UL, 100000UL, 0UL, 0UL, 2UL, 42U, &toy, toy_allocat, toy_randomz, NULL,
+			      toy_fitness, NULL, toy_copy, 0.5f, toy_crossvr, 0.5f, toy_mutation, &state, &(toy.ga));
+    fail_unless(APR_EINVAL == status, "Empty state restored.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_napr_galife_surrogate)
+{
+    toy_t toy;
+    napr_galife_stats_t stats;
+    unsigned int better[TOY_GENES], worse[TOY_GENES];
+    float predicted_better, predicted_worse;
+    apr_status_t status;
+    int i;
+
+    for (i = 0; i < TOY_GENES; i++) {
+	worse[i] = TOY_MAX / 4;
+	better[i] = worse[i];
+    }
+    /* Better by a single gene */
+    better[TOY_GENES / 2] = TOY_MAX - 1;
+
+    /* Without timeout, 20 generations */
+    toy.eval_time = 0;
+    status = napr_galife_init(pool, 32UL, 20UL, 0UL, 0UL, 2UL, 42U, &toy, toy_allocat, toy_randomz, NULL,
+			      toy_fitness, NULL, toy_copy, 0.5f, toy_crossvr, 0.5f, toy_mutation, NULL, &(toy.ga));
+    fail_unless(APR_SUCCESS == status, "Unable to init the genetic algorithm.");
+    fail_unless(-FLT_MAX == napr_galife_predict(toy.ga, better), "Prediction without surrogate.");
+    status = napr_galife_set_surrogate(toy.ga, toy_features, TOY_GENES);
+    fail_unless(APR_SUCCESS == status, "Unable to set the surrogate.");
+    status = ga_run(toy.ga);
+    fail_unless(APR_SUCCESS == status, "Error running the genetic algorithm.");
+
+    napr_galife_get_stats(toy.ga, FLT_MAX, &stats);
+    fail_unless(20UL == stats.nb_ages, "%lu generations instead of 20.", stats.nb_ages);
+    fail_unless(0UL != stats.nb_predicted, "No prediction checked.");
+    predicted_better = napr_galife_predict(toy.ga, better);
+    predicted_worse = napr_galife_predict(toy.ga, worse);
+    fail_unless(predicted_better > predicted_worse, "Better gene predicted %f, below the worse one %f.",
+		predicted_better, predicted_worse);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *napr_galife_tcase(void)
+{
+    TCase *tc_core = tcase_create("napr_galife_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_napr_galife_fixed_timeout);
+    tcase_add_test(tc_core, test_napr_galife_cancel);
+    tcase_add_test(tc_core, test_napr_galife_checkpoint_islands);
+    tcase_add_test(tc_core, test_napr_galife_checkpoint_steady);
+    tcase_add_test(tc_core, test_napr_galife_surrogate);
+    tcase_add_test(tc_core, test_napr_galife_resume);
+
+    return tc_core;
+}
@@ -17,10 +17,12 @@
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <apr_file_io.h>
 
 #include "os_conf.h"
 #include "os_fleet.h"
+#include "os_io.h"
 
 apr_pool_t *pool;
 
@@ -132,6 +134,400 @@ START_TEST(test_os_fleet_battle)
 END_TEST
 /* *INDENT-ON* */
 
+/* A guessing attacker against a defenseless planet */
+static void guess_fleets(os_conf_t **conf, os_fleet_t **attacker, os_fleet_t **defender)
+{
+    apr_status_t status;
+
+    *conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != *conf, "Unable to load conf.");
+    *attacker = os_fleet_make(pool, ATK_FLT);
+    fail_unless(NULL != *attacker, "Unable to make fleet.");
+    status = os_fleet_set_conf(*attacker, "15,16,15,15,13,10,[3:432:9],2000,1000,5000,2000,1000,500,0,300,0,300,0,100,0,0");
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(*attacker, *conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+    *defender = os_fleet_make(pool, DEF_FLT);
+    fail_unless(NULL != *defender, "Unable to make fleet.");
+    status = os_fleet_set_conf(*defender, "14,14,14,[3:412:7],100000,100000,50000,0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(*defender, *conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+    os_fleet_to_guess(*attacker);
+}
+
+/*
+ * Guess the attacker of guess_fleets for max_ages generations without
+ * timeout: every child is then either screened or evaluated, whatever the
+ * time it takes.
+ */
+static void guess(unsigned int nb_cpu, unsigned int nb_individuals, unsigned long max_ages,
+		  const napr_galife_tuning_t *tuning, napr_galife_stats_t *stats)
+{
+    os_fleet_t *attacker = NULL, *defender = NULL;
+    os_conf_t *conf = NULL;
+
+    guess_fleets(&conf, &attacker, &defender);
+    fail_unless(NULL != defender, "Unable to make fleets.");
+    memset(stats, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 0, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, nb_cpu,
+				  nb_individuals, max_ages, tuning, 0.0f, NULL, 0, NULL, NULL, stats);
+    fail_unless(max_ages == stats->nb_ages, "Bad number of generations.");
+    /* Plundering a defenseless planet is profitable from the first generations */
+    fail_unless(stats->best_score > 0.0f, "No profitable attacker found.");
+    fail_unless(stats->best_time <= stats->run_time, "Bad time of best.");
+}
+
+/* The initial population, then half of it replaced at each generation */
+#define GENERATIONAL_BIRTHS(nb_individuals, max_ages) ((nb_individuals) + (max_ages) * ((nb_individuals) / 2))
+
+START_TEST(test_os_fleet_find_cheapest_winner)
+{
+    napr_galife_stats_t stats;
+
+    guess(1, 32, 8UL, NULL, &stats);
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+    fail_unless((stats.target_time >= 0) && (stats.target_time <= stats.best_time), "Bad time to target.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_islands)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+
+    /* Each island of 8 individuals breeds 4 children per generation, migrants are not evaluated again */
+    napr_galife_tuning_default(&tuning);
+    tuning.nb_islands = 4;
+    tuning.migration_interval = 2;
+    tuning.topology = NAPR_GALIFE_RANDOM;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_steady)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+
+    /* A generation is as many births as individuals, each one replacing a loser as soon as it is evaluated */
+    napr_galife_tuning_default(&tuning);
+    tuning.steady_state = 1;
+    guess(4, 32, 16UL, &tuning, &stats);
+    fail_unless(32UL + 16UL * 32UL == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		32UL + 16UL * 32UL);
+    fail_unless(0UL != stats.nb_dropped, "No child cut short below the loser it replaces.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_race)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+
+    /* Dropping a hopeless child ends its evaluation, it still counts as evaluated */
+    napr_galife_tuning_default(&tuning);
+    tuning.race_first_samples = 2;
+    tuning.race_max_samples = 64;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(0UL != stats.nb_dropped, "No hopeless child dropped.");
+    fail_unless(stats.nb_dropped <= stats.nb_evaluations, "More children dropped than evaluated.");
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+
+    /* Without racing, every child fights all its battles */
+    tuning.race_first_samples = 0;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(0UL == stats.nb_dropped, "Child dropped without racing.");
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_screen)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+
+    /* A screened child is not evaluated */
+    napr_galife_tuning_default(&tuning);
+    tuning.screen_percent = 0;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(0UL != stats.nb_screened, "No child screened.");
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+
+    /* Without screening, every child is evaluated */
+    tuning.screen_percent = 100;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(0UL == stats.nb_screened, "Child screened without screening.");
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations, "%lu children evaluated, expected %lu.",
+		stats.nb_evaluations, GENERATIONAL_BIRTHS(32UL, 8UL));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_surrogate)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+
+    /* The surplus offspring the model discards are never evaluated */
+    napr_galife_tuning_default(&tuning);
+    tuning.surrogate_surplus = 7;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(0UL != stats.nb_predicted, "No prediction checked.");
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+
+    /* Without surplus offspring, no model is needed */
+    tuning.surrogate_surplus = 0;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(0UL == stats.nb_predicted, "Prediction checked without surplus.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_big_population)
+{
+    napr_galife_stats_t stats;
+    os_fleet_t *attacker = NULL, *defender = NULL;
+    os_conf_t *conf = NULL;
+
+    /* Individuals are only a repartition, the fixed timeout cuts the initial population short */
+    guess_fleets(&conf, &attacker, &defender);
+    fail_unless(NULL != defender, "Unable to make fleets.");
+    memset(&stats, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 50000,
+				  0UL, NULL, 0.0f, NULL, 0, NULL, NULL, &stats);
+    fail_unless(0 != stats.run_time, "Genetic algorithm did not run.");
+    fail_unless((0UL != stats.nb_evaluations) && (stats.nb_evaluations < 50000UL), "Initial population not cut short.");
+    fail_unless(0UL == stats.nb_ages, "Generation bred before the initial population was evaluated.");
+    fail_unless(stats.best_score > 0.0f, "No profitable attacker found.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_tournament)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+
+    /* Selection is a draw of contestants, not a sort of the population */
+    napr_galife_tuning_default(&tuning);
+    tuning.tournament_size = 7;
+    guess(1, 64, 8UL, &tuning, &stats);
+    fail_unless(GENERATIONAL_BIRTHS(64UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(64UL, 8UL));
+    /* The largest tournament a population of 32 allows: a winner and a loser drawn among 15 each */
+    tuning.tournament_size = 15;
+    guess(1, 32, 8UL, &tuning, &stats);
+    fail_unless(GENERATIONAL_BIRTHS(32UL, 8UL) == stats.nb_evaluations + stats.nb_screened,
+		"%lu children evaluated and %lu screened, expected %lu.", stats.nb_evaluations, stats.nb_screened,
+		GENERATIONAL_BIRTHS(32UL, 8UL));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* Read the counters and the best score a checkpoint saved */
+static void read_checkpoint(const char *filename, apr_uint64_t *counters, float *best_score)
+{
+    const unsigned char *ptr, *end;
+    apr_uint32_t nb_items, seed;
+    apr_uint64_t fingerprint;
+    apr_size_t size;
+    apr_status_t status;
+
+    status = os_io_read(filename, OS_FLEET_CHECKPOINT_MAGIC, OS_FLEET_CHECKPOINT_VERSION, &ptr, &size, pool);
+    fail_unless(APR_SUCCESS == status, "Unable to read checkpoint.");
+    end = ptr + size;
+    fail_unless((0 == os_io_get_uint32(&ptr, end, &nb_items)) && (0 == os_io_get_uint64(&ptr, end, &fingerprint))
+		&& (0 == os_io_get_uint32(&ptr, end, &seed)) && (0 == os_io_get_uint32(&ptr, end, &seed))
+		&& (0 == os_io_get_uint64_array(&ptr, end, counters, 6))
+		&& (0 == os_io_get_float(&ptr, end, best_score)), "Truncated checkpoint.");
+}
+
+START_TEST(test_os_fleet_find_cheapest_winner_checkpoint)
+{
+    napr_galife_stats_t stats, resumed;
+    os_fleet_t *attacker = NULL, *defender = NULL;
+    os_conf_t *conf = NULL;
+    apr_uint64_t saved[6], again[6];
+    float saved_score, again_score;
+    const unsigned char *ptr;
+    apr_size_t size;
+    apr_status_t status;
+    FILE *f;
+
+    guess_fleets(&conf, &attacker, &defender);
+    fail_unless(NULL != defender, "Unable to make fleets.");
+    apr_file_remove(CHECKS_DIR "/guess.osc", pool);
+    /* Nothing to resume yet, the run starts afresh and saves its state at the end */
+    memset(&stats, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, CHECKS_DIR "/guess.osc", 1, NULL, NULL, &stats);
+    fail_unless(0UL != stats.nb_evaluations, "No fitness evaluated.");
+    read_checkpoint(CHECKS_DIR "/guess.osc", saved, &saved_score);
+    fail_unless((saved[0] == stats.nb_ages) && (saved[1] == stats.nb_evaluations) && (saved_score == stats.best_score),
+		"Saved state is not the final one.");
+
+    /* The fixed timeout counts the saved run time: with the same one, the resumed run is the saved one */
+    memset(&resumed, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, CHECKS_DIR "/guess.osc", 1, NULL, NULL, &resumed);
+    fail_unless(saved[0] == resumed.nb_ages, "Resumed at generation %lu instead of %lu.", resumed.nb_ages,
+		(unsigned long) saved[0]);
+    fail_unless(saved[1] == resumed.nb_evaluations, "%lu evaluations restored instead of %lu.", resumed.nb_evaluations,
+		(unsigned long) saved[1]);
+    fail_unless(saved_score == resumed.best_score, "Best score %f restored instead of %f.", resumed.best_score,
+		saved_score);
+    fail_unless(resumed.run_time >= (apr_time_t) saved[4], "Run time not restored.");
+
+    /* Another guess doesn't run from it, nor overwrites it */
+    memset(&resumed, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, FULL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, CHECKS_DIR "/guess.osc", 1, NULL, NULL, &resumed);
+    fail_unless(0UL == resumed.nb_evaluations, "Checkpoint of another guess resumed.");
+    read_checkpoint(CHECKS_DIR "/guess.osc", again, &again_score);
+    fail_unless((saved[0] == again[0]) && (saved[1] == again[1]) && (saved_score == again_score),
+		"Checkpoint overwritten by another guess.");
+
+    /* Nor does a corrupted one */
+    f = fopen(CHECKS_DIR "/guess.osc", "r+b");
+    fail_unless(NULL != f, "Unable to open checkpoint.");
+    fseek(f, 20L, SEEK_SET);
+    fputc(~fgetc(f), f);
+    fclose(f);
+    memset(&resumed, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, CHECKS_DIR "/guess.osc", 1, NULL, NULL, &resumed);
+    fail_unless(0UL == resumed.nb_evaluations, "Corrupted checkpoint resumed.");
+    status = os_io_read(CHECKS_DIR "/guess.osc", OS_FLEET_CHECKPOINT_MAGIC, OS_FLEET_CHECKPOINT_VERSION, &ptr, &size, pool);
+    apr_file_remove(CHECKS_DIR "/guess.osc", pool);
+    fail_unless(APR_EINVAL == status, "Corrupted checkpoint overwritten.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_warm)
+{
+    napr_galife_stats_t stats, warm;
+    os_fleet_t *attacker = NULL, *defender = NULL;
+    os_conf_t *conf = NULL;
+    apr_finfo_t finfo;
+    apr_status_t status;
+
+    guess_fleets(&conf, &attacker, &defender);
+    fail_unless(NULL != defender, "Unable to make fleets.");
+    apr_file_remove(CHECKS_DIR "/guess.osw", pool);
+    /* No fleet to start from yet, the best ones are written at the end */
+    memset(&stats, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, NULL, 0, CHECKS_DIR "/guess.osw", NULL, &stats);
+    fail_unless(stats.best_score > 0.0f, "No profitable attacker found.");
+    status = apr_stat(&finfo, CHECKS_DIR "/guess.osw", APR_FINFO_SIZE, pool);
+    fail_unless(APR_SUCCESS == status, "Best fleets not written.");
+
+    /* The best fleets start the next guess, nearly as profitable with other battles */
+    memset(&warm, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.9f * stats.best_score, NULL, 0, CHECKS_DIR "/guess.osw", NULL, &warm);
+    apr_file_remove(CHECKS_DIR "/guess.osw", pool);
+    fail_unless(warm.target_time >= 0, "Guess not started from the best fleets.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_index)
+{
+    napr_galife_stats_t stats, answer;
+    os_fleet_t *attacker = NULL, *defender = NULL;
+    os_conf_t *conf = NULL;
+
+    guess_fleets(&conf, &attacker, &defender);
+    fail_unless(NULL != defender, "Unable to make fleets.");
+    apr_file_remove(CHECKS_DIR "/guess.osi", pool);
+    /* Nothing indexed yet, the genetic algorithm runs and its best fleet is recorded */
+    memset(&stats, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, NULL, 0, NULL, CHECKS_DIR "/guess.osi", &stats);
+    fail_unless(stats.best_score > 0.0f, "No profitable attacker found.");
+
+    /* The same guess is answered by its verification battles only */
+    memset(&answer, 0, sizeof(napr_galife_stats_t));
+    os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 1, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET, 1, 32,
+				  0UL, NULL, 0.0f, NULL, 0, NULL, CHECKS_DIR "/guess.osi", &answer);
+    apr_file_remove(CHECKS_DIR "/guess.osi", pool);
+    apr_file_remove(CHECKS_DIR "/guess.osi.lock", pool);
+    fail_unless(1UL == answer.nb_evaluations, "Guess not answered by the index.");
+    fail_unless(answer.best_score > 0.0f, "Unprofitable answer.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_fleet_find_cheapest_winner_seed)
+{
+    napr_galife_stats_t stats[2];
+    os_fleet_t *attacker = NULL, *defender = NULL;
+    os_conf_t *conf = NULL;
+    const char *warm_file[2] = { CHECKS_DIR "/guess1.osw", CHECKS_DIR "/guess4.osw" };
+    const unsigned char *best[2];
+    apr_size_t size[2];
+    unsigned int nb_cpu[2] = { 1, 4 };
+    apr_status_t status;
+    int i;
+
+    os_fleet_set_seed(42U);
+    for (i = 0; i < 2; i++) {
+	guess_fleets(&conf, &attacker, &defender);
+	fail_unless(NULL != defender, "Unable to make fleets.");
+	apr_file_remove(warm_file[i], pool);
+	/* No timeout, a few generations whatever the time they take; the warm file holds the best fleets */
+	memset(&stats[i], 0, sizeof(napr_galife_stats_t));
+	os_fleet_find_cheapest_winner(attacker, defender, conf, NORMAL, 0, 0, 0, 0, OS_MODE_HUMAN | OS_MODE_QUIET,
+				      nb_cpu[i], 32, 6UL, NULL, 0.0f, NULL, 0, warm_file[i], NULL, &stats[i]);
+	status = os_io_read(warm_file[i], OS_FLEET_WARM_MAGIC, OS_FLEET_WARM_VERSION, &best[i], &size[i], pool);
+	apr_file_remove(warm_file[i], pool);
+	fail_unless(APR_SUCCESS == status, "Best fleets not written.");
+	fail_unless(6UL == stats[i].nb_ages, "Bad number of generations.");
+    }
+
+    fail_unless(stats[0].best_score > 0.0f, "No profitable attacker found.");
+    fail_unless(stats[0].best_score == stats[1].best_score, "Best score depends on the number of threads.");
+    fail_unless(stats[0].nb_evaluations == stats[1].nb_evaluations, "Evaluations depend on the number of threads.");
+    fail_unless((size[0] == size[1]) && (0 == memcmp(best[0], best[1], size[0])),
+		"Best fleets depend on the number of threads.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
 START_TEST(test_os_fleet_distance)
 {
     fail_unless(4695UL == os_fleet_distance("3:432:9", "3:411:12"), "Bad distance to syst.");
@@ -170,10 +566,24 @@ TCase *os_fleet_tcase(void)
 {
     TCase *tc_core = tcase_create("os_fleet_cases");
     tcase_add_checked_fixture(tc_core, setup, teardown);
+    /* Guesses run their generations whatever the time they take */
+    tcase_set_timeout(tc_core, 120);
     tcase_add_test(tc_core, test_os_fleet_make);
     tcase_add_test(tc_core, test_os_fleet_set_conf);
     tcase_add_test(tc_core, test_os_fleet_parse);
     tcase_add_test(tc_core, test_os_fleet_battle);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_islands);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_steady);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_race);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_screen);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_surrogate);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_big_population);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_tournament);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_checkpoint);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_warm);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_index);
+    tcase_add_test(tc_core, test_os_fleet_find_cheapest_winner_seed);
     tcase_add_test(tc_core, test_os_fleet_distance);
     tcase_add_test(tc_core, test_os_fleet_consumption);
 
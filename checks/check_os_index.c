@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <apr_file_io.h>
+
+#include "os_conf.h"
+#include "os_index.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+START_TEST(test_os_index_lookup)
+{
+    os_index_t *index;
+    float signature[OS_INDEX_DIM], near[OS_INDEX_DIM], score = 0.0f;
+    unsigned int solution[ITEM_END], found[ITEM_END];
+    int i;
+
+    index = os_index_make(pool);
+    fail_unless(NULL != index, "Unable to make index.");
+    for (i = 0; i < OS_INDEX_DIM; i++)
+	near[i] = signature[i] = 1000.0f * i;
+    near[0] = 1000.0f;
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = i;
+
+    fail_unless(0 == os_index_lookup(index, 42ULL, signature, 0.05f, found, &score), "Empty index found an entry.");
+    os_index_add(index, 42ULL, signature, solution, 12.5f);
+    fail_unless(1 == os_index_get_nb(index), "Bad number of entries.");
+    fail_unless(1 == os_index_lookup(index, 42ULL, near, 0.05f, found, &score), "Close entry not found.");
+    fail_unless(0 == memcmp(solution, found, ITEM_END * sizeof(unsigned int)), "Bad solution.");
+    fail_unless(12.5f == score, "Bad score.");
+    fail_unless(0 == os_index_lookup(index, 43ULL, signature, 0.05f, found, &score), "Entry of another key found.");
+    near[1] = 1e9f;
+    fail_unless(0 == os_index_lookup(index, 42ULL, near, 0.05f, found, &score), "Far entry found.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_index_write)
+{
+    os_index_t *index, *mapped;
+    float signature[OS_INDEX_DIM], score = 0.0f;
+    unsigned int solution[ITEM_END], found[ITEM_END];
+    struct stat st;
+    apr_status_t status;
+    mode_t mask;
+    int i;
+
+    apr_file_remove(CHECKS_DIR "/index.osi", pool);
+    index = os_index_make(pool);
+    status = os_index_open(index, CHECKS_DIR "/index.osi");
+    fail_unless(APR_SUCCESS == status, "Missing index not empty.");
+    for (i = 0; i < OS_INDEX_DIM; i++)
+	signature[i] = 10.0f * i;
+    /* Keys out of order, they are sorted in the file */
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = 1;
+    os_index_add(index, 7ULL, signature, solution, 1.0f);
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = 3;
+    os_index_add(index, 3ULL, signature, solution, 3.0f);
+    status = os_index_write(index, CHECKS_DIR "/index.osi", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write index.");
+    /* A new file gets the default permissions */
+    mask = umask(0);
+    umask(mask);
+    fail_unless((0 == stat(CHECKS_DIR "/index.osi", &st)) && ((st.st_mode & 0777) == (0666 & ~mask)),
+		"Bad permissions of a new file.");
+
+    mapped = os_index_make(pool);
+    status = os_index_open(mapped, CHECKS_DIR "/index.osi");
+    fail_unless(APR_SUCCESS == status, "Unable to map index.");
+    fail_unless(2 == os_index_get_nb(mapped), "Bad number of entries.");
+    fail_unless(1 == os_index_lookup(mapped, 7ULL, signature, 0.0f, found, &score), "Entry not found.");
+    fail_unless((1 == found[0]) && (1.0f == score), "Bad entry.");
+    fail_unless(1 == os_index_lookup(mapped, 3ULL, signature, 0.0f, found, &score), "Entry not found.");
+    fail_unless((3 == found[0]) && (3.0f == score), "Bad entry.");
+
+    /* The same key and signature replace the entry */
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = 5;
+    os_index_add(mapped, 3ULL, signature, solution, 5.0f);
+    chmod(CHECKS_DIR "/index.osi", 0640);
+    status = os_index_write(mapped, CHECKS_DIR "/index.osi", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write index.");
+    /* A replaced file keeps its permissions */
+    fail_unless((0 == stat(CHECKS_DIR "/index.osi", &st)) && (0640 == (st.st_mode & 0777)),
+		"Permissions of the replaced file lost.");
+    index = os_index_make(pool);
+    status = os_index_open(index, CHECKS_DIR "/index.osi");
+    apr_file_remove(CHECKS_DIR "/index.osi", pool);
+    apr_file_remove(CHECKS_DIR "/index.osi.lock", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to map index.");
+    fail_unless(2 == os_index_get_nb(index), "Entry not replaced.");
+    fail_unless(1 == os_index_lookup(index, 3ULL, signature, 0.0f, found, &score), "Entry not found.");
+    fail_unless((5 == found[0]) && (5.0f == score), "Bad replaced entry.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_index_write_merge)
+{
+    os_index_t *first, *second, *index;
+    float signature[OS_INDEX_DIM], score = 0.0f;
+    unsigned int solution[ITEM_END], found[ITEM_END];
+    apr_status_t status;
+    int i;
+
+    /* Both guesses open the index before any of them writes */
+    apr_file_remove(CHECKS_DIR "/merge.osi", pool);
+    first = os_index_make(pool);
+    second = os_index_make(pool);
+    fail_unless(APR_SUCCESS == os_index_open(first, CHECKS_DIR "/merge.osi"), "Missing index not empty.");
+    fail_unless(APR_SUCCESS == os_index_open(second, CHECKS_DIR "/merge.osi"), "Missing index not empty.");
+    for (i = 0; i < OS_INDEX_DIM; i++)
+	signature[i] = 10.0f * i;
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = 1;
+    os_index_add(first, 1ULL, signature, solution, 1.0f);
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = 2;
+    os_index_add(second, 2ULL, signature, solution, 2.0f);
+    status = os_index_write(first, CHECKS_DIR "/merge.osi", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write index.");
+    status = os_index_write(second, CHECKS_DIR "/merge.osi", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write index.");
+
+    index = os_index_make(pool);
+    status = os_index_open(index, CHECKS_DIR "/merge.osi");
+    apr_file_remove(CHECKS_DIR "/merge.osi", pool);
+    apr_file_remove(CHECKS_DIR "/merge.osi.lock", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to map index.");
+    fail_unless(2 == os_index_get_nb(index), "Entry of the first writer lost.");
+    fail_unless(1 == os_index_lookup(index, 1ULL, signature, 0.0f, found, &score), "Entry not found.");
+    fail_unless((1 == found[0]) && (1.0f == score), "Bad entry.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_index_write_corrupt)
+{
+    os_index_t *index;
+    float signature[OS_INDEX_DIM], score = 0.0f;
+    unsigned int solution[ITEM_END], found[ITEM_END];
+    apr_finfo_t finfo;
+    apr_status_t status;
+    FILE *f;
+    int i;
+
+    f = fopen(CHECKS_DIR "/corrupt.osi", "w");
+    fail_unless(NULL != f, "Unable to write corrupt.osi.");
+    fprintf(f, "not an index, but someone's work");
+    fclose(f);
+
+    index = os_index_make(pool);
+    for (i = 0; i < OS_INDEX_DIM; i++)
+	signature[i] = 10.0f * i;
+    for (i = 0; i < ITEM_END; i++)
+	solution[i] = 1;
+    os_index_add(index, 1ULL, signature, solution, 1.0f);
+    status = os_index_write(index, CHECKS_DIR "/corrupt.osi", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write index.");
+
+    /* The corrupted file is kept aside */
+    status = apr_stat(&finfo, CHECKS_DIR "/corrupt.osi.corrupt", APR_FINFO_SIZE, pool);
+    fail_unless((APR_SUCCESS == status) && (32 == finfo.size), "Corrupted index not moved aside.");
+    index = os_index_make(pool);
+    status = os_index_open(index, CHECKS_DIR "/corrupt.osi");
+    apr_file_remove(CHECKS_DIR "/corrupt.osi", pool);
+    apr_file_remove(CHECKS_DIR "/corrupt.osi.corrupt", pool);
+    apr_file_remove(CHECKS_DIR "/corrupt.osi.lock", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to map index.");
+    fail_unless(1 == os_index_get_nb(index), "Bad number of entries.");
+    fail_unless(1 == os_index_lookup(index, 1ULL, signature, 0.0f, found, &score), "Entry not found.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *os_index_tcase(void)
+{
+    TCase *tc_core = tcase_create("os_index_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_os_index_lookup);
+    tcase_add_test(tc_core, test_os_index_write);
+    tcase_add_test(tc_core, test_os_index_write_merge);
+    tcase_add_test(tc_core, test_os_index_write_corrupt);
+
+    return tc_core;
+}
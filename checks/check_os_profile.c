@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_profile.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+static os_fleet_t *check_os_profile_fleet(os_conf_t *conf, enum Fleet_enum type, const char *csv)
+{
+    os_fleet_t *fleet;
+    apr_status_t status;
+
+    fleet = os_fleet_make(pool, type);
+    fail_unless(NULL != fleet, "Unable to make fleet.");
+    status = os_fleet_set_conf(fleet, csv);
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(fleet, conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+
+    return fleet;
+}
+START_TEST(test_os_profile_battle)
+{
+    os_fleet_t *attacker, *defender;
+    os_conf_t *conf;
+    os_result_t *result;
+    apr_uint64_t nb_round = 0;
+    apr_status_t status;
+    unsigned char i;
+
+    conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != conf, "Unable to load conf.");
+    attacker = check_os_profile_fleet(conf, ATK_FLT, "15,15,14,15,13,10,[3:432:9],0,100,1000,0,0,0,0,0,0,0,0,0,0");
+    defender = check_os_profile_fleet(conf, DEF_FLT, "11,11,11,[3:412:7],200000,100000,90000,10,0,0,0,0,0,0,0,0,0,0");
+
+    os_profile_enable();
+    result = os_result_make(pool);
+    status = os_fleet_battle_shard(attacker, defender, 10UL, 0, 1, conf, result);
+    os_profile_enabled = 0;
+    fail_unless(APR_SUCCESS == status, "Unable to simulate battle.");
+    for (i = 0; i <= MAX_ROUND_NUMBER; i++)
+	nb_round += i * os_result_get_nb_round(result, i);
+
+    fail_unless(10 == os_profile_calls[PRF_MISSILE], "Bad number of missile phases.");
+    fail_unless(10 == os_profile_calls[PRF_STATS], "Bad number of stats phases.");
+    fail_unless(nb_round == os_profile_calls[PRF_SHIELD], "Bad number of shield phases.");
+    fail_unless(nb_round == os_profile_calls[PRF_SHOOT], "Bad number of shoot phases.");
+    fail_unless(nb_round == os_profile_calls[PRF_COMPACTION], "Bad number of compaction phases.");
+    fail_unless(0 != os_profile_ns[PRF_SHOOT], "Shoot phase not timed.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *os_profile_tcase(void)
+{
+    TCase *tc_core = tcase_create("os_profile_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_os_profile_battle);
+
+    return tc_core;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <apr_file_io.h>
+
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_result.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+static void check_os_result_fleets(os_fleet_t **attacker, os_fleet_t **defender, os_conf_t **conf)
+{
+    apr_status_t status;
+
+    *conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != *conf, "Unable to load conf.");
+
+    *attacker = os_fleet_make(pool, ATK_FLT);
+    fail_unless(NULL != *attacker, "Unable to make fleet.");
+    status = os_fleet_set_conf(*attacker, "15,15,14,15,13,10,[3:432:9],0,0,110,38,11,11,0,0,0,0,0,5,0");
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(*attacker, *conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+
+    *defender = os_fleet_make(pool, DEF_FLT);
+    fail_unless(NULL != *defender, "Unable to make fleet.");
+    status =
+	os_fleet_set_conf(*defender, "11,11,11,[3:412:7],200000,100000,90000,21,44,4,3,7,4,0,0,8,0,11,2,0,80,20,7,2,9,5,1,1");
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(*defender, *conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+}
+
+START_TEST(test_os_result_make)
+{
+    os_result_t *result;
+
+    result = os_result_make(pool);
+    fail_unless(NULL != result, "Unable to make result.");
+    fail_unless(0ULL == os_result_get_nb_simu(result), "New result is not empty.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_result_shard)
+{
+    os_fleet_t *attacker, *defender;
+    os_conf_t *conf;
+    os_result_t *result, *shard;
+    apr_uint64_t nb_round;
+    apr_status_t status;
+    unsigned int i;
+    unsigned char j;
+
+    check_os_result_fleets(&attacker, &defender, &conf);
+
+    result = os_result_make(pool);
+    for (i = 0; i < 3; i++) {
+	shard = os_result_make(pool);
+	status = os_fleet_battle_shard(attacker, defender, 10UL, i, 3, conf, shard);
+	fail_unless(APR_SUCCESS == status, "Unable to run shard.");
+	fail_unless(((0 == i) ? 4ULL : 3ULL) == os_result_get_nb_simu(shard), "Bad share of simulations.");
+	status = os_result_merge(result, shard);
+	fail_unless(APR_SUCCESS == status, "Unable to merge shard.");
+    }
+    fail_unless(10ULL == os_result_get_nb_simu(result), "Merged result doesn't contain all simulations.");
+    for (j = 0, nb_round = 0ULL; j <= MAX_ROUND_NUMBER; j++)
+	nb_round += os_result_get_nb_round(result, j);
+    fail_unless(10ULL == nb_round, "Rounds histogram doesn't contain all simulations.");
+
+    status = os_fleet_battle_shard(attacker, defender, 10UL, 3, 3, conf, shard);
+    fail_unless(APR_SUCCESS != status, "Invalid shard accepted.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_result_write_read)
+{
+    os_fleet_t *attacker, *defender;
+    os_conf_t *conf;
+    os_result_t *result, *reread;
+    apr_status_t status;
+    unsigned char j;
+
+    check_os_result_fleets(&attacker, &defender, &conf);
+
+    result = os_result_make(pool);
+    status = os_fleet_battle_shard(attacker, defender, 20UL, 1, 2, conf, result);
+    fail_unless(APR_SUCCESS == status, "Unable to run shard.");
+
+    status = os_result_write(result, CHECKS_DIR "/partial.osr", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write partial result.");
+    status = os_result_read(&reread, CHECKS_DIR "/partial.osr", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to read partial result.");
+    apr_file_remove(CHECKS_DIR "/partial.osr", pool);
+
+    fail_unless(os_result_get_nb_simu(result) == os_result_get_nb_simu(reread), "Bad number of simulations.");
+    for (j = 0; j <= MAX_ROUND_NUMBER; j++)
+	fail_unless(os_result_get_nb_round(result, j) == os_result_get_nb_round(reread, j), "Bad rounds histogram.");
+
+    /* A result of another matchup can't be merged */
+    result = os_result_make(pool);
+    os_fleet_set_conf(defender, "11,11,11,[3:412:7],0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+    status = os_fleet_parse(defender, conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+    status = os_fleet_battle_shard(attacker, defender, 5UL, 0, 1, conf, result);
+    fail_unless(APR_SUCCESS == status, "Unable to run shard.");
+    status = os_result_merge(result, reread);
+    fail_unless(APR_SUCCESS != status, "Results of different matchups merged.");
+
+    status = os_result_read(&reread, CHECKS_DIR "/check_os_result.c", pool);
+    fail_unless(APR_SUCCESS != status, "A source file has been read as a partial result.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *os_result_tcase(void)
+{
+    TCase *tc_core = tcase_create("os_result_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_os_result_make);
+    tcase_add_test(tc_core, test_os_result_shard);
+    tcase_add_test(tc_core, test_os_result_write_read);
+
+    return tc_core;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <apr_file_io.h>
+
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_sample.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+static os_fleet_t *check_os_sample_fleet(os_conf_t *conf, enum Fleet_enum type, const char *csv)
+{
+    os_fleet_t *fleet;
+    apr_status_t status;
+
+    fleet = os_fleet_make(pool, type);
+    fail_unless(NULL != fleet, "Unable to make fleet.");
+    status = os_fleet_set_conf(fleet, csv);
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(fleet, conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+
+    return fleet;
+}
+
+START_TEST(test_os_sample_add)
+{
+    os_sample_t *sample;
+    unsigned int atk[ITEM_END], def[ITEM_END];
+    unsigned int i;
+
+    sample = os_sample_make(pool);
+    fail_unless(NULL != sample, "Unable to make sample.");
+    fail_unless(0 == os_sample_get_nb(sample), "New sample is not empty.");
+
+    memset(def, 0, ITEM_END * sizeof(unsigned int));
+    for (i = 0; i < 100; i++) {
+	memset(atk, 0, ITEM_END * sizeof(unsigned int));
+	atk[CLE] = i;
+	os_sample_add(sample, i % MAX_ROUND_NUMBER, atk, def);
+    }
+    fail_unless(100 == os_sample_get_nb(sample), "Bad number of samples.");
+    for (i = 0; i < 100; i++) {
+	fail_unless(i == os_sample_get_atk_repartitions(sample)[i * ITEM_END + CLE], "Bad sample %u.", i);
+	fail_unless((i % MAX_ROUND_NUMBER) == os_sample_get_nb_round(sample, i), "Bad rounds of sample %u.", i);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_sample_rescore)
+{
+    os_fleet_t *attacker, *defender;
+    os_conf_t *conf;
+    os_sample_t *sample, *reread;
+    apr_status_t status;
+
+    conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != conf, "Unable to load conf.");
+    attacker = check_os_sample_fleet(conf, ATK_FLT, "15,15,14,15,13,10,[3:432:9],0,100,1000,0,0,0,0,0,0,0,0,0,0");
+    defender = check_os_sample_fleet(conf, DEF_FLT, "11,11,11,[3:412:7],200000,100000,90000,10,0,0,0,0,0,0,0,0,0,0");
+
+    sample = os_sample_make(pool);
+    status = os_fleet_battle_sample(attacker, defender, 10UL, conf, sample);
+    fail_unless(APR_SUCCESS == status, "Unable to sample battle.");
+    fail_unless(10 == os_sample_get_nb(sample), "Bad number of samples.");
+
+    status = os_sample_write(sample, CHECKS_DIR "/samples.oss", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to write samples.");
+    status = os_sample_read(&reread, CHECKS_DIR "/samples.oss", pool);
+    fail_unless(APR_SUCCESS == status, "Unable to read samples.");
+    apr_file_remove(CHECKS_DIR "/samples.oss", pool);
+    fail_unless(os_sample_get_matchup(sample) == os_sample_get_matchup(reread), "Bad matchup.");
+    fail_unless(0 ==
+		memcmp(os_sample_get_atk_repartitions(sample), os_sample_get_atk_repartitions(reread),
+		       10 * ITEM_END * sizeof(unsigned int)), "Bad attacker samples.");
+    fail_unless(0 ==
+		memcmp(os_sample_get_def_repartitions(sample), os_sample_get_def_repartitions(reread),
+		       10 * ITEM_END * sizeof(unsigned int)), "Bad defender samples.");
+
+    /* Resources of the defender can change, the samples still belong to the battle */
+    defender = check_os_sample_fleet(conf, DEF_FLT, "11,11,11,[3:412:7],500000,0,0,10,0,0,0,0,0,0,0,0,0,0");
+    os_fleet_to_guess(attacker);
+    status = os_fleet_rescore(attacker, defender, conf, reread, 0, 0, OS_MODE_HUMAN | OS_MODE_NO_RECYCLING);
+    fail_unless(APR_SUCCESS == status, "Unable to rescore samples.");
+
+    /* But not its ships */
+    defender = check_os_sample_fleet(conf, DEF_FLT, "11,11,11,[3:412:7],500000,0,0,11,0,0,0,0,0,0,0,0,0,0");
+    status = os_fleet_rescore(attacker, defender, conf, reread, 0, 0, OS_MODE_HUMAN);
+    fail_unless(APR_SUCCESS != status, "Samples of another battle rescored.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_sample_seed)
+{
+    os_fleet_t *attacker, *defender;
+    os_conf_t *conf;
+    os_sample_t *sample[3];
+    unsigned int i;
+    apr_status_t status;
+
+    conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != conf, "Unable to load conf.");
+    attacker = check_os_sample_fleet(conf, ATK_FLT, "15,15,14,15,13,10,[3:432:9],0,100,1000,200,0,0,0,0,0,0,0,0,0");
+    defender = check_os_sample_fleet(conf, DEF_FLT, "11,11,11,[3:412:7],200000,100000,90000,10,0,300,100,0,0,0,0,0,0,0");
+
+    /* Same seed, same battles, another seed gives other ones */
+    for (i = 0; i < 3; i++) {
+	os_fleet_set_seed((2 == i) ? 43U : 42U);
+	sample[i] = os_sample_make(pool);
+	status = os_fleet_battle_sample(attacker, defender, 20UL, conf, sample[i]);
+	fail_unless(APR_SUCCESS == status, "Unable to sample battle.");
+    }
+    fail_unless(0 ==
+		memcmp(os_sample_get_atk_repartitions(sample[0]), os_sample_get_atk_repartitions(sample[1]),
+		       20 * ITEM_END * sizeof(unsigned int)), "Seeded attacker samples differ.");
+    fail_unless(0 ==
+		memcmp(os_sample_get_def_repartitions(sample[0]), os_sample_get_def_repartitions(sample[1]),
+		       20 * ITEM_END * sizeof(unsigned int)), "Seeded defender samples differ.");
+    fail_unless(0 !=
+		memcmp(os_sample_get_atk_repartitions(sample[0]), os_sample_get_atk_repartitions(sample[2]),
+		       20 * ITEM_END * sizeof(unsigned int)), "Another seed gives the same samples.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *os_sample_tcase(void)
+{
+    TCase *tc_core = tcase_create("os_sample_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_os_sample_add);
+    tcase_add_test(tc_core, test_os_sample_rescore);
+    tcase_add_test(tc_core, test_os_sample_seed);
+
+    return tc_core;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <apr_strings.h>
+
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_stat.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+/* Outcomes of each engine per matchup, and family-wise false alarm rate of the equivalence checks */
+#define CHECK_OS_STAT_NB_SIMU 1000
+#define CHECK_OS_STAT_NB_MATCHUP 12
+#define CHECK_OS_STAT_ALPHA 1e-4
+
+static unsigned int check_os_stat_rand(unsigned int *state, unsigned int limit)
+{
+    *state = *state * 1103515245U + 12345U;
+
+    return (*state >> 16) % limit;
+}
+
+static os_fleet_t *check_os_stat_fleet(os_conf_t *conf, enum Fleet_enum type, unsigned char techno,
+				       const unsigned int *repartition)
+{
+    os_fleet_t *fleet;
+    char *csv;
+    apr_status_t status;
+    int i;
+
+    if (ATK_FLT == type)
+	csv = apr_psprintf(pool, "%u,%u,%u,13,10,8,[1:1:1]", techno, techno, techno);
+    else
+	csv = apr_psprintf(pool, "%u,%u,%u,[1:1:2],0,0,0", techno, techno, techno);
+    for (i = 0; i < ITEM_END; i++)
+	csv = apr_psprintf(pool, "%s,%u", csv, repartition[i]);
+    if (DEF_FLT == type)
+	csv = apr_pstrcat(pool, csv, ",0", NULL);
+
+    fleet = os_fleet_make(pool, type);
+    fail_unless(NULL != fleet, "Unable to make fleet.");
+    status = os_fleet_set_conf(fleet, csv);
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet %s.", csv);
+    status = os_fleet_parse(fleet, conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration %s.", csv);
+
+    return fleet;
+}
+
+static unsigned int check_os_stat_outcome(const unsigned int *atk, const unsigned int *def)
+{
+    unsigned int i, atk_alive = 0, def_alive = 0;
+
+    for (i = 0; i < LM; i++)
+	atk_alive += atk[i];
+    for (i = 0; i < ITEM_END; i++)
+	def_alive += def[i];
+
+    if (atk_alive && !def_alive)
+	return 0;
+    else if (!atk_alive && def_alive)
+	return 2;
+
+    return 1;
+}
+
+static void check_os_stat_min_pvalue(double pvalue, double *min_pvalue, unsigned int *nb_tests)
+{
+    (*nb_tests)++;
+    if (pvalue < *min_pvalue)
+	*min_pvalue = pvalue;
+}
+
+/*
+ * Compare wins, rounds, survivors of each type and losses (value of the
+ * survivors, initial fleets being the same) of two samples.
+ */
+static double check_os_stat_compare(const os_sample_t *ref, const os_sample_t *cand, const os_conf_t *conf,
+				    unsigned int *nb_tests)
+{
+    apr_uint64_t ref_hist[MAX_ROUND_NUMBER + 1], cand_hist[MAX_ROUND_NUMBER + 1];
+    const unsigned int *ref_rep[2], *cand_rep[2];
+    double *ref_val, *cand_val;
+    double min_pvalue = 1.0;
+    apr_size_t nb_ref, nb_cand, k;
+    unsigned int side, i, varies;
+
+    nb_ref = os_sample_get_nb(ref);
+    nb_cand = os_sample_get_nb(cand);
+    ref_rep[0] = os_sample_get_atk_repartitions(ref);
+    ref_rep[1] = os_sample_get_def_repartitions(ref);
+    cand_rep[0] = os_sample_get_atk_repartitions(cand);
+    cand_rep[1] = os_sample_get_def_repartitions(cand);
+    ref_val = apr_palloc(pool, nb_ref * sizeof(double));
+    cand_val = apr_palloc(pool, nb_cand * sizeof(double));
+
+    memset(ref_hist, 0, sizeof(ref_hist));
+    memset(cand_hist, 0, sizeof(cand_hist));
+    for (k = 0; k < nb_ref; k++)
+	ref_hist[check_os_stat_outcome(ref_rep[0] + k * ITEM_END, ref_rep[1] + k * ITEM_END)]++;
+    for (k = 0; k < nb_cand; k++)
+	cand_hist[check_os_stat_outcome(cand_rep[0] + k * ITEM_END, cand_rep[1] + k * ITEM_END)]++;
+    check_os_stat_min_pvalue(os_stat_chi2_homogeneity(ref_hist, cand_hist, 3), &min_pvalue, nb_tests);
+
+    memset(ref_hist, 0, sizeof(ref_hist));
+    memset(cand_hist, 0, sizeof(cand_hist));
+    for (k = 0; k < nb_ref; k++)
+	ref_hist[os_sample_get_nb_round(ref, k)]++;
+    for (k = 0; k < nb_cand; k++)
+	cand_hist[os_sample_get_nb_round(cand, k)]++;
+    check_os_stat_min_pvalue(os_stat_chi2_homogeneity(ref_hist, cand_hist, MAX_ROUND_NUMBER + 1), &min_pvalue,
+			     nb_tests);
+
+    for (side = 0; side < 2; side++) {
+	for (i = 0; i < ITEM_END; i++) {
+	    for (k = 0, varies = 0; k < nb_ref; k++) {
+		ref_val[k] = ref_rep[side][k * ITEM_END + i];
+		varies |= (ref_val[k] != ref_val[0]);
+	    }
+	    for (k = 0; k < nb_cand; k++) {
+		cand_val[k] = cand_rep[side][k * ITEM_END + i];
+		varies |= (cand_val[k] != ref_val[0]);
+	    }
+	    if (varies)
+		check_os_stat_min_pvalue(os_stat_ks_2samp(ref_val, nb_ref, cand_val, nb_cand), &min_pvalue, nb_tests);
+	}
+
+	for (k = 0; k < nb_ref; k++)
+	    for (i = 0, ref_val[k] = 0.0; i < ITEM_END; i++)
+		ref_val[k] += ref_rep[side][k * ITEM_END + i] * os_conf_get_ship_price(conf, i);
+	for (k = 0; k < nb_cand; k++)
+	    for (i = 0, cand_val[k] = 0.0; i < ITEM_END; i++)
+		cand_val[k] += cand_rep[side][k * ITEM_END + i] * os_conf_get_ship_price(conf, i);
+	check_os_stat_min_pvalue(os_stat_ks_2samp(ref_val, nb_ref, cand_val, nb_cand), &min_pvalue, nb_tests);
+    }
+
+    return min_pvalue;
+}
+
+START_TEST(test_os_stat_chi2)
+{
+    apr_uint64_t a[4] = { 100, 200, 300, 400 }, b[4] = { 50, 100, 150, 200 }, c[4] = { 400, 300, 200, 100 };
+
+    fail_unless(fabs(os_stat_chi2_pvalue(3.841459, 1) - 0.05) < 1e-5, "Bad chi2 p-value with 1 df.");
+    fail_unless(fabs(os_stat_chi2_pvalue(18.307038, 10) - 0.05) < 1e-5, "Bad chi2 p-value with 10 df.");
+    fail_unless(fabs(os_stat_chi2_pvalue(0.0, 3) - 1.0) < 1e-9, "Bad chi2 p-value of 0.");
+    fail_unless(fabs(os_stat_chi2_homogeneity(a, b, 4) - 1.0) < 1e-9, "Proportional histograms differ.");
+    fail_unless(os_stat_chi2_homogeneity(a, c, 4) < 1e-6, "Opposite histograms don't differ.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_stat_ks)
+{
+    double a[200], b[200];
+    unsigned int state = 42, i;
+
+    for (i = 0; i < 200; i++) {
+	a[i] = check_os_stat_rand(&state, 1000);
+	b[i] = a[i];
+    }
+    fail_unless(fabs(os_stat_ks_2samp(a, 200, b, 200) - 1.0) < 1e-9, "Same samples differ.");
+
+    for (i = 0; i < 200; i++)
+	b[i] = check_os_stat_rand(&state, 1000) + 300.0;
+    fail_unless(os_stat_ks_2samp(a, 200, b, 200) < 1e-6, "Shifted samples don't differ.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_stat_engine_equivalence)
+{
+    static const enum Item_enum atk_items[] = { CLE, CLO, CR, VB, BB, DEST };
+    static const enum Item_enum def_items[] = { CLE, CR, VB, LM, ALLE, ALLO, CG, AAI, LP };
+    unsigned int atk[ITEM_END], def[ITEM_END];
+    os_fleet_t *attacker, *defender;
+    os_sample_t *ref, *cand;
+    os_conf_t *conf;
+    double pvalue[CHECK_OS_STAT_NB_MATCHUP];
+    unsigned int state = 1977, nb_tests = 0, m, i;
+    apr_status_t status;
+
+    conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != conf, "Unable to load conf.");
+
+    for (m = 0; m < CHECK_OS_STAT_NB_MATCHUP; m++) {
+	memset(atk, 0, sizeof(atk));
+	memset(def, 0, sizeof(def));
+	for (i = 0; i < 3; i++) {
+	    atk[atk_items[check_os_stat_rand(&state, sizeof(atk_items) / sizeof(atk_items[0]))]] +=
+		5 + check_os_stat_rand(&state, 60);
+	    def[def_items[check_os_stat_rand(&state, sizeof(def_items) / sizeof(def_items[0]))]] +=
+		5 + check_os_stat_rand(&state, 150);
+	}
+	attacker = check_os_stat_fleet(conf, ATK_FLT, 8 + check_os_stat_rand(&state, 8), atk);
+	defender = check_os_stat_fleet(conf, DEF_FLT, 8 + check_os_stat_rand(&state, 8), def);
+
+	ref = os_sample_make(pool);
+	status = os_fleet_reference_battle_sample(attacker, defender, CHECK_OS_STAT_NB_SIMU, 0x5eed, conf, ref);
+	fail_unless(APR_SUCCESS == status, "Unable to sample reference engine.");
+	cand = os_sample_make(pool);
+	status = os_fleet_battle_sample(attacker, defender, CHECK_OS_STAT_NB_SIMU, conf, cand);
+	fail_unless(APR_SUCCESS == status, "Unable to sample engine.");
+
+	pvalue[m] = check_os_stat_compare(ref, cand, conf, &nb_tests);
+    }
+
+    /* Bonferroni correction over every test of every matchup */
+    for (m = 0; m < CHECK_OS_STAT_NB_MATCHUP; m++)
+	fail_unless(pvalue[m] >= CHECK_OS_STAT_ALPHA / nb_tests,
+		    "Engine diverges from the reference on matchup %u (p-value %g, %u tests).", m, pvalue[m], nb_tests);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+START_TEST(test_os_stat_engine_divergence)
+{
+    unsigned int atk[ITEM_END], def[ITEM_END];
+    os_fleet_t *attacker, *defender, *stronger;
+    os_sample_t *ref, *cand;
+    os_conf_t *conf;
+    unsigned int nb_tests = 0;
+    apr_status_t status;
+
+    conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != conf, "Unable to load conf.");
+
+    /* A defender with 10% more units must be told apart */
+    memset(atk, 0, sizeof(atk));
+    memset(def, 0, sizeof(def));
+    atk[CR] = 50;
+    def[ALLE] = 200;
+    attacker = check_os_stat_fleet(conf, ATK_FLT, 10, atk);
+    defender = check_os_stat_fleet(conf, DEF_FLT, 10, def);
+    def[ALLE] = 220;
+    stronger = check_os_stat_fleet(conf, DEF_FLT, 10, def);
+
+    ref = os_sample_make(pool);
+    status = os_fleet_reference_battle_sample(attacker, defender, CHECK_OS_STAT_NB_SIMU, 0x5eed, conf, ref);
+    fail_unless(APR_SUCCESS == status, "Unable to sample reference engine.");
+    cand = os_sample_make(pool);
+    status = os_fleet_battle_sample(attacker, stronger, CHECK_OS_STAT_NB_SIMU, conf, cand);
+    fail_unless(APR_SUCCESS == status, "Unable to sample engine.");
+
+    fail_unless(check_os_stat_compare(ref, cand, conf, &nb_tests) < CHECK_OS_STAT_ALPHA / nb_tests,
+		"Divergence not detected.");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *os_stat_tcase(void)
+{
+    TCase *tc_core = tcase_create("os_stat_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    /* Each engine runs some thousands of battles */
+    tcase_set_timeout(tc_core, 120);
+    tcase_add_test(tc_core, test_os_stat_chi2);
+    tcase_add_test(tc_core, test_os_stat_ks);
+    tcase_add_test(tc_core, test_os_stat_engine_equivalence);
+    tcase_add_test(tc_core, test_os_stat_engine_divergence);
+
+    return tc_core;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_telemetry.h"
+
+apr_pool_t *pool;
+
+static void setup(void)
+{
+    apr_status_t rs;
+
+    rs = apr_pool_create(&pool, NULL);
+    if (rs != APR_SUCCESS) {
+	printf("Error creating pool\n");
+	exit(1);
+    }
+}
+
+static void teardown(void)
+{
+    apr_pool_destroy(pool);
+}
+
+static os_fleet_t *check_os_telemetry_fleet(os_conf_t *conf, enum Fleet_enum type, const char *csv)
+{
+    os_fleet_t *fleet;
+    apr_status_t status;
+
+    fleet = os_fleet_make(pool, type);
+    fail_unless(NULL != fleet, "Unable to make fleet.");
+    status = os_fleet_set_conf(fleet, csv);
+    fail_unless(APR_SUCCESS == status, "Unable to configure fleet.");
+    status = os_fleet_parse(fleet, conf);
+    fail_unless(APR_SUCCESS == status, "Unable to parse fleet configuration.");
+
+    return fleet;
+}
+START_TEST(test_os_telemetry_battle)
+{
+    os_fleet_t *attacker, *defender;
+    os_conf_t *conf;
+    os_sample_t *sample;
+    os_telemetry_t total;
+    apr_uint64_t nb_round = 0, nb_chain = 0;
+    apr_status_t status;
+    unsigned int i;
+
+    conf = os_conf_make(pool, NULL);
+    fail_unless(NULL != conf, "Unable to load conf.");
+    attacker = check_os_telemetry_fleet(conf, ATK_FLT, "15,15,14,15,13,10,[3:432:9],0,100,1000,0,0,0,0,0,0,0,0,0,0");
+    defender = check_os_telemetry_fleet(conf, DEF_FLT, "11,11,11,[3:412:7],200000,100000,90000,10,0,0,0,0,0,0,0,0,0,0");
+
+    status = os_telemetry_enable();
+#ifdef HAVE_TELEMETRY
+    fail_unless(APR_SUCCESS == status, "Unable to enable telemetry.");
+#else
+    fail_unless(APR_ENOTIMPL == status, "Telemetry enabled without being compiled in.");
+#endif
+    os_telemetry_reset();
+
+    sample = os_sample_make(pool);
+    status = os_fleet_battle_sample(attacker, defender, 10UL, conf, sample);
+    fail_unless(APR_SUCCESS == status, "Unable to sample battle.");
+    for (i = 0; i < os_sample_get_nb(sample); i++)
+	nb_round += os_sample_get_nb_round(sample, i);
+
+    os_telemetry_aggregate(&total);
+#ifdef HAVE_TELEMETRY
+    fail_unless(10 == total.counter[TLM_BATTLE], "Bad number of battles.");
+    fail_unless(nb_round == total.counter[TLM_ROUND], "Bad number of rounds.");
+    for (i = 0; i < OS_TELEMETRY_CHAIN_BINS; i++)
+	nb_chain += total.chain[i];
+    fail_unless(nb_chain <= total.counter[TLM_SHOT], "More rapid-fire chains than shots.");
+    fail_unless(total.counter[TLM_BOUNCED_SHOT] <= total.counter[TLM_SHOT], "More bounced shots than shots.");
+    fail_unless(total.counter[TLM_SHIP_COMPACTED] <=
+		total.counter[TLM_EXPLOSION_STRUCTURE] + total.counter[TLM_EXPLOSION_PROBABILISTIC],
+		"More ships compacted than exploded.");
+#else
+    for (i = 0; i < TLM_END; i++)
+	fail_unless(0 == total.counter[i], "Counter %u incremented while compiled out.", i);
+    for (i = 0; i < OS_TELEMETRY_CHAIN_BINS; i++)
+	nb_chain += total.chain[i];
+    fail_unless(0 == nb_chain, "Rapid-fire chains counted while compiled out.");
+#endif
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+TCase *os_telemetry_tcase(void)
+{
+    TCase *tc_core = tcase_create("os_telemetry_cases");
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_os_telemetry_battle);
+
+    return tc_core;
+}
@@ -19,16 +19,32 @@
 #include <apr_pools.h>
 #include <stdio.h>
 
+TCase *napr_cache_tcase(void);
+TCase *napr_galife_tcase(void);
 TCase *os_conf_tcase(void);
 TCase *os_fleet_tcase(void);
+TCase *os_index_tcase(void);
 TCase *os_parse_tcase(void);
+TCase *os_profile_tcase(void);
+TCase *os_result_tcase(void);
+TCase *os_sample_tcase(void);
+TCase *os_stat_tcase(void);
+TCase *os_telemetry_tcase(void);
 
 Suite *osim_suite(void)
 {
     Suite *s = suite_create("osim_suite");
+    suite_add_tcase(s, napr_cache_tcase());
+    suite_add_tcase(s, napr_galife_tcase());
     suite_add_tcase(s, os_conf_tcase());
     suite_add_tcase(s, os_fleet_tcase());
+    suite_add_tcase(s, os_index_tcase());
     suite_add_tcase(s, os_parse_tcase());
+    suite_add_tcase(s, os_profile_tcase());
+    suite_add_tcase(s, os_result_tcase());
+    suite_add_tcase(s, os_sample_tcase());
+    suite_add_tcase(s, os_stat_tcase());
+    suite_add_tcase(s, os_telemetry_tcase());
     return s;
 }
 
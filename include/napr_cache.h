@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NAPR_CACHE_H
+#define NAPR_CACHE_H
+
+#include <apr_pools.h>
+
+/**
+ * A thread safe, size-bounded map of fixed size keys to fixed size values.
+ * Entries are spread over sets of a few ways, the least recently used entry
+ * of a full set is evicted to make room for a new key.
+ * Values can also be deferred, then merged all at once by a commit in an
+ * order that only depends on them: what the cache holds after a commit
+ * doesn't depend on the threads that deferred them, as long as the merge
+ * function is commutative.
+ */
+typedef struct napr_cache_t napr_cache_t;
+
+/**
+ * Combine a new value with the stored one, called with the entry locked.
+ * @param stored The value in the cache, zeroed for a new key.
+ * @param value The new value, it receives the combined value.
+ */
+typedef void (napr_cache_merge_callback_fn_t) (void *stored, void *value);
+
+/**
+ * Allocate a cache.
+ * @param cache The address of a pointer to the opaque structure to allocate.
+ * @param nb_entries The maximum number of entries (rounded up to a power of two).
+ * @param key_size The size of a key.
+ * @param value_size The size of a value.
+ * @param pool The apr_pool_t to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t napr_cache_init(napr_cache_t **cache, unsigned long nb_entries, apr_size_t key_size,
+			     apr_size_t value_size, apr_pool_t *pool);
+
+/**
+ * Copy the value stored for a key, marked as used as of the last merge: the
+ * order of the lookups between two merges doesn't change what gets evicted.
+ * @param cache The opaque cache.
+ * @param key The key (key_size bytes).
+ * @param value The buffer that receives the value (value_size bytes).
+ * @return 1 if the key was found, 0 otherwise.
+ */
+int napr_cache_get(napr_cache_t *cache, const void *key, void *value);
+
+/**
+ * Insert or update the value of a key.
+ * @param cache The opaque cache.
+ * @param key The key (key_size bytes).
+ * @param value The new value, it receives the value stored after the merge.
+ * @param merge The function that combines the new value with the stored one.
+ */
+void napr_cache_merge(napr_cache_t *cache, const void *key, void *value, napr_cache_merge_callback_fn_t *merge);
+
+/**
+ * Log a value to merge on the next commit, it is invisible until then.
+ * @param cache The opaque cache.
+ * @param key The key (key_size bytes).
+ * @param value The value (value_size bytes).
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t napr_cache_defer(napr_cache_t *cache, const void *key, const void *value);
+
+/**
+ * Merge the deferred values, ordered by key then value, and empty the log.
+ * @param cache The opaque cache.
+ * @param merge The function that combines a deferred value with the stored one.
+ */
+void napr_cache_commit(napr_cache_t *cache, napr_cache_merge_callback_fn_t *merge);
+
+/**
+ * Get the number of lookups that found, or not, their key.
+ * @param cache The opaque cache.
+ * @param hits The address of a counter that receives the number of hits.
+ * @param misses The address of a counter that receives the number of misses.
+ */
+void napr_cache_get_stats(napr_cache_t *cache, apr_uint64_t *hits, apr_uint64_t *misses);
+
+#endif /* NAPR_CACHE_H */
@@ -18,28 +18,38 @@
 #define NAPR_GALIFE_H
 
 #include <apr_pools.h>
+#include <apr_time.h>
 
 /* #define DEBUG */
 
 typedef struct napr_galife_t napr_galife_t;
 
+/* Features of a gene the surrogate model can learn from */
+#define NAPR_GALIFE_MAX_FEATURES 32
+
 /**
- * function that allocate a gene for your problem.
+ * function that allocate a gene for your problem, it may be run by several threads at once.
  * @param rec The data passed as the first argument to napr_galife_init.
+ * @param pool The apr_pool_t to allocate from, private to the calling thread.
  * @param chromosome A pointer to a chromosome that will be created.
  */
 typedef void (chrom_allocat_callback_fn_t) (void *rec, apr_pool_t *pool, void **chromosome);
 
 /**
- * function that randomize a gene.
+ * function that randomize a gene, it may be run by several threads at once.
  * @param rec The data passed as the first argument to napr_galife_init.
  * @param chromosome The gene to shuffle.
+ * @param idx The rank of the gene in the initial population, the first ones may be seeded with known genes.
+ * @param seed The rand_r state to draw from, private to the gene.
  */
-typedef void (chrom_randomz_callback_fn_t) (void *rec, void *chromosome);
+typedef void (chrom_randomz_callback_fn_t) (void *rec, void *chromosome, unsigned long idx, unsigned int *seed);
 
 /**
  * The function that will report some useful informations about a chromosome,
- * called for each best.
+ * called for each best. During napr_galife_init and ga_run, if genes can be
+ * copied (chrom_copy of napr_galife_init), it is called by a thread of its
+ * own on a copy: the output is out of the lock of the best, a best replaced
+ * before it was printed is skipped.
  * @param rec The data passed as the first argument to napr_galife_init.
  * @param chromosome The gene to print.
  */
@@ -48,9 +58,19 @@ typedef void (chrom_display_callback_fn_t) (void *rec, const void *chromosome);
 /**
  * Function that will estimate the efficiency of a gene.
  * @param rec The data passed as the first argument to napr_galife_init.
+ * @param worker The private data of the evaluating thread, allocated by chrom_worker (NULL without it).
  * @param chromosome The gene to evaluate.
  */
-typedef float (chrom_fitness_callback_fn_t) (void *rec, void *chromosome);
+typedef float (chrom_fitness_callback_fn_t) (void *rec, void *worker, void *chromosome);
+
+/**
+ * Function that allocates the private data of a thread evaluating genes, it
+ * is kept from one evaluation to the next so that they don't allocate.
+ * @param rec The data passed as the first argument to napr_galife_init.
+ * @param pool The apr_pool_t to allocate from, it lives as long as the genetic algorithm.
+ * @param worker A pointer to the private data that will be created.
+ */
+typedef void (chrom_worker_callback_fn_t) (void *rec, apr_pool_t *pool, void **worker);
 
 /** 
  * Function that will cross two genes into one.
@@ -58,16 +78,100 @@ typedef float (chrom_fitness_callback_fn_t) (void *rec, void *chromosome);
  * @param crossover_p Probability that a crossover occured.
  * @param father One of the parent genes.
  * @param mother The other parent gene overwritten by child.
+ * @param seed The rand_r state to draw from, private to the breeding thread.
  */
-typedef void (chrom_crossvr_callback_fn_t) (void *rec, float crossover_p, const void *father, void *mother);
+typedef void (chrom_crossvr_callback_fn_t) (void *rec, float crossover_p, const void *father, void *mother,
+					    unsigned int *seed);
 
 /**
  * Function that mutate one gene.
  * @param rec The data passed as the first argument to napr_galife_init.
  * @param mutation_p Probability that a mutation occured.
  * @param chromosome The gene to mutate.
+ * @param seed The rand_r state to draw from, private to the breeding thread.
+ */
+typedef void (chrom_mutation_callback_fn_t) (void *rec, float mutation_p, void *chromosome, unsigned int *seed);
+
+/**
+ * Function that refines the evaluation of a gene with more samples, used to
+ * race the children of a generation (see napr_galife_set_race).
+ * @param rec The data passed as the first argument to napr_galife_init.
+ * @param worker The private data of the evaluating thread, as for chrom_fitness.
+ * @param chromosome The gene to evaluate.
+ * @param nb_sample The number of samples the score must at least be based on, those already taken on the
+ * same gene count.
+ * @param threshold The score the gene must be able to reach to be worth its samples, sampling may stop
+ * as soon as the score plus its error falls below it.
+ * @param error Receives the half-width of the confidence interval of the returned score.
+ * @return The score over all the samples taken on the gene, -FLT_MAX if rejected.
+ */
+typedef float (chrom_race_callback_fn_t) (void *rec, void *worker, void *chromosome, unsigned int nb_sample,
+					  float threshold, float *error);
+
+/**
+ * Function that cheaply predicts the score of a gene, to screen the children
+ * before chrom_fitness (see napr_galife_set_estimate).
+ * @param rec The data passed as the first argument to napr_galife_init.
+ * @param chromosome The gene to evaluate.
+ * @return The predicted score, -FLT_MAX if the gene is predicted to be rejected.
+ */
+typedef float (chrom_estimate_callback_fn_t) (void *rec, void *chromosome);
+
+/**
+ * Function that describes a gene by nb_features numbers, the surrogate model
+ * predicts its score as a linear function of them (see napr_galife_set_surrogate).
+ * @param rec The data passed as the first argument to napr_galife_init.
+ * @param chromosome The gene to describe.
+ * @param features The nb_features numbers to fill.
+ */
+typedef void (chrom_features_callback_fn_t) (void *rec, const void *chromosome, float *features);
+
+/**
+ * Function that copies a gene into another one.
+ * @param rec The data passed as the first argument to napr_galife_init.
+ * @param src The gene to copy.
+ * @param dst The gene (allocated by chrom_allocat) overwritten by the copy.
+ */
+typedef void (chrom_copy_callback_fn_t) (void *rec, const void *src, void *dst);
+
+/**
+ * An improvement of the best score, see napr_galife_state_t.
+ */
+typedef struct napr_galife_best_t
+{
+    apr_interval_time_t time;		/* since init */
+    float score;
+} napr_galife_best_t;
+
+/**
+ * What a genetic algorithm worker needs to go on where it stopped, see
+ * napr_galife_set_checkpoint and napr_galife_init. The arrays belong to
+ * the worker, they are only valid during the call of the checkpoint function.
+ */
+typedef struct napr_galife_state_t
+{
+    void **chromosomes;			/* the population, in its order */
+    float *scores;			/* the score of each one of them */
+    unsigned long nb_members;
+    unsigned long nb_ages;
+    unsigned long nb_evaluations;
+    unsigned long nb_dropped;
+    unsigned long nb_screened;
+    apr_interval_time_t run_time;	/* since init */
+    apr_interval_time_t best_time;	/* since init, when the best score was found */
+    napr_galife_best_t *history;	/* each improvement of the best score */
+    unsigned long nb_history;
+    float best_score;
+    unsigned int seed;			/* rand_r state of the thread running ga_run */
+} napr_galife_state_t;
+
+/**
+ * Function that saves the state of a genetic algorithm worker.
+ * @param rec The data passed as the first argument to napr_galife_init.
+ * @param state The state to save.
+ * @return APR_SUCCESS if no error occured, the run goes on anyway.
  */
-typedef void (chrom_mutation_callback_fn_t) (void *rec, float mutation_p, void *chromosome);
+typedef apr_status_t (galife_checkpoint_callback_fn_t) (void *rec, const napr_galife_state_t *state);
 
 /** 
  * Allocate and initialize a genetic algorithm worker.
@@ -76,28 +180,234 @@ typedef void (chrom_mutation_callback_fn_t) (void *rec, float mutation_p, void *
  * @param inactivity_timeout Maximum time (in seconds) to wait a best individual, if no best has been found, stop the generation.
  * @param fixed_timeout Maximum time to process.
  * @param nb_cpu The number of threads that will be running, ideally should be equal to number of CPU.
+ * @param seed The seed of the random numbers: with the same one, whatever nb_cpu, the generations breed the
+ * same children, the scores are accounted in the order of the population whichever thread evaluated them.
+ * Islands and steady state depend on the timing of their threads.
  * @param rec The data to pass as the first argument to the chromosome function.
  * @param chrom_allocat The function to run in order to allocate a chromosome.
  * @param chrom_randomz The function to run in order to randomize a chromosome.
- * @param chrom_display The function that will print on stderr some useful informations about a chromosome.
+ * @param chrom_display The function that will print on stderr some useful informations about a chromosome, NULL to keep quiet.
  * @param fitness Function that will estimate the efficiency of a gene.
+ * @param chrom_worker The function that allocates the private data of each evaluating thread, NULL if none.
+ * @param chrom_copy The function that copies a gene, NULL if genes can't be copied: the bests are then printed
+ * under a lock, and neither napr_galife_set_surrogate nor napr_galife_keep_best can be used.
  * @param crossover_p Probability that a crossover occured.
  * @param crossover Function that will cross two genes into one.
  * @param mutation_p Probability that a mutation occured.
  * @param mutation Function that mutate one gene.
- * @param ga The genetic algorithm searcher that will be freshly allocated by this function.
+ * @param state A saved state to go on from, NULL to start afresh: its population is copied (extra saved
+ * individuals are left out, missing ones are random), the counters, random numbers and timeouts go on
+ * from the saved ones. It needs chrom_copy.
+ * @param ga The genetic algorithm searcher that will be freshly allocated by this function, it is set
+ * before any callback is run: chrom_fitness may thus poll napr_galife_is_over.
  * 
- * @return APR_SUCCESS if no error occured.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if state holds no individual or genes can't be copied.
  */
 apr_status_t napr_galife_init(apr_pool_t *pool, unsigned long pop_size, unsigned long max_ages,
-			      unsigned long inactivity_timeout, unsigned long fixed_timeout, unsigned long nb_cpu, void *rec,
-			      chrom_allocat_callback_fn_t *chrom_allocat, chrom_randomz_callback_fn_t *chrom_randomz,
-			      chrom_display_callback_fn_t *chrom_display, chrom_fitness_callback_fn_t *fitness,
-			      float crossover_p, chrom_crossvr_callback_fn_t *crossover, float mutation_p,
-			      chrom_mutation_callback_fn_t *mutation, napr_galife_t **ga);
+			      unsigned long inactivity_timeout, unsigned long fixed_timeout, unsigned long nb_cpu,
+			      unsigned int seed, void *rec, chrom_allocat_callback_fn_t *chrom_allocat,
+			      chrom_randomz_callback_fn_t *chrom_randomz, chrom_display_callback_fn_t *chrom_display,
+			      chrom_fitness_callback_fn_t *fitness, chrom_worker_callback_fn_t *chrom_worker,
+			      chrom_copy_callback_fn_t *chrom_copy, float crossover_p, chrom_crossvr_callback_fn_t *crossover, float mutation_p,
+			      chrom_mutation_callback_fn_t *mutation, const napr_galife_state_t *state, napr_galife_t **ga);
+
+/**
+ * Topology of the migrations between islands.
+ */
+enum napr_galife_topology
+{
+    NAPR_GALIFE_RING = 0x0,	/* island i sends to island i + 1 */
+    NAPR_GALIFE_RANDOM		/* island i sends to any other island */
+};
+
+/**
+ * Knobs of the breeding engine, set with napr_galife_set_tuning.
+ */
+typedef struct napr_galife_tuning_t
+{
+    unsigned long nb_islands;	/* subpopulations bred by their own thread, 1 for a single population */
+    unsigned long migration_interval;	/* generations between two migrations */
+    unsigned long nb_migrants;	/* best individuals sent at each migration */
+    enum napr_galife_topology topology;
+    int steady_state;		/* no generations: each child replaces a loser as soon as it is evaluated */
+    unsigned long tournament_size;	/* individuals drawn to select a parent (or a loser) in steady state */
+    unsigned long race_first_samples;	/* samples given to every child when racing, 0 to disable racing */
+    unsigned long race_max_samples;	/* samples after which a child stops racing */
+    unsigned long screen_percent;	/* screened children evaluated anyway to keep exploring, 100 disables screening */
+    unsigned long surrogate_surplus;	/* extra offspring bred for each child, the surrogate keeps the best one */
+} napr_galife_tuning_t;
+
+/**
+ * Fill a tuning with the default values (a single population).
+ * @param tuning The structure to fill.
+ */
+void napr_galife_tuning_default(napr_galife_tuning_t *tuning);
+
+/**
+ * Change the tuning of a genetic algorithm worker, must be called before ga_run.
+ * By default, the parents of each generation are drawn by the thread running
+ * ga_run, and the children are bred and evaluated by the nb_cpu threads.
+ * With more than one island, the initial population is dealt among islands
+ * and each island breeds (and evaluates) its subpopulation in its own thread,
+ * the nb_cpu threads of napr_galife_init are not used.
+ * In steady state, nb_cpu threads breed and evaluate children one at a time
+ * without waiting for each other: the best of a tournament is crossed into
+ * the worst of another one, which is replaced by the child. Only the
+ * tournaments and the copies of the parents hold the lock of the population.
+ * @param ga The genetic algorithm worker.
+ * @param tuning The tuning to copy.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if the population is too small for that many islands
+ * (or tournaments), or if islands are asked in steady state, or steady state without chrom_copy.
+ */
+apr_status_t napr_galife_set_tuning(napr_galife_t *ga, const napr_galife_tuning_t *tuning);
+
+/**
+ * Race the children of each generation instead of calling chrom_fitness,
+ * must be called before ga_run. Every child first gets race_first_samples
+ * samples, then the children whose score plus error still reaches the median
+ * score of the parents double their samples, until race_max_samples.
+ * Hopeless children are thus ranked after a few samples. In steady state,
+ * a child is given race_max_samples at once with the score of the loser it
+ * replaces as threshold.
+ * @param ga The genetic algorithm worker.
+ * @param chrom_race The function that refines a score, NULL to stop racing.
+ */
+void napr_galife_set_race(napr_galife_t *ga, chrom_race_callback_fn_t *chrom_race);
+
+/**
+ * Screen the children before their evaluation, must be called before ga_run.
+ * A child predicted to be rejected, or to score below the loser it replaces,
+ * is ranked last without evaluation, except screen_percent of them.
+ * @param ga The genetic algorithm worker.
+ * @param chrom_estimate The function that predicts a score, NULL to stop screening.
+ */
+void napr_galife_set_estimate(napr_galife_t *ga, chrom_estimate_callback_fn_t *chrom_estimate);
+
+/**
+ * Learn online a surrogate model of the fitness, must be called before ga_run.
+ * A ridge regression of the scores on the features of every evaluated gene
+ * (the current population included) ranks surrogate_surplus extra offspring
+ * bred for each child: only the one with the best predicted score is kept
+ * and evaluated. The accuracy of the model is checked on a few children
+ * bred without surplus (see napr_galife_get_stats).
+ * @param ga The genetic algorithm worker.
+ * @param chrom_features The function that describes a gene.
+ * @param nb_features The number of features of a gene, at most NAPR_GALIFE_MAX_FEATURES.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if there are too many features or genes can't be copied.
+ */
+apr_status_t napr_galife_set_surrogate(napr_galife_t *ga, chrom_features_callback_fn_t *chrom_features,
+				       unsigned long nb_features);
+
+/**
+ * Predict the score of a gene with the surrogate model learnt so far.
+ * @param ga The genetic algorithm worker.
+ * @param chromosome The gene.
+ * @return The predicted score, -FLT_MAX without a surrogate or before any score was learnt.
+ */
+float napr_galife_predict(napr_galife_t *ga, const void *chromosome);
+
+/**
+ * Save the state of a genetic algorithm worker every interval seconds,
+ * between two generations, and once more when ga_run ends. Islands save
+ * the last copy of each one's population, made between its generations;
+ * steady state saves a copy of its population made between two children,
+ * the children being evaluated are saved as the worst. Fitness caches of the caller are its own business.
+ * @param ga The genetic algorithm worker.
+ * @param interval The minimum time (in seconds) between two saves.
+ * @param checkpoint The function that saves the state.
+ */
+void napr_galife_set_checkpoint(napr_galife_t *ga, unsigned long interval, galife_checkpoint_callback_fn_t *checkpoint);
+
+/**
+ * The function that publishes what the evaluations learned, see napr_galife_set_sync.
+ * @param rec The data passed as the first argument to napr_galife_init.
+ */
+typedef void (galife_sync_callback_fn_t) (void *rec);
+
+/**
+ * Call sync whenever the evaluations of a batch are over: when ga_run starts
+ * (the initial population), after each generation and each rung of its
+ * races, after each child in steady state. A fitness that only reads what
+ * the previous syncs published then gives the same scores whatever the order
+ * of the threads. Islands and steady state threads may call it concurrently.
+ * @param ga The genetic algorithm worker.
+ * @param sync The function to call, NULL if none.
+ */
+void napr_galife_set_sync(napr_galife_t *ga, galife_sync_callback_fn_t *sync);
 
 apr_status_t ga_run(napr_galife_t *ga);
 
+/**
+ * Counters of a genetic algorithm worker, filled by napr_galife_get_stats.
+ */
+typedef struct napr_galife_stats_t
+{
+    unsigned long nb_evaluations;	/* calls of the fitness function */
+    unsigned long nb_ages;		/* generations run */
+    unsigned long nb_dropped;		/* children that stopped racing below their threshold */
+    unsigned long nb_screened;		/* children ranked last without evaluation */
+    unsigned long nb_predicted;		/* holdout children, bred without surplus, whose score was predicted */
+    float surrogate_error;		/* mean absolute error of these predictions */
+    float surrogate_correlation;	/* between these predictions and the evaluations, 0 if undefined */
+    float best_score;
+    apr_interval_time_t best_time;	/* since init, when the best score was found */
+    apr_interval_time_t target_time;	/* since init, when the target score was first reached, -1 if never */
+    apr_interval_time_t run_time;	/* since init */
+} napr_galife_stats_t;
+
+/**
+ * Get the counters of a genetic algorithm worker.
+ * @param ga The genetic algorithm searcher.
+ * @param target_score The score for which target_time is computed.
+ * @param stats The structure to fill.
+ */
+void napr_galife_get_stats(napr_galife_t *ga, float target_score, napr_galife_stats_t *stats);
+
+/**
+ * Get the best individuals of the population, to start another run from them.
+ * @param ga The genetic algorithm searcher.
+ * @param nb The size of the arrays.
+ * @param chromosomes Receives the genes, best first, they belong to the worker.
+ * @param scores Receives their scores.
+ * @return The number of individuals filled, at most nb.
+ */
+unsigned long napr_galife_get_best(napr_galife_t *ga, unsigned long nb, void **chromosomes, float *scores);
+
+/**
+ * Stop a genetic algorithm worker as soon as possible, from any thread: the
+ * children not bred yet stay the losers they were, the ones not evaluated yet
+ * are ranked last, and ga_run returns once the evaluations in progress end.
+ * @param ga The genetic algorithm searcher.
+ */
+void napr_galife_cancel(napr_galife_t *ga);
+
+/**
+ * Tell whether a genetic algorithm worker was cancelled or timeouted. A long
+ * chrom_fitness (or chrom_race) can poll it to give up, returning -FLT_MAX:
+ * the run then stops on time instead of after its pending evaluations.
+ * @param ga The genetic algorithm searcher.
+ * @return 1 if the run is over, 0 otherwise.
+ */
+int napr_galife_is_over(napr_galife_t *ga);
+
+/**
+ * Keep a copy of each new best individual, to read it while ga_run is
+ * running. Must be called before ga_run, from the thread that runs it: the
+ * copy is allocated from the pool of ga.
+ * @param ga The genetic algorithm searcher.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if genes can't be copied.
+ */
+apr_status_t napr_galife_keep_best(napr_galife_t *ga);
+
+/**
+ * Get the best individual found so far, from any thread: a caller with a
+ * deadline can cancel the run and answer at once.
+ * @param ga The genetic algorithm searcher, see napr_galife_keep_best.
+ * @param chromosome Receives a copy of the gene, allocated by the caller.
+ * @return Its score, -FLT_MAX if none was kept (chromosome is then left as is).
+ */
+float napr_galife_get_best_so_far(napr_galife_t *ga, void *chromosome);
+
 /*
  * greetz to Juan who thought about heap for handling GA... and for all !
  */
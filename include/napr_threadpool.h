@@ -23,21 +23,36 @@ typedef struct napr_threadpool_t napr_threadpool_t;
 
 /** 
  * Function that will be processed by a thread from the pool upon a data added to the pool.
- * @param rec The data added via napr_threadpool_add_data
+ * @param ctx The global context passed to napr_threadpool_init.
+ * @param thread_ctx The context of the thread processing the data, NULL without thread_init.
+ * @param data The data added via napr_threadpool_add
  * @return APR_SUCCESS if no error occured.
  */
-typedef apr_status_t (threadpool_process_data_callback_fn_t) (void *ctx, void *data);
+typedef apr_status_t (threadpool_process_data_callback_fn_t) (void *ctx, void *thread_ctx, void *data);
+
+/**
+ * Function that allocates what a thread of the pool keeps from one data to the next.
+ * It is run by napr_threadpool_init, once per thread, before the thread starts.
+ * @param ctx The global context passed to napr_threadpool_init.
+ * @param pool The apr_pool_t to allocate from, destroyed with the threadpool.
+ * @param thread_ctx Receives the context of the thread.
+ * @return APR_SUCCESS if no error occured.
+ */
+typedef apr_status_t (threadpool_thread_init_callback_fn_t) (void *ctx, apr_pool_t *pool, void **thread_ctx);
 
 /** 
  * Initialize a threadpool, it's an engine that keeps n threads running on data processing.
+ * The threads are stopped and joined when pool is destroyed.
  * @param threadpool The addresse of a pointer to the opaque structure to allocate.
  * @param ctx A global context to pass as a first argument to callback function.
  * @param nb_thread The number of thread to allocate to your computation.
+ * @param thread_init A callback that allocates the context of each thread, NULL if threads need none.
  * @param process_data A callback that will be run by a thread on a data added to the pool later.
  * @param pool The apr_pool_t to allocate from.
  * @return APR_SUCCESS if no error occured.
  */
 apr_status_t napr_threadpool_init(napr_threadpool_t **threadpool, void *ctx, unsigned long nb_thread,
+				  threadpool_thread_init_callback_fn_t *thread_init,
 				  threadpool_process_data_callback_fn_t *process_data, apr_pool_t *pool);
 
 /** 
@@ -19,9 +19,27 @@
 
 #include <apr_pools.h>
 
+#include "napr_galife.h"
+#include "os_result.h"
+#include "os_sample.h"
+
 typedef struct os_fleet_t os_fleet_t;
 
 #define MAX_ROUND_NUMBER '\6'
+/* Population of the genetic algorithm when the caller doesn't choose */
+#define GA_DEFAULT_INDIVIDUALS 256U
+/* Generations of the genetic algorithm when the caller doesn't choose, its timeouts stop it first */
+#define GA_DEFAULT_AGES 100000UL
+/* Time (in seconds) between two checkpoints of the genetic algorithm */
+#define GA_CHECKPOINT_INTERVAL 60U
+/* Magic and version of the binary checkpoint file of the genetic algorithm, bump it on any layout change */
+#define OS_FLEET_CHECKPOINT_MAGIC "OSIMGAC"
+#define OS_FLEET_CHECKPOINT_VERSION 1
+/* Best distinct fleets written at the end of the genetic algorithm, for the next guess */
+#define GA_WARM_INDIVIDUALS 32U
+/* Magic and version of the binary file of these fleets, bump it on any layout change */
+#define OS_FLEET_WARM_MAGIC "OSIMGAW"
+#define OS_FLEET_WARM_VERSION 1
 
 enum Fleet_enum
 {
@@ -31,8 +49,26 @@ enum Fleet_enum
 
 os_fleet_t *os_fleet_make(apr_pool_t *pool, enum Fleet_enum type);
 
+/**
+ * Seed the random numbers of the simulations and of the genetic algorithm of
+ * the process, each run is seeded from the current time otherwise. With the
+ * same seed, the simulations give the same result (whatever the shards), and
+ * guess mode breeds the same individuals whatever the number of threads,
+ * until a timeout stops it. Islands and steady state depend on the order
+ * their threads run in.
+ * @param seed The seed.
+ */
+void os_fleet_set_seed(unsigned int seed);
+
 void os_fleet_to_guess(os_fleet_t *fleet);
 
+/**
+ * Count the ships and defenses of a parsed fleet, missiles of an attacker excluded.
+ * @param fleet The fleet.
+ * @return The number of units.
+ */
+unsigned int os_fleet_get_nb_units(const os_fleet_t *fleet);
+
 apr_status_t os_fleet_set_conf(os_fleet_t *fleet, const char *conf);
 
 apr_status_t os_fleet_parse(os_fleet_t *fleet, const os_conf_t *conf);
@@ -42,6 +78,34 @@ apr_status_t os_fleet_precalc_shoot_table(apr_pool_t *pool, os_fleet_t *defender
 void os_fleet_battle(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu, const os_conf_t *conf,
 		     unsigned char mode);
 
+/**
+ * Run the share of nb_simu simulations that belongs to the shard shard_idx
+ * (over shard_count), and accumulate them in result.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_fleet_battle_shard(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+				   unsigned int shard_idx, unsigned int shard_count, const os_conf_t *conf,
+				   os_result_t *result);
+
+/**
+ * Run nb_simu simulations and record the outcome of each of them in sample,
+ * without any economic evaluation.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_fleet_battle_sample(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+				    const os_conf_t *conf, os_sample_t *sample);
+
+#ifdef UNITTEST
+/**
+ * Same as os_fleet_battle_sample, with the frozen battle engine of osim 1.6.0
+ * the equivalence checks compare the current one with.
+ * @param salt Mixed in the seed, use another one than the sample to compare with.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_fleet_reference_battle_sample(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+					      unsigned int salt, const os_conf_t *conf, os_sample_t *sample);
+#endif
+
 /* output formated for a human */
 #define OS_MODE_HUMAN 0x01
 /* output formated for perl script */
@@ -54,6 +118,8 @@ void os_fleet_battle(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb
 #define OS_MODE_NO_RECYCLING 0x10
 /* computation don't include investment for the fleet (result will be a subset of your own fleet) */
 #define OS_MODE_NO_INVEST 0x20
+/* genetic algorithm doesn't print its best individuals (benchmarks) */
+#define OS_MODE_QUIET 0x40
 
 enum genetic_algorithm_mask
 {
@@ -64,10 +130,50 @@ enum genetic_algorithm_mask
     NORMAL			/* no buffer fleet (PT,GT,VC,REC,SE,SAT,EDLM) */
 };
 
+/**
+ * Search with a genetic algorithm the cheapest fleet that wins against the defender.
+ * @param max_individuals Upper bound of the population, 0 for GA_DEFAULT_INDIVIDUALS (the
+ * free memory bounds it too).
+ * @param max_ages The number of generations to run, 0 for GA_DEFAULT_AGES.
+ * @param tuning The tuning of the genetic algorithm (islands...), NULL for the default one.
+ * @param target_score The score for which stats->target_time is computed.
+ * @param checkpoint_file The file (over)written with the state of the genetic algorithm every
+ * GA_CHECKPOINT_INTERVAL seconds and at the end of the run, NULL if none.
+ * @param resume Go on from checkpoint_file if it exists, nothing is run if it belongs to another guess.
+ * @param warm_file The file of the fleets a previous guess (of the same or a similar target) ended
+ * with: the first individuals are these fleets, repaired against the constraints of this guess, and
+ * the GA_WARM_INDIVIDUALS best distinct ones replace them at the end. NULL if none.
+ * @param index_file The index of solved guesses (see os_index.h): the fleet of a close one answers
+ * at once if it is nearly as profitable in its verification battles, otherwise the best fleet
+ * found is added to it. NULL if none.
+ * @param stats If not NULL, receives the counters of the genetic algorithm at the end of the run.
+ */
 void os_fleet_find_cheapest_winner(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf,
 				   enum genetic_algorithm_mask mask, unsigned int inactivity_timeout,
 				   unsigned int fixed_timeout, unsigned int flight_time, unsigned int wave_time,
-				   unsigned char mode, unsigned int nb_cpu);
+				   unsigned char mode, unsigned int nb_cpu, unsigned int max_individuals,
+				   unsigned long max_ages, const napr_galife_tuning_t *tuning, float target_score,
+				   const char *checkpoint_file, int resume, const char *warm_file, const char *index_file,
+				   napr_galife_stats_t *stats);
+
+/**
+ * Cancel the guess os_fleet_find_cheapest_winner is running, if any: it
+ * stops as soon as possible, prints the best fleet found so far, saves its
+ * checkpoint and warm start files, but doesn't record it in the index. Only
+ * sets flags, it can be called from a signal handler.
+ * @return 1 if a guess was running, 0 otherwise (nothing is cancelled).
+ */
+int os_fleet_cancel_guess(void);
+
+/**
+ * Score the samples of a battle like the genetic algorithm would do, for
+ * the fleet in guess mode and the economic flags of mode. No battle is run.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if the samples don't
+ * belong to these fleets.
+ */
+apr_status_t os_fleet_rescore(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf,
+			      const os_sample_t *sample, unsigned int flight_time, unsigned int wave_time,
+			      unsigned char mode);
 
 unsigned int os_fleet_distance(const char *fleet1, const char *fleet2);
 
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_INDEX_H
+#define OS_INDEX_H
+
+#include <apr_pools.h>
+
+#include "os_conf.h"
+
+/**
+ * Index of solved guesses: each entry is the best fleet found for a key
+ * (what must be equal, technologies...) and a signature (what may differ
+ * a little, the enemy fleet...). The file is mapped in memory with its
+ * entries sorted by key, the new ones are kept aside until os_index_write.
+ */
+typedef struct os_index_t os_index_t;
+
+/* Version of the binary index file, bump it on any layout change */
+#define OS_INDEX_VERSION 1
+
+/* Numbers in a signature: value of each type of the enemy fleet, then the resources of the planet */
+#define OS_INDEX_DIM (ITEM_END + 3)
+
+/**
+ * Allocate an empty index.
+ * @param pool The pool to allocate from, the mapping of the file is deleted with it.
+ * @return A pointer to the freshly allocated index, NULL if an error occured.
+ */
+os_index_t *os_index_make(apr_pool_t *pool);
+
+/**
+ * Map the entries of an index file, a missing file is an empty index. Only
+ * the header is checked, the entries are read when looked up.
+ * @param index The index, empty.
+ * @param filename The file to map.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if the file is not an index or corrupted.
+ */
+apr_status_t os_index_open(os_index_t *index, const char *filename);
+
+/**
+ * Find the entry of key with the nearest signature: the distance is the sum
+ * of the absolute differences relative to the sum of both signatures.
+ * @param index The index.
+ * @param key The key the entry must have.
+ * @param signature The OS_INDEX_DIM numbers to compare, none negative.
+ * @param max_distance The greatest distance of an entry found, in [0, 1].
+ * @param solution Receives the ITEM_END numbers of the fleet of the entry found.
+ * @param score Receives the score of the entry found.
+ * @return 1 if an entry was found, 0 otherwise.
+ */
+int os_index_lookup(const os_index_t *index, apr_uint64_t key, const float *signature, float max_distance,
+		    unsigned int *solution, float *score);
+
+/**
+ * Add an entry, it replaces the one of the same key and signature when written.
+ * @param index The index.
+ * @param key The key of the entry.
+ * @param signature The OS_INDEX_DIM numbers of the entry.
+ * @param solution The ITEM_END numbers of the fleet found.
+ * @param score The score of the fleet found.
+ */
+void os_index_add(os_index_t *index, apr_uint64_t key, const float *signature, const unsigned int *solution,
+		  float score);
+
+/**
+ * Get the number of entries, the ones added included.
+ * @param index The index.
+ * @return The number of entries.
+ */
+unsigned int os_index_get_nb(const os_index_t *index);
+
+/**
+ * Write the entries added with the ones the file holds when it is written:
+ * the file is mapped again (and checked) under an exclusive lock of
+ * filename.lock, the entries other writers recorded since os_index_open
+ * are kept. A corrupted file is moved to filename.corrupt before it is
+ * written, a file that can't be read is left as it is and not written.
+ * @param index The index.
+ * @param filename The file to (over)write, the mapped one may be replaced.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_index_write(const os_index_t *index, const char *filename, apr_pool_t *pool);
+
+#endif /* OS_INDEX_H */
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_IO_H
+#define OS_IO_H
+
+#include <string.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+
+/**
+ * Versioned binary files of osim (partial results, samples...): a magic
+ * string of OS_IO_MAGIC_LEN bytes, a 32 bits version, the payload, and a
+ * 64 bits checksum of all that precedes it.
+ */
+#define OS_IO_MAGIC_LEN 8
+
+/* Size of the header and trailer added around the payload */
+#define OS_IO_FRAME_SIZE (OS_IO_MAGIC_LEN + 4 + 8)
+
+/**
+ * Write a payload in a file, framed with magic, version and checksum. The
+ * file is written and synced under a temporary filename.XXXXXX of its own
+ * (readable by its owner only), then renamed: readers see either the
+ * previous file or the whole new one, concurrent writers don't mix theirs.
+ * @param filename The file to (over)write.
+ * @param magic The magic string (OS_IO_MAGIC_LEN bytes, including the trailing '\0').
+ * @param version The version of the payload layout.
+ * @param payload The payload.
+ * @param size The size of the payload.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_io_write(const char *filename, const char *magic, apr_uint32_t version, const unsigned char *payload,
+			 apr_size_t size, apr_pool_t *pool);
+
+/**
+ * Read a payload written by os_io_write.
+ * @param filename The file to read.
+ * @param magic The expected magic string.
+ * @param version The expected version of the payload layout.
+ * @param payload The address of a pointer that will receive the payload.
+ * @param size The address of a size that will receive the size of the payload.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if the file is not
+ * what is expected or corrupted.
+ */
+apr_status_t os_io_read(const char *filename, const char *magic, apr_uint32_t version, const unsigned char **payload,
+			apr_size_t *size, apr_pool_t *pool);
+
+/**
+ * Map a file written by os_io_write in memory instead of reading it: big
+ * files are only paged in where they are looked at. Only the header is
+ * checked, see os_io_verify to check the whole payload.
+ * @param filename The file to map.
+ * @param magic The expected magic string.
+ * @param version The expected version of the payload layout.
+ * @param payload The address of a pointer that will receive the payload, valid as long as pool.
+ * @param size The address of a size that will receive the size of the payload.
+ * @param pool The pool to allocate from, the mapping is deleted with it.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if the file is not
+ * what is expected or corrupted.
+ */
+apr_status_t os_io_map(const char *filename, const char *magic, apr_uint32_t version, const unsigned char **payload,
+		       apr_size_t *size, apr_pool_t *pool);
+
+/**
+ * Check the checksum of a file mapped by os_io_map, once the whole payload
+ * is about to be read anyway.
+ * @param filename The file mapped, for the error message.
+ * @param payload The payload given by os_io_map.
+ * @param size The size of the payload given by os_io_map.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if the file is corrupted.
+ */
+apr_status_t os_io_verify(const char *filename, const unsigned char *payload, apr_size_t size);
+
+/*
+ * Serialization: every integer is stored little endian whatever the
+ * host is, floats are stored through their IEEE 754 representation.
+ */
+static inline void os_io_put_uint32(unsigned char **ptr, apr_uint32_t value)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+	*(*ptr)++ = (unsigned char) (value >> (8 * i));
+}
+
+static inline void os_io_put_uint64(unsigned char **ptr, apr_uint64_t value)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+	*(*ptr)++ = (unsigned char) (value >> (8 * i));
+}
+
+static inline void os_io_put_float(unsigned char **ptr, float value)
+{
+    apr_uint32_t tmp;
+
+    memcpy(&tmp, &value, sizeof(apr_uint32_t));
+    os_io_put_uint32(ptr, tmp);
+}
+
+static inline void os_io_put_string(unsigned char **ptr, const char *str)
+{
+    apr_uint32_t len;
+
+    len = strlen(str);
+    os_io_put_uint32(ptr, len);
+    memcpy(*ptr, str, len);
+    *ptr += len;
+}
+
+static inline void os_io_put_uint64_array(unsigned char **ptr, const apr_uint64_t *array, unsigned int nb)
+{
+    unsigned int i;
+
+    for (i = 0; i < nb; i++)
+	os_io_put_uint64(ptr, array[i]);
+}
+
+static inline void os_io_put_uint32_array(unsigned char **ptr, const unsigned int *array, unsigned int nb)
+{
+    unsigned int i;
+
+    for (i = 0; i < nb; i++)
+	os_io_put_uint32(ptr, array[i]);
+}
+
+/* The reader never goes beyond end, it returns -1 instead */
+static inline int os_io_get_uint32(const unsigned char **ptr, const unsigned char *end, apr_uint32_t *value)
+{
+    int i;
+
+    if ((end - *ptr) < 4)
+	return -1;
+
+    for (i = 0, *value = 0; i < 4; i++)
+	*value |= (apr_uint32_t) (*(*ptr)++) << (8 * i);
+
+    return 0;
+}
+
+static inline int os_io_get_uint64(const unsigned char **ptr, const unsigned char *end, apr_uint64_t *value)
+{
+    int i;
+
+    if ((end - *ptr) < 8)
+	return -1;
+
+    for (i = 0, *value = 0; i < 8; i++)
+	*value |= (apr_uint64_t) (*(*ptr)++) << (8 * i);
+
+    return 0;
+}
+
+static inline int os_io_get_float(const unsigned char **ptr, const unsigned char *end, float *value)
+{
+    apr_uint32_t tmp;
+
+    if (0 != os_io_get_uint32(ptr, end, &tmp))
+	return -1;
+    memcpy(value, &tmp, sizeof(float));
+
+    return 0;
+}
+
+static inline int os_io_get_string(apr_pool_t *pool, const unsigned char **ptr, const unsigned char *end,
+				       char **str)
+{
+    apr_uint32_t len;
+
+    if ((0 != os_io_get_uint32(ptr, end, &len)) || ((apr_uint32_t) (end - *ptr) < len))
+	return -1;
+    *str = apr_pstrndup(pool, (const char *) *ptr, len);
+    *ptr += len;
+
+    return 0;
+}
+
+static inline int os_io_get_uint64_array(const unsigned char **ptr, const unsigned char *end,
+					     apr_uint64_t *array, unsigned int nb)
+{
+    unsigned int i;
+
+    for (i = 0; i < nb; i++)
+	if (0 != os_io_get_uint64(ptr, end, &(array[i])))
+	    return -1;
+
+    return 0;
+}
+
+static inline int os_io_get_uint32_array(const unsigned char **ptr, const unsigned char *end,
+					     unsigned int *array, unsigned int nb)
+{
+    unsigned int i;
+    apr_uint32_t tmp;
+
+    for (i = 0; i < nb; i++) {
+	if (0 != os_io_get_uint32(ptr, end, &tmp))
+	    return -1;
+	array[i] = tmp;
+    }
+
+    return 0;
+}
+
+#endif /* OS_IO_H */
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_PROFILE_H
+#define OS_PROFILE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <time.h>
+
+#include <apr_pools.h>
+
+/*
+ * Wall clock time spent in each phase of a simulation run (osim --profile),
+ * plus hardware counters around the battle loop when perf_event_open is
+ * available. Accumulators are not thread safe, the profile is only meant for
+ * the simulation mode which runs in the main thread.
+ */
+
+enum Profile_enum
+{
+    PRF_CONF = 0x0,		/* os_conf_make */
+    PRF_REPORT_PARSE,		/* spy report read on stdin */
+    PRF_FLEET_PARSE,		/* os_fleet_parse of both fleets */
+    PRF_MISSILE,		/* hit tables init and missile launch, once per simulation */
+    PRF_SHIELD,			/* shields reset, once per round */
+    PRF_SHOOT,
+    PRF_COMPACTION,		/* exploded ships removal */
+    PRF_STATS,			/* losses and statistics accumulation */
+    PRF_OUTPUT,
+    PRF_END
+};
+
+enum Profile_counter_enum
+{
+    PRF_CYCLES = 0x0,
+    PRF_INSTRUCTIONS,
+    PRF_LLC_MISSES,
+    PRF_BRANCH_MISSES,
+    PRF_COUNTER_END
+};
+
+extern int os_profile_enabled;
+extern apr_uint64_t os_profile_ns[PRF_END];
+extern apr_uint64_t os_profile_calls[PRF_END];
+
+static inline apr_uint64_t os_profile_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (apr_uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define OS_PROFILE_BEGIN(start) do { if (os_profile_enabled) (start) = os_profile_clock(); } while (0)
+#define OS_PROFILE_END(phase, start) do { if (os_profile_enabled) { \
+    os_profile_ns[(phase)] += os_profile_clock() - (start); os_profile_calls[(phase)]++; } } while (0)
+
+/**
+ * Start timing phases, must be called from the thread running the simulations.
+ */
+void os_profile_enable(void);
+
+/**
+ * Reset and start the hardware counters, no-op if they are not available.
+ */
+void os_profile_counters_start(void);
+
+/**
+ * Stop the hardware counters and accumulate their values.
+ */
+void os_profile_counters_stop(void);
+
+/**
+ * Print the phases and hardware counters as "profile,..." lines, counters
+ * are also given per simulation and per round.
+ * @param out The stream to print to.
+ */
+void os_profile_display(FILE *out);
+
+#endif /* OS_PROFILE_H */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_RESULT_H
+#define OS_RESULT_H
+
+#include <apr_pools.h>
+
+#include "os_conf.h"
+
+/**
+ * Accumulated statistics of a set of simulations of one matchup.
+ * Counters are 64 bits wide so that results of many shards (or a lot of
+ * simulations of a big fleet) can be merged without overflowing.
+ */
+typedef struct os_result_t os_result_t;
+
+/* Version of the binary partial result file, bump it on any layout change */
+#define OS_RESULT_VERSION 1
+
+/* Number of buckets of the survival sketches (fraction of fleet value still alive) */
+#define OS_RESULT_SKETCH_BINS 20
+
+enum Resource_enum
+{
+    RES_METAL = 0x0,
+    RES_CRISTAL,
+    RES_DEUT,
+    RES_END
+};
+
+/**
+ * Allocate an empty result.
+ * @param pool The pool to allocate from.
+ * @return A pointer to the freshly allocated result, NULL if an error occured.
+ */
+os_result_t *os_result_make(apr_pool_t *pool);
+
+/**
+ * Describe the matchup the result belongs to, partial results can only be
+ * merged if they share the same matchup.
+ * @param result The result to describe.
+ * @param matchup A fingerprint of both fleets (technologies and repartition).
+ * @param atk_coord The attacker coordinates.
+ * @param def_coord The defender coordinates.
+ * @param resources The resources available on the defender planet (RES_END entries).
+ * @param deut_consumed The deut consumed by the attacker for the flight.
+ * @param atk_value The value of the attacking fleet before the battle.
+ * @param def_value The value of the defending fleet before the battle.
+ */
+void os_result_set_matchup(os_result_t *result, apr_uint64_t matchup, const char *atk_coord, const char *def_coord,
+			   const unsigned int *resources, unsigned int deut_consumed, float atk_value, float def_value);
+
+/**
+ * Account one simulation.
+ * @param result The result to update.
+ * @param nb_round Number of rounds played.
+ * @param atk_repartition Surviving attacking ships (ITEM_END entries).
+ * @param atk_value Value of the surviving attacking ships.
+ * @param def_repartition Surviving defending ships and defenses (ITEM_END entries).
+ * @param def_value Value of the surviving defending ships and defenses.
+ * @param atk_loss Resources lost by the attacker (RES_END entries).
+ * @param def_loss Resources lost by the defender (RES_END entries).
+ * @param recycled Metal and cristal left in the debris field.
+ */
+void os_result_add(os_result_t *result, unsigned char nb_round, const unsigned int *atk_repartition, float atk_value,
+		   const unsigned int *def_repartition, float def_value, const apr_uint64_t *atk_loss,
+		   const apr_uint64_t *def_loss, const apr_uint64_t *recycled);
+
+/**
+ * Add a partial result to another one.
+ * @param result The result that will contain both.
+ * @param partial The result to add.
+ * @return APR_SUCCESS if no error occured, APR_EINVAL if matchups differ.
+ */
+apr_status_t os_result_merge(os_result_t *result, const os_result_t *partial);
+
+/**
+ * Write a result in the versioned binary partial format.
+ * @param result The result to save.
+ * @param filename The file to (over)write.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_result_write(const os_result_t *result, const char *filename, apr_pool_t *pool);
+
+/**
+ * Read a result written by os_result_write.
+ * @param result The address of a pointer that will receive the result.
+ * @param filename The file to read.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_result_read(os_result_t **result, const char *filename, apr_pool_t *pool);
+
+/**
+ * Get the number of simulations accounted in the result.
+ * @param result The result.
+ * @return The number of simulations.
+ */
+apr_uint64_t os_result_get_nb_simu(const os_result_t *result);
+
+/**
+ * Get the number of simulations that ended after nb_round rounds.
+ * @param result The result.
+ * @param nb_round The number of rounds.
+ * @return The number of simulations.
+ */
+apr_uint64_t os_result_get_nb_round(const os_result_t *result, unsigned char nb_round);
+
+/**
+ * Print the result in the same format as a simulation run.
+ * @param result The result to display.
+ * @param conf The configuration (for ship names and recycler capacity).
+ * @param mode Binary mask of OS_MODE_* (see os_fleet.h).
+ */
+void os_result_display(const os_result_t *result, const os_conf_t *conf, unsigned char mode);
+
+#endif /* OS_RESULT_H */
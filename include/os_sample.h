@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_SAMPLE_H
+#define OS_SAMPLE_H
+
+#include <apr_pools.h>
+
+#include "os_conf.h"
+
+/**
+ * Outcome of each simulation of one matchup: number of rounds and
+ * surviving ships of both fleets. Economic evaluation (loot, recycling,
+ * losses) can be computed from it without running any battle again.
+ */
+typedef struct os_sample_t os_sample_t;
+
+/* Version of the binary sample file, bump it on any layout change */
+#define OS_SAMPLE_VERSION 1
+
+/**
+ * Allocate an empty sample set.
+ * @param pool The pool to allocate from.
+ * @return A pointer to the freshly allocated sample set, NULL if an error occured.
+ */
+os_sample_t *os_sample_make(apr_pool_t *pool);
+
+/**
+ * Set the fingerprint of the battle (technologies and repartitions, not
+ * the resources) the samples belong to.
+ * @param sample The sample set.
+ * @param matchup The fingerprint.
+ */
+void os_sample_set_matchup(os_sample_t *sample, apr_uint64_t matchup);
+
+/**
+ * Get the fingerprint of the battle the samples belong to.
+ * @param sample The sample set.
+ * @return The fingerprint.
+ */
+apr_uint64_t os_sample_get_matchup(const os_sample_t *sample);
+
+/**
+ * Record the outcome of one simulation.
+ * @param sample The sample set.
+ * @param nb_round Number of rounds played.
+ * @param atk_repartition Surviving attacking ships (ITEM_END entries).
+ * @param def_repartition Surviving defending ships and defenses (ITEM_END entries).
+ */
+void os_sample_add(os_sample_t *sample, unsigned char nb_round, const unsigned int *atk_repartition,
+		   const unsigned int *def_repartition);
+
+/**
+ * Get the number of simulations recorded.
+ * @param sample The sample set.
+ * @return The number of simulations.
+ */
+unsigned int os_sample_get_nb(const os_sample_t *sample);
+
+/**
+ * Get the number of rounds of one simulation.
+ * @param sample The sample set.
+ * @param idx The index of the simulation.
+ * @return The number of rounds.
+ */
+unsigned char os_sample_get_nb_round(const os_sample_t *sample, unsigned int idx);
+
+/**
+ * Get the surviving attacking ships of all simulations.
+ * @param sample The sample set.
+ * @return An array of os_sample_get_nb() rows of ITEM_END entries.
+ */
+const unsigned int *os_sample_get_atk_repartitions(const os_sample_t *sample);
+
+/**
+ * Get the surviving defending ships and defenses of all simulations.
+ * @param sample The sample set.
+ * @return An array of os_sample_get_nb() rows of ITEM_END entries.
+ */
+const unsigned int *os_sample_get_def_repartitions(const os_sample_t *sample);
+
+/**
+ * Write a sample set in the versioned binary format.
+ * @param sample The sample set to save.
+ * @param filename The file to (over)write.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_sample_write(const os_sample_t *sample, const char *filename, apr_pool_t *pool);
+
+/**
+ * Read a sample set written by os_sample_write.
+ * @param sample The address of a pointer that will receive the sample set.
+ * @param filename The file to read.
+ * @param pool The pool to allocate from.
+ * @return APR_SUCCESS if no error occured.
+ */
+apr_status_t os_sample_read(os_sample_t **sample, const char *filename, apr_pool_t *pool);
+
+#endif /* OS_SAMPLE_H */
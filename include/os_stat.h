@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_STAT_H
+#define OS_STAT_H
+
+#include <apr_pools.h>
+
+/*
+ * Two-sample tests used to compare outcome distributions of battle engines.
+ * All functions return a p-value: the probability, if both samples come from
+ * the same distribution, of a divergence at least as large as the observed one.
+ */
+
+/**
+ * Upper tail of the chi-square distribution.
+ * @param chi2 The statistic.
+ * @param df The degrees of freedom.
+ * @return The p-value, 1.0 if df is 0.
+ */
+double os_stat_chi2_pvalue(double chi2, unsigned int df);
+
+/**
+ * Chi-square test of homogeneity of two histograms over the same bins.
+ * Adjacent bins are merged until each one holds at least 10 observations.
+ * @param a The first histogram.
+ * @param b The second histogram.
+ * @param nb_bins The number of bins of both histograms.
+ * @return The p-value, 1.0 if less than two bins remain.
+ */
+double os_stat_chi2_homogeneity(const apr_uint64_t *a, const apr_uint64_t *b, unsigned int nb_bins);
+
+/**
+ * Two-sample Kolmogorov-Smirnov test (asymptotic distribution, conservative
+ * for discrete values).
+ * @param a The first sample, sorted in place.
+ * @param na The size of the first sample.
+ * @param b The second sample, sorted in place.
+ * @param nb The size of the second sample.
+ * @return The p-value.
+ */
+double os_stat_ks_2samp(double *a, apr_size_t na, double *b, apr_size_t nb);
+
+#endif /* OS_STAT_H */
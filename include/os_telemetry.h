@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OS_TELEMETRY_H
+#define OS_TELEMETRY_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <apr_pools.h>
+
+/*
+ * Battle engine counters, only compiled in with ./configure --enable-telemetry.
+ * Each thread increments its own block (no lock, no shared cache line), blocks
+ * are summed when the counters are displayed.
+ */
+
+enum Telemetry_enum
+{
+    TLM_SHOT = 0x0,
+    TLM_BOUNCED_SHOT,		/* damage < 1% of the target shield */
+    TLM_EXPLOSION_STRUCTURE,	/* structure points < 0 */
+    TLM_EXPLOSION_PROBABILISTIC,	/* hull damage >= 30 % */
+    TLM_SHIP_COMPACTED,		/* exploded ships removed from the hit table */
+    TLM_ROUND,
+    TLM_BATTLE,
+    TLM_END
+};
+
+/* Buckets of the rapid-fire chain length histogram, the last one holds all longer chains */
+#define OS_TELEMETRY_CHAIN_BINS 16
+
+typedef struct os_telemetry_t os_telemetry_t;
+struct os_telemetry_t
+{
+    apr_uint64_t counter[TLM_END];
+    apr_uint64_t chain[OS_TELEMETRY_CHAIN_BINS];
+    os_telemetry_t *next;
+};
+
+#ifdef HAVE_TELEMETRY
+
+extern int os_telemetry_enabled;
+extern __thread os_telemetry_t *os_telemetry_local;
+
+os_telemetry_t *os_telemetry_register(void);
+
+static inline os_telemetry_t *os_telemetry_get(void)
+{
+    if (NULL == os_telemetry_local)
+	os_telemetry_local = os_telemetry_register();
+
+    return os_telemetry_local;
+}
+
+#define OS_TELEMETRY_INC(idx) do { if (os_telemetry_enabled) os_telemetry_get()->counter[(idx)]++; } while (0)
+#define OS_TELEMETRY_SHOT(len) do { if (os_telemetry_enabled) { os_telemetry_get()->counter[TLM_SHOT]++; (len)++; } } while (0)
+#define OS_TELEMETRY_CHAIN(len) do { if (os_telemetry_enabled && (0 != (len))) \
+    os_telemetry_get()->chain[((len) < OS_TELEMETRY_CHAIN_BINS) ? ((len) - 1) : (OS_TELEMETRY_CHAIN_BINS - 1)]++; } while (0)
+
+#else
+
+#define OS_TELEMETRY_INC(idx) do {} while (0)
+#define OS_TELEMETRY_SHOT(len) do {} while (0)
+#define OS_TELEMETRY_CHAIN(len) do { (void) (len); } while (0)
+
+#endif /* HAVE_TELEMETRY */
+
+/**
+ * Start counting, must be called before any battle is simulated.
+ * @return APR_SUCCESS if no error occured, APR_ENOTIMPL if telemetry was not compiled in.
+ */
+apr_status_t os_telemetry_enable(void);
+
+/**
+ * Zero the counters of every thread, threads must be idle.
+ */
+void os_telemetry_reset(void);
+
+/**
+ * Sum the counters of every thread.
+ * @param total The block that will receive the sum (next is set to NULL).
+ */
+void os_telemetry_aggregate(os_telemetry_t *total);
+
+/**
+ * Print the aggregated counters as "telemetry,<name>,<value>" lines.
+ * @param out The stream to print to.
+ */
+void os_telemetry_display(FILE *out);
+
+#endif /* OS_TELEMETRY_H */
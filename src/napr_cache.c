@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+
+#include "debug.h"
+#include "napr_cache.h"
+
+#define NAPR_CACHE_WAYS 4
+/* Sets share their locks, enough of them to keep contention low with a few threads */
+#define NAPR_CACHE_LOCKS 64
+
+typedef struct napr_cache_slot_t
+{
+    apr_uint64_t hash;
+    apr_uint64_t last_use;	/* 0 if the slot is free */
+} napr_cache_slot_t;
+
+typedef struct napr_cache_lock_t
+{
+    apr_thread_mutex_t *mutex;
+    apr_uint64_t hits;
+    apr_uint64_t misses;
+    apr_uint64_t tick;
+} napr_cache_lock_t;
+
+/* A deferred value, followed by its key and the value */
+typedef struct napr_cache_deferred_t
+{
+    apr_uint64_t hash;
+    apr_size_t size;		/* of the key and the value, what orders the entries of the same hash */
+} napr_cache_deferred_t;
+
+struct napr_cache_t
+{
+    napr_cache_lock_t lock[NAPR_CACHE_LOCKS];
+    unsigned char *slots;	/* a napr_cache_slot_t followed by the key and the value, slot_size bytes each */
+    apr_thread_mutex_t *deferred_mutex;
+    unsigned char *deferred;	/* the log of the values to merge on the next commit, deferred_size bytes each */
+    apr_size_t deferred_size;
+    apr_size_t nb_deferred;
+    apr_size_t max_deferred;
+    apr_size_t key_size;
+    apr_size_t value_size;
+    apr_size_t slot_size;
+    unsigned long set_mask;
+};
+
+/* FNV-1a */
+static inline apr_uint64_t napr_cache_hash(const void *key, apr_size_t len)
+{
+    const unsigned char *ptr = key;
+    apr_uint64_t hash = 14695981039346656037ULL;
+    apr_size_t i;
+
+    for (i = 0; i < len; i++) {
+	hash ^= ptr[i];
+	hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static inline napr_cache_slot_t *napr_cache_slot(const napr_cache_t *cache, unsigned long set, unsigned int way)
+{
+    return (napr_cache_slot_t *) (cache->slots + (set * NAPR_CACHE_WAYS + way) * cache->slot_size);
+}
+
+/* Return the slot of key in its set, NULL if it's not there, called with the set locked */
+static inline napr_cache_slot_t *napr_cache_find(const napr_cache_t *cache, unsigned long set, apr_uint64_t hash,
+						 const void *key)
+{
+    napr_cache_slot_t *slot;
+    unsigned int way;
+
+    for (way = 0; way < NAPR_CACHE_WAYS; way++) {
+	slot = napr_cache_slot(cache, set, way);
+	if ((0ULL != slot->last_use) && (hash == slot->hash) && (0 == memcmp(slot + 1, key, cache->key_size)))
+	    return slot;
+    }
+
+    return NULL;
+}
+
+/* Order the deferred values by key then value, thus a commit doesn't depend on the order of the defers */
+static int napr_cache_deferred_cmp(const void *p1, const void *p2)
+{
+    const napr_cache_deferred_t *d1 = p1;
+    const napr_cache_deferred_t *d2 = p2;
+
+    if (d1->hash != d2->hash)
+	return (d1->hash < d2->hash) ? -1 : 1;
+
+    return memcmp(d1 + 1, d2 + 1, d1->size);
+}
+
+static apr_status_t napr_cache_cleanup(void *data)
+{
+    napr_cache_t *cache = data;
+
+    free(cache->deferred);
+
+    return APR_SUCCESS;
+}
+
+apr_status_t napr_cache_init(napr_cache_t **cache, unsigned long nb_entries, apr_size_t key_size,
+			     apr_size_t value_size, apr_pool_t *pool)
+{
+    char errbuf[128];
+    unsigned long nb_sets;
+    apr_status_t status;
+    int i;
+
+    if ((0UL == nb_entries) || (0 == key_size) || (0 == value_size))
+	return APR_EINVAL;
+
+    for (nb_sets = 1UL; nb_sets * NAPR_CACHE_WAYS < nb_entries; nb_sets <<= 1);
+
+    *cache = apr_pcalloc(pool, sizeof(struct napr_cache_t));
+    (*cache)->key_size = key_size;
+    (*cache)->value_size = value_size;
+    (*cache)->slot_size = APR_ALIGN_DEFAULT(sizeof(napr_cache_slot_t) + key_size + value_size);
+    (*cache)->deferred_size = APR_ALIGN_DEFAULT(sizeof(napr_cache_deferred_t) + key_size + value_size);
+    (*cache)->set_mask = nb_sets - 1;
+    if (NULL == ((*cache)->slots = apr_pcalloc(pool, nb_sets * NAPR_CACHE_WAYS * (*cache)->slot_size))) {
+	DEBUG_ERR("can't allocate %lu entries of %" APR_SIZE_T_FMT " bytes", nb_sets * NAPR_CACHE_WAYS,
+		  (*cache)->slot_size);
+	return APR_ENOMEM;
+    }
+
+    for (i = 0; i < NAPR_CACHE_LOCKS; i++) {
+	if (APR_SUCCESS !=
+	    (status = apr_thread_mutex_create(&((*cache)->lock[i].mutex), APR_THREAD_MUTEX_DEFAULT, pool))) {
+	    DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+    }
+    if (APR_SUCCESS != (status = apr_thread_mutex_create(&((*cache)->deferred_mutex), APR_THREAD_MUTEX_DEFAULT, pool))) {
+	DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    apr_pool_cleanup_register(pool, *cache, napr_cache_cleanup, apr_pool_cleanup_null);
+
+    return APR_SUCCESS;
+}
+
+int napr_cache_get(napr_cache_t *cache, const void *key, void *value)
+{
+    napr_cache_slot_t *slot;
+    napr_cache_lock_t *lock;
+    apr_uint64_t hash;
+    unsigned long set;
+
+    hash = napr_cache_hash(key, cache->key_size);
+    set = hash & cache->set_mask;
+    lock = &(cache->lock[set % NAPR_CACHE_LOCKS]);
+
+    apr_thread_mutex_lock(lock->mutex);
+    if (NULL != (slot = napr_cache_find(cache, set, hash, key))) {
+	memcpy(value, (unsigned char *) (slot + 1) + cache->key_size, cache->value_size);
+	/* Not a new tick: lookups between two merges leave the eviction order as it was, whatever their order */
+	slot->last_use = lock->tick;
+	lock->hits++;
+    }
+    else {
+	lock->misses++;
+    }
+    apr_thread_mutex_unlock(lock->mutex);
+
+    return (NULL != slot);
+}
+
+void napr_cache_merge(napr_cache_t *cache, const void *key, void *value, napr_cache_merge_callback_fn_t *merge)
+{
+    napr_cache_slot_t *slot, *candidate;
+    napr_cache_lock_t *lock;
+    unsigned char *stored;
+    apr_uint64_t hash;
+    unsigned long set;
+    unsigned int way;
+
+    hash = napr_cache_hash(key, cache->key_size);
+    set = hash & cache->set_mask;
+    lock = &(cache->lock[set % NAPR_CACHE_LOCKS]);
+
+    apr_thread_mutex_lock(lock->mutex);
+    if (NULL == (slot = napr_cache_find(cache, set, hash, key))) {
+	/* A free slot, or the least recently used one */
+	slot = napr_cache_slot(cache, set, 0);
+	for (way = 1; (way < NAPR_CACHE_WAYS) && (0ULL != slot->last_use); way++) {
+	    candidate = napr_cache_slot(cache, set, way);
+	    if (candidate->last_use < slot->last_use)
+		slot = candidate;
+	}
+	slot->hash = hash;
+	memcpy(slot + 1, key, cache->key_size);
+	memset((unsigned char *) (slot + 1) + cache->key_size, 0, cache->value_size);
+    }
+    stored = (unsigned char *) (slot + 1) + cache->key_size;
+    merge(stored, value);
+    memcpy(stored, value, cache->value_size);
+    slot->last_use = ++(lock->tick);
+    apr_thread_mutex_unlock(lock->mutex);
+}
+
+apr_status_t napr_cache_defer(napr_cache_t *cache, const void *key, const void *value)
+{
+    napr_cache_deferred_t *deferred;
+    unsigned char *log;
+    apr_size_t max;
+
+    apr_thread_mutex_lock(cache->deferred_mutex);
+    if (cache->nb_deferred == cache->max_deferred) {
+	max = (0 == cache->max_deferred) ? 64 : 2 * cache->max_deferred;
+	if (NULL == (log = realloc(cache->deferred, max * cache->deferred_size))) {
+	    apr_thread_mutex_unlock(cache->deferred_mutex);
+	    DEBUG_ERR("can't allocate %" APR_SIZE_T_FMT " deferred values", max);
+	    return APR_ENOMEM;
+	}
+	cache->deferred = log;
+	cache->max_deferred = max;
+    }
+    deferred = (napr_cache_deferred_t *) (cache->deferred + cache->nb_deferred * cache->deferred_size);
+    memset(deferred, 0, cache->deferred_size);
+    deferred->hash = napr_cache_hash(key, cache->key_size);
+    deferred->size = cache->key_size + cache->value_size;
+    memcpy(deferred + 1, key, cache->key_size);
+    memcpy((unsigned char *) (deferred + 1) + cache->key_size, value, cache->value_size);
+    cache->nb_deferred++;
+    apr_thread_mutex_unlock(cache->deferred_mutex);
+
+    return APR_SUCCESS;
+}
+
+void napr_cache_commit(napr_cache_t *cache, napr_cache_merge_callback_fn_t *merge)
+{
+    napr_cache_deferred_t *deferred;
+    apr_size_t i;
+
+    apr_thread_mutex_lock(cache->deferred_mutex);
+    qsort(cache->deferred, cache->nb_deferred, cache->deferred_size, napr_cache_deferred_cmp);
+    for (i = 0; i < cache->nb_deferred; i++) {
+	deferred = (napr_cache_deferred_t *) (cache->deferred + i * cache->deferred_size);
+	napr_cache_merge(cache, deferred + 1, (unsigned char *) (deferred + 1) + cache->key_size, merge);
+    }
+    cache->nb_deferred = 0;
+    apr_thread_mutex_unlock(cache->deferred_mutex);
+}
+
+void napr_cache_get_stats(napr_cache_t *cache, apr_uint64_t *hits, apr_uint64_t *misses)
+{
+    int i;
+
+    *hits = 0ULL;
+    *misses = 0ULL;
+    for (i = 0; i < NAPR_CACHE_LOCKS; i++) {
+	apr_thread_mutex_lock(cache->lock[i].mutex);
+	*hits += cache->lock[i].hits;
+	*misses += cache->lock[i].misses;
+	apr_thread_mutex_unlock(cache->lock[i].mutex);
+    }
+}
@@ -14,18 +14,25 @@
  * limitations under the License.
  */
 
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
 #include <values.h>
 
+#include <apr_atomic.h>
+#include <apr_tables.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
 #include <apr_time.h>
 
 #include "debug.h"
 #include "napr_galife.h"
-#include "napr_heap.h"
 #include "napr_threadpool.h"
 
+typedef struct beeing_t beeing_t;
+
 struct beeing_t
 {
     void *chromosome;		/* This will be a pointer to a structure manipulated by:
@@ -35,10 +42,99 @@ struct beeing_t
 				 * (look at the bottom of this file to see whole strategy)
 				 */
     float score;		/* score result from chrom_fitness applied on beeing_t */
-    unsigned char born;		/* During the running process, in order to know if it must be drop */
+    float error;		/* half-width of the confidence interval of score, set by chrom_race */
+    float threshold;		/* score a racing child must be able to reach */
+    float predicted;		/* score predicted for a holdout child by the surrogate, -FLT_MAX if none */
+    unsigned int race_samples;	/* samples asked to chrom_race at the current rung, 0 once out of the race */
+    unsigned int seed;		/* rand_r state of a child bred by the threadpool */
+    beeing_t *father;		/* parent of a child waiting to be bred, NULL once bred */
+    unsigned char born;		/* A child waiting for its evaluation (2 if screened), the selection skips it */
+    unsigned char is_father;	/* a child of the generation is bred from it, it can't be replaced meanwhile */
+    unsigned char scored;	/* a racing child got the score of a completed rung */
 };
 
-typedef struct beeing_t beeing_t;
+/* The intercept of the surrogate model comes first */
+#define SURROGATE_DIM (NAPR_GALIFE_MAX_FEATURES + 1)
+/* New scores after which the surrogate model is solved again */
+#define SURROGATE_REFIT 16UL
+/* Weight of the ridge penalty, relative to the mean variance of the features */
+#define SURROGATE_RIDGE 1e-3
+/* Decay of the older scores at each new one, the model follows the population as it converges */
+#define SURROGATE_FORGET 0.995
+/*
+ * One child in SURROGATE_HOLDOUT is bred alone to check the accuracy of the
+ * model, the kept offspring of a surplus are biased toward overestimated ones.
+ */
+#define SURROGATE_HOLDOUT 16UL
+
+/*
+ * Online ridge regression of the scores on the features of the evaluated
+ * individuals: only the normal equations are accumulated, they are solved
+ * once in a while. Protected by best_mutex.
+ */
+typedef struct surrogate_t
+{
+    double xtx[SURROGATE_DIM * SURROGATE_DIM];
+    double xty[SURROGATE_DIM];
+    double weights[SURROGATE_DIM];
+    unsigned long dim;		/* nb_features plus the intercept */
+    unsigned long nb_samples;
+    unsigned long nb_fitted;	/* samples the weights were solved from, 0 if never solved */
+    /* Accuracy of the predictions, checked against the evaluation of the holdout children */
+    double error_sum;
+    double mean_predicted, mean_score;	/* Welford's running means and co-moments */
+    double m2_predicted, m2_score, comoment;
+    unsigned long nb_predicted;
+} surrogate_t;
+
+/* Flag of the published slot of the reporter, set until the reporter thread takes it */
+#define REPORT_FRESH 0x4U
+
+/* A best individual published for the reporter thread */
+typedef struct report_slot_t
+{
+    void *chromosome;		/* copy, the population may overwrite the original meanwhile */
+    apr_interval_time_t time;	/* since init */
+    float score;
+} report_slot_t;
+
+/*
+ * Triple buffer between the threads that find the best individuals and the
+ * one that prints them: the holder of best_mutex fills the back slot and
+ * swaps it with the published one, the reporter swaps its front slot with
+ * the published one when it is fresh. Neither of them ever waits for the
+ * other to copy or print, a best replaced before it was printed is skipped;
+ * the reporter sleeps on fresh until a best is published.
+ */
+typedef struct reporter_t
+{
+    report_slot_t slots[3];
+    apr_uint32_t back;		/* slot being filled, protected by best_mutex */
+    volatile apr_uint32_t published;	/* last slot filled, ORed with REPORT_FRESH until taken */
+    apr_uint32_t front;		/* slot being printed, owned by the reporter thread */
+    apr_thread_mutex_t *mutex;	/* only held to test published and stop, and to signal fresh */
+    apr_thread_cond_t *fresh;
+    int stop;			/* set once no best can be published anymore, protected by mutex */
+    apr_thread_t *thread;
+} reporter_t;
+
+/*
+ * A flat array of individuals, the selection draws them by index in
+ * constant time, no order is kept.
+ */
+typedef struct population_t
+{
+    beeing_t **members;
+    unsigned long nb_members;
+} population_t;
+
+/* What a thread of the threadpool keeps from one child to the next */
+typedef struct ga_thread_t
+{
+    void *chrom_data;		/* private data of the evaluations, see chrom_worker */
+    void **scratch;		/* chromosomes of the surplus offspring, set by ga_run */
+    apr_pool_t *pool;		/* chromosomes of the initial population born in this thread */
+} ga_thread_t;
 
 struct napr_galife_t
 {
@@ -46,49 +142,368 @@ struct napr_galife_t
     chrom_randomz_callback_fn_t *chrom_randomz;
     chrom_display_callback_fn_t *chrom_display;
     chrom_fitness_callback_fn_t *chrom_fitness;
+    chrom_worker_callback_fn_t *chrom_worker;	/* NULL if evaluations need no private data */
     chrom_crossvr_callback_fn_t *chrom_crossvr;
     chrom_mutation_callback_fn_t *chrom_mutation;
-    napr_heap_t *population_past;
+    chrom_race_callback_fn_t *chrom_race;	/* NULL if children are evaluated by chrom_fitness */
+    chrom_estimate_callback_fn_t *chrom_estimate;	/* NULL if children are not screened */
+    chrom_features_callback_fn_t *chrom_features;
+    chrom_copy_callback_fn_t *chrom_copy;
+    surrogate_t *surrogate;	/* NULL if no surrogate model is learnt */
+    population_t population;
+    beeing_t *newborns;		/* the initial population, the rank of each one is given to chrom_randomz */
     napr_threadpool_t *threadpool;
+    ga_thread_t *threads;	/* contexts of the threads of threadpool */
+    unsigned long nb_threads;
     /*
      * avoid more than 1 thread to write a best score at the same time,
      * confusing the genetic algo, the result of one is the score of the other
      */
     apr_thread_mutex_t *best_mutex;
+    /* Each improvement of the best score, to know afterward when a given score was reached */
+    apr_array_header_t *best_history;	/* protected by best_mutex */
+    void *best_chromosome;	/* copy of the best individual, NULL unless kept, protected by best_mutex */
+    float best_kept_score;	/* protected by best_mutex */
+    reporter_t *reporter;	/* prints the best individuals during ga_run, NULL if they are printed at once */
+    galife_sync_callback_fn_t *sync;	/* NULL if the evaluations have nothing to publish */
+    galife_checkpoint_callback_fn_t *checkpoint;	/* NULL if the state is never saved */
+    napr_galife_state_t checkpoint_state;	/* filled at each save, its arrays are kept from one to the next */
+    apr_time_t checkpoint_interval;
+    apr_time_t last_checkpoint;	/* protected by the steady mutex and saving flag, or the snapshot_mutex of islands */
     apr_pool_t *pool;
     void *param;
     unsigned long current_age;
     unsigned long population_size;
+    unsigned long nb_cpu;
     unsigned long max_ages;
+    unsigned long nb_evaluations;	/* protected by best_mutex */
+    unsigned long nb_dropped;	/* protected by best_mutex */
+    unsigned long nb_screened;	/* protected by best_mutex */
     apr_time_t inactivity_timeout;
     apr_time_t last_best_date;
     apr_time_t init_time;
     apr_time_t death_date;
+    volatile apr_uint32_t over;	/* set once a timeout expired or the run was cancelled, by any thread */
     float best_score;
     float crossover_p;
     float mutation_p;
+    unsigned int seed;		/* rand_r state of the thread running ga_run */
+    napr_galife_tuning_t tuning;
 };
 
-static inline void beeing_init(napr_galife_t *ga, beeing_t *beeing)
+/*
+ * A subpopulation bred by its own thread, the best individuals emigrate to
+ * another island every tuning.migration_interval generations.
+ */
+typedef struct island_t
+{
+    napr_galife_t *ga;
+    struct island_t *islands;	/* all of them, to find the destination of migrants */
+    population_t population;	/* members can hold the whole population */
+    apr_thread_mutex_t *mailbox_mutex;
+    struct island_t *mailbox;	/* islands whose travellers were sent here, protected by mailbox_mutex */
+    struct island_t *next_sender;	/* chaining of the mailbox this island sent its travellers to */
+    beeing_t *travellers;	/* copies of the nb_migrants best individuals sent */
+    beeing_t **ranked;		/* the members sorted to find the best ones, as big as members */
+    volatile apr_uint32_t travelling;	/* set until the travellers are received */
+    apr_thread_mutex_t *snapshot_mutex;	/* shared by the islands, NULL if the state is never saved */
+    beeing_t *snapshot;		/* copy of the population saved by the checkpoints, protected by snapshot_mutex */
+    beeing_t **snapshot_members;	/* the whole snapshot of all the islands, this one's slice included */
+    unsigned long snapshot_age;	/* generation of the snapshot, protected by snapshot_mutex */
+    unsigned long current_age;
+    unsigned int seed;		/* rand_r state, mate selection of islands don't share a RNG */
+    void **scratch;		/* chromosomes of the surplus offspring, NULL without surrogate */
+    void *chrom_data;		/* private data of the evaluations, see chrom_worker */
+    unsigned int idx;
+} island_t;
+
+/* Steady state breeding, the population and the counter of births are protected by mutex */
+typedef struct steady_t
+{
+    napr_galife_t *ga;
+    apr_thread_mutex_t *mutex;
+    unsigned long nb_births;
+    beeing_t *snapshot;		/* copy of the population saved by the checkpoints, NULL if it is never saved */
+    beeing_t **snapshot_members;
+    int saving;			/* set while a worker saves the snapshot, the others don't touch it */
+} steady_t;
+
+/*
+ * A steady state breeder: the parents are copied into its own beeings under
+ * the mutex, the child is bred and evaluated out of it, then swapped with
+ * the loser it replaces.
+ */
+typedef struct steady_worker_t
+{
+    steady_t *steady;
+    beeing_t father;
+    beeing_t child;
+    void **scratch;
+    void *chrom_data;
+    unsigned int seed;
+} steady_worker_t;
+
+/* Add the score of an individual to the normal equations */
+static void surrogate_learn(surrogate_t *surrogate, const float *features, float score)
+{
+    double x[SURROGATE_DIM];
+    unsigned long i, j;
+
+    x[0] = 1.0;
+    for (i = 1; i < surrogate->dim; i++)
+	x[i] = features[i - 1];
+    for (i = 0; i < surrogate->dim; i++) {
+	for (j = 0; j < surrogate->dim; j++)
+	    surrogate->xtx[i * SURROGATE_DIM + j] = SURROGATE_FORGET * surrogate->xtx[i * SURROGATE_DIM + j] + x[i] * x[j];
+	surrogate->xty[i] = SURROGATE_FORGET * surrogate->xty[i] + x[i] * score;
+    }
+    surrogate->nb_samples++;
+}
+
+/*
+ * Solve (XtX + ridge) w = Xty by a Cholesky decomposition, the intercept is
+ * not penalised. Return 0 if there are too few samples yet.
+ */
+static int surrogate_fit(surrogate_t *surrogate)
+{
+    double a[SURROGATE_DIM * SURROGATE_DIM], y[SURROGATE_DIM];
+    double ridge = 0.0, sum;
+    unsigned long dim = surrogate->dim, i, j, k;
+
+    if (surrogate->nb_samples < 2UL * dim)
+	return 0;
+
+    for (i = 1; i < dim; i++)
+	ridge += surrogate->xtx[i * SURROGATE_DIM + i];
+    ridge = SURROGATE_RIDGE * ((dim > 1UL) ? ridge / (dim - 1UL) : 0.0) + 1e-9;
+    memcpy(a, surrogate->xtx, sizeof(a));
+    for (i = 1; i < dim; i++)
+	a[i * SURROGATE_DIM + i] += ridge;
+
+    /* Lower triangle of a is overwritten by L, a = L.Lt */
+    for (j = 0; j < dim; j++) {
+	sum = a[j * SURROGATE_DIM + j];
+	for (k = 0; k < j; k++)
+	    sum -= a[j * SURROGATE_DIM + k] * a[j * SURROGATE_DIM + k];
+	if (sum <= 0.0)
+	    return 0;
+	a[j * SURROGATE_DIM + j] = sqrt(sum);
+	for (i = j + 1; i < dim; i++) {
+	    sum = a[i * SURROGATE_DIM + j];
+	    for (k = 0; k < j; k++)
+		sum -= a[i * SURROGATE_DIM + k] * a[j * SURROGATE_DIM + k];
+	    a[i * SURROGATE_DIM + j] = sum / a[j * SURROGATE_DIM + j];
+	}
+    }
+    /* L.y = Xty then Lt.w = y */
+    for (i = 0; i < dim; i++) {
+	sum = surrogate->xty[i];
+	for (k = 0; k < i; k++)
+	    sum -= a[i * SURROGATE_DIM + k] * y[k];
+	y[i] = sum / a[i * SURROGATE_DIM + i];
+    }
+    for (i = dim; i-- > 0;) {
+	sum = y[i];
+	for (k = i + 1; k < dim; k++)
+	    sum -= a[k * SURROGATE_DIM + i] * surrogate->weights[k];
+	surrogate->weights[i] = sum / a[i * SURROGATE_DIM + i];
+    }
+    surrogate->nb_fitted = surrogate->nb_samples;
+
+    return 1;
+}
+
+/* Copy the weights of the surrogate model, solved again if enough scores came in, return 0 if there are none */
+static int surrogate_weights(napr_galife_t *ga, double *weights)
+{
+    surrogate_t *surrogate = ga->surrogate;
+    int rv;
+
+    apr_thread_mutex_lock(ga->best_mutex);
+    if ((0UL == surrogate->nb_fitted) || (surrogate->nb_samples >= surrogate->nb_fitted + SURROGATE_REFIT))
+	surrogate_fit(surrogate);
+    if (0 != (rv = (0UL != surrogate->nb_fitted)))
+	memcpy(weights, surrogate->weights, surrogate->dim * sizeof(double));
+    apr_thread_mutex_unlock(ga->best_mutex);
+
+    return rv;
+}
+
+static float surrogate_predict(napr_galife_t *ga, const double *weights, const void *chromosome)
+{
+    float features[NAPR_GALIFE_MAX_FEATURES];
+    double predicted = weights[0];
+    unsigned long i;
+
+    ga->chrom_features(ga->param, chromosome, features);
+    for (i = 1; i < ga->surrogate->dim; i++)
+	predicted += weights[i] * features[i - 1];
+
+    return (float) predicted;
+}
+
+/* Learn the score of an evaluated beeing, and check the prediction made for it, under best_mutex */
+static void surrogate_account(surrogate_t *surrogate, beeing_t *beeing, const float *features)
+{
+    double delta_predicted, delta_score;
+
+    surrogate_learn(surrogate, features, beeing->score);
+    if (-FLT_MAX == beeing->predicted)
+	return;
+
+    surrogate->error_sum += fabs(beeing->predicted - beeing->score);
+    surrogate->nb_predicted++;
+    delta_predicted = beeing->predicted - surrogate->mean_predicted;
+    delta_score = beeing->score - surrogate->mean_score;
+    surrogate->mean_predicted += delta_predicted / surrogate->nb_predicted;
+    surrogate->mean_score += delta_score / surrogate->nb_predicted;
+    surrogate->m2_predicted += delta_predicted * (beeing->predicted - surrogate->mean_predicted);
+    surrogate->m2_score += delta_score * (beeing->score - surrogate->mean_score);
+    surrogate->comoment += delta_predicted * (beeing->score - surrogate->mean_score);
+    beeing->predicted = -FLT_MAX;
+}
+
+/* Print a best individual */
+static void ga_display_best(napr_galife_t *ga, apr_interval_time_t time, float score, const void *chromosome)
+{
+    fprintf(stdout, "[%" APR_TIME_T_FMT " sec] best: score[%f]: ", apr_time_sec(time), score);
+    fflush(stdout);
+    ga->chrom_display(ga->param, chromosome);
+}
+
+/* Hand a new best individual over to the reporter thread, under best_mutex */
+static void ga_report_publish(napr_galife_t *ga, apr_interval_time_t time, float score, const void *chromosome)
+{
+    reporter_t *reporter = ga->reporter;
+    report_slot_t *slot = &(reporter->slots[reporter->back]);
+
+    ga->chrom_copy(ga->param, chromosome, slot->chromosome);
+    slot->time = time;
+    slot->score = score;
+    reporter->back = apr_atomic_xchg32(&(reporter->published), reporter->back | REPORT_FRESH) & ~REPORT_FRESH;
+    /* The reporter tests published under the mutex before it waits, the signal can't come in between */
+    apr_thread_mutex_lock(reporter->mutex);
+    apr_thread_cond_signal(reporter->fresh);
+    apr_thread_mutex_unlock(reporter->mutex);
+}
+
+static void *APR_THREAD_FUNC ga_report_loop(apr_thread_t *thd, void *rec)
+{
+    napr_galife_t *ga = rec;
+    reporter_t *reporter = ga->reporter;
+    report_slot_t *slot;
+    int stop;
+
+    do {
+	apr_thread_mutex_lock(reporter->mutex);
+	while (!(apr_atomic_read32(&(reporter->published)) & REPORT_FRESH) && !reporter->stop)
+	    apr_thread_cond_wait(reporter->fresh, reporter->mutex);
+	/* Read before the last look, the best published before the stop is printed */
+	stop = reporter->stop;
+	apr_thread_mutex_unlock(reporter->mutex);
+	if (apr_atomic_read32(&(reporter->published)) & REPORT_FRESH) {
+	    reporter->front = apr_atomic_xchg32(&(reporter->published), reporter->front) & ~REPORT_FRESH;
+	    slot = &(reporter->slots[reporter->front]);
+	    ga_display_best(ga, slot->time, slot->score, slot->chromosome);
+	}
+    } while (!stop);
+
+    apr_thread_exit(thd, APR_SUCCESS);
+
+    return NULL;
+}
+
+/* Print the best individuals of napr_galife_init or ga_run in a thread of their own, if they can be copied */
+static apr_status_t ga_report_start(napr_galife_t *ga)
 {
     char errbuf[128];
+    reporter_t *reporter;
+    int i;
     apr_status_t status;
 
-    beeing->born = 0;
-    beeing->score = (ga->chrom_fitness) (ga->param, beeing->chromosome);
+    if ((NULL == ga->chrom_display) || (NULL == ga->chrom_copy))
+	return APR_SUCCESS;
+
+    reporter = apr_pcalloc(ga->pool, sizeof(reporter_t));
+    for (i = 0; i < 3; i++)
+	ga->chrom_allocat(ga->param, ga->pool, &(reporter->slots[i].chromosome));
+    reporter->back = 0;
+    reporter->published = 1;
+    reporter->front = 2;
+    reporter->stop = 0;
+    if (APR_SUCCESS != (status = apr_thread_mutex_create(&(reporter->mutex), APR_THREAD_MUTEX_DEFAULT, ga->pool))) {
+	DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_thread_cond_create(&(reporter->fresh), ga->pool))) {
+	DEBUG_ERR("error calling apr_thread_cond_create: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    /* No best is found before the evaluations go on, the reporter is set before any can be published */
+    ga->reporter = reporter;
+    if (APR_SUCCESS != (status = apr_thread_create(&(reporter->thread), NULL, ga_report_loop, ga, ga->pool))) {
+	DEBUG_ERR("error calling apr_thread_create: %s", apr_strerror(status, errbuf, 128));
+	ga->reporter = NULL;
+	return status;
+    }
+
+    return APR_SUCCESS;
+}
+
+/* Once every evaluating thread is done: the reporter prints the last best published, the next ones are printed at once */
+static void ga_report_stop(napr_galife_t *ga)
+{
+    reporter_t *reporter = ga->reporter;
+    apr_status_t status;
+
+    if (NULL == reporter)
+	return;
+    apr_thread_mutex_lock(reporter->mutex);
+    reporter->stop = 1;
+    apr_thread_cond_signal(reporter->fresh);
+    apr_thread_mutex_unlock(reporter->mutex);
+    if (APR_SUCCESS != apr_thread_join(&status, reporter->thread))
+	DEBUG_ERR("error calling apr_thread_join");
+    ga->reporter = NULL;
+}
+
+/* Account the final score of a beeing, dropped is 1 if it stopped racing before race_max_samples */
+static void beeing_account(napr_galife_t *ga, beeing_t *beeing, int dropped)
+{
+    float features[NAPR_GALIFE_MAX_FEATURES];
+    char errbuf[128];
+    int learn = (NULL != ga->surrogate) && (-FLT_MAX != beeing->score);
+    apr_status_t status;
+
+    if (learn)
+	ga->chrom_features(ga->param, beeing->chromosome, features);
     if (APR_SUCCESS != (status = apr_thread_mutex_lock(ga->best_mutex))) {
 	DEBUG_ERR("error calling apr_thread_mutex_lock: %s", apr_strerror(status, errbuf, 128));
 	return;
     }
+    ga->nb_evaluations++;
+    if (dropped)
+	ga->nb_dropped++;
+    if (learn)
+	surrogate_account(ga->surrogate, beeing, features);
     if (beeing->score > (ga->best_score)) {
+	napr_galife_best_t *best;
 	apr_time_t now;
 
 	now = apr_time_now();
 	ga->best_score = beeing->score;
 	ga->last_best_date = now;
-	fprintf(stdout, "[%" APR_TIME_T_FMT " sec] best: score[%f]: ", apr_time_sec(now - ga->init_time), beeing->score);
-	fflush(stdout);
-	ga->chrom_display(ga->param, beeing->chromosome);
+	best = apr_array_push(ga->best_history);
+	best->time = now - ga->init_time;
+	best->score = beeing->score;
+	if (NULL != ga->best_chromosome) {
+	    ga->chrom_copy(ga->param, beeing->chromosome, ga->best_chromosome);
+	    ga->best_kept_score = beeing->score;
+	}
+	if (NULL != ga->reporter)
+	    ga_report_publish(ga, best->time, beeing->score, beeing->chromosome);
+	else if (NULL != ga->chrom_display)
+	    ga_display_best(ga, best->time, beeing->score, beeing->chromosome);
     }
     if (APR_SUCCESS != (status = apr_thread_mutex_unlock(ga->best_mutex))) {
 	DEBUG_ERR("error calling apr_thread_mutex_unlock: %s", apr_strerror(status, errbuf, 128));
@@ -96,61 +511,343 @@ static inline void beeing_init(napr_galife_t *ga, beeing_t *beeing)
     }
 }
 
-static int beeing_compare_score(const void *b1, const void *b2)
+/* Score a beeing, the caller accounts it */
+static inline void beeing_evaluate(napr_galife_t *ga, void *worker, beeing_t *beeing)
 {
-    const beeing_t *beeing1 = b1;
-    const beeing_t *beeing2 = b2;
+    beeing->score = (ga->chrom_fitness) (ga->param, worker, beeing->chromosome);
+}
+
+/* Evaluate a beeing, the caller resets born once no selection can read it */
+static inline void beeing_init(napr_galife_t *ga, void *worker, beeing_t *beeing)
+{
+    beeing_evaluate(ga, worker, beeing);
+    beeing_account(ga, beeing, 0);
+}
+
+/* Allocate the private data of an evaluating thread, NULL without chrom_worker */
+static void *ga_worker_make(napr_galife_t *ga, apr_pool_t *pool)
+{
+    void *worker = NULL;
+
+    if (NULL != ga->chrom_worker)
+	ga->chrom_worker(ga->param, pool, &worker);
+
+    return worker;
+}
+
+/* Run by napr_threadpool_init on the thread of napr_galife_init, one thread after the other */
+static apr_status_t napr_galife_init_threadpool_thread(void *ctx, apr_pool_t *pool, void **thread_ctx)
+{
+    napr_galife_t *ga = ctx;
+    ga_thread_t *thread = &(ga->threads[ga->nb_threads++]);
+
+    thread->chrom_data = ga_worker_make(ga, pool);
+    thread->scratch = NULL;
+    apr_pool_create(&(thread->pool), pool);
+    (*thread_ctx) = thread;
+
+    return APR_SUCCESS;
+}
 
-    if (beeing1->score > beeing2->score) {
+/* Return 1 if one of the timeouts expired or the run was cancelled, the next calls then only read over */
+static inline int ga_is_over(napr_galife_t *ga)
+{
+    if (apr_atomic_read32(&(ga->over)))
 	return 1;
+    if (0 != ga->inactivity_timeout) {
+	apr_time_t now;
+
+	now = apr_time_now();
+	if (ga->inactivity_timeout < (now - ga->last_best_date)) {
+	    DEBUG_DBG("Genetic algorithm timeouted");
+	    apr_atomic_set32(&(ga->over), 1);
+	    return 1;
+	}
     }
+    if ((apr_time_t) 0UL != ga->death_date) {
+	apr_time_t now;
 
-    return -1;
+	now = apr_time_now();
+	if (ga->death_date < now) {
+	    DEBUG_DBG("Genetic algorithm fixed-timeouted");
+	    apr_atomic_set32(&(ga->over), 1);
+	    return 1;
+	}
+    }
+
+    return 0;
 }
 
-typedef struct threadpool_data_t
+/*
+ * Run one rung of the race of a child, the caller accounts it once it stops
+ * racing. A rung cut by the end of the run keeps the score of the previous one.
+ */
+static inline void beeing_race(napr_galife_t *ga, void *worker, beeing_t *beeing)
 {
-    /* The beeing which will be fitnessed */
-    beeing_t *beeing;
-    /* The heap in which he will be inserted */
-    napr_heap_t *heap;
-} threadpool_data_t;
+    float score, error;
+
+    score = (ga->chrom_race) (ga->param, worker, beeing->chromosome, beeing->race_samples, beeing->threshold, &error);
+    if ((-FLT_MAX == score) && ga_is_over(ga))
+	return;
+    beeing->score = score;
+    beeing->error = error;
+    beeing->scored = 1;
+}
+
+static inline unsigned long ga_rand_idx(unsigned int *seed, unsigned long nb)
+{
+    return (unsigned long) (nb * (rand_r(seed) / (RAND_MAX + 1.0)));
+}
+
+/*
+ * Draw tournament_size members that are not waiting for their evaluation,
+ * return the best (or the worst) one, NULL if none was found. The bigger
+ * the tournament, the stronger the selection pressure. A father of a child
+ * not bred yet can't be the worst.
+ */
+static beeing_t *ga_tournament(const napr_galife_t *ga, const population_t *population, unsigned int *seed, int best,
+			       const beeing_t *exclude)
+{
+    beeing_t *winner = NULL, *candidate;
+    unsigned long l, nb_drawn = 0UL;
+
+    if (0UL == population->nb_members)
+	return NULL;
+
+    /* At most half of the members are children, a few more draws always find parents */
+    for (l = 0; (nb_drawn < ga->tuning.tournament_size) && (l < 16UL * population->nb_members); l++) {
+	candidate = population->members[ga_rand_idx(seed, population->nb_members)];
+	if ((0 != candidate->born) || (exclude == candidate) || (!best && candidate->is_father))
+	    continue;
+	nb_drawn++;
+	if ((NULL == winner) || (best ? (candidate->score > winner->score) : (candidate->score < winner->score)))
+	    winner = candidate;
+    }
+
+    return winner;
+}
+
+static inline void ga_offspring(napr_galife_t *ga, const beeing_t *father, void *chromosome, unsigned int *seed)
+{
+    /*
+     * Babies herits from the ancients, here we must check the probability of mutation
+     * Prob of Crossover must be check in the function for each unit copied into the chromosome there's a prob. 
+     * crossover_p that this unit came from the other parent.
+     */
+    ga->chrom_crossvr(ga->param, ga->crossover_p, father->chromosome, chromosome, seed);
+    if (ga->mutation_p > ((float) rand_r(seed) / (RAND_MAX + 1.0f)))
+	ga->chrom_mutation(ga->param, ga->mutation_p, chromosome, seed);
+}
+
+/*
+ * The best of a tournament is the father, the worst of another one becomes a
+ * child, still to be bred. Return NULL if no parent was found.
+ */
+static beeing_t *ga_select(napr_galife_t *ga, population_t *population, unsigned int *seed)
+{
+    beeing_t *father, *child;
+
+    if ((NULL == (father = ga_tournament(ga, population, seed, 1, NULL)))
+	|| (NULL == (child = ga_tournament(ga, population, seed, 0, father))))
+	return NULL;
+
+    child->born = 1;
+    child->father = father;
+
+    return child;
+}
+
+/*
+ * Cross the father of a selected child into it. Once the surrogate model is
+ * solved, the loser is first copied into the scratch chromosomes to breed
+ * surrogate_surplus other offspring of the same parents, the child keeps the
+ * one with the best predicted score (unless it is a holdout child).
+ */
+static void ga_breed(napr_galife_t *ga, beeing_t *child, unsigned int *seed, void **scratch)
+{
+    double weights[SURROGATE_DIM];
+    const beeing_t *father = child->father;
+    void *chromosome;
+    float predicted, best;
+    unsigned long l;
+
+    child->father = NULL;
+    child->predicted = -FLT_MAX;
+    if ((NULL == scratch) || !surrogate_weights(ga, weights)) {
+	ga_offspring(ga, father, child->chromosome, seed);
+	return;
+    }
+
+    if (0UL == ga_rand_idx(seed, SURROGATE_HOLDOUT)) {
+	ga_offspring(ga, father, child->chromosome, seed);
+	child->predicted = surrogate_predict(ga, weights, child->chromosome);
+	return;
+    }
 
-static apr_status_t napr_galife_process_threadpool_data(void *ctx, void *data)
+    for (l = 0; l < ga->tuning.surrogate_surplus; l++)
+	ga->chrom_copy(ga->param, child->chromosome, scratch[l]);
+    ga_offspring(ga, father, child->chromosome, seed);
+    best = surrogate_predict(ga, weights, child->chromosome);
+    for (l = 0; l < ga->tuning.surrogate_surplus; l++) {
+	ga_offspring(ga, father, scratch[l], seed);
+	if ((predicted = surrogate_predict(ga, weights, scratch[l])) > best) {
+	    /* The chromosome of the child goes back to the scratch */
+	    chromosome = child->chromosome;
+	    child->chromosome = scratch[l];
+	    scratch[l] = chromosome;
+	    best = predicted;
+	}
+    }
+}
+
+/* Allocate the scratch chromosomes of a breeding thread, NULL if there is no surplus offspring */
+static void **ga_scratch_make(napr_galife_t *ga)
+{
+    void **scratch;
+    unsigned long l;
+
+    if ((NULL == ga->surrogate) || (0UL == ga->tuning.surrogate_surplus))
+	return NULL;
+
+    scratch = apr_palloc(ga->pool, ga->tuning.surrogate_surplus * sizeof(void *));
+    for (l = 0; l < ga->tuning.surrogate_surplus; l++)
+	ga->chrom_allocat(ga->param, ga->pool, &(scratch[l]));
+
+    return scratch;
+}
+
+/*
+ * Rank last a child predicted to be rejected, or to score below the loser it
+ * replaces (whose score it still holds), unless it is drawn to keep exploring.
+ * Return 1 if the child is screened.
+ */
+static int ga_screen(napr_galife_t *ga, beeing_t *child, unsigned int *seed)
+{
+    float predicted;
+
+    if ((NULL == ga->chrom_estimate) || (100UL <= ga->tuning.screen_percent))
+	return 0;
+
+    predicted = ga->chrom_estimate(ga->param, child->chromosome);
+    if (((-FLT_MAX != predicted) && (predicted >= child->score))
+	|| (ga_rand_idx(seed, 100UL) < ga->tuning.screen_percent))
+	return 0;
+
+    child->score = -FLT_MAX;
+    apr_thread_mutex_lock(ga->best_mutex);
+    ga->nb_screened++;
+    apr_thread_mutex_unlock(ga->best_mutex);
+
+    return 1;
+}
+
+/* Return 1 if the children are raced instead of evaluated by chrom_fitness */
+static inline int ga_races(const napr_galife_t *ga)
+{
+    return (NULL != ga->chrom_race) && (0UL != ga->tuning.race_first_samples);
+}
+
+static apr_status_t napr_galife_process_threadpool_data(void *ctx, void *thread_ctx, void *data)
 {
     napr_galife_t *ga = ctx;
-    threadpool_data_t *tp_data = data;
+    ga_thread_t *thread = thread_ctx;
+    beeing_t *beeing = data;
 
-    beeing_init(ga, tp_data->beeing);
-    if (0 > napr_heap_insert_r(tp_data->heap, tp_data->beeing)) {
-	fprintf(stderr, "%s: error calling napr_heap_insert_r in %d\n", __FUNCTION__, __LINE__);
-	return APR_ENOMEM;
+    if (NULL == beeing->chromosome) {
+	/* One of the initial population, left unborn once the time is over */
+	if (ga_is_over(ga))
+	    return APR_SUCCESS;
+	ga->chrom_allocat(ga->param, thread->pool, &(beeing->chromosome));
+	ga->chrom_randomz(ga->param, beeing->chromosome, (unsigned long) (beeing - ga->newborns), &(beeing->seed));
+	beeing_evaluate(ga, thread->chrom_data, beeing);
     }
+    else if (NULL != beeing->father) {
+	/* A child of the generation, its race waits for all the others; left unbred once the time is over */
+	if (ga_is_over(ga))
+	    return APR_SUCCESS;
+	ga_breed(ga, beeing, &(beeing->seed), thread->scratch);
+	if (ga_screen(ga, beeing, &(beeing->seed)))
+	    beeing->born = 2;
+	else if (!ga_races(ga))
+	    beeing_evaluate(ga, thread->chrom_data, beeing);
+    }
+    else if (0 != beeing->race_samples)
+	beeing_race(ga, thread->chrom_data, beeing);
+    else
+	beeing_init(ga, thread->chrom_data, beeing);
 
     return APR_SUCCESS;
 }
 
+void napr_galife_tuning_default(napr_galife_tuning_t *tuning)
+{
+    tuning->nb_islands = 1UL;
+    tuning->migration_interval = 10UL;
+    tuning->nb_migrants = 2UL;
+    tuning->topology = NAPR_GALIFE_RING;
+    tuning->steady_state = 0;
+    tuning->tournament_size = 3UL;
+    tuning->race_first_samples = 4UL;
+    tuning->race_max_samples = 32UL;
+    tuning->screen_percent = 10UL;
+    tuning->surrogate_surplus = 3UL;
+}
+
+/* Put back the counters, random numbers and timeouts of a saved state, init then puts back its population */
+static void ga_restore(napr_galife_t *ga, const napr_galife_state_t *state)
+{
+    apr_time_t now, init_time;
+    unsigned long l;
+
+    /* The timeouts count the whole run, the saved part included */
+    now = apr_time_now();
+    init_time = now - state->run_time;
+    if ((apr_time_t) 0UL != ga->death_date)
+	ga->death_date += init_time - ga->init_time;
+    ga->init_time = init_time;
+    ga->last_best_date = init_time + state->best_time;
+    ga->last_checkpoint = now;
+
+    ga->seed = state->seed;
+    ga->current_age = state->nb_ages;
+    ga->nb_evaluations = state->nb_evaluations;
+    ga->nb_dropped = state->nb_dropped;
+    ga->nb_screened = state->nb_screened;
+    ga->best_score = state->best_score;
+    ga->best_history->nelts = 0;
+    for (l = 0; l < state->nb_history; l++)
+	*(napr_galife_best_t *) apr_array_push(ga->best_history) = state->history[l];
+}
+
 apr_status_t napr_galife_init(apr_pool_t *pool, unsigned long pop_size, unsigned long max_ages,
-			      unsigned long inactivity_timeout, unsigned long fixed_timeout, unsigned long nb_cpu, void *rec,
-			      chrom_allocat_callback_fn_t *chrom_allocat, chrom_randomz_callback_fn_t *chrom_randomz,
-			      chrom_display_callback_fn_t *chrom_display, chrom_fitness_callback_fn_t *chrom_fitness,
-			      float crossover_p, chrom_crossvr_callback_fn_t *chrom_crossvr, float mutation_p,
-			      chrom_mutation_callback_fn_t *chrom_mutation, napr_galife_t **ga)
+			      unsigned long inactivity_timeout, unsigned long fixed_timeout, unsigned long nb_cpu,
+			      unsigned int seed, void *rec, chrom_allocat_callback_fn_t *chrom_allocat,
+			      chrom_randomz_callback_fn_t *chrom_randomz, chrom_display_callback_fn_t *chrom_display,
+			      chrom_fitness_callback_fn_t *chrom_fitness, chrom_worker_callback_fn_t *chrom_worker,
+			      chrom_copy_callback_fn_t *chrom_copy, float crossover_p, chrom_crossvr_callback_fn_t *chrom_crossvr, float mutation_p,
+			      chrom_mutation_callback_fn_t *chrom_mutation, const napr_galife_state_t *state,
+			      napr_galife_t **ga)
 {
     char errbuf[128];
-    beeing_t *beeing;
-    apr_pool_t *local_pool, *tp_pool;
+    beeing_t *beeing, *best = NULL;
+    apr_pool_t *local_pool;
     char date[APR_RFC822_DATE_LEN];
-    unsigned long l;
+    unsigned long l, nb_restored = 0UL;
     apr_status_t status;
 
-    srand((unsigned int) time(NULL));
     apr_pool_create(&local_pool, pool);
     (*ga) = apr_palloc(local_pool, sizeof(struct napr_galife_t));
     (*ga)->pool = local_pool;
-    (*ga)->population_past = napr_heap_make_r((*ga)->pool, &beeing_compare_score);
+    (*ga)->population.members = apr_palloc((*ga)->pool, pop_size * sizeof(beeing_t *));
+    (*ga)->population.nb_members = 0UL;
+    (*ga)->seed = seed;
+    (*ga)->over = 0;
 
     (*ga)->current_age = 0UL;
+    (*ga)->nb_evaluations = 0UL;
+    (*ga)->nb_dropped = 0UL;
+    (*ga)->nb_screened = 0UL;
+    (*ga)->best_history = apr_array_make((*ga)->pool, 64, sizeof(napr_galife_best_t));
     (*ga)->population_size = pop_size;
     (*ga)->max_ages = max_ages;
     (*ga)->inactivity_timeout = apr_time_from_sec(inactivity_timeout);
@@ -168,10 +865,24 @@ apr_status_t napr_galife_init(apr_pool_t *pool, unsigned long pop_size, unsigned
     (*ga)->chrom_randomz = chrom_randomz;
     (*ga)->chrom_display = chrom_display;
     (*ga)->chrom_fitness = chrom_fitness;
+    (*ga)->chrom_worker = chrom_worker;
     (*ga)->crossover_p = crossover_p;
     (*ga)->chrom_crossvr = chrom_crossvr;
     (*ga)->mutation_p = mutation_p;
     (*ga)->chrom_mutation = chrom_mutation;
+    (*ga)->chrom_race = NULL;
+    (*ga)->chrom_estimate = NULL;
+    (*ga)->chrom_features = NULL;
+    (*ga)->chrom_copy = chrom_copy;
+    (*ga)->surrogate = NULL;
+    (*ga)->best_chromosome = NULL;
+    (*ga)->best_kept_score = -FLT_MAX;
+    (*ga)->reporter = NULL;
+    (*ga)->checkpoint = NULL;
+    (*ga)->nb_cpu = nb_cpu;
+    (*ga)->threads = apr_palloc((*ga)->pool, nb_cpu * sizeof(ga_thread_t));
+    (*ga)->nb_threads = 0UL;
+    napr_galife_tuning_default(&((*ga)->tuning));
 
     if (APR_SUCCESS != (status = apr_thread_mutex_create(&((*ga)->best_mutex), APR_THREAD_MUTEX_DEFAULT, (*ga)->pool))) {
 	DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
@@ -180,194 +891,930 @@ apr_status_t napr_galife_init(apr_pool_t *pool, unsigned long pop_size, unsigned
 
     if (APR_SUCCESS !=
 	(status =
-	 napr_threadpool_init(&((*ga)->threadpool), (*ga), nb_cpu, napr_galife_process_threadpool_data, (*ga)->pool))) {
+	 napr_threadpool_init(&((*ga)->threadpool), (*ga), nb_cpu, napr_galife_init_threadpool_thread,
+			      napr_galife_process_threadpool_data, (*ga)->pool))) {
 	DEBUG_ERR("error calling napr_threadpool_init: %s", apr_strerror(status, errbuf, 128));
 	return status;
     }
-    /* Because we want to collect garbage */
-    apr_pool_create(&tp_pool, local_pool);
+
+    if (NULL != state) {
+	if ((0UL == state->nb_members) || (NULL == chrom_copy)) {
+	    DEBUG_ERR("can't restore %lu individuals without chrom_copy", state->nb_members);
+	    return APR_EINVAL;
+	}
+	ga_restore(*ga, state);
+	nb_restored = (state->nb_members < pop_size) ? state->nb_members : pop_size;
+    }
+
+    /* The bests of the initial population are printed as the ones of ga_run */
+    if (APR_SUCCESS != (status = ga_report_start(*ga)))
+	return status;
 
     /*
-     * Now we fill the heap with random generated beeing.
+     * Now we fill the population: the restored beeings are copied, the
+     * missing ones are randomly generated, each one is allocated, randomized
+     * (with its own rand_r state) and evaluated by a thread of the pool.
      */
+    (*ga)->newborns = apr_palloc((*ga)->pool, pop_size * sizeof(struct beeing_t));
     for (l = 0; l < pop_size; l++) {
-	threadpool_data_t *tp_data;
+	beeing = &((*ga)->newborns[l]);
+	beeing->chromosome = NULL;
+	beeing->born = 0;
+	beeing->is_father = 0;
+	beeing->father = NULL;
+	beeing->race_samples = 0;
+	beeing->predicted = -FLT_MAX;
+	beeing->seed = (unsigned int) rand_r(&((*ga)->seed));
 
-	if (0 != (*ga)->inactivity_timeout) {
-	    apr_time_t now;
-
-	    now = apr_time_now();
-	    if ((*ga)->inactivity_timeout < (now - (*ga)->last_best_date)) {
-		DEBUG_DBG("Genetic algorithm timeouted");
-		break;
-	    }
+	if (l < nb_restored) {
+	    chrom_allocat(rec, (*ga)->pool, &(beeing->chromosome));
+	    chrom_copy(rec, state->chromosomes[l], beeing->chromosome);
+	    beeing->score = state->scores[l];
+	    if ((NULL == best) || (beeing->score > best->score))
+		best = beeing;
 	}
-	if ((apr_time_t) 0UL != (*ga)->death_date) {
-	    apr_time_t now;
-
-	    now = apr_time_now();
-	    if ((*ga)->death_date < now) {
-		DEBUG_DBG("Genetic algorithm fixed-timeouted");
-		break;
-	    }
-	}
-
-	beeing = apr_palloc((*ga)->pool, sizeof(struct beeing_t));
-	chrom_allocat(rec, (*ga)->pool, &(beeing->chromosome));
-	chrom_randomz(rec, beeing->chromosome);
-
-	tp_data = apr_palloc(tp_pool, sizeof(struct threadpool_data_t));
-	tp_data->beeing = beeing;
-	tp_data->heap = (*ga)->population_past;
-	if (APR_SUCCESS != (status = napr_threadpool_add((*ga)->threadpool, tp_data))) {
+	else if (APR_SUCCESS != (status = napr_threadpool_add((*ga)->threadpool, beeing))) {
 	    DEBUG_ERR("error calling napr_threadpool_add: %s", apr_strerror(status, errbuf, 128));
+	    ga_report_stop(*ga);
 	    return status;
 	}
-
     }
 
     if (APR_SUCCESS != (status = napr_threadpool_wait((*ga)->threadpool))) {
 	DEBUG_ERR("error calling napr_threadpool_wait: %s", apr_strerror(status, errbuf, 128));
+	ga_report_stop(*ga);
 	return status;
     }
-    apr_pool_destroy(tp_pool);
+
+    /* The ones not born before a timeout are left out, the others are accounted by rank, the restored ones were */
+    for (l = 0; l < pop_size; l++) {
+	beeing = &((*ga)->newborns[l]);
+	if (NULL == beeing->chromosome)
+	    continue;
+	if (l >= nb_restored)
+	    beeing_account(*ga, beeing, 0);
+	(*ga)->population.members[(*ga)->population.nb_members++] = beeing;
+    }
+    ga_report_stop(*ga);
+
+    if ((NULL != chrom_display) && (NULL != best)) {
+	fprintf(stdout, "[%" APR_TIME_T_FMT " sec] restored: score[%f]: ", apr_time_sec(state->run_time), best->score);
+	chrom_display(rec, best->chromosome);
+    }
 
     return APR_SUCCESS;
 }
 
-apr_status_t ga_run(napr_galife_t *ga)
+apr_status_t napr_galife_set_tuning(napr_galife_t *ga, const napr_galife_tuning_t *tuning)
+{
+    if ((0UL == tuning->nb_islands) || (0UL == tuning->migration_interval) || (0UL == tuning->tournament_size)) {
+	DEBUG_ERR("invalid tuning: %lu islands, migration every %lu generations, tournaments of %lu",
+		  tuning->nb_islands, tuning->migration_interval, tuning->tournament_size);
+	return APR_EINVAL;
+    }
+    /* Each island needs a few individuals to breed and some more to send */
+    if ((tuning->nb_islands > 1UL)
+	&& ((ga->population_size / tuning->nb_islands) < (4UL + tuning->nb_migrants))) {
+	DEBUG_ERR("%lu individuals are not enough for %lu islands", ga->population_size, tuning->nb_islands);
+	return APR_EINVAL;
+    }
+    /* Migrants are copies of the best individuals of an island */
+    if ((tuning->nb_islands > 1UL) && (NULL == ga->chrom_copy)) {
+	DEBUG_ERR("islands need a chrom_copy callback");
+	return APR_EINVAL;
+    }
+    if ((0UL != tuning->race_first_samples) && (tuning->race_max_samples < tuning->race_first_samples)) {
+	DEBUG_ERR("invalid tuning: race of %lu to %lu samples", tuning->race_first_samples, tuning->race_max_samples);
+	return APR_EINVAL;
+    }
+    if (tuning->screen_percent > 100UL) {
+	DEBUG_ERR("invalid tuning: %lu%% of screened children evaluated", tuning->screen_percent);
+	return APR_EINVAL;
+    }
+    if (tuning->steady_state) {
+	if (tuning->nb_islands > 1UL) {
+	    DEBUG_ERR("steady state breeds a single population");
+	    return APR_EINVAL;
+	}
+	/* The parents are copied to be bred out of the lock of the population */
+	if (NULL == ga->chrom_copy) {
+	    DEBUG_ERR("steady state needs a chrom_copy callback");
+	    return APR_EINVAL;
+	}
+	/* Each worker holds a loser out of the tournaments while its child is evaluated */
+	if (ga->population_size < (ga->nb_cpu + 2UL * tuning->tournament_size)) {
+	    DEBUG_ERR("%lu individuals are not enough for tournaments of %lu with %lu threads", ga->population_size,
+		      tuning->tournament_size, ga->nb_cpu);
+	    return APR_EINVAL;
+	}
+    }
+    memcpy(&(ga->tuning), tuning, sizeof(napr_galife_tuning_t));
+
+    return APR_SUCCESS;
+}
+
+void napr_galife_set_race(napr_galife_t *ga, chrom_race_callback_fn_t *chrom_race)
+{
+    ga->chrom_race = chrom_race;
+}
+
+void napr_galife_set_estimate(napr_galife_t *ga, chrom_estimate_callback_fn_t *chrom_estimate)
+{
+    ga->chrom_estimate = chrom_estimate;
+}
+
+apr_status_t napr_galife_set_surrogate(napr_galife_t *ga, chrom_features_callback_fn_t *chrom_features,
+				       unsigned long nb_features)
+{
+    float features[NAPR_GALIFE_MAX_FEATURES];
+    beeing_t *beeing;
+    unsigned long l;
+
+    if (nb_features > NAPR_GALIFE_MAX_FEATURES) {
+	DEBUG_ERR("invalid surrogate: %lu features, at most %u", nb_features, NAPR_GALIFE_MAX_FEATURES);
+	return APR_EINVAL;
+    }
+    if (NULL == ga->chrom_copy) {
+	DEBUG_ERR("invalid surrogate: the surplus offspring need genes that can be copied");
+	return APR_EINVAL;
+    }
+    ga->chrom_features = chrom_features;
+    ga->surrogate = apr_pcalloc(ga->pool, sizeof(surrogate_t));
+    ga->surrogate->dim = nb_features + 1UL;
+
+    /* The initial population is the first training set */
+    for (l = 0; l < ga->population.nb_members; l++) {
+	beeing = ga->population.members[l];
+	if (-FLT_MAX == beeing->score)
+	    continue;
+	chrom_features(ga->param, beeing->chromosome, features);
+	surrogate_learn(ga->surrogate, features, beeing->score);
+    }
+
+    return APR_SUCCESS;
+}
+
+float napr_galife_predict(napr_galife_t *ga, const void *chromosome)
+{
+    double weights[SURROGATE_DIM];
+
+    if ((NULL == ga->surrogate) || !surrogate_weights(ga, weights))
+	return -FLT_MAX;
+
+    return surrogate_predict(ga, weights, chromosome);
+}
+
+void napr_galife_set_sync(napr_galife_t *ga, galife_sync_callback_fn_t *sync)
+{
+    ga->sync = sync;
+}
+
+static inline void ga_sync(napr_galife_t *ga)
+{
+    if (NULL != ga->sync)
+	ga->sync(ga->param);
+}
+
+void napr_galife_set_checkpoint(napr_galife_t *ga, unsigned long interval, galife_checkpoint_callback_fn_t *checkpoint)
+{
+    ga->checkpoint = checkpoint;
+    ga->checkpoint_interval = apr_time_from_sec(interval);
+    ga->last_checkpoint = apr_time_now();
+    ga->checkpoint_state.chromosomes = apr_palloc(ga->pool, ga->population_size * sizeof(void *));
+    ga->checkpoint_state.scores = apr_palloc(ga->pool, ga->population_size * sizeof(float));
+}
+
+/*
+ * Fill the state of the worker under best_mutex, save it outside of it. The
+ * caller keeps the chromosomes of members still meanwhile, a child still
+ * waiting for its evaluation is saved as the worst.
+ */
+static void ga_checkpoint(napr_galife_t *ga, beeing_t **members, unsigned long nb_members, unsigned long nb_ages)
 {
     char errbuf[128];
-    unsigned long era, born;
-    unsigned int mother_idx, i, pop_nmb;
-    apr_pool_t *tp_pool;	/* garbage collector */
-    napr_heap_t *population_future, *swap;
-    beeing_t *father, *mother, *buf;
+    napr_galife_state_t *state = &(ga->checkpoint_state);
+    apr_time_t now;
+    unsigned long l;
     apr_status_t status;
 
-    /*
-     * era(s) are generations.
-     */
-    population_future = napr_heap_make_r(ga->pool, &beeing_compare_score);
-
-    for (era = 0; era < ga->max_ages; era++) {
-	/*DEBUG_DBG("Era [%lu]", era); */
-	/* future population is the place where already processed and new born beeings go */
-	born = 1;
-
-	apr_pool_create(&tp_pool, ga->pool);
-
-	/* we go through the whole past population to see which survives and which fuck */
-	while (napr_heap_size(ga->population_past) > 1) {
-	    if (0 != ga->inactivity_timeout) {
-		apr_time_t now;
-
-		now = apr_time_now();
-		if (ga->inactivity_timeout < (now - ga->last_best_date)) {
-		    DEBUG_DBG("Genetic algorithm timeouted");
-		    era = ga->max_ages;
-		    break;
-		}
+    apr_thread_mutex_lock(ga->best_mutex);
+    now = apr_time_now();
+    for (l = 0; l < nb_members; l++) {
+	state->chromosomes[l] = members[l]->chromosome;
+	state->scores[l] = (0 != members[l]->born) ? -FLT_MAX : members[l]->score;
+    }
+    state->nb_members = nb_members;
+    state->nb_ages = nb_ages;
+    state->nb_evaluations = ga->nb_evaluations;
+    state->nb_dropped = ga->nb_dropped;
+    state->nb_screened = ga->nb_screened;
+    state->run_time = now - ga->init_time;
+    state->best_time = ga->last_best_date - ga->init_time;
+    state->history = (napr_galife_best_t *) ga->best_history->elts;
+    state->nb_history = ga->best_history->nelts;
+    state->best_score = ga->best_score;
+    state->seed = ga->seed;
+    apr_thread_mutex_unlock(ga->best_mutex);
+
+    ga->last_checkpoint = now;
+    if (APR_SUCCESS != (status = ga->checkpoint(ga->param, state)))
+	DEBUG_ERR("error calling checkpoint: %s", apr_strerror(status, errbuf, 128));
+}
+
+static inline int ga_checkpoint_due(const napr_galife_t *ga)
+{
+    return (NULL != ga->checkpoint) && ((apr_time_now() - ga->last_checkpoint) >= ga->checkpoint_interval);
+}
+
+static int ga_score_cmp(const void *a, const void *b)
+{
+    float score_a = *(const float *) a, score_b = *(const float *) b;
+
+    return (score_a > score_b) - (score_a < score_b);
+}
+
+/*
+ * Successive halving of the children of a generation: every child gets
+ * race_first_samples, then each rung doubles the samples of the children
+ * whose score plus error still reaches the median of the parents, a child
+ * below it would soon lose a tournament.
+ */
+static apr_status_t ga_race(napr_galife_t *ga, population_t *population, void *worker, napr_threadpool_t *threadpool)
+{
+    char errbuf[128];
+    beeing_t *child;
+    float *scores, cutoff = -FLT_MAX;
+    unsigned long l, nb_parents = 0UL, nb_racing, nb_samples;
+    int over;
+    apr_status_t status;
+
+    if (NULL == (scores = malloc(population->nb_members * sizeof(float)))) {
+	DEBUG_ERR("allocation error");
+	return APR_ENOMEM;
+    }
+    for (l = 0; l < population->nb_members; l++) {
+	child = population->members[l];
+	if (0 == child->born)
+	    scores[nb_parents++] = child->score;
+	else if ((1 == child->born) && (NULL == child->father)) {
+	    child->race_samples = 1;	/* enters the race */
+	    child->scored = 0;
+	}
+    }
+    if (0UL != nb_parents) {
+	qsort(scores, nb_parents, sizeof(float), ga_score_cmp);
+	cutoff = scores[nb_parents / 2];
+    }
+    free(scores);
+
+    for (nb_samples = ga->tuning.race_first_samples;;) {
+	nb_racing = 0UL;
+	for (l = 0; l < population->nb_members; l++) {
+	    child = population->members[l];
+	    if (0 == child->race_samples)
+		continue;
+	    child->race_samples = nb_samples;
+	    child->threshold = cutoff;
+	    nb_racing++;
+	    if (NULL == threadpool)
+		beeing_race(ga, worker, child);
+	    else if (APR_SUCCESS != (status = napr_threadpool_add(threadpool, child))) {
+		DEBUG_ERR("error calling napr_threadpool_add: %s", apr_strerror(status, errbuf, 128));
+		return status;
 	    }
-	    if ((apr_time_t) 0UL != ga->death_date) {
-		apr_time_t now;
-
-		now = apr_time_now();
-		if (ga->death_date < now) {
-		    DEBUG_DBG("Genetic algorithm fixed-timeouted");
-		    era = ga->max_ages;
-		    break;
-		}
+	}
+	if (0UL == nb_racing)
+	    break;
+	if ((NULL != threadpool) && (APR_SUCCESS != (status = napr_threadpool_wait(threadpool)))) {
+	    DEBUG_ERR("error calling napr_threadpool_wait: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	/* The next rung goes on from the samples of this one */
+	ga_sync(ga);
+
+	over = ga_is_over(ga);
+	for (l = 0; l < population->nb_members; l++) {
+	    child = population->members[l];
+	    if (0 == child->race_samples)
+		continue;
+	    if (over || (nb_samples >= ga->tuning.race_max_samples) || (-FLT_MAX == child->score)
+		|| (child->score + child->error < cutoff)) {
+		child->race_samples = 0;
+		/* Cut by the end of the run before any rung completed: not an evaluation, rank it last */
+		if (!child->scored)
+		    child->score = -FLT_MAX;
+		else
+		    beeing_account(ga, child, !over && (nb_samples < ga->tuning.race_max_samples)
+				   && (-FLT_MAX != child->score));
 	    }
+	}
+	/* Double the samples of the survivors, without going past race_max_samples */
+	nb_samples = (2UL * nb_samples < ga->tuning.race_max_samples) ? 2UL * nb_samples : ga->tuning.race_max_samples;
+    }
 
-	    /* extraction and check if the parents will die */
-	    /*DEBUG_DBG("Father extract / %lu", napr_heap_size(ga->population_past)); */
-	    if (NULL == (father = napr_heap_extract_r(ga->population_past)))
-		break;
+    return APR_SUCCESS;
+}
 
-	    /* This is a new beeing, don't mate him this time */
-	    if (0 != father->born) {
-		threadpool_data_t *tp_data;
+/*
+ * One generation: half of the population is replaced by children, each one
+ * bred from the winner of a tournament and the loser of another. Parents are
+ * drawn by the calling thread, then each child is bred (with its own rand_r
+ * state) and evaluated by the threadpool. If threadpool is NULL, the calling
+ * thread breeds them, then evaluates them with worker as private data.
+ * Raced children are evaluated once all of them are bred.
+ * Return APR_TIMEUP if a timeout expired.
+ */
+static apr_status_t ga_era(napr_galife_t *ga, population_t *population, unsigned int *seed, void **scratch,
+			   void *worker, napr_threadpool_t *threadpool)
+{
+    char errbuf[128];
+    beeing_t *child;
+    unsigned long l, nb_children;
+    apr_status_t status, rv = APR_SUCCESS;
 
-		/*DEBUG_DBG("new born"); */
-		tp_data = apr_palloc(tp_pool, sizeof(struct threadpool_data_t));
-		tp_data->beeing = father;
-		tp_data->heap = population_future;
-		if (APR_SUCCESS != (status = napr_threadpool_add(ga->threadpool, tp_data))) {
-		    DEBUG_ERR("error calling napr_threadpool_add: %s", apr_strerror(status, errbuf, 128));
-		    return status;
-		}
+    nb_children = population->nb_members / 2;
+    for (l = 0; l < nb_children; l++) {
+	if (ga_is_over(ga)) {
+	    rv = APR_TIMEUP;
+	    break;
+	}
+	if (NULL == (child = ga_select(ga, population, seed)))
+	    break;
+	if (NULL == threadpool) {
+	    ga_breed(ga, child, seed, scratch);
+	    if (ga_screen(ga, child, seed))
+		child->born = 2;
+	}
+	else {
+	    child->father->is_father = 1;
+	    child->seed = (unsigned int) rand_r(seed);
+	    if (APR_SUCCESS != (status = napr_threadpool_add(threadpool, child))) {
+		DEBUG_ERR("error calling napr_threadpool_add: %s", apr_strerror(status, errbuf, 128));
+		return status;
+	    }
+	}
+    }
+    if ((NULL != threadpool) && (APR_SUCCESS != (status = napr_threadpool_wait(threadpool)))) {
+	DEBUG_ERR("error calling napr_threadpool_wait: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    /* The threadpool gives up the children it had not bred yet once the time is over */
+    if ((NULL != threadpool) && ga_is_over(ga))
+	rv = APR_TIMEUP;
 
+    if ((APR_TIMEUP != rv) && ga_races(ga)) {
+	if (APR_SUCCESS != (status = ga_race(ga, population, worker, threadpool)))
+	    return status;
+    }
+    else {
+	for (l = 0; l < population->nb_members; l++) {
+	    child = population->members[l];
+	    if (1 != child->born)
 		continue;
+	    if (NULL != child->father) {
+		/* Left unbred by the threadpool, it stays the loser it was */
+		child->father = NULL;
+	    }
+	    else if ((NULL != threadpool) && !ga_races(ga)) {
+		/*
+		 * Already evaluated by the thread that bred it, the best and the
+		 * surrogate model don't depend on which thread finished first
+		 */
+		beeing_account(ga, child, 0);
+	    }
+	    else if ((APR_TIMEUP == rv) || ga_is_over(ga)) {
+		/* No time to evaluate it, rank it last */
+		rv = APR_TIMEUP;
+		child->score = -FLT_MAX;
+	    }
+	    else {
+		beeing_init(ga, worker, child);
 	    }
+	}
+    }
+    for (l = 0; l < population->nb_members; l++) {
+	population->members[l]->born = 0;
+	population->members[l]->is_father = 0;
+    }
+    ga_sync(ga);
 
-	    /*DEBUG_DBG("Mother get"); */
-	    pop_nmb = napr_heap_size(ga->population_past);
-	    mother_idx = (pop_nmb * rand() / (RAND_MAX + 1.0f));
-	    if (NULL == (mother = napr_heap_get_nth(ga->population_past, mother_idx))) {
-		/*DEBUG_DBG("Last.. insert father in pop."); */
-		if (0 > napr_heap_insert_r(population_future, father)) {
-		    fprintf(stderr, "%s: error calling napr_heap_insert_r in %d\n", __FUNCTION__, __LINE__);
-		    return APR_EGENERAL;
-		}
+    return rv;
+}
+
+/* Best score first */
+static int ga_beeing_cmp(const void *a, const void *b)
+{
+    float score_a = (*(beeing_t * const *) a)->score, score_b = (*(beeing_t * const *) b)->score;
+
+    return (score_a < score_b) - (score_a > score_b);
+}
+
+/*
+ * Send copies of the best individuals to another island, they stay in this
+ * one too. Nothing is sent until the previous copies were received.
+ */
+static void ga_island_emigrate(island_t *island)
+{
+    napr_galife_t *ga = island->ga;
+    const napr_galife_tuning_t *tuning = &(ga->tuning);
+    population_t *population = &(island->population);
+    island_t *dest;
+    unsigned long l;
+
+    if (apr_atomic_read32(&(island->travelling)))
+	return;
+
+    if (NAPR_GALIFE_RING == tuning->topology)
+	dest = &(island->islands[(island->idx + 1) % tuning->nb_islands]);
+    else
+	dest = &(island->islands[(island->idx + 1 + ga_rand_idx(&(island->seed), tuning->nb_islands - 1))
+				 % tuning->nb_islands]);
+
+    memcpy(island->ranked, population->members, population->nb_members * sizeof(beeing_t *));
+    qsort(island->ranked, population->nb_members, sizeof(beeing_t *), ga_beeing_cmp);
+    for (l = 0; l < tuning->nb_migrants; l++) {
+	ga->chrom_copy(ga->param, island->ranked[l]->chromosome, island->travellers[l].chromosome);
+	island->travellers[l].score = island->ranked[l]->score;
+    }
+
+    apr_atomic_set32(&(island->travelling), 1);
+    apr_thread_mutex_lock(dest->mailbox_mutex);
+    island->next_sender = dest->mailbox;
+    dest->mailbox = island;
+    apr_thread_mutex_unlock(dest->mailbox_mutex);
+}
+
+/* Copy the migrants received over the worst individuals, then let their islands send again */
+static void ga_island_immigrate(island_t *island)
+{
+    napr_galife_t *ga = island->ga;
+    population_t *population = &(island->population);
+    island_t *sender, *next;
+    beeing_t *worst;
+    unsigned long l, i;
+
+    apr_thread_mutex_lock(island->mailbox_mutex);
+    sender = island->mailbox;
+    island->mailbox = NULL;
+    apr_thread_mutex_unlock(island->mailbox_mutex);
+
+    for (; NULL != sender; sender = next) {
+	next = sender->next_sender;
+	for (l = 0; l < ga->tuning.nb_migrants; l++) {
+	    for (worst = population->members[0], i = 1; i < population->nb_members; i++)
+		if (population->members[i]->score < worst->score)
+		    worst = population->members[i];
+	    if (sender->travellers[l].score <= worst->score)
 		break;
+	    ga->chrom_copy(ga->param, sender->travellers[l].chromosome, worst->chromosome);
+	    worst->score = sender->travellers[l].score;
+	}
+	apr_atomic_set32(&(sender->travelling), 0);
+    }
+}
+
+/*
+ * Copy the population of an island into its slice of the snapshot, then save
+ * the whole snapshot if it is time to: the other islands wait to copy theirs
+ * meanwhile, the ones that didn't yet are saved as of their previous copy.
+ */
+static void ga_island_snapshot(island_t *island)
+{
+    napr_galife_t *ga = island->ga;
+    population_t *population = &(island->population);
+    unsigned long l, nb_ages = 0UL;
+
+    apr_thread_mutex_lock(island->snapshot_mutex);
+    for (l = 0; l < population->nb_members; l++) {
+	ga->chrom_copy(ga->param, population->members[l]->chromosome, island->snapshot[l].chromosome);
+	island->snapshot[l].score = population->members[l]->score;
+    }
+    island->snapshot_age = island->current_age;
+    if (ga_checkpoint_due(ga)) {
+	for (l = 0; l < ga->tuning.nb_islands; l++)
+	    if (island->islands[l].snapshot_age > nb_ages)
+		nb_ages = island->islands[l].snapshot_age;
+	ga_checkpoint(ga, island->snapshot_members, ga->population.nb_members, nb_ages);
+    }
+    apr_thread_mutex_unlock(island->snapshot_mutex);
+}
+
+static void *APR_THREAD_FUNC ga_island_loop(apr_thread_t *thd, void *rec)
+{
+    island_t *island = rec;
+    napr_galife_t *ga = island->ga;
+    apr_status_t status = APR_SUCCESS;
+
+    /* A restored run goes on from its last generation */
+    for (island->current_age = ga->current_age; island->current_age < ga->max_ages;) {
+	status = ga_era(ga, &(island->population), &(island->seed), island->scratch, island->chrom_data, NULL);
+	/* A generation cut by the end of the run is not counted, a resumed run goes on from the same one */
+	if (APR_SUCCESS != status)
+	    break;
+	island->current_age++;
+
+	if (0 == (island->current_age % ga->tuning.migration_interval))
+	    ga_island_emigrate(island);
+	ga_island_immigrate(island);
+	if (NULL != island->snapshot_mutex)
+	    ga_island_snapshot(island);
+    }
+    if (APR_TIMEUP == status)
+	status = APR_SUCCESS;
+
+    apr_thread_exit(thd, status);
+
+    return NULL;
+}
+
+static apr_status_t ga_run_islands(napr_galife_t *ga)
+{
+    char errbuf[128];
+    island_t *islands;
+    apr_thread_t **thread;
+    population_t *population;
+    apr_thread_mutex_t *snapshot_mutex = NULL;
+    beeing_t *snapshot = NULL, **snapshot_members = NULL;
+    unsigned long nb_islands = ga->tuning.nb_islands, l, i;
+    apr_status_t status, rv = APR_SUCCESS;
+
+    islands = apr_pcalloc(ga->pool, nb_islands * sizeof(island_t));
+    thread = apr_pcalloc(ga->pool, nb_islands * sizeof(apr_thread_t *));
+    /* The checkpoints save copies, the islands go on breeding meanwhile */
+    if (NULL != ga->checkpoint) {
+	if (APR_SUCCESS != (status = apr_thread_mutex_create(&snapshot_mutex, APR_THREAD_MUTEX_DEFAULT, ga->pool))) {
+	    DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	snapshot = apr_pcalloc(ga->pool, ga->population.nb_members * sizeof(beeing_t));
+	snapshot_members = apr_palloc(ga->pool, ga->population.nb_members * sizeof(beeing_t *));
+	for (l = 0; l < ga->population.nb_members; l++) {
+	    ga->chrom_allocat(ga->param, ga->pool, &(snapshot[l].chromosome));
+	    ga->chrom_copy(ga->param, ga->population.members[l]->chromosome, snapshot[l].chromosome);
+	    snapshot[l].score = ga->population.members[l]->score;
+	    snapshot_members[l] = &(snapshot[l]);
+	}
+    }
+    for (l = 0; l < nb_islands; l++) {
+	islands[l].ga = ga;
+	islands[l].islands = islands;
+	islands[l].idx = l;
+	islands[l].seed = (unsigned int) rand_r(&(ga->seed));
+	islands[l].scratch = ga_scratch_make(ga);
+	/* The threadpool is idle while the islands run, its threads lend their data */
+	islands[l].chrom_data = (l < ga->nb_threads) ? ga->threads[l].chrom_data : ga_worker_make(ga, ga->pool);
+	islands[l].population.members = apr_palloc(ga->pool, ga->population.nb_members * sizeof(beeing_t *));
+	islands[l].ranked = apr_palloc(ga->pool, ga->population.nb_members * sizeof(beeing_t *));
+	islands[l].travellers = apr_pcalloc(ga->pool, ga->tuning.nb_migrants * sizeof(beeing_t));
+	for (i = 0; i < ga->tuning.nb_migrants; i++)
+	    ga->chrom_allocat(ga->param, ga->pool, &(islands[l].travellers[i].chromosome));
+	if (APR_SUCCESS !=
+	    (status = apr_thread_mutex_create(&(islands[l].mailbox_mutex), APR_THREAD_MUTEX_DEFAULT, ga->pool))) {
+	    DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+    }
+
+    /* Deal the population, the order of the members is random enough; each island owns a slice of the snapshot */
+    for (l = 0; l < ga->population.nb_members; l++) {
+	population = &(islands[l % nb_islands].population);
+	population->members[population->nb_members++] = ga->population.members[l];
+    }
+    for (l = 0, i = 0; (NULL != snapshot) && (l < nb_islands); i += islands[l].population.nb_members, l++) {
+	islands[l].snapshot_mutex = snapshot_mutex;
+	islands[l].snapshot = snapshot + i;
+	islands[l].snapshot_members = snapshot_members;
+	islands[l].snapshot_age = ga->current_age;
+    }
+    for (l = 0; l < nb_islands; l++) {
+	if (APR_SUCCESS != (status = apr_thread_create(&(thread[l]), NULL, ga_island_loop, &(islands[l]), ga->pool))) {
+	    DEBUG_ERR("error calling apr_thread_create: %s", apr_strerror(status, errbuf, 128));
+	    rv = status;
+	    break;
+	}
+    }
+    /* Once one island died, the others run until a timeout or max_ages */
+    nb_islands = l;
+    for (l = 0; l < nb_islands; l++) {
+	if (APR_SUCCESS != apr_thread_join(&status, thread[l])) {
+	    DEBUG_ERR("error calling apr_thread_join");
+	    rv = APR_EGENERAL;
+	}
+	else if (APR_SUCCESS != status) {
+	    DEBUG_ERR("island %lu died: %s", l, apr_strerror(status, errbuf, 128));
+	    rv = status;
+	}
+	if (islands[l].current_age > ga->current_age)
+	    ga->current_age = islands[l].current_age;
+    }
+
+    /* Gather the survivors back into the main population, the travellers are only copies */
+    ga->population.nb_members = 0UL;
+    for (l = 0; l < ga->tuning.nb_islands; l++) {
+	memcpy(ga->population.members + ga->population.nb_members, islands[l].population.members,
+	       islands[l].population.nb_members * sizeof(beeing_t *));
+	ga->population.nb_members += islands[l].population.nb_members;
+    }
+
+    return rv;
+}
+
+static void *APR_THREAD_FUNC ga_steady_loop(apr_thread_t *thd, void *rec)
+{
+    steady_worker_t *worker = rec;
+    steady_t *steady = worker->steady;
+    napr_galife_t *ga = steady->ga;
+    beeing_t *loser, *child = &(worker->child);
+    void *chromosome;
+    unsigned long max_births = ga->max_ages * ga->population.nb_members, nb_ages = 0UL, l;
+    int race = ga_races(ga), save;
+
+    while (!ga_is_over(ga)) {
+	apr_thread_mutex_lock(steady->mutex);
+	if (steady->nb_births >= max_births) {
+	    apr_thread_mutex_unlock(steady->mutex);
+	    break;
+	}
+	/*
+	 * The father may be the loser of another worker later, he is copied
+	 * while nobody can overwrite him; the loser stays in the population
+	 * as it is, born keeps it out of the tournaments until it is replaced.
+	 */
+	if (NULL == (loser = ga_select(ga, &(ga->population), &(worker->seed)))) {
+	    apr_thread_mutex_unlock(steady->mutex);
+	    break;
+	}
+	ga->chrom_copy(ga->param, loser->father->chromosome, worker->father.chromosome);
+	ga->chrom_copy(ga->param, loser->chromosome, child->chromosome);
+	child->score = loser->score;
+	loser->father = NULL;
+	steady->nb_births++;
+	ga->current_age = steady->nb_births / ga->population.nb_members;
+	apr_thread_mutex_unlock(steady->mutex);
+
+	child->father = &(worker->father);
+	ga_breed(ga, child, &(worker->seed), worker->scratch);
+	/* A screened child is ranked last, nothing to evaluate */
+	if (!ga_screen(ga, child, &(worker->seed))) {
+	    if (race) {
+		/* The child still holds the score of the loser it replaces, not worth sampling a worse one */
+		child->race_samples = ga->tuning.race_max_samples;
+		child->threshold = child->score;
+		child->scored = 0;
+		beeing_race(ga, worker->chrom_data, child);
+		child->race_samples = 0;
+		if (!child->scored)
+		    child->score = -FLT_MAX;
+		else
+		    beeing_account(ga, child, (-FLT_MAX != child->score) && (child->score + child->error < child->threshold));
 	    }
-	    if (1 == mother->born) {
-		/*DEBUG_DBG("Mother [%i]/[%i] already born", mother_idx, pop_nmb); */
-		for (i = 1; (i < pop_nmb) && (NULL != mother) && (1 == mother->born); i++) {
-		    mother = napr_heap_get_nth(ga->population_past, (mother_idx + i) % pop_nmb);
-		}
-		if ((NULL == mother) || (1 == mother->born)) {
-		    /*DEBUG_DBG("No more unborn amongst [%i]", pop_nmb); */
-		    if (0 > napr_heap_insert_r(population_future, father)) {
-			fprintf(stderr, "%s: error calling napr_heap_insert_r in %d\n", __FUNCTION__, __LINE__);
-			return APR_EGENERAL;
-		    }
-
-		    break;
-		}
-	    }
-	    mother->born = 1;
-
-	    /*
-	     * Babies herits from the ancients, here we must check the probability of mutation
-	     * Prob of Crossover must be check in the function for each unit copied into the chromosome there's a prob. 
-	     * crossover_p that this unit came from the other parent.
-	     */
-	    /*DEBUG_DBG("Cross"); */
-	    ga->chrom_crossvr(ga->param, ga->crossover_p, father->chromosome, mother->chromosome);
-	    /*DEBUG_DBG("Mutate"); */
-	    if (ga->mutation_p > ((float) rand() / (RAND_MAX + 1.0f)))
-		ga->chrom_mutation(ga->param, ga->mutation_p, mother->chromosome);
-
-	    /*DEBUG_DBG("Insert Father"); */
-	    if (0 > napr_heap_insert_r(population_future, father)) {
-		fprintf(stderr, "%s: error calling napr_heap_insert_r in %d\n", __FUNCTION__, __LINE__);
-		return APR_EGENERAL;
+	    else {
+		beeing_init(ga, worker->chrom_data, child);
 	    }
 	}
+	ga_sync(ga);
 
-	if (NULL != (buf = napr_heap_extract_r(ga->population_past))) {
-	    if (0 > napr_heap_insert_r(population_future, buf)) {
-		fprintf(stderr, "%s: error calling napr_heap_insert_r in %d\n", __FUNCTION__, __LINE__);
-		return APR_EGENERAL;
+	apr_thread_mutex_lock(steady->mutex);
+	/* The chromosome of the loser is the next child's */
+	chromosome = loser->chromosome;
+	loser->chromosome = child->chromosome;
+	child->chromosome = chromosome;
+	loser->score = child->score;
+	loser->error = child->error;
+	loser->born = 0;
+	/* The population is copied under the lock, the children being evaluated are saved as the worst */
+	if (0 != (save = (NULL != steady->snapshot) && !steady->saving && ga_checkpoint_due(ga))) {
+	    steady->saving = 1;
+	    for (l = 0; l < ga->population.nb_members; l++) {
+		ga->chrom_copy(ga->param, ga->population.members[l]->chromosome, steady->snapshot[l].chromosome);
+		steady->snapshot[l].score = ga->population.members[l]->score;
+		steady->snapshot[l].born = ga->population.members[l]->born;
 	    }
+	    nb_ages = ga->current_age;
 	}
+	apr_thread_mutex_unlock(steady->mutex);
 
-	if (APR_SUCCESS != (status = napr_threadpool_wait(ga->threadpool))) {
-	    DEBUG_ERR("error calling napr_threadpool_wait: %s", apr_strerror(status, errbuf, 128));
-	    return status;
+	/* ... and written once the others can breed again */
+	if (save) {
+	    ga_checkpoint(ga, steady->snapshot_members, ga->population.nb_members, nb_ages);
+	    apr_thread_mutex_lock(steady->mutex);
+	    steady->saving = 0;
+	    apr_thread_mutex_unlock(steady->mutex);
+	}
+    }
+
+    apr_thread_exit(thd, APR_SUCCESS);
+
+    return NULL;
+}
+
+static apr_status_t ga_run_steady(napr_galife_t *ga)
+{
+    char errbuf[128];
+    steady_t steady;
+    steady_worker_t *workers;
+    apr_thread_t **thread;
+    unsigned long nb_threads = ga->nb_cpu, l;
+    apr_status_t status, rv = APR_SUCCESS;
+
+    steady.ga = ga;
+    /* A restored run goes on from its last generation */
+    steady.nb_births = ga->current_age * ga->population.nb_members;
+    steady.snapshot = NULL;
+    steady.snapshot_members = NULL;
+    steady.saving = 0;
+    if (NULL != ga->checkpoint) {
+	steady.snapshot = apr_pcalloc(ga->pool, ga->population.nb_members * sizeof(beeing_t));
+	steady.snapshot_members = apr_palloc(ga->pool, ga->population.nb_members * sizeof(beeing_t *));
+	for (l = 0; l < ga->population.nb_members; l++) {
+	    ga->chrom_allocat(ga->param, ga->pool, &(steady.snapshot[l].chromosome));
+	    steady.snapshot_members[l] = &(steady.snapshot[l]);
 	}
-	apr_pool_destroy(tp_pool);
+    }
+    if (APR_SUCCESS != (status = apr_thread_mutex_create(&(steady.mutex), APR_THREAD_MUTEX_DEFAULT, ga->pool))) {
+	DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
 
-	swap = ga->population_past;
-	ga->population_past = population_future;
-	population_future = swap;
+    thread = apr_pcalloc(ga->pool, nb_threads * sizeof(apr_thread_t *));
+    workers = apr_pcalloc(ga->pool, nb_threads * sizeof(steady_worker_t));
+    for (l = 0; l < nb_threads; l++) {
+	workers[l].steady = &steady;
+	ga->chrom_allocat(ga->param, ga->pool, &(workers[l].father.chromosome));
+	ga->chrom_allocat(ga->param, ga->pool, &(workers[l].child.chromosome));
+	workers[l].seed = (unsigned int) rand_r(&(ga->seed));
+	workers[l].scratch = ga_scratch_make(ga);
+	/* The threadpool is idle meanwhile, its threads lend their data */
+	workers[l].chrom_data = (l < ga->nb_threads) ? ga->threads[l].chrom_data : ga_worker_make(ga, ga->pool);
+	if (APR_SUCCESS != (status = apr_thread_create(&(thread[l]), NULL, ga_steady_loop, &(workers[l]), ga->pool))) {
+	    DEBUG_ERR("error calling apr_thread_create: %s", apr_strerror(status, errbuf, 128));
+	    rv = status;
+	    break;
+	}
+    }
+    nb_threads = l;
+    for (l = 0; l < nb_threads; l++) {
+	if (APR_SUCCESS != apr_thread_join(&status, thread[l])) {
+	    DEBUG_ERR("error calling apr_thread_join");
+	    rv = APR_EGENERAL;
+	}
     }
 
-    napr_heap_destroy(population_future);
+    return rv;
+}
+
+static apr_status_t ga_run_generations(napr_galife_t *ga)
+{
+    unsigned long l;
+    apr_status_t status;
+
+    /*
+     * era(s) are generations, a restored run goes on from its last one.
+     */
+    /* The threads of the pool are waiting, their scratch can be set */
+    for (l = 0; l < ga->nb_threads; l++)
+	ga->threads[l].scratch = ga_scratch_make(ga);
+    while (ga->current_age < ga->max_ages) {
+	/*DEBUG_DBG("Era [%lu]", ga->current_age); */
+	status = ga_era(ga, &(ga->population), &(ga->seed), NULL, NULL, ga->threadpool);
+	/* A generation cut by the end of the run is not counted, a resumed run goes on from the same one */
+	if (APR_TIMEUP == status)
+	    break;
+	if (APR_SUCCESS != status)
+	    return status;
+	ga->current_age++;
+	if (ga_checkpoint_due(ga))
+	    ga_checkpoint(ga, ga->population.members, ga->population.nb_members, ga->current_age);
+    }
 
     return APR_SUCCESS;
 }
 
+apr_status_t ga_run(napr_galife_t *ga)
+{
+    apr_status_t status;
+
+    /* The evaluations of the initial population */
+    ga_sync(ga);
+    /* Too few individuals to breed */
+    if (ga->population.nb_members < 2UL)
+	return APR_SUCCESS;
+    if (APR_SUCCESS != (status = ga_report_start(ga)))
+	return status;
+    if (ga->tuning.steady_state)
+	status = ga_run_steady(ga);
+    else if (ga->tuning.nb_islands > 1UL)
+	status = ga_run_islands(ga);
+    else
+	status = ga_run_generations(ga);
+    ga_report_stop(ga);
+
+    if ((APR_SUCCESS == status) && (NULL != ga->checkpoint))
+	ga_checkpoint(ga, ga->population.members, ga->population.nb_members, ga->current_age);
 
+    return status;
+}
+
+void napr_galife_get_stats(napr_galife_t *ga, float target_score, napr_galife_stats_t *stats)
+{
+    const napr_galife_best_t *best;
+    int i;
+
+    apr_thread_mutex_lock(ga->best_mutex);
+    stats->nb_evaluations = ga->nb_evaluations;
+    stats->nb_ages = ga->current_age;
+    stats->nb_dropped = ga->nb_dropped;
+    stats->nb_screened = ga->nb_screened;
+    stats->nb_predicted = 0UL;
+    stats->surrogate_error = 0.0f;
+    stats->surrogate_correlation = 0.0f;
+    if (NULL != ga->surrogate) {
+	stats->nb_predicted = ga->surrogate->nb_predicted;
+	if (0UL != ga->surrogate->nb_predicted)
+	    stats->surrogate_error = ga->surrogate->error_sum / ga->surrogate->nb_predicted;
+	if ((ga->surrogate->m2_predicted > 0.0) && (ga->surrogate->m2_score > 0.0))
+	    stats->surrogate_correlation =
+		ga->surrogate->comoment / sqrt(ga->surrogate->m2_predicted * ga->surrogate->m2_score);
+    }
+    stats->best_score = ga->best_score;
+    stats->best_time = ga->last_best_date - ga->init_time;
+    stats->target_time = -1;
+    stats->run_time = apr_time_now() - ga->init_time;
+    best = (const napr_galife_best_t *) ga->best_history->elts;
+    for (i = 0; i < ga->best_history->nelts; i++) {
+	if (best[i].score >= target_score) {
+	    stats->target_time = best[i].time;
+	    break;
+	}
+    }
+    apr_thread_mutex_unlock(ga->best_mutex);
+}
+
+void napr_galife_cancel(napr_galife_t *ga)
+{
+    apr_atomic_set32(&(ga->over), 1);
+}
+
+int napr_galife_is_over(napr_galife_t *ga)
+{
+    return ga_is_over(ga);
+}
+
+apr_status_t napr_galife_keep_best(napr_galife_t *ga)
+{
+    beeing_t *beeing, *best = NULL;
+    unsigned long l;
+
+    if (NULL == ga->chrom_copy) {
+	DEBUG_ERR("the best can't be kept, genes can't be copied");
+	return APR_EINVAL;
+    }
+    /* The pool of ga is not shared with the threads of ga_run, the best is */
+    ga->chrom_allocat(ga->param, ga->pool, &(ga->best_chromosome));
+    apr_thread_mutex_lock(ga->best_mutex);
+    for (l = 0; l < ga->population.nb_members; l++) {
+	beeing = ga->population.members[l];
+	if ((NULL == best) || (beeing->score > best->score))
+	    best = beeing;
+    }
+    if (NULL != best) {
+	ga->chrom_copy(ga->param, best->chromosome, ga->best_chromosome);
+	ga->best_kept_score = best->score;
+    }
+    apr_thread_mutex_unlock(ga->best_mutex);
+
+    return APR_SUCCESS;
+}
+
+float napr_galife_get_best_so_far(napr_galife_t *ga, void *chromosome)
+{
+    float score;
+
+    apr_thread_mutex_lock(ga->best_mutex);
+    score = ga->best_kept_score;
+    if ((NULL != ga->best_chromosome) && (-FLT_MAX != score))
+	ga->chrom_copy(ga->param, ga->best_chromosome, chromosome);
+    apr_thread_mutex_unlock(ga->best_mutex);
+
+    return score;
+}
+
+unsigned long napr_galife_get_best(napr_galife_t *ga, unsigned long nb, void **chromosomes, float *scores)
+{
+    beeing_t **members;
+    unsigned long l;
+
+    apr_thread_mutex_lock(ga->best_mutex);
+    members = apr_palloc(ga->pool, ga->population.nb_members * sizeof(beeing_t *));
+    memcpy(members, ga->population.members, ga->population.nb_members * sizeof(beeing_t *));
+    qsort(members, ga->population.nb_members, sizeof(beeing_t *), ga_beeing_cmp);
+    if (nb > ga->population.nb_members)
+	nb = ga->population.nb_members;
+    for (l = 0; l < nb; l++) {
+	chromosomes[l] = members[l]->chromosome;
+	scores[l] = members[l]->score;
+    }
+    apr_thread_mutex_unlock(ga->best_mutex);
+
+    return nb;
+}
@@ -288,16 +288,21 @@ int napr_heap_insert_r(napr_heap_t *heap, void *datum)
     if (1 == heap->mutex_set) {
 #ifdef HAVE_APR
 	if (APR_SUCCESS == (rc = apr_thread_mutex_lock(heap->mutex))) {
-	    if (0 == (rc = napr_heap_insert(heap, datum)))
-		rc = apr_thread_mutex_unlock(heap->mutex);
+	    rc = napr_heap_insert(heap, datum);
+	    /* Unlock even if the insertion failed, or the heap would stay locked forever */
+	    if (APR_SUCCESS != apr_thread_mutex_unlock(heap->mutex)) {
+		DEBUG_ERR("unlocking failed");
+		rc = -1;
+	    }
 	}
 	else {
 	    DEBUG_ERR("locking failed");
 	}
 #else
 	if (0 == (rc = pthread_mutex_lock(&heap->mutex))) {
-	    if (0 == (rc = napr_heap_insert(heap, datum)))
-		rc = pthread_mutex_unlock(&heap->mutex);
+	    rc = napr_heap_insert(heap, datum);
+	    if (0 != pthread_mutex_unlock(&heap->mutex))
+		rc = -1;
 	}
 #endif
     }
@@ -315,20 +320,21 @@ void *napr_heap_extract_r(napr_heap_t *heap)
     if (1 == heap->mutex_set) {
 #ifdef HAVE_APR
 	if (APR_SUCCESS == apr_thread_mutex_lock(heap->mutex)) {
-	    if (NULL != (result = napr_heap_extract(heap)))
-		if (APR_SUCCESS != apr_thread_mutex_unlock(heap->mutex)) {
-		    DEBUG_ERR("unlocking failed");
-		    result = NULL;
-		}
+	    result = napr_heap_extract(heap);
+	    /* An empty heap must be unlocked too */
+	    if (APR_SUCCESS != apr_thread_mutex_unlock(heap->mutex)) {
+		DEBUG_ERR("unlocking failed");
+		result = NULL;
+	    }
 	}
 	else {
 	    DEBUG_ERR("locking failed");
 	}
 #else
 	if (0 == pthread_mutex_lock(&heap->mutex)) {
-	    if (NULL != (result = napr_heap_extract(heap)))
-		if (0 != pthread_mutex_unlock(&heap->mutex))
-		    result = NULL;
+	    result = napr_heap_extract(heap);
+	    if (0 != pthread_mutex_unlock(&heap->mutex))
+		result = NULL;
 	}
 #endif
     }
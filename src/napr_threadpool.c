@@ -145,9 +145,16 @@ static inline void *napr_list_get(napr_cell_t *cell)
 }
 
 /* The threadpool structures and engine */
+typedef struct napr_thread_t
+{
+    struct napr_threadpool_t *threadpool;
+    void *thread_ctx;		/* allocated by thread_init, NULL if none */
+} napr_thread_t;
+
 struct napr_threadpool_t
 {
     apr_thread_t **thread;
+    napr_thread_t *threads;
 
     void *ctx;
     /* This mutex protects everything below in writing and reading */
@@ -185,11 +192,47 @@ struct napr_threadpool_t
 
     unsigned int run:1;
     unsigned int ended:1;
+    /* Set when the pool of the threadpool is destroyed, threads must exit */
+    unsigned int killed:1;
 };
 
 static void *APR_THREAD_FUNC napr_threadpool_loop(apr_thread_t *thd, void *rec);
 
+/*
+ * Run before the memory of the threadpool is freed: without it, the threads
+ * would stay blocked forever on a condition that no longer exists.
+ */
+static apr_status_t napr_threadpool_cleanup(void *rec)
+{
+    char errbuf[128];
+    napr_threadpool_t *threadpool = rec;
+    unsigned long l;
+    apr_status_t status, thread_status;
+
+    if (APR_SUCCESS != (status = apr_thread_mutex_lock(threadpool->threadpool_mutex))) {
+	DEBUG_ERR("error calling apr_thread_mutex_lock: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    threadpool->killed |= 0x1;
+    if (APR_SUCCESS != (status = apr_thread_cond_broadcast(threadpool->threadpool_update))) {
+	DEBUG_ERR("error calling apr_thread_cond_broadcast: %s", apr_strerror(status, errbuf, 128));
+    }
+    if (APR_SUCCESS != (status = apr_thread_mutex_unlock(threadpool->threadpool_mutex))) {
+	DEBUG_ERR("error calling apr_thread_mutex_unlock: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+
+    for (l = 0; l < threadpool->nb_thread; l++) {
+	if (APR_SUCCESS != (status = apr_thread_join(&thread_status, threadpool->thread[l]))) {
+	    DEBUG_ERR("error calling apr_thread_join: %s", apr_strerror(status, errbuf, 128));
+	}
+    }
+
+    return APR_SUCCESS;
+}
+
 extern apr_status_t napr_threadpool_init(napr_threadpool_t **threadpool, void *ctx, unsigned long nb_thread,
+					 threadpool_thread_init_callback_fn_t *thread_init,
 					 threadpool_process_data_callback_fn_t *process_data, apr_pool_t *pool)
 {
     char errbuf[128];
@@ -212,6 +255,7 @@ extern apr_status_t napr_threadpool_init(napr_threadpool_t **threadpool, void *c
 	return status;
     }
     (*threadpool)->thread = apr_palloc((*threadpool)->pool, nb_thread * sizeof(apr_thread_mutex_t *));
+    (*threadpool)->threads = apr_palloc((*threadpool)->pool, nb_thread * sizeof(napr_thread_t));
     (*threadpool)->ctx = ctx;
     (*threadpool)->nb_thread = nb_thread;
     (*threadpool)->nb_waiting = 0UL;
@@ -219,18 +263,30 @@ extern apr_status_t napr_threadpool_init(napr_threadpool_t **threadpool, void *c
     (*threadpool)->process_data = process_data;
     (*threadpool)->run &= 0x0;
     (*threadpool)->ended &= 0x0;
+    (*threadpool)->killed &= 0x0;
 
     for (l = 0; l < nb_thread; l++) {
+	(*threadpool)->threads[l].threadpool = (*threadpool);
+	(*threadpool)->threads[l].thread_ctx = NULL;
+	/* Allocated here, the pool can't be shared by running threads */
+	if ((NULL != thread_init)
+	    && (APR_SUCCESS != (status = thread_init(ctx, (*threadpool)->pool, &((*threadpool)->threads[l].thread_ctx))))) {
+	    DEBUG_ERR("error calling thread_init: %s", apr_strerror(status, errbuf, 128));
+	    break;
+	}
 	if (APR_SUCCESS !=
 	    (status =
-	     apr_thread_create(&((*threadpool)->thread[l]), NULL, napr_threadpool_loop, (*threadpool),
+	     apr_thread_create(&((*threadpool)->thread[l]), NULL, napr_threadpool_loop, &((*threadpool)->threads[l]),
 			       (*threadpool)->pool))) {
 	    DEBUG_ERR("error calling apr_thread_create: %s", apr_strerror(status, errbuf, 128));
-	    return status;
+	    break;
 	}
     }
+    /* Only the threads created are stopped and joined */
+    (*threadpool)->nb_thread = l;
+    apr_pool_pre_cleanup_register((*threadpool)->pool, (*threadpool), napr_threadpool_cleanup);
 
-    return APR_SUCCESS;
+    return status;
 }
 
 extern apr_status_t napr_threadpool_add(napr_threadpool_t *threadpool, void *data)
@@ -305,7 +361,8 @@ extern apr_status_t napr_threadpool_wait(napr_threadpool_t *threadpool)
 static void *APR_THREAD_FUNC napr_threadpool_loop(apr_thread_t *thd, void *rec)
 {
     char errbuf[128];
-    napr_threadpool_t *threadpool = rec;
+    napr_thread_t *thread = rec;
+    napr_threadpool_t *threadpool = thread->threadpool;
     apr_status_t status;
 
     /* lock the mutex, to access the list exclusively. */
@@ -314,8 +371,15 @@ static void *APR_THREAD_FUNC napr_threadpool_loop(apr_thread_t *thd, void *rec)
 	return NULL;
     }
 
-    /* do forever.... */
+    /* do forever.... or until the threadpool is destroyed */
     while (1) {
+	if (threadpool->killed & 0x1) {
+	    if (APR_SUCCESS != (status = apr_thread_mutex_unlock(threadpool->threadpool_mutex))) {
+		DEBUG_ERR("error calling apr_thread_mutex_unlock: %s", apr_strerror(status, errbuf, 128));
+	    }
+	    apr_thread_exit(thd, APR_SUCCESS);
+	    return NULL;
+	}
 	/* DEBUG_DBG("list_size: %lu", napr_list_size(threadpool->list)); */
 	if ((0 < napr_list_size(threadpool->list)) && !(threadpool->ended & 0x1)) {
 	    napr_cell_t *cell;
@@ -333,7 +397,7 @@ static void *APR_THREAD_FUNC napr_threadpool_loop(apr_thread_t *thd, void *rec)
 		    DEBUG_ERR("error calling apr_thread_mutex_unlock: %s", apr_strerror(status, errbuf, 128));
 		    return NULL;
 		}
-		threadpool->process_data(threadpool->ctx, data);
+		threadpool->process_data(threadpool->ctx, thread->thread_ctx, data);
 		if (APR_SUCCESS != (status = apr_thread_mutex_lock(threadpool->threadpool_mutex))) {
 		    DEBUG_ERR("error calling apr_thread_mutex_lock: %s", apr_strerror(status, errbuf, 128));
 		    return NULL;
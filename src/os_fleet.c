@@ -17,15 +17,24 @@
 #include <stdlib.h>
 #include <math.h>
 #include <values.h>
+#include <signal.h>
 #include <time.h>
 
+#include <apr_atomic.h>
 #include <apr_strings.h>
 
 #include <pcre.h>
 #include "debug.h"
+#include "napr_cache.h"
 #include "napr_galife.h"
 #include "os_conf.h"
 #include "os_fleet.h"
+#include "os_index.h"
+#include "os_io.h"
+#include "os_result.h"
+#include "os_profile.h"
+#include "os_sample.h"
+#include "os_telemetry.h"
 
 #define MAX(a,b) (((a)>(b))?(a):(b))
 #define MIN(a,b) (((a)<(b))?(a):(b))
@@ -110,6 +119,16 @@ extern void os_fleet_to_guess(os_fleet_t *fleet)
     fleet->guess_mode = 1;
 }
 
+extern unsigned int os_fleet_get_nb_units(const os_fleet_t *fleet)
+{
+    unsigned int i, nb_units;
+
+    for (i = PT, nb_units = 0; i < fleet->limit; i++)
+	nb_units += fleet->initial_repartition[i];
+
+    return nb_units;
+}
+
 static inline unsigned int os_fleet_csv_parse_get_ulong(const char **conf)
 {
     const char *ptr;
@@ -364,47 +383,95 @@ static inline void os_fleet_battle_maximize_shield(os_fleet_t *fleet)
 }
 
 #define RND_ARRAY_SIZE '\55'
-static unsigned int rsl[RND_ARRAY_SIZE];
-static unsigned char last_rsl_used;
+/* Lagged Fibonacci generator of the battles, each simulation (or evaluation of guess mode) gets its own */
+typedef struct os_fleet_rand_t
+{
+    unsigned int rsl[RND_ARRAY_SIZE];
+    unsigned char last_rsl_used;
+} os_fleet_rand_t;
+
+/* The guess os_fleet_cancel_guess stops, NULL if none is running; read by a signal handler */
+static napr_galife_t **volatile os_fleet_guess_ga = NULL;
+static volatile sig_atomic_t os_fleet_guess_cancelled = 0;
+
+extern int os_fleet_cancel_guess(void)
+{
+    napr_galife_t **ga = os_fleet_guess_ga;
+
+    if (NULL == ga)
+	return 0;
+    os_fleet_guess_cancelled = 1;
+    if (NULL != *ga)
+	napr_galife_cancel(*ga);
+
+    return 1;
+}
+
+/* Seed set by os_fleet_set_seed, the current time is taken otherwise */
+static unsigned int os_fleet_seed;
+static int os_fleet_seeded = 0;
+
+extern void os_fleet_set_seed(unsigned int seed)
+{
+    os_fleet_seed = seed;
+    os_fleet_seeded = 1;
+}
+
+static inline unsigned int os_fleet_get_seed(void)
+{
+    return os_fleet_seeded ? os_fleet_seed : (unsigned int) time(NULL);
+}
+
+/* Finalizer of murmur3 on seed and value: streams derived from close values don't look alike */
+static inline unsigned int os_fleet_mix(unsigned int seed, unsigned int value)
+{
+    unsigned int hash = seed ^ (value * 0x9e3779b9U);
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
 
-static inline void my_srand()
+    return hash;
+}
+
+static inline void my_srand(os_fleet_rand_t *rnd, unsigned int seed)
 {
     unsigned char i;
 
-    srand((unsigned int) time(NULL));
     for (i = 0; i < RND_ARRAY_SIZE; ++i)
-	rsl[i] = (unsigned int) UINT_MAX *(rand() / (RAND_MAX + 1.0));
+	rnd->rsl[i] = os_fleet_mix(seed, i);
 
     for (i = 0; i < RND_ARRAY_SIZE; ++i)
-	rsl[i] = rsl[i] + rsl[(i + 24) % RND_ARRAY_SIZE];
+	rnd->rsl[i] = rnd->rsl[i] + rnd->rsl[(i + 24) % RND_ARRAY_SIZE];
+    rnd->last_rsl_used = 0;
 }
 
-static inline unsigned int my_rand(unsigned int limit)
+static inline unsigned int my_rand(os_fleet_rand_t *rnd, unsigned int limit)
 {
-    unsigned char i;
+    unsigned char i, idx;
 
-    last_rsl_used++;
-    if (last_rsl_used == RND_ARRAY_SIZE) {
+    idx = rnd->last_rsl_used + 1;
+    if (idx >= RND_ARRAY_SIZE) {
 	for (i = 0; i < RND_ARRAY_SIZE; ++i)
-	    rsl[i] = rsl[i] + rsl[(i + 24) % RND_ARRAY_SIZE];
-	last_rsl_used = 0;
+	    rnd->rsl[i] = rnd->rsl[i] + rnd->rsl[(i + 24) % RND_ARRAY_SIZE];
+	idx = 0;
     }
+    rnd->last_rsl_used = idx;
 
-    return rsl[last_rsl_used] % limit;
+    return rnd->rsl[idx] % limit;
 }
 
-static inline float my_randf()
+/* Draws of the genetic operators, from the rand_r state of the thread breeding the individual */
+static inline unsigned int os_fleet_ga_rand(unsigned int *seed, unsigned int limit)
 {
-    unsigned char i;
-
-    last_rsl_used++;
-    if (last_rsl_used == RND_ARRAY_SIZE) {
-	for (i = 0; i < RND_ARRAY_SIZE; ++i)
-	    rsl[i] = rsl[i] + rsl[(i + 24) % RND_ARRAY_SIZE];
-	last_rsl_used = 0;
-    }
+    return (unsigned int) (limit * (rand_r(seed) / (RAND_MAX + 1.0)));
+}
 
-    return (float) rsl[last_rsl_used] / (float) UINT_MAX;
+static inline float os_fleet_ga_randf(unsigned int *seed)
+{
+    return (float) rand_r(seed) / (float) RAND_MAX;
 }
 
 static const short unsigned int rapid_fire_const[] = {
@@ -432,7 +499,7 @@ static const short unsigned int rapid_fire_const[] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 };
 
-static inline int rapid_fired(enum Item_enum atktype, enum Item_enum deftype)
+static inline int rapid_fired(enum Item_enum atktype, enum Item_enum deftype, os_fleet_rand_t *rnd)
 {
     unsigned short int rf;
 
@@ -441,18 +508,19 @@ static inline int rapid_fired(enum Item_enum atktype, enum Item_enum deftype)
 	return 0;
     else {
 	unsigned short int rsi;
-	rsi = (unsigned short int) my_rand(10000UL);
+	rsi = (unsigned short int) my_rand(rnd, 10000UL);
 	return rsi >= rf;
     }
 }
 
 static void os_fleet_battle_shoot(const os_fleet_t *attacker, unsigned int attack_ship_number, os_fleet_t *defender,
-				  const os_conf_t *conf)
+				  const os_conf_t *conf, os_fleet_rand_t *rnd)
 {
     enum Item_enum attack_ship, defend_ship;
     unsigned int rnd_nb;
     float damage;
     unsigned char has_rapid_fired;
+    unsigned int chain_length = 0;
 
     /* First, get the type of the ship that will shoot from attacker */
     attack_ship = (attacker->ships_hit_table)[attack_ship_number].type;
@@ -460,9 +528,10 @@ static void os_fleet_battle_shoot(const os_fleet_t *attacker, unsigned int attac
     /* Then this ship will attack as long as possible */
     do {
 	/* find the target */
-	rnd_nb = my_rand(defender->ship_count);
+	rnd_nb = my_rand(rnd, defender->ship_count);
 	defend_ship = (defender->ships_hit_table)[rnd_nb].type;
 	has_rapid_fired = 0;
+	OS_TELEMETRY_SHOT(chain_length);
 
 	damage = attacker->os_ship[attack_ship].attack_value;
 	if (1.0f <= (damage * defender->os_ship[defend_ship].shield_points_percent)) {
@@ -481,24 +550,30 @@ static void os_fleet_battle_shoot(const os_fleet_t *attacker, unsigned int attac
 
 		    if ((defender->ships_hit_table)[rnd_nb].structure_points < 0.0f) {
 			(defender->ships_hit_table)[rnd_nb].exploded |= 0x1;
+			OS_TELEMETRY_INC(TLM_EXPLOSION_STRUCTURE);
 		    }
 		    else if ((defender->ships_hit_table)[rnd_nb].structure_points <=
 			     (0.7f * defender->os_ship[defend_ship].structure_points)) {
 			/*
 			 * ship probably explodes, when hull damage >= 30 %
 			 */
-			if ((float) my_rand(100UL) >=
+			if ((float) my_rand(rnd, 100UL) >=
 			    ((defender->ships_hit_table)[rnd_nb].structure_points *
 			     defender->os_ship[defend_ship].structure_points_percent)) {
 			    (defender->ships_hit_table)[rnd_nb].exploded |= 0x1;
+			    OS_TELEMETRY_INC(TLM_EXPLOSION_PROBABILISTIC);
 			}
 		    }
 		}
 	    }
 
-	    has_rapid_fired = rapid_fired(attack_ship, defend_ship);
+	    has_rapid_fired = rapid_fired(attack_ship, defend_ship, rnd);
+	}
+	else {
+	    OS_TELEMETRY_INC(TLM_BOUNCED_SHOT);
 	}
     } while (0 != has_rapid_fired);
+    OS_TELEMETRY_CHAIN(chain_length);
 }
 
 static inline void os_fleet_battle_remove_exploded_ships(os_fleet_t *fleet)
@@ -509,9 +584,11 @@ static inline void os_fleet_battle_remove_exploded_ships(os_fleet_t *fleet)
 	/*DEBUG_DBG("Ship_idx:%u Ship_count:%u", ship_idx, fleet->ship_count); */
 	if (((fleet->ships_hit_table)[ship_idx].exploded & 0x1) && (fleet->ship_count != 0)) {
 	    (fleet->ship_count)--;
+	    OS_TELEMETRY_INC(TLM_SHIP_COMPACTED);
 	    while (((fleet->ships_hit_table)[fleet->ship_count].exploded & 0x1) && (ship_idx < fleet->ship_count)) {
 		((fleet->current_repartition)[(fleet->ships_hit_table)[fleet->ship_count].type])--;
 		(fleet->ship_count)--;
+		OS_TELEMETRY_INC(TLM_SHIP_COMPACTED);
 		/*DEBUG_DBG("Ship_idx:%u Ship_count:%u", ship_idx, fleet->ship_count); */
 	    }
 	    ((fleet->current_repartition)[(fleet->ships_hit_table)[ship_idx].type])--;
@@ -585,501 +662,780 @@ static inline void os_fleet_launch_missile(os_fleet_t *attacker, os_fleet_t *def
     memcpy(defender->initial_repartition, initial_repartition, ITEM_END * sizeof(unsigned int));
 }
 
-static inline unsigned char os_fleet_onebattle(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf)
+static inline unsigned char os_fleet_onebattle(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf,
+						os_fleet_rand_t *rnd)
 {
+    apr_uint64_t start = 0;
     unsigned int ship_idx;
     unsigned char i;
 
+    OS_TELEMETRY_INC(TLM_BATTLE);
+    OS_PROFILE_BEGIN(start);
     os_fleet_battle_init(attacker);
     os_fleet_launch_missile(attacker, defender);
+    OS_PROFILE_END(PRF_MISSILE, start);
 
     for (i = '\0'; (i < MAX_ROUND_NUMBER) && (0 != attacker->ship_count) && (defender->ship_count); i++) {
+	OS_TELEMETRY_INC(TLM_ROUND);
+	OS_PROFILE_BEGIN(start);
 	os_fleet_battle_maximize_shield(attacker);
 	os_fleet_battle_maximize_shield(defender);
+	OS_PROFILE_END(PRF_SHIELD, start);
 
+	OS_PROFILE_BEGIN(start);
 	for (ship_idx = 0; ship_idx < attacker->ship_count; ship_idx++) {
-	    os_fleet_battle_shoot(attacker, ship_idx, defender, conf);
+	    os_fleet_battle_shoot(attacker, ship_idx, defender, conf, rnd);
 	}
 
 	for (ship_idx = 0; ship_idx < defender->ship_count; ship_idx++) {
-	    os_fleet_battle_shoot(defender, ship_idx, attacker, conf);
+	    os_fleet_battle_shoot(defender, ship_idx, attacker, conf, rnd);
 	}
+	OS_PROFILE_END(PRF_SHOOT, start);
 
+	OS_PROFILE_BEGIN(start);
 	/*DEBUG_DBG("Remove defender ships"); */
 	os_fleet_battle_remove_exploded_ships(defender);
 	/*DEBUG_DBG("Remove attacker ships"); */
 	os_fleet_battle_remove_exploded_ships(attacker);
+	OS_PROFILE_END(PRF_COMPACTION, start);
     }
 
     return i;
 }
 
-extern void os_fleet_battle(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu, const os_conf_t *conf,
-			    unsigned char mode)
+/* FNV-1a over everything that changes the outcome of a battle, partial results must share it to be merged */
+static inline apr_uint64_t os_fleet_hash(apr_uint64_t hash, const void *data, apr_size_t len)
 {
-    unsigned int atk_avg[ITEM_END], def_avg[ITEM_END], atk_wrst[ITEM_END], def_wrst[ITEM_END], atk_bst[ITEM_END],
-	def_bst[ITEM_END];
-    apr_uint64_t recycl_m, recycl_c, atk_loss_m, atk_loss_c, atk_loss_d, def_loss_m, def_loss_c, def_loss_d;
-    char *pct_M_atk_str, *pct_C_atk_str, *pct_M_def_str, *pct_C_def_str;
-    unsigned int nb_atk_vict, nb_def_vict, nb_round, distance, flight_time;
-    float atk_max_score, def_max_score, atk_min_score, def_min_score, atk_score, def_score;
-    int j, k;
+    const unsigned char *ptr = data;
+    apr_size_t i;
 
-    my_srand();
-    if (0UL == (distance = os_fleet_distance(attacker->coord, defender->coord))) {
-	DEBUG_ERR("Invalid coordinates");
-	return;
+    for (i = 0; i < len; i++) {
+	hash ^= ptr[i];
+	hash *= 1099511628211ULL;
     }
-    atk_max_score = def_max_score = 0UL;
-    atk_min_score = def_min_score = UINT_MAX;
 
-    nb_atk_vict = nb_def_vict = nb_round = recycl_m = recycl_c = atk_loss_m = atk_loss_c = atk_loss_d = def_loss_m =
-	def_loss_c = def_loss_d = 0UL;
-    memset(atk_avg, 0UL, sizeof(unsigned int) * ITEM_END);
-    memset(def_avg, 0UL, sizeof(unsigned int) * ITEM_END);
-    memset(atk_wrst, 0UL, sizeof(unsigned int) * ITEM_END);
-    memset(def_wrst, 0UL, sizeof(unsigned int) * ITEM_END);
-    memset(atk_bst, 0UL, sizeof(unsigned int) * ITEM_END);
-    memset(def_bst, 0UL, sizeof(unsigned int) * ITEM_END);
+    return hash;
+}
 
-    if (attacker->guess_mode || defender->guess_mode) {
-	DEBUG_ERR("invalid simulation, one is in guess mode (only technos precised)");
-	return;
+static apr_uint64_t os_fleet_matchup_fingerprint(const os_fleet_t *attacker, const os_fleet_t *defender,
+						 int with_resources)
+{
+    const os_fleet_t *fleets[2];
+    apr_uint64_t hash = 14695981039346656037ULL;
+    int i;
+
+    fleets[0] = attacker;
+    fleets[1] = defender;
+    for (i = 0; i < 2; i++) {
+	hash = os_fleet_hash(hash, fleets[i]->initial_repartition, ITEM_END * sizeof(unsigned int));
+	hash = os_fleet_hash(hash, &(fleets[i]->mit), sizeof(unsigned int));
+	if (with_resources) {
+	    hash = os_fleet_hash(hash, &(fleets[i]->metal), sizeof(unsigned int));
+	    hash = os_fleet_hash(hash, &(fleets[i]->cristal), sizeof(unsigned int));
+	    hash = os_fleet_hash(hash, &(fleets[i]->deut), sizeof(unsigned int));
+	}
+	hash = os_fleet_hash(hash, &(fleets[i]->attack), sizeof(unsigned char));
+	hash = os_fleet_hash(hash, &(fleets[i]->shield), sizeof(unsigned char));
+	hash = os_fleet_hash(hash, &(fleets[i]->structr), sizeof(unsigned char));
+	hash = os_fleet_hash(hash, &(fleets[i]->combustion), sizeof(unsigned char));
+	hash = os_fleet_hash(hash, &(fleets[i]->impulsion), sizeof(unsigned char));
+	hash = os_fleet_hash(hash, &(fleets[i]->hyperespace), sizeof(unsigned char));
+	hash = os_fleet_hash(hash, fleets[i]->coord, strlen(fleets[i]->coord));
     }
 
-    for (k = 0; k < nb_simu; k++) {
-	nb_round += os_fleet_onebattle(attacker, defender, conf);
+    /* 0 means "no matchup set" for os_result */
+    return (0ULL == hash) ? 1ULL : hash;
+}
+
+static inline float os_fleet_value(const os_fleet_t *fleet, const unsigned int *repartition, enum Item_enum limit)
+{
+    float value;
+    int j;
 
-	if (0 == attacker->ship_count)
-	    nb_def_vict++;
-	else if (0 == defender->ship_count)
-	    nb_atk_vict++;
+    for (j = 0, value = 0.0f; j < limit; j++)
+	value += repartition[j] * fleet->os_ship[j].price;
 
-	for (j = 0; j < LM; j++) {
-	    recycl_m +=
-		(((attacker->initial_repartition[j] -
-		   attacker->current_repartition[j]) * attacker->os_ship[j].metl_price) * 0.3f);
-	    atk_loss_m +=
-		((attacker->initial_repartition[j] - attacker->current_repartition[j]) * attacker->os_ship[j].metl_price);
-	    recycl_m +=
-		(((defender->initial_repartition[j] -
-		   defender->current_repartition[j]) * defender->os_ship[j].metl_price) * 0.3f);
-	    def_loss_m +=
-		((defender->initial_repartition[j] - defender->current_repartition[j]) * defender->os_ship[j].metl_price);
-	    recycl_c +=
-		(((attacker->initial_repartition[j] -
-		   attacker->current_repartition[j]) * attacker->os_ship[j].crst_price) * 0.3f);
-	    atk_loss_c +=
-		((attacker->initial_repartition[j] - attacker->current_repartition[j]) * attacker->os_ship[j].crst_price);
-	    recycl_c +=
-		(((defender->initial_repartition[j] -
-		   defender->current_repartition[j]) * defender->os_ship[j].crst_price) * 0.3f);
-	    def_loss_c +=
-		((defender->initial_repartition[j] - defender->current_repartition[j]) * defender->os_ship[j].crst_price);
-	    atk_loss_d +=
-		((attacker->initial_repartition[j] - attacker->current_repartition[j]) * attacker->os_ship[j].deut_price);
-	    def_loss_d +=
-		((defender->initial_repartition[j] - defender->current_repartition[j]) * defender->os_ship[j].deut_price);
-	}
-	for (; j < ITEM_END; j++) {
-	    def_loss_m +=
-		((defender->initial_repartition[j] - defender->current_repartition[j]) * defender->os_ship[j].metl_price);
-	    def_loss_c +=
-		((defender->initial_repartition[j] - defender->current_repartition[j]) * defender->os_ship[j].crst_price);
-	    def_loss_d +=
-		((defender->initial_repartition[j] - defender->current_repartition[j]) * defender->os_ship[j].deut_price);
-	}
-	/*DEBUG_DBG("recycl_m %llu recycl_c %llu", recycl_m, recycl_c); */
-	/*DEBUG_DBG("atk_loss_m %llu atk_loss_c %llu atk_loss_d %llu", atk_loss_m, atk_loss_c, atk_loss_d); */
-	/*DEBUG_DBG("def_loss_m %llu def_loss_c %llu def_loss_d %llu", def_loss_m, def_loss_c, def_loss_d); */
-
-	for (j = 0, atk_score = 0UL; j < LM; j++) {
-	    atk_avg[j] += attacker->current_repartition[j];
-	    atk_score += attacker->current_repartition[j] * attacker->os_ship[j].price;
-	}
-	if (atk_score >= atk_max_score) {
-	    for (j = 0; j < LM; j++)
-		atk_bst[j] = attacker->current_repartition[j];
-	    atk_max_score = atk_score;
-	}
-	if (atk_score <= atk_min_score) {
-	    for (j = 0; j < LM; j++)
-		atk_wrst[j] = attacker->current_repartition[j];
-	    atk_min_score = atk_score;
-	}
-	for (j = 0, def_score = 0UL; j < ITEM_END; j++) {
-	    def_avg[j] += defender->current_repartition[j];
-	    def_score += defender->current_repartition[j] * defender->os_ship[j].price;
-	}
-	if (def_score >= def_max_score) {
-	    for (j = 0; j < ITEM_END; j++)
-		def_bst[j] = defender->current_repartition[j];
-	    def_max_score = def_score;
-	}
-	if (def_score <= def_min_score) {
-	    for (j = 0; j < ITEM_END; j++)
-		def_wrst[j] = defender->current_repartition[j];
-	    def_min_score = def_score;
-	}
-    }
-
-    if (mode & OS_MODE_HTML) {
-	fprintf(stdout, "<p>attacker,%s,", attacker->coord);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%s (%u), ", os_conf_get_shortname(conf, j), atk_avg[j] / nb_simu);
-	}
-	fprintf(stdout, "%u victoires, %u nuls, %u round", nb_atk_vict, (nb_simu - (nb_atk_vict + nb_def_vict)),
-		nb_round / nb_simu);
-	fprintf(stdout,
-		", %" APR_UINT64_T_FMT " metal perdu, %" APR_UINT64_T_FMT " cristal perdu, %" APR_UINT64_T_FMT
-		" deut perdu, %u deut consommé</p><br />", atk_loss_m / nb_simu, atk_loss_c / nb_simu, atk_loss_d / nb_simu,
-		os_fleet_consumption(attacker, distance, &flight_time));
+    return value;
+}
 
-	fprintf(stdout, "<p>defender,%s,%u,%u,%u,", defender->coord, defender->metal, defender->cristal, defender->deut);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%s (%u), ", os_conf_get_shortname(conf, j), def_avg[j] / nb_simu);
-	}
-	fprintf(stdout, "%u victoires, %u nuls, %u round", nb_def_vict, (nb_simu - (nb_atk_vict + nb_def_vict)),
-		nb_round / nb_simu);
-	fprintf(stdout,
-		", %" APR_UINT64_T_FMT " metal perdu, %" APR_UINT64_T_FMT " cristal perdu, %" APR_UINT64_T_FMT
-		" deut perdu</p><br />", def_loss_m / nb_simu, def_loss_c / nb_simu, def_loss_d / nb_simu);
-
-	fprintf(stdout, "<p>Statistiques de recyclage (moyenne):</p><br />");
-	fprintf(stdout, "<p>%s, %" APR_UINT64_T_FMT " metal, %" APR_UINT64_T_FMT " cristal,", defender->coord,
-		recycl_m / nb_simu, recycl_c / nb_simu);
-
-	pct_M_atk_str =
-	    (0 == atk_loss_m) ? apr_pstrdup(attacker->pool, "no-metal-loss") : apr_psprintf(attacker->pool,
-											    "%" APR_UINT64_T_FMT,
-											    100UL * recycl_m / atk_loss_m);
-	pct_C_atk_str =
-	    (0 == atk_loss_c) ? apr_pstrdup(attacker->pool, "no-cristal-loss") : apr_psprintf(attacker->pool,
-											      "%" APR_UINT64_T_FMT,
-											      100UL * recycl_c / atk_loss_c);
-	pct_M_def_str =
-	    (0 == def_loss_m) ? apr_pstrdup(defender->pool, "no-metal-loss") : apr_psprintf(defender->pool,
-											    "%" APR_UINT64_T_FMT,
-											    100UL * recycl_m / def_loss_m);
-	pct_C_def_str =
-	    (0 == def_loss_c) ? apr_pstrdup(defender->pool, "no-cristal-loss") : apr_psprintf(defender->pool,
-											      "%" APR_UINT64_T_FMT,
-											      100UL * recycl_c / def_loss_c);
-	fprintf(stdout, "%s %%age_M_atk, %s %%age_C_atk, %s %%age_M_def, %s %%age_C_def, ", pct_M_atk_str, pct_C_atk_str,
-		pct_M_def_str, pct_C_def_str);
-	fprintf(stdout, "%" APR_UINT64_T_FMT " recycleurs</p><br />",
-		(recycl_m + recycl_c) / (nb_simu * os_conf_get_ship_capacity(conf, REC)));
+extern apr_status_t os_fleet_battle_shard(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+					  unsigned int shard_idx, unsigned int shard_count, const os_conf_t *conf,
+					  os_result_t *result)
+{
+    apr_uint64_t atk_loss[RES_END], def_loss[RES_END], recycled[RES_DEUT];
+    apr_uint64_t start = 0;
+    os_fleet_rand_t rnd;
+    unsigned int resources[RES_END];
+    unsigned int distance, flight_time, lost, k, first, seed;
+    unsigned char nb_round;
+    int j;
+
+    if ((0 == shard_count) || (shard_idx >= shard_count)) {
+	DEBUG_ERR("invalid shard %u/%u", shard_idx, shard_count);
+	return APR_EINVAL;
+    }
+    if (0UL == (distance = os_fleet_distance(attacker->coord, defender->coord))) {
+	DEBUG_ERR("Invalid coordinates");
+	return APR_EINVAL;
+    }
+    if (attacker->guess_mode || defender->guess_mode) {
+	DEBUG_ERR("invalid simulation, one is in guess mode (only technos precised)");
+	return APR_EINVAL;
     }
-    else {
-	fprintf(stdout, "\nplayer,coord,metal,cristal,deut,");
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%s,", os_conf_get_shortname(conf, j));
-	}
-	fprintf(stdout, "victory,draw,round,metal_loss,cristal_loss,deut_loss,deut_consumed");
 
-	fprintf(stdout, "\nattacker,%s,0,0,0,", attacker->coord);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%u,", atk_avg[j] / nb_simu);
-	}
-	fprintf(stdout, "%u,%u,%u,", nb_atk_vict, (nb_simu - (nb_atk_vict + nb_def_vict)), nb_round / nb_simu);
-	fprintf(stdout, "%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%u", atk_loss_m / nb_simu,
-		atk_loss_c / nb_simu, atk_loss_d / nb_simu, os_fleet_consumption(attacker, distance, &flight_time));
+    /*
+     * Each simulation gets its own stream of random numbers, derived from its
+     * rank among the nb_simu ones: the shards of a seeded battle sum up to the
+     * same result whatever their number.
+     */
+    seed = os_fleet_get_seed();
+    first = shard_idx * (nb_simu / shard_count) + MIN(shard_idx, nb_simu % shard_count);
+    nb_simu = nb_simu / shard_count + ((shard_idx < (nb_simu % shard_count)) ? 1 : 0);
+
+    resources[RES_METAL] = defender->metal;
+    resources[RES_CRISTAL] = defender->cristal;
+    resources[RES_DEUT] = defender->deut;
+    os_result_set_matchup(result, os_fleet_matchup_fingerprint(attacker, defender, 1), attacker->coord, defender->coord,
+			  resources, os_fleet_consumption(attacker, distance, &flight_time),
+			  os_fleet_value(attacker, attacker->initial_repartition, LM),
+			  os_fleet_value(defender, defender->initial_repartition, ITEM_END));
+
+    os_profile_counters_start();
+    for (k = 0; k < nb_simu; k++) {
+	my_srand(&rnd, os_fleet_mix(seed, first + k));
+	nb_round = os_fleet_onebattle(attacker, defender, conf, &rnd);
 
-	fprintf(stdout, "\ndefender,%s,%u,%u,%u,", defender->coord, defender->metal, defender->cristal, defender->deut);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%u,", def_avg[j] / nb_simu);
-	}
-	fprintf(stdout, "%u,%u,%u,", nb_def_vict, (nb_simu - (nb_atk_vict + nb_def_vict)), nb_round / nb_simu);
-	fprintf(stdout, "%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",0", def_loss_m / nb_simu,
-		def_loss_c / nb_simu, def_loss_d / nb_simu);
-
-	fprintf(stdout, "\n\nRecycling statistics (average):");
-	fprintf(stdout, "\nrecycl,coord,metal,cristal,%%age_M_atk,%%age_C_atk,%%age_M_def,%%age_C_def,nb_recycler");
-	fprintf(stdout, "\nrecycl,%s,%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",", defender->coord, recycl_m / nb_simu,
-		recycl_c / nb_simu);
-
-	pct_M_atk_str =
-	    (0 == atk_loss_m) ? apr_pstrdup(attacker->pool, "no-metal-loss") : apr_psprintf(attacker->pool,
-											    "%" APR_UINT64_T_FMT,
-											    100UL * recycl_m / atk_loss_m);
-	pct_C_atk_str =
-	    (0 == atk_loss_c) ? apr_pstrdup(attacker->pool, "no-cristal-loss") : apr_psprintf(attacker->pool,
-											      "%" APR_UINT64_T_FMT,
-											      100UL * recycl_c / atk_loss_c);
-	pct_M_def_str =
-	    (0 == def_loss_m) ? apr_pstrdup(defender->pool, "no-metal-loss") : apr_psprintf(defender->pool,
-											    "%" APR_UINT64_T_FMT,
-											    100UL * recycl_m / def_loss_m);
-	pct_C_def_str =
-	    (0 == def_loss_c) ? apr_pstrdup(defender->pool, "no-cristal-loss") : apr_psprintf(defender->pool,
-											      "%" APR_UINT64_T_FMT,
-											      100 * recycl_c / def_loss_c);
-	fprintf(stdout, "%s,%s,%s,%s,", pct_M_atk_str, pct_C_atk_str, pct_M_def_str, pct_C_def_str);
-	fprintf(stdout, "%" APR_UINT64_T_FMT, (recycl_m + recycl_c) / (nb_simu * os_conf_get_ship_capacity(conf, REC)));
-
-	fprintf(stdout, "\n\nAdditional statistics Best/Worst:");
-	fprintf(stdout, "\nplayer,coord,metal,cristal,deut,");
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%s%s", os_conf_get_shortname(conf, j), ((ITEM_END - 1) == j) ? "" : ",");
-	}
-	fprintf(stdout, "\nbest_attacker,%s,0,0,0,", attacker->coord);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%u%s", atk_bst[j], ((ITEM_END - 1) == j) ? "" : ",");
-	}
-	fprintf(stdout, "\nbest_defender,%s,%u,%u,%u,", defender->coord, defender->metal, defender->cristal, defender->deut);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%u%s", def_bst[j], ((ITEM_END - 1) == j) ? "" : ",");
-	}
-	fprintf(stdout, "\nworst_attacker,%s,0,0,0,", attacker->coord);
-	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%u%s", atk_wrst[j], ((ITEM_END - 1) == j) ? "" : ",");
+	OS_PROFILE_BEGIN(start);
+	memset(atk_loss, 0, RES_END * sizeof(apr_uint64_t));
+	memset(def_loss, 0, RES_END * sizeof(apr_uint64_t));
+	memset(recycled, 0, RES_DEUT * sizeof(apr_uint64_t));
+	for (j = 0; j < LM; j++) {
+	    lost = attacker->initial_repartition[j] - attacker->current_repartition[j];
+	    atk_loss[RES_METAL] += (apr_uint64_t) lost *attacker->os_ship[j].metl_price;
+	    atk_loss[RES_CRISTAL] += (apr_uint64_t) lost *attacker->os_ship[j].crst_price;
+	    atk_loss[RES_DEUT] += (apr_uint64_t) lost *attacker->os_ship[j].deut_price;
+	    recycled[RES_METAL] += (apr_uint64_t) ((lost * (float) attacker->os_ship[j].metl_price) * 0.3f);
+	    recycled[RES_CRISTAL] += (apr_uint64_t) ((lost * (float) attacker->os_ship[j].crst_price) * 0.3f);
 	}
-	fprintf(stdout, "\nworst_defender,%s,%u,%u,%u,", defender->coord, defender->metal, defender->cristal,
-		defender->deut);
 	for (j = 0; j < ITEM_END; j++) {
-	    fprintf(stdout, "%u%s", def_wrst[j], ((ITEM_END - 1) == j) ? "" : ",");
+	    lost = defender->initial_repartition[j] - defender->current_repartition[j];
+	    def_loss[RES_METAL] += (apr_uint64_t) lost *defender->os_ship[j].metl_price;
+	    def_loss[RES_CRISTAL] += (apr_uint64_t) lost *defender->os_ship[j].crst_price;
+	    def_loss[RES_DEUT] += (apr_uint64_t) lost *defender->os_ship[j].deut_price;
+	    /* Destroyed defenses don't go to the debris field */
+	    if (j < LM) {
+		recycled[RES_METAL] += (apr_uint64_t) ((lost * (float) defender->os_ship[j].metl_price) * 0.3f);
+		recycled[RES_CRISTAL] += (apr_uint64_t) ((lost * (float) defender->os_ship[j].crst_price) * 0.3f);
+	    }
 	}
-	fprintf(stdout, "\n");
-    }
-}
-
-static const unsigned int item_bitmask[ITEM_END] = {
-    0x00000001,			/* PT */
-    0x00000002,			/* GT */
-    0x00000004,			/* CLE */
-    0x00000008,			/* CLO */
-    0x00000010,			/* CR */
-    0x00000020,			/* VB */
-    0x00000040,			/* VC */
-    0x00000080,			/* REC */
-    0x00000100,			/* SE */
-    0x00000200,			/* BB */
-    0x00000400,			/* SAT */
-    0x00000800,			/* DEST */
-    0x00001000,			/* EDLM */
-    0x00002000,			/* TRAC */
-    0x00004000,			/* LM */
-    0x00008000,			/* ALLE */
-    0x00010000,			/* ALLO */
-    0x00020000,			/* CG */
-    0x00040000,			/* AAI */
-    0x00080000,			/* LP */
-    0x00100000,			/* PB */
-    0x00200000			/* GB */
-};
+	/*DEBUG_DBG("recycl_m %llu recycl_c %llu", recycled[RES_METAL], recycled[RES_CRISTAL]); */
 
-#define	BUFFER_FLEET_DEF_FULL (0x00000000)
-#define	BUFFER_FLEET_ATK_FULL (item_bitmask[SAT])
-#define BUFFER_FLEET_ATK_NORMAL (item_bitmask[PT]|item_bitmask[GT]|item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT]|item_bitmask[EDLM])
-#define BUFFER_FLEET_DEF_NORMAL (item_bitmask[PT]|item_bitmask[GT]|item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT])
-#define BUFFER_FLEET_ATK_NOMISSILE (item_bitmask[LM]|item_bitmask[ALLE]|item_bitmask[ALLO]|item_bitmask[CG]|item_bitmask[AAI]|item_bitmask[LP]|item_bitmask[PB]|item_bitmask[GB])
-#define BUFFER_FLEET_SCRIPT (item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT]|item_bitmask[EDLM]|BUFFER_FLEET_ATK_NOMISSILE)
-#define BUFFER_FLEET_DEF_BIGDEF (item_bitmask[PT]|item_bitmask[GT]|item_bitmask[CLE]|item_bitmask[CLO]|item_bitmask[CR]|item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT])
-
-struct os_fleet_genetic_ctx_t
-{
-    unsigned int initial_repartition[ITEM_END];	/* Used to store already buyed fleet , to remove the price from guessed */
-    unsigned int max_missiles[ITEM_END];
-    unsigned int buffer_fleet;	/* binary mask with forbidden ship set to one */
-    apr_uint64_t metl_recycled;
-    apr_uint64_t crst_recycled;
-    const os_conf_t *conf;
-    os_fleet_t *fleet;		/* Ennemy fleet */
-    apr_pool_t *pool;
-    float max_price;
-    unsigned int max_ship;
-    unsigned int distance;
-    unsigned int wave_time;
-    unsigned int max_flight_time;
-    unsigned int first_fleet_set;	/* 0 if we have a repartition, 1 after the first random generation that won't be random but copy of it */
-    unsigned char attack;
-    unsigned char shield;
-    unsigned char structr;
-    unsigned char combustion;
-    unsigned char impulsion;
-    unsigned char hyperespace;
-    unsigned char mode;		/* binary mask of OS_MODE_HUMAN/OS_MODE_PERL/OS_MODE_HTML/OS_MODE_NO_LOSS/OS_MODE_NO_RECYCLING/... see os_fleet.h */
-};
+	os_result_add(result, nb_round, attacker->current_repartition,
+		      os_fleet_value(attacker, attacker->current_repartition, LM), defender->current_repartition,
+		      os_fleet_value(defender, defender->current_repartition, ITEM_END), atk_loss, def_loss, recycled);
+	OS_PROFILE_END(PRF_STATS, start);
+    }
+    os_profile_counters_stop();
 
-typedef struct os_fleet_genetic_ctx_t os_fleet_genetic_ctx_t;
+    return APR_SUCCESS;
+}
 
-static void os_fleet_ga_display(void *rec, const void *chromosome)
+extern void os_fleet_battle(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu, const os_conf_t *conf,
+			    unsigned char mode)
 {
-    os_fleet_genetic_ctx_t *ctx = rec;
-    const os_fleet_t *fleet = chromosome;
-    const os_fleet_t *attacker, *defender;
-    unsigned int deut_consumed, free_capacity, flight_time;
-    long stealsum, metal_stolen, cristal_stolen, deut_stolen;	/* can be negative */
-    int is_first = 1, display_mip = 0;
-    enum Item_enum j;
+    os_result_t *result;
+    apr_uint64_t start = 0;
 
-    if (ctx->mode & OS_MODE_PERL) {
-	defender = ctx->fleet;
-	attacker = chromosome;
+    if (NULL == (result = os_result_make(attacker->pool))) {
+	DEBUG_ERR("error calling os_result_make");
+	return;
+    }
+    if (APR_SUCCESS != os_fleet_battle_shard(attacker, defender, nb_simu, 0, 1, conf, result))
+	return;
 
-	for (j = 0, free_capacity = 0; j < LM; j++)
-	    free_capacity += (attacker->current_repartition[j] * attacker->os_ship[j].capacity);
+    OS_PROFILE_BEGIN(start);
+    os_result_display(result, conf, mode);
+    OS_PROFILE_END(PRF_OUTPUT, start);
+}
 
-	/* Deut consummed added to total lost */
-	deut_consumed = os_fleet_consumption(attacker, ctx->distance, &flight_time);
-	free_capacity -= deut_consumed;
+extern apr_status_t os_fleet_battle_sample(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+					   const os_conf_t *conf, os_sample_t *sample)
+{
+    apr_uint64_t start = 0;
+    os_fleet_rand_t rnd;
+    unsigned int k, seed;
+    unsigned char nb_round;
 
-	metal_stolen = (long) ((defender->metal >> 1) - attacker->metl_lost);
-	cristal_stolen = (long) ((defender->cristal >> 1) - attacker->crst_lost);
-	deut_stolen = (long) ((defender->deut >> 1) - attacker->deut_lost);
+    if (attacker->guess_mode || defender->guess_mode) {
+	DEBUG_ERR("invalid simulation, one is in guess mode (only technos precised)");
+	return APR_EINVAL;
+    }
 
-	stealsum = metal_stolen + cristal_stolen + deut_stolen;
-	/*
-	 * this < insure that stealsum is positive
-	 * Thus metal_stolen, cristal_stolen are always positives.
-	 */
-	if (free_capacity < stealsum) {
-	    float capacity_divider;
+    seed = os_fleet_get_seed();
+    /* Resources are not part of the fingerprint, samples can be rescored with other ones */
+    os_sample_set_matchup(sample, os_fleet_matchup_fingerprint(attacker, defender, 0));
+    os_profile_counters_start();
+    for (k = 0; k < nb_simu; k++) {
+	my_srand(&rnd, os_fleet_mix(seed, k));
+	nb_round = os_fleet_onebattle(attacker, defender, conf, &rnd);
+	OS_PROFILE_BEGIN(start);
+	os_sample_add(sample, nb_round, attacker->current_repartition, defender->current_repartition);
+	OS_PROFILE_END(PRF_STATS, start);
+    }
+    os_profile_counters_stop();
 
-	    capacity_divider = (float) free_capacity / (float) stealsum;
-	    metal_stolen = ((float) metal_stolen * capacity_divider);
-	    cristal_stolen = ((float) cristal_stolen * capacity_divider);
-	    deut_stolen = (long) ((float) deut_stolen * capacity_divider) - (long) deut_consumed;
-	}
-	else {
-	    deut_stolen -= deut_consumed;
-	}
+    return APR_SUCCESS;
+}
 
-	fprintf(stdout, "\nmetal,cristal,deut(less_consumed),recyclable_metal,recyclable_cristal,flight_time,deut_consum,");
-	for (j = PT, is_first = 1; j < LM; j++) {
-	    fprintf(stdout, "%s%s", (1 == is_first) ? "" : ",", (fleet->os_ship)[j].shortname);
-	    is_first = 0;
-	}
-	fprintf(stdout, "\n%li,%li,%li,%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%u,%u,", metal_stolen, cristal_stolen,
-		deut_stolen, attacker->metl_recycled, attacker->crst_recycled, flight_time, deut_consumed);
-	for (j = PT, is_first = 1; j < LM; j++) {
-	    fprintf(stdout, "%s%u", (1 == is_first) ? "" : ",", fleet->initial_repartition[j]);
-	    is_first = 0;
-	}
-	fprintf(stdout, "\n\n");
-    }
-    else {
-	if (ctx->mode & OS_MODE_HTML)
-	    fprintf(stdout, "Flotte proposée:<br />");
-	for (j = PT; j < ITEM_END; j++) {
-	    if (0 != fleet->initial_repartition[j]) {
-		if ((ATK_FLT == fleet->type) && (j >= LM) && !display_mip) {
-		    fprintf(stdout, "%sMISSILE VS. ", (1 == is_first) ? "" : ", ");
-		    display_mip = 1;
-		    is_first = 1;
-		}
-		fprintf(stdout, "%s%s:%u", (1 == is_first) ? "" : ", ", (fleet->os_ship)[j].shortname,
-			fleet->initial_repartition[j]);
-		is_first = 0;
-	    }
-	}
+#ifdef UNITTEST
+/*
+ * Frozen copy of the battle engine of osim 1.6.0, never optimise nor fix it:
+ * the equivalence checks compare the outcome distributions of the engine
+ * above with this one. It has its own random numbers and rapid fire table,
+ * a change of the ones of the engine can't move it too.
+ */
+static unsigned int reference_rsl[RND_ARRAY_SIZE];
+static unsigned char reference_last_rsl_used;
 
-	if (ctx->mode & OS_MODE_HTML)
-	    fprintf(stdout, "<br />");
+static void os_fleet_reference_srand(unsigned int salt)
+{
+    unsigned char i;
 
-	if (!(ctx->mode & OS_MODE_NO_INVEST)) {
-	    fprintf(stdout, "\n");
-	    fprintf(stdout, "\tMetal Invested:%" APR_UINT64_T_FMT, fleet->ship_metal);
-	    fprintf(stdout, ", Cristal Invested:%" APR_UINT64_T_FMT, fleet->ship_cristal);
-	    fprintf(stdout, ", Deut Invested:%" APR_UINT64_T_FMT, fleet->ship_deut);
-	}
-	fprintf(stdout, "\n");
-	if (ctx->mode & OS_MODE_HTML)
-	    fprintf(stdout, "<br /><br />");
-    }
+    srand(salt);
+    for (i = 0; i < RND_ARRAY_SIZE; ++i)
+	reference_rsl[i] = (unsigned int) UINT_MAX *(rand() / (RAND_MAX + 1.0));
 
-    fflush(stdout);
+    for (i = 0; i < RND_ARRAY_SIZE; ++i)
+	reference_rsl[i] = reference_rsl[i] + reference_rsl[(i + 24) % RND_ARRAY_SIZE];
 }
 
-static inline int os_fleet_compute_fitness_stats(os_fleet_t *adversary, os_fleet_t *own)
+static unsigned int os_fleet_reference_rand(unsigned int limit)
 {
-    unsigned char j;
+    unsigned char i;
 
-    /* Must not lose */
-    if (0 == own->ship_count)
-	return 0;
+    reference_last_rsl_used++;
+    if (reference_last_rsl_used == RND_ARRAY_SIZE) {
+	for (i = 0; i < RND_ARRAY_SIZE; ++i)
+	    reference_rsl[i] = reference_rsl[i] + reference_rsl[(i + 24) % RND_ARRAY_SIZE];
+	reference_last_rsl_used = 0;
+    }
 
-    /* Ennemy must lose */
-    if (0 != adversary->ship_count)
-	return 0;
+    return reference_rsl[reference_last_rsl_used] % limit;
+}
 
-    own->metl_lost = 0ULL;
-    own->crst_lost = 0ULL;
-    own->deut_lost = 0ULL;
-    for (j = '\0'; j < ITEM_END; j++) {
-	own->metl_lost +=
-	    (apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
-			    (apr_uint64_t) own->current_repartition[j]) * (apr_uint64_t) own->os_ship[j].metl_price;
-	own->crst_lost +=
-	    (apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
-			    (apr_uint64_t) own->current_repartition[j]) * (apr_uint64_t) own->os_ship[j].crst_price;
-	own->deut_lost +=
-	    (apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
-			    (apr_uint64_t) own->current_repartition[j]) * (apr_uint64_t) own->os_ship[j].deut_price;
+static const short unsigned int reference_rapid_fire_const[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    3300, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 3300, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 1000, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 0, 500, 500, 1000, 0, 1000, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 2000, 0, 0, 5000, 0, 1000, 0, 0, 0, 0, 0, 0,
+    40, 40, 50, 100, 303, 333, 40, 40, 8, 400, 8, 2000, 0, 667, 50, 50, 100, 200, 100, 0, 0, 0,
+    3300, 3300, 0, 4, 4, 7, 0, 0, 2000, 0, 2000, 0, 0, 5000, 0, 1000, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static int os_fleet_reference_rapid_fired(enum Item_enum atktype, enum Item_enum deftype)
+{
+    unsigned short int rf;
+
+    rf = reference_rapid_fire_const[deftype + atktype * (GB + 1)];
+    if (0 == rf)
+	return 0;
+    else {
+	unsigned short int rsi;
+	rsi = (unsigned short int) os_fleet_reference_rand(10000UL);
+	return rsi >= rf;
+    }
+}
+
+static void os_fleet_reference_init(os_fleet_t *fleet)
+{
+    unsigned int ships_idx, count;
+    enum Item_enum i;
+
+    memset(fleet->ships_hit_table, 0, fleet->ship_initial_count);
+    fleet->ship_count = 0;
+
+    for (i = PT; i < fleet->limit; i++) {
+	count = fleet->ship_count;
+	for (ships_idx = 0; ships_idx < fleet->initial_repartition[i]; ships_idx++) {
+	    /* No need to set shields, they will be reset */
+	    (fleet->ships_hit_table)[count + ships_idx].structure_points = (fleet->os_ship)[i].structure_points;
+	    (fleet->ships_hit_table)[count + ships_idx].type = i;
+	    (fleet->ships_hit_table)[count + ships_idx].exploded &= 0x0;
+	}
+	fleet->current_repartition[i] = ships_idx;
+	fleet->ship_count += ships_idx;
+    }
+}
+
+static void os_fleet_reference_maximize_shield(os_fleet_t *fleet)
+{
+    unsigned int count;
+    os_battle_ship_t *__restrict__ ships_hit_table = fleet->ships_hit_table;
+    os_battle_ship_t *__restrict__ ships_hit_table_bis = fleet->ships_hit_table;
+    os_ship_t *__restrict__ os_ship = fleet->os_ship;
+
+    for (count = 0; count < fleet->ship_count; count++)
+	ships_hit_table[count].shield_points = os_ship[ships_hit_table_bis[count].type].shield_points;
+}
+
+static void os_fleet_reference_shoot(const os_fleet_t *attacker, unsigned int attack_ship_number, os_fleet_t *defender,
+				     const os_conf_t *conf)
+{
+    enum Item_enum attack_ship, defend_ship;
+    unsigned int rnd_nb;
+    float damage;
+    unsigned char has_rapid_fired;
+
+    /* First, get the type of the ship that will shoot from attacker */
+    attack_ship = (attacker->ships_hit_table)[attack_ship_number].type;
+
+    /* Then this ship will attack as long as possible */
+    do {
+	/* find the target */
+	rnd_nb = os_fleet_reference_rand(defender->ship_count);
+	defend_ship = (defender->ships_hit_table)[rnd_nb].type;
+	has_rapid_fired = 0;
+
+	damage = attacker->os_ship[attack_ship].attack_value;
+	if (1.0f <= (damage * defender->os_ship[defend_ship].shield_points_percent)) {
+	    if (!(0x1 & (defender->ships_hit_table)[rnd_nb].exploded)) {
+		float tmp;
+		damage = floorf(damage * 10.0f) * 0.1f;
+
+		tmp = damage;
+		damage -= (defender->ships_hit_table)[rnd_nb].shield_points;
+		(defender->ships_hit_table)[rnd_nb].shield_points -= tmp;
+
+		if (damage > 0.0f) {
+		    (defender->ships_hit_table)[rnd_nb].structure_points -= damage;
+		    /* If we are here, it means that the shield has been destroyed */
+		    (defender->ships_hit_table)[rnd_nb].shield_points = 0.0f;
+
+		    if ((defender->ships_hit_table)[rnd_nb].structure_points < 0.0f) {
+			(defender->ships_hit_table)[rnd_nb].exploded |= 0x1;
+		    }
+		    else if ((defender->ships_hit_table)[rnd_nb].structure_points <=
+			     (0.7f * defender->os_ship[defend_ship].structure_points)) {
+			/*
+			 * ship probably explodes, when hull damage >= 30 %
+			 */
+			if ((float) os_fleet_reference_rand(100UL) >=
+			    ((defender->ships_hit_table)[rnd_nb].structure_points *
+			     defender->os_ship[defend_ship].structure_points_percent)) {
+			    (defender->ships_hit_table)[rnd_nb].exploded |= 0x1;
+			}
+		    }
+		}
+	    }
+
+	    has_rapid_fired = os_fleet_reference_rapid_fired(attack_ship, defend_ship);
+	}
+    } while (0 != has_rapid_fired);
+}
+
+static void os_fleet_reference_remove_exploded_ships(os_fleet_t *fleet)
+{
+    unsigned int ship_idx;
+
+    for (ship_idx = 0; ship_idx < fleet->ship_count; ship_idx++) {
+	if (((fleet->ships_hit_table)[ship_idx].exploded & 0x1) && (fleet->ship_count != 0)) {
+	    (fleet->ship_count)--;
+	    while (((fleet->ships_hit_table)[fleet->ship_count].exploded & 0x1) && (ship_idx < fleet->ship_count)) {
+		((fleet->current_repartition)[(fleet->ships_hit_table)[fleet->ship_count].type])--;
+		(fleet->ship_count)--;
+	    }
+	    ((fleet->current_repartition)[(fleet->ships_hit_table)[ship_idx].type])--;
+	    (fleet->ships_hit_table)[ship_idx].structure_points =
+		(fleet->ships_hit_table)[fleet->ship_count].structure_points;
+	    /* No need to set shields, they will be reset */
+	    (fleet->ships_hit_table)[ship_idx].type = (fleet->ships_hit_table)[fleet->ship_count].type;
+	    (fleet->ships_hit_table)[ship_idx].exploded &= 0x0;
+	}
+    }
+}
+
+static void os_fleet_reference_launch_missile(os_fleet_t *attacker, os_fleet_t *defender)
+{
+    unsigned int initial_repartition[ITEM_END];
+    unsigned int nb_dest;
+    unsigned int mit;
+    float damage;
+    enum Item_enum i;
+
+    mit = defender->mit;
+    memcpy(initial_repartition, defender->initial_repartition, ITEM_END * sizeof(unsigned int));
+    for (i = LM; i <= GB; i++) {
+	if (attacker->initial_repartition[i] > mit) {
+	    damage = (attacker->initial_repartition[i] - mit) * 12000.0f * (1.0f + attacker->attack / 10.0f);
+	    if (attacker->initial_repartition[i] > mit) {
+		mit = 0UL;
+	    }
+	    else {
+		mit -= attacker->initial_repartition[i];
+	    }
+	    nb_dest = damage / defender->os_ship[i].structure_points;
+	    nb_dest = MIN(nb_dest, defender->initial_repartition[i]);
+	    defender->initial_repartition[i] -= nb_dest;
+	}
+	attacker->current_repartition[i] = 0UL;
+    }
+    os_fleet_reference_init(defender);
+    memcpy(defender->initial_repartition, initial_repartition, ITEM_END * sizeof(unsigned int));
+}
+
+static unsigned char os_fleet_reference_onebattle(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf)
+{
+    unsigned int ship_idx;
+    unsigned char i;
+
+    os_fleet_reference_init(attacker);
+    os_fleet_reference_launch_missile(attacker, defender);
+
+    for (i = '\0'; (i < MAX_ROUND_NUMBER) && (0 != attacker->ship_count) && (defender->ship_count); i++) {
+	os_fleet_reference_maximize_shield(attacker);
+	os_fleet_reference_maximize_shield(defender);
+
+	for (ship_idx = 0; ship_idx < attacker->ship_count; ship_idx++) {
+	    os_fleet_reference_shoot(attacker, ship_idx, defender, conf);
+	}
+
+	for (ship_idx = 0; ship_idx < defender->ship_count; ship_idx++) {
+	    os_fleet_reference_shoot(defender, ship_idx, attacker, conf);
+	}
+
+	os_fleet_reference_remove_exploded_ships(defender);
+	os_fleet_reference_remove_exploded_ships(attacker);
+    }
+
+    return i;
+}
+
+extern apr_status_t os_fleet_reference_battle_sample(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+						     unsigned int salt, const os_conf_t *conf, os_sample_t *sample)
+{
+    unsigned int k;
+    unsigned char nb_round;
+
+    if (attacker->guess_mode || defender->guess_mode) {
+	DEBUG_ERR("invalid simulation, one is in guess mode (only technos precised)");
+	return APR_EINVAL;
+    }
+
+    os_fleet_reference_srand(os_fleet_get_seed() ^ salt);
+    os_sample_set_matchup(sample, os_fleet_matchup_fingerprint(attacker, defender, 0));
+    for (k = 0; k < nb_simu; k++) {
+	nb_round = os_fleet_reference_onebattle(attacker, defender, conf);
+	os_sample_add(sample, nb_round, attacker->current_repartition, defender->current_repartition);
+    }
+
+    return APR_SUCCESS;
+}
+#endif /* UNITTEST */
+
+static const unsigned int item_bitmask[ITEM_END] = {
+    0x00000001,			/* PT */
+    0x00000002,			/* GT */
+    0x00000004,			/* CLE */
+    0x00000008,			/* CLO */
+    0x00000010,			/* CR */
+    0x00000020,			/* VB */
+    0x00000040,			/* VC */
+    0x00000080,			/* REC */
+    0x00000100,			/* SE */
+    0x00000200,			/* BB */
+    0x00000400,			/* SAT */
+    0x00000800,			/* DEST */
+    0x00001000,			/* EDLM */
+    0x00002000,			/* TRAC */
+    0x00004000,			/* LM */
+    0x00008000,			/* ALLE */
+    0x00010000,			/* ALLO */
+    0x00020000,			/* CG */
+    0x00040000,			/* AAI */
+    0x00080000,			/* LP */
+    0x00100000,			/* PB */
+    0x00200000			/* GB */
+};
+
+#define	BUFFER_FLEET_DEF_FULL (0x00000000)
+#define	BUFFER_FLEET_ATK_FULL (item_bitmask[SAT])
+#define BUFFER_FLEET_ATK_NORMAL (item_bitmask[PT]|item_bitmask[GT]|item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT]|item_bitmask[EDLM])
+#define BUFFER_FLEET_DEF_NORMAL (item_bitmask[PT]|item_bitmask[GT]|item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT])
+#define BUFFER_FLEET_ATK_NOMISSILE (item_bitmask[LM]|item_bitmask[ALLE]|item_bitmask[ALLO]|item_bitmask[CG]|item_bitmask[AAI]|item_bitmask[LP]|item_bitmask[PB]|item_bitmask[GB])
+#define BUFFER_FLEET_SCRIPT (item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT]|item_bitmask[EDLM]|BUFFER_FLEET_ATK_NOMISSILE)
+#define BUFFER_FLEET_DEF_BIGDEF (item_bitmask[PT]|item_bitmask[GT]|item_bitmask[CLE]|item_bitmask[CLO]|item_bitmask[CR]|item_bitmask[VC]|item_bitmask[REC]|item_bitmask[SE]|item_bitmask[SAT])
+
+/*
+ * An individual of guess mode: its repartition, and what its last evaluation
+ * left to display. The fleet it stands for is only built when needed, from
+ * the technologies of the genetic context.
+ */
+typedef struct os_fleet_ga_chrom_t
+{
+    unsigned int initial_repartition[ITEM_END];
+    unsigned int current_repartition[ITEM_END];	/* average survivors */
+    apr_uint64_t metl_lost;
+    apr_uint64_t crst_lost;
+    apr_uint64_t deut_lost;
+    apr_uint64_t metl_recycled;
+    apr_uint64_t crst_recycled;
+    apr_uint64_t ship_metal;	/* invested */
+    apr_uint64_t ship_cristal;
+    apr_uint64_t ship_deut;
+    unsigned int ship_initial_count;
+} os_fleet_ga_chrom_t;
+
+/* What a thread evaluating individuals of guess mode keeps from one battle to the next */
+typedef struct os_fleet_ga_worker_t
+{
+    os_fleet_t enemy;		/* clone of the ennemy fleet, with its own hit table */
+    os_battle_ship_t *ships_hit_table;	/* max_ship ships, for the guessed fleet */
+    os_fleet_rand_t rnd;		/* reseeded for each batch of battles, see os_fleet_ga_fight */
+} os_fleet_ga_worker_t;
+
+struct os_fleet_genetic_ctx_t
+{
+    unsigned int initial_repartition[ITEM_END];	/* Used to store already buyed fleet , to remove the price from guessed */
+    unsigned int max_missiles[ITEM_END];
+    unsigned int buffer_fleet;	/* binary mask with forbidden ship set to one */
+    apr_uint64_t metl_recycled;
+    apr_uint64_t crst_recycled;
+    const os_conf_t *conf;
+    os_fleet_t *fleet;		/* Ennemy fleet */
+    os_fleet_t *own;		/* Technologies of the guessed fleet, shared by all the individuals */
+    napr_cache_t *cache;	/* os_fleet_ga_memo_t of the individuals already evaluated, NULL if none */
+    apr_pool_t *pool;
+    unsigned int seed;		/* the battles of an evaluation only depend on it and on the repartition */
+    const char *checkpoint_file;	/* NULL if the state of the genetic algorithm is never saved */
+    apr_uint64_t fingerprint;	/* of the guess, a checkpoint can only be resumed by the same one */
+    unsigned int *warm;		/* nb_warm repartitions (ITEM_END each) of a previous guess to start from */
+    unsigned long nb_warm;
+    napr_galife_t *ga;		/* polled by the battles to stop on time, NULL outside of the genetic algorithm */
+    float max_price;
+    unsigned int max_ship;
+    unsigned int distance;
+    unsigned int wave_time;
+    unsigned int max_flight_time;
+    unsigned char attack;
+    unsigned char shield;
+    unsigned char structr;
+    unsigned char combustion;
+    unsigned char impulsion;
+    unsigned char hyperespace;
+    unsigned char mode;		/* binary mask of OS_MODE_HUMAN/OS_MODE_PERL/OS_MODE_HTML/OS_MODE_NO_LOSS/OS_MODE_NO_RECYCLING/... see os_fleet.h */
+};
+
+typedef struct os_fleet_genetic_ctx_t os_fleet_genetic_ctx_t;
+
+/* Build the fleet an individual stands for, without hit table */
+static void os_fleet_ga_expand(const os_fleet_genetic_ctx_t *ctx, const os_fleet_ga_chrom_t *chrom, os_fleet_t *fleet)
+{
+    memcpy(fleet, ctx->own, sizeof(os_fleet_t));
+    fleet->ships_hit_table = NULL;
+    memcpy(fleet->initial_repartition, chrom->initial_repartition, ITEM_END * sizeof(unsigned int));
+    memcpy(fleet->current_repartition, chrom->current_repartition, ITEM_END * sizeof(unsigned int));
+    fleet->ship_initial_count = chrom->ship_initial_count;
+    fleet->metl_lost = chrom->metl_lost;
+    fleet->crst_lost = chrom->crst_lost;
+    fleet->deut_lost = chrom->deut_lost;
+    fleet->metl_recycled = chrom->metl_recycled;
+    fleet->crst_recycled = chrom->crst_recycled;
+    fleet->ship_metal = chrom->ship_metal;
+    fleet->ship_cristal = chrom->ship_cristal;
+    fleet->ship_deut = chrom->ship_deut;
+}
+
+/* Keep in an individual what the evaluation of its fleet left to display */
+static void os_fleet_ga_fold(const os_fleet_t *fleet, os_fleet_ga_chrom_t *chrom)
+{
+    memcpy(chrom->current_repartition, fleet->current_repartition, ITEM_END * sizeof(unsigned int));
+    chrom->metl_lost = fleet->metl_lost;
+    chrom->crst_lost = fleet->crst_lost;
+    chrom->deut_lost = fleet->deut_lost;
+    chrom->metl_recycled = fleet->metl_recycled;
+    chrom->crst_recycled = fleet->crst_recycled;
+    chrom->ship_metal = fleet->ship_metal;
+    chrom->ship_cristal = fleet->ship_cristal;
+    chrom->ship_deut = fleet->ship_deut;
+}
+
+/*
+ * The ennemy fleet is read by every thread, each one fights its own clone:
+ * nothing is allocated (nor copied) per evaluation.
+ */
+static void os_fleet_ga_worker(void *rec, apr_pool_t *pool, void **worker)
+{
+    const os_fleet_genetic_ctx_t *ctx = rec;
+    os_fleet_ga_worker_t *ga_worker;
+
+    ga_worker = apr_palloc(pool, sizeof(os_fleet_ga_worker_t));
+    memcpy(&(ga_worker->enemy), ctx->fleet, sizeof(os_fleet_t));
+    ga_worker->enemy.ships_hit_table = apr_palloc(pool, ctx->fleet->ship_initial_count * sizeof(struct os_battle_ship_t));
+    ga_worker->ships_hit_table = apr_palloc(pool, ctx->max_ship * sizeof(struct os_battle_ship_t));
+    (*worker) = ga_worker;
+}
+
+static void os_fleet_ga_display_fleet(const os_fleet_genetic_ctx_t *ctx, const os_fleet_t *fleet)
+{
+    const os_fleet_t *attacker, *defender;
+    unsigned int deut_consumed, free_capacity, flight_time;
+    long stealsum, metal_stolen, cristal_stolen, deut_stolen;	/* can be negative */
+    int is_first = 1, display_mip = 0;
+    enum Item_enum j;
+
+    if (ctx->mode & OS_MODE_PERL) {
+	defender = ctx->fleet;
+	attacker = fleet;
+
+	for (j = 0, free_capacity = 0; j < LM; j++)
+	    free_capacity += (attacker->current_repartition[j] * attacker->os_ship[j].capacity);
+
+	/* Deut consummed added to total lost */
+	deut_consumed = os_fleet_consumption(attacker, ctx->distance, &flight_time);
+	free_capacity -= deut_consumed;
+
+	metal_stolen = (long) ((defender->metal >> 1) - attacker->metl_lost);
+	cristal_stolen = (long) ((defender->cristal >> 1) - attacker->crst_lost);
+	deut_stolen = (long) ((defender->deut >> 1) - attacker->deut_lost);
+
+	stealsum = metal_stolen + cristal_stolen + deut_stolen;
+	/*
+	 * this < insure that stealsum is positive
+	 * Thus metal_stolen, cristal_stolen are always positives.
+	 */
+	if (free_capacity < stealsum) {
+	    float capacity_divider;
+
+	    capacity_divider = (float) free_capacity / (float) stealsum;
+	    metal_stolen = ((float) metal_stolen * capacity_divider);
+	    cristal_stolen = ((float) cristal_stolen * capacity_divider);
+	    deut_stolen = (long) ((float) deut_stolen * capacity_divider) - (long) deut_consumed;
+	}
+	else {
+	    deut_stolen -= deut_consumed;
+	}
+
+	fprintf(stdout, "\nmetal,cristal,deut(less_consumed),recyclable_metal,recyclable_cristal,flight_time,deut_consum,");
+	for (j = PT, is_first = 1; j < LM; j++) {
+	    fprintf(stdout, "%s%s", (1 == is_first) ? "" : ",", (fleet->os_ship)[j].shortname);
+	    is_first = 0;
+	}
+	fprintf(stdout, "\n%li,%li,%li,%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%u,%u,", metal_stolen, cristal_stolen,
+		deut_stolen, attacker->metl_recycled, attacker->crst_recycled, flight_time, deut_consumed);
+	for (j = PT, is_first = 1; j < LM; j++) {
+	    fprintf(stdout, "%s%u", (1 == is_first) ? "" : ",", fleet->initial_repartition[j]);
+	    is_first = 0;
+	}
+	fprintf(stdout, "\n\n");
     }
-    own->metl_lost = (0ULL == own->metl_lost) ? 1 : own->metl_lost;
-    own->crst_lost = (0ULL == own->crst_lost) ? 1 : own->crst_lost;
-    own->deut_lost = (0ULL == own->deut_lost) ? 1 : own->deut_lost;
+    else {
+	if (ctx->mode & OS_MODE_HTML)
+	    fprintf(stdout, "Flotte proposée:<br />");
+	for (j = PT; j < ITEM_END; j++) {
+	    if (0 != fleet->initial_repartition[j]) {
+		if ((ATK_FLT == fleet->type) && (j >= LM) && !display_mip) {
+		    fprintf(stdout, "%sMISSILE VS. ", (1 == is_first) ? "" : ", ");
+		    display_mip = 1;
+		    is_first = 1;
+		}
+		fprintf(stdout, "%s%s:%u", (1 == is_first) ? "" : ", ", (fleet->os_ship)[j].shortname,
+			fleet->initial_repartition[j]);
+		is_first = 0;
+	    }
+	}
 
-    return 1;
-}
+	if (ctx->mode & OS_MODE_HTML)
+	    fprintf(stdout, "<br />");
 
-#define FITNESS_NB_SIM 32LLU
+	if (!(ctx->mode & OS_MODE_NO_INVEST)) {
+	    fprintf(stdout, "\n");
+	    fprintf(stdout, "\tMetal Invested:%" APR_UINT64_T_FMT, fleet->ship_metal);
+	    fprintf(stdout, ", Cristal Invested:%" APR_UINT64_T_FMT, fleet->ship_cristal);
+	    fprintf(stdout, ", Deut Invested:%" APR_UINT64_T_FMT, fleet->ship_deut);
+	}
+	fprintf(stdout, "\n");
+	if (ctx->mode & OS_MODE_HTML)
+	    fprintf(stdout, "<br /><br />");
+    }
+
+    fflush(stdout);
+}
 
-static float os_fleet_ga_fitness(void *rec, void *chromosome)
+static void os_fleet_ga_display(void *rec, const void *chromosome)
 {
-    os_fleet_genetic_ctx_t *ctx = rec;
-    os_fleet_t *attacker, *defender, *own, *adversary;
-    unsigned int deut_consumed = 0, free_capacity, flight_time;
-    apr_uint64_t metal_stolen = 0, cristal_stolen = 0, divider, div_acc = 0, stealsum, wave_time_divider =
-	1, metl_lost, crst_lost, deut_lost;
-    apr_uint64_t current_repartition_avg[ITEM_END];
-    apr_int64_t deut_stolen = 0, numerator, num_acc = 0;	/* can be negatives */
-    os_fleet_t ctx_fleet;
-    float ratio;
-    int j, k;
+    os_fleet_t fleet;
 
-    /* 
-     * XXX : this ctx->fleet passed like this may be the multithread violation
-     * As a workaround, we will temporarly copy new values.
-     */
-    memcpy(&ctx_fleet, ctx->fleet, sizeof(os_fleet_t));
-    memset(current_repartition_avg, 0, ITEM_END * sizeof(apr_uint64_t));
+    os_fleet_ga_expand(rec, chromosome, &fleet);
+    os_fleet_ga_display_fleet(rec, &fleet);
+}
 
-    /* The ships_hit_table is a pointer, so the memcpy does not alloc a new one */
-    ctx_fleet.ships_hit_table = malloc(ctx_fleet.ship_initial_count * sizeof(struct os_battle_ship_t));
+/* Compute own losses from its surviving ships */
+static inline void os_fleet_compute_losses(os_fleet_t *own, const unsigned int *survivors)
+{
+    unsigned char j;
 
-    if (ctx->fleet->type == ATK_FLT) {
-	adversary = attacker = &ctx_fleet;
-	own = defender = chromosome;
+    own->metl_lost = 0ULL;
+    own->crst_lost = 0ULL;
+    own->deut_lost = 0ULL;
+    for (j = '\0'; j < ITEM_END; j++) {
+	own->metl_lost +=
+	    (apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
+			    (apr_uint64_t) survivors[j]) * (apr_uint64_t) own->os_ship[j].metl_price;
+	own->crst_lost +=
+	    (apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
+			    (apr_uint64_t) survivors[j]) * (apr_uint64_t) own->os_ship[j].crst_price;
+	own->deut_lost +=
+	    (apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
+			    (apr_uint64_t) survivors[j]) * (apr_uint64_t) own->os_ship[j].deut_price;
     }
-    else {
-	adversary = defender = &ctx_fleet;
-	own = attacker = chromosome;
+    own->metl_lost = (0ULL == own->metl_lost) ? 1 : own->metl_lost;
+    own->crst_lost = (0ULL == own->crst_lost) ? 1 : own->crst_lost;
+    own->deut_lost = (0ULL == own->deut_lost) ? 1 : own->deut_lost;
+}
+
+/*
+ * Flight time and investment part of the fitness, no battle is needed.
+ * Return 0 if own can't be accepted whatever the outcome of the battles.
+ */
+static inline int os_fleet_ga_invest(const os_fleet_genetic_ctx_t *ctx, os_fleet_t *own, unsigned int *deut_consumed,
+				     apr_uint64_t *wave_time_divider)
+{
+    unsigned int flight_time;
+    int j;
 
+    *deut_consumed = 0;
+    *wave_time_divider = 1;
+    if (ctx->fleet->type != ATK_FLT) {
 	/* Deut consummed added to total lost */
-	deut_consumed = os_fleet_consumption(attacker, ctx->distance, &flight_time);
-	if ((0UL != ctx->max_flight_time) && (flight_time > ctx->max_flight_time)) {
-	    free(ctx_fleet.ships_hit_table);
-	    return -FLT_MAX;
-	}
+	*deut_consumed = os_fleet_consumption(own, ctx->distance, &flight_time);
+	if ((0UL != ctx->max_flight_time) && (flight_time > ctx->max_flight_time))
+	    return 0;
 	if ((0UL != ctx->wave_time) && (flight_time > ctx->wave_time)) {
-	    for (wave_time_divider = 1; (ctx->wave_time * wave_time_divider) < flight_time; wave_time_divider++);
+	    for (*wave_time_divider = 1; (ctx->wave_time * *wave_time_divider) < flight_time; (*wave_time_divider)++);
 	}
-
     }
 
-    own->metl_recycled = 0;
-    own->crst_recycled = 0;
-    metl_lost = crst_lost = deut_lost = 0;
-
     for (j = 0, own->ship_metal = 1, own->ship_cristal = 1, own->ship_deut = 1; j < ITEM_END; j++) {
 	if (own->initial_repartition[j] > ctx->initial_repartition[j]) {
 	    /* No investment mode */
-	    if (ctx->mode & OS_MODE_NO_INVEST) {
-		free(ctx_fleet.ships_hit_table);
-		return -FLT_MAX;
-	    }
+	    if (ctx->mode & OS_MODE_NO_INVEST)
+		return 0;
 
 	    own->ship_metal +=
 		(apr_uint64_t) ((apr_uint64_t) own->initial_repartition[j] -
@@ -1093,44 +1449,73 @@ static float os_fleet_ga_fitness(void *rec, void *chromosome)
 	}
     }
 
-    for (k = 0; k < FITNESS_NB_SIM; k++) {
-	os_fleet_onebattle(attacker, defender, ctx->conf);
+    return 1;
+}
 
-	if (0 == os_fleet_compute_fitness_stats(adversary, own)) {
-	    free(ctx_fleet.ships_hit_table);
-	    return -FLT_MAX;
-	}
+/*
+ * Economic evaluation of won battles: own_survivors holds nb_sample rows of
+ * ITEM_END surviving ships of own. No battle is run here, thus the same
+ * outcomes can be scored under several modes or defender resources.
+ * The score is numerator_sum / divider_sum, sums of several calls can be
+ * added. If ratio_sums is not NULL, it receives the sum and the sum of
+ * squares of the scores of each sample, to know how much they spread.
+ * Return 0 if own is rejected.
+ */
+static int os_fleet_ga_score_sums(const os_fleet_genetic_ctx_t *ctx, os_fleet_t *own, const unsigned int *own_survivors,
+				  unsigned int nb_sample, apr_int64_t *numerator_sum, apr_uint64_t *divider_sum,
+				  double *ratio_sums)
+{
+    const os_fleet_t *defender = ctx->fleet;
+    const unsigned int *survivors;
+    unsigned int deut_consumed, free_capacity, k;
+    apr_uint64_t metal_stolen = 0, cristal_stolen = 0, divider, div_acc = 0, stealsum, wave_time_divider,
+	metl_lost, crst_lost, deut_lost;
+    apr_uint64_t current_repartition_avg[ITEM_END];
+    apr_int64_t deut_stolen = 0, numerator, num_acc = 0;	/* can be negatives */
+    double ratio, ratio_acc = 0.0, ratio_sq_acc = 0.0;
+    int j;
+
+    if ((0 == nb_sample) || !os_fleet_ga_invest(ctx, own, &deut_consumed, &wave_time_divider))
+	return 0;
+
+    memset(current_repartition_avg, 0, ITEM_END * sizeof(apr_uint64_t));
+    own->metl_recycled = 0;
+    own->crst_recycled = 0;
+    metl_lost = crst_lost = deut_lost = 0;
 
-	if (own == defender) {
+    for (k = 0; k < nb_sample; k++) {
+	survivors = own_survivors + k * ITEM_END;
+	os_fleet_compute_losses(own, survivors);
+	for (j = PT; j < ITEM_END; j++)
+	    current_repartition_avg[j] += survivors[j];
+
+	if (ctx->fleet->type == ATK_FLT) {
 	    numerator =
-		META_RATIO * (ctx->metl_recycled - defender->metl_lost) + CRST_RATIO * (ctx->crst_recycled -
-											defender->crst_lost) -
-		DEUT_RATIO * (defender->deut_lost);
+		META_RATIO * (ctx->metl_recycled - own->metl_lost) + CRST_RATIO * (ctx->crst_recycled -
+										   own->crst_lost) -
+		DEUT_RATIO * (own->deut_lost);
 	}
 	else {
-	    if ((ctx->mode & OS_MODE_NO_LOSS)
-		&& (1 != (attacker->metl_lost * attacker->crst_lost * attacker->deut_lost))) {
+	    if ((ctx->mode & OS_MODE_NO_LOSS) && (1 != (own->metl_lost * own->crst_lost * own->deut_lost))) {
 		/* Don't tolerate a loss */
-		free(ctx_fleet.ships_hit_table);
-		return -FLT_MAX;
+		return 0;
 	    }
 	    else {
-		metl_lost += attacker->metl_lost;
-		crst_lost += attacker->crst_lost;
-		deut_lost += attacker->deut_lost;
+		metl_lost += own->metl_lost;
+		crst_lost += own->crst_lost;
+		deut_lost += own->deut_lost;
 
 		/* include our fleet in the recycling */
 		if (!(ctx->mode & OS_MODE_NO_RECYCLING)) {
-		    attacker->metl_recycled += ctx->metl_recycled + attacker->metl_lost * 0.30f;
-		    attacker->crst_recycled += ctx->crst_recycled + attacker->crst_lost * 0.30f;
-		    attacker->metl_lost *= 0.70f;
-		    attacker->crst_lost *= 0.70f;
+		    own->metl_recycled += ctx->metl_recycled + own->metl_lost * 0.30f;
+		    own->crst_recycled += ctx->crst_recycled + own->crst_lost * 0.30f;
+		    own->metl_lost *= 0.70f;
+		    own->crst_lost *= 0.70f;
 		}
 	    }
 
-	    /* XXX refactor this, if we are in no-loss mode no need to recalculate */
 	    for (j = 0, free_capacity = 0; j < LM; j++)
-		free_capacity += (attacker->current_repartition[j] * attacker->os_ship[j].capacity);
+		free_capacity += (survivors[j] * own->os_ship[j].capacity);
 
 	    if (free_capacity >= deut_consumed) {
 		free_capacity -= deut_consumed;
@@ -1152,74 +1537,563 @@ static float os_fleet_ga_fitness(void *rec, void *chromosome)
 		    deut_stolen -= deut_consumed;
 		}
 
-	    }
-	    else if (ctx->mode & OS_MODE_NO_RECYCLING) {
-		/* Fleet can take nothing. Thus, if no recycling, just give up */
-		free(ctx_fleet.ships_hit_table);
-		return -FLT_MAX;
-	    }
-	    else {
-		metal_stolen = 0;
-		cristal_stolen = 0;
-		deut_stolen = 0;
-	    }
-	    if (!(ctx->mode & OS_MODE_NO_RECYCLING)) {
-		metal_stolen += ctx->metl_recycled;
-		cristal_stolen += ctx->crst_recycled;
-	    }
+	    }
+	    else if (ctx->mode & OS_MODE_NO_RECYCLING) {
+		/* Fleet can take nothing. Thus, if no recycling, just give up */
+		return 0;
+	    }
+	    else {
+		metal_stolen = 0;
+		cristal_stolen = 0;
+		deut_stolen = 0;
+	    }
+	    if (!(ctx->mode & OS_MODE_NO_RECYCLING)) {
+		metal_stolen += ctx->metl_recycled;
+		cristal_stolen += ctx->crst_recycled;
+	    }
+
+	    /* if we are here with acceptable loss else ... it is important for the following (1) */
+	    numerator =
+		META_RATIO * (metal_stolen - own->metl_lost) +
+		CRST_RATIO * (cristal_stolen - own->crst_lost) + DEUT_RATIO * (deut_stolen - own->deut_lost);
+
+	    /*
+	     * (1) if loss acceptable + perl output i'm pretty sure I was
+	     * invoked by a script that don't want to lose many ships.
+	     */
+	    if ((ctx->mode & OS_MODE_PERL) && (numerator < 0))
+		return 0;
+	}
+
+	if ((ctx->fleet->type == ATK_FLT) || ((numerator > 0.0f) && !(ctx->mode & OS_MODE_NO_INVEST))) {
+	    /* No need do divide if numerator is negative */
+	    divider = META_RATIO * own->ship_metal + CRST_RATIO * own->ship_cristal + DEUT_RATIO * own->ship_deut;
+	}
+	else {
+	    divider = 1LLU;
+	}
+	divider *= wave_time_divider;
+	num_acc += numerator;
+	div_acc += divider;
+	ratio = (double) numerator / (double) divider;
+	ratio_acc += ratio;
+	ratio_sq_acc += ratio * ratio;
+    }
+
+    own->metl_recycled /= nb_sample;
+    own->crst_recycled /= nb_sample;
+
+    own->metl_lost = metl_lost / nb_sample;
+    own->crst_lost = crst_lost / nb_sample;
+    own->deut_lost = deut_lost / nb_sample;
+
+    if (!(ctx->mode & OS_MODE_NO_LOSS)) {
+	for (j = PT; j < ITEM_END; j++) {
+	    own->current_repartition[j] = current_repartition_avg[j] / nb_sample;
+	}
+    }
+
+    *numerator_sum = num_acc;
+    *divider_sum = div_acc;
+    if (NULL != ratio_sums) {
+	ratio_sums[0] = ratio_acc;
+	ratio_sums[1] = ratio_sq_acc;
+    }
+
+    return 1;
+}
+
+static float os_fleet_ga_score(const os_fleet_genetic_ctx_t *ctx, os_fleet_t *own, const unsigned int *own_survivors,
+			       unsigned int nb_sample)
+{
+    apr_int64_t num_acc;
+    apr_uint64_t div_acc;
+
+    if (!os_fleet_ga_score_sums(ctx, own, own_survivors, nb_sample, &num_acc, &div_acc, NULL))
+	return -FLT_MAX;
+    /*DEBUG_DBG("Returning %.2f = %"APR_INT64_T_FMT" / %"APR_UINT64_T_FMT" pt:%lu\n", (float) num_acc / (float) div_acc, num_acc, div_acc, (apr_uint64_t) own->initial_repartition[PT]); */
+
+    return ((float) num_acc / (float) div_acc);
+}
+
+
+#define FITNESS_NB_SIM 32LLU
+/* Past this number of simulations, a memoised score is returned without fighting */
+#define FITNESS_MAX_SAMPLES (4 * FITNESS_NB_SIM)
+#define FITNESS_CACHE_ENTRIES 16384UL
+/* Battles fought before the first sequential test of os_fleet_ga_fight, the next ones are at each doubling */
+#define FITNESS_FIRST_CHECK 4U
+
+/*
+ * Memoised evaluation of an individual, keyed by its initial_repartition.
+ * The sums of each new batch of simulations are added, thus the score of an
+ * individual is refined instead of being drawn again. The averages shown by
+ * os_fleet_ga_display are kept to restore them on a hit. The evaluations
+ * defer their memos, the genetic algorithm commits them between two batches
+ * of evaluations (see os_fleet_ga_sync): each one reads what the previous
+ * batches memoised, whatever the order of the threads.
+ */
+typedef struct os_fleet_ga_memo_t
+{
+    apr_int64_t numerator_sum;
+    apr_uint64_t divider_sum;
+    apr_uint64_t metl_lost;
+    apr_uint64_t crst_lost;
+    apr_uint64_t deut_lost;
+    apr_uint64_t metl_recycled;
+    apr_uint64_t crst_recycled;
+    double ratio_sum;		/* scores of each sample, for the confidence interval */
+    double ratio_sq_sum;
+    unsigned int current_repartition[ITEM_END];
+    unsigned int nb_sample;
+    unsigned int rejected;	/* once rejected, always rejected */
+} os_fleet_ga_memo_t;
+
+#define MEMO_AVERAGE(stored, value, field) \
+    (value)->field = ((stored)->field * (stored)->nb_sample + (value)->field * (value)->nb_sample) \
+    / ((stored)->nb_sample + (value)->nb_sample)
+
+static void os_fleet_ga_memo_merge(void *stored_memo, void *value_memo)
+{
+    const os_fleet_ga_memo_t *stored = stored_memo;
+    os_fleet_ga_memo_t *value = value_memo;
+    int j;
+
+    if (stored->rejected || value->rejected) {
+	value->rejected = 1;
+	return;
+    }
+    MEMO_AVERAGE(stored, value, metl_lost);
+    MEMO_AVERAGE(stored, value, crst_lost);
+    MEMO_AVERAGE(stored, value, deut_lost);
+    MEMO_AVERAGE(stored, value, metl_recycled);
+    MEMO_AVERAGE(stored, value, crst_recycled);
+    for (j = PT; j < ITEM_END; j++)
+	MEMO_AVERAGE(stored, value, current_repartition[j]);
+    value->numerator_sum += stored->numerator_sum;
+    value->divider_sum += stored->divider_sum;
+    value->ratio_sum += stored->ratio_sum;
+    value->ratio_sq_sum += stored->ratio_sq_sum;
+    value->nb_sample += stored->nb_sample;
+}
+
+/*
+ * Merge of the deferred memos: each one holds all the simulations of its
+ * repartition, those deferred between two commits went on from the same
+ * memo with the same random numbers, the one with more samples holds the
+ * others.
+ */
+static void os_fleet_ga_memo_keep(void *stored_memo, void *value_memo)
+{
+    const os_fleet_ga_memo_t *stored = stored_memo;
+    os_fleet_ga_memo_t *value = value_memo;
+
+    if (stored->rejected || value->rejected) {
+	memset(value, 0, sizeof(os_fleet_ga_memo_t));
+	value->rejected = 1;
+    }
+    else if (stored->nb_sample > value->nb_sample) {
+	memcpy(value, stored, sizeof(os_fleet_ga_memo_t));
+    }
+}
+
+static void os_fleet_ga_sync(void *rec)
+{
+    os_fleet_genetic_ctx_t *ctx = rec;
+
+    if (NULL != ctx->cache)
+	napr_cache_commit(ctx->cache, os_fleet_ga_memo_keep);
+}
+
+/* Half-width of the 95% confidence interval of the score of a memo */
+static float os_fleet_ga_memo_error(const os_fleet_ga_memo_t *memo)
+{
+    double mean, variance;
+
+    if (memo->rejected)
+	return 0.0f;
+    if (memo->nb_sample < 2)
+	return FLT_MAX;
+
+    mean = memo->ratio_sum / memo->nb_sample;
+    variance = (memo->ratio_sq_sum - mean * memo->ratio_sum) / (memo->nb_sample - 1);
+    if (variance < 0.0)
+	variance = 0.0;
+
+    return (float) (1.96 * sqrt(variance / memo->nb_sample));
+}
+
+static float os_fleet_ga_memo_restore(const os_fleet_ga_memo_t *memo, os_fleet_t *own)
+{
+    if (memo->rejected)
+	return -FLT_MAX;
+
+    own->metl_lost = memo->metl_lost;
+    own->crst_lost = memo->crst_lost;
+    own->deut_lost = memo->deut_lost;
+    own->metl_recycled = memo->metl_recycled;
+    own->crst_recycled = memo->crst_recycled;
+    memcpy(own->current_repartition, memo->current_repartition, ITEM_END * sizeof(unsigned int));
+
+    return ((float) memo->numerator_sum / (float) memo->divider_sum);
+}
+
+/*
+ * Add the evaluation of a new batch of simulations to memo, defer it to the
+ * cache, return the refined score, and its confidence interval in error if
+ * not NULL.
+ */
+static float os_fleet_ga_memo_update(const os_fleet_genetic_ctx_t *ctx, os_fleet_t *own, os_fleet_ga_memo_t *memo,
+				     int accepted, apr_int64_t numerator_sum, apr_uint64_t divider_sum,
+				     const double *ratio_sums, unsigned int nb_sample, float *error)
+{
+    os_fleet_ga_memo_t batch;
+
+    memset(&batch, 0, sizeof(os_fleet_ga_memo_t));
+    if (accepted) {
+	batch.numerator_sum = numerator_sum;
+	batch.divider_sum = divider_sum;
+	batch.ratio_sum = ratio_sums[0];
+	batch.ratio_sq_sum = ratio_sums[1];
+	batch.metl_lost = own->metl_lost;
+	batch.crst_lost = own->crst_lost;
+	batch.deut_lost = own->deut_lost;
+	batch.metl_recycled = own->metl_recycled;
+	batch.crst_recycled = own->crst_recycled;
+	memcpy(batch.current_repartition, own->current_repartition, ITEM_END * sizeof(unsigned int));
+	batch.nb_sample = nb_sample;
+    }
+    else {
+	batch.rejected = 1;
+    }
+    os_fleet_ga_memo_merge(memo, &batch);
+    memcpy(memo, &batch, sizeof(os_fleet_ga_memo_t));
+    /* Without cache, the memo only lasts for the evaluation; one that can't be deferred is fought again */
+    if (NULL != ctx->cache)
+	napr_cache_defer(ctx->cache, own->initial_repartition, memo);
+    if (NULL != error)
+	*error = os_fleet_ga_memo_error(memo);
+
+    return os_fleet_ga_memo_restore(memo, own);
+}
+
+/* Upper bound of the confidence interval of the score of a batch, added to the previous simulations */
+static float os_fleet_ga_upper_bound(const os_fleet_ga_memo_t *previous, apr_int64_t numerator_sum,
+				     apr_uint64_t divider_sum, const double *ratio_sums, unsigned int nb_sample)
+{
+    os_fleet_ga_memo_t memo;
+
+    memset(&memo, 0, sizeof(os_fleet_ga_memo_t));
+    memo.numerator_sum = numerator_sum;
+    memo.divider_sum = divider_sum;
+    memo.ratio_sum = ratio_sums[0];
+    memo.ratio_sq_sum = ratio_sums[1];
+    memo.nb_sample = nb_sample;
+    memo.numerator_sum += previous->numerator_sum;
+    memo.divider_sum += previous->divider_sum;
+    memo.ratio_sum += previous->ratio_sum;
+    memo.ratio_sq_sum += previous->ratio_sq_sum;
+    memo.nb_sample += previous->nb_sample;
+
+    return ((float) memo.numerator_sum / (float) memo.divider_sum) + os_fleet_ga_memo_error(&memo);
+}
+
+/*
+ * Fight nb_sim (at most FITNESS_NB_SIM) battles of chromosome, the batch is
+ * added to memo, the simulations already memoised for the same repartition
+ * (zeroed if none). The random numbers of the batch are drawn from a stream
+ * derived from the seed, the repartition and the battles already fought for
+ * it: an evaluation fights the same battles whichever thread runs it.
+ * Sequential test: at FITNESS_FIRST_CHECK battles and at each
+ * doubling, the batch is cut short if the upper bound of the score can't
+ * reach threshold anymore.
+ * Return the refined score, and its confidence interval in error if not NULL,
+ * -FLT_MAX once the genetic algorithm is over.
+ */
+static float os_fleet_ga_fight(os_fleet_genetic_ctx_t *ctx, os_fleet_ga_worker_t *worker, os_fleet_t *own,
+			       unsigned int nb_sim, os_fleet_ga_memo_t *memo, float threshold, float *error)
+{
+    os_fleet_t *attacker, *defender, *adversary;
+    unsigned int survivors[FITNESS_NB_SIM * ITEM_END];
+    apr_int64_t numerator_sum;
+    apr_uint64_t divider_sum, hash;
+    double ratio_sums[2];
+    unsigned int k, checkpoint;
+    int accepted;
+
+    own->ships_hit_table = worker->ships_hit_table;
+    if (ctx->fleet->type == ATK_FLT) {
+	adversary = attacker = &(worker->enemy);
+	defender = own;
+    }
+    else {
+	adversary = defender = &(worker->enemy);
+	attacker = own;
+    }
+
+    hash = os_fleet_hash(14695981039346656037ULL ^ ctx->seed, own->initial_repartition, ITEM_END * sizeof(unsigned int));
+    my_srand(&(worker->rnd), os_fleet_mix((unsigned int) (hash ^ (hash >> 32)), memo->nb_sample));
+    checkpoint = (-FLT_MAX == threshold) ? nb_sim : FITNESS_FIRST_CHECK;
+    for (k = 0; k < nb_sim; k++) {
+	/*
+	 * A big fleet fights long battles, a batch cut by the end of the run is
+	 * not memoised; the flag also stops the evaluations of napr_galife_init.
+	 */
+	if (os_fleet_guess_cancelled || ((NULL != ctx->ga) && napr_galife_is_over(ctx->ga))) {
+	    if (NULL != error)
+		*error = 0.0f;
+	    return -FLT_MAX;
+	}
+	os_fleet_onebattle(attacker, defender, ctx->conf, &(worker->rnd));
+
+	/* Must not lose, ennemy must lose */
+	if ((0 == own->ship_count) || (0 != adversary->ship_count)) {
+	    return os_fleet_ga_memo_update(ctx, own, memo, 0, 0, 0, NULL, 0, error);
+	}
+	memcpy(survivors + k * ITEM_END, own->current_repartition, ITEM_END * sizeof(unsigned int));
+
+	/* Same test as in os_fleet_ga_score, but without waiting for the other battles */
+	if ((own == attacker) && (ctx->mode & OS_MODE_NO_LOSS)) {
+	    os_fleet_compute_losses(own, own->current_repartition);
+	    if (1 != (own->metl_lost * own->crst_lost * own->deut_lost)) {
+		return os_fleet_ga_memo_update(ctx, own, memo, 0, 0, 0, NULL, 0, error);
+	    }
+	}
+
+	if ((k + 1 == checkpoint) && (k + 1 < nb_sim)) {
+	    checkpoint <<= 1;
+	    accepted = os_fleet_ga_score_sums(ctx, own, survivors, k + 1, &numerator_sum, &divider_sum, ratio_sums);
+	    if (!accepted
+		|| (os_fleet_ga_upper_bound(memo, numerator_sum, divider_sum, ratio_sums, k + 1) < threshold)) {
+		return os_fleet_ga_memo_update(ctx, own, memo, accepted, numerator_sum, divider_sum, ratio_sums, k + 1,
+					       error);
+	    }
+	}
+    }
+    accepted = os_fleet_ga_score_sums(ctx, own, survivors, nb_sim, &numerator_sum, &divider_sum, ratio_sums);
+
+    return os_fleet_ga_memo_update(ctx, own, memo, accepted, numerator_sum, divider_sum, ratio_sums, nb_sim, error);
+}
+
+static float os_fleet_ga_fitness(void *rec, void *worker, void *chromosome)
+{
+    os_fleet_genetic_ctx_t *ctx = rec;
+    unsigned int deut_consumed;
+    apr_uint64_t wave_time_divider;
+    os_fleet_ga_memo_t memo;
+    os_fleet_t own;
+    float score;
+
+    memset(&memo, 0, sizeof(os_fleet_ga_memo_t));
+    os_fleet_ga_expand(ctx, chromosome, &own);
+    /* Reject without fighting what the economic evaluation would reject anyway */
+    if (!os_fleet_ga_invest(ctx, &own, &deut_consumed, &wave_time_divider))
+	score = -FLT_MAX;
+    else if ((NULL != ctx->cache) && napr_cache_get(ctx->cache, own.initial_repartition, &memo)
+	     && (memo.rejected || (memo.nb_sample >= FITNESS_MAX_SAMPLES)))
+	score = os_fleet_ga_memo_restore(&memo, &own);
+    else
+	score = os_fleet_ga_fight(ctx, worker, &own, FITNESS_NB_SIM, &memo, -FLT_MAX, NULL);
+    os_fleet_ga_fold(&own, chromosome);
+
+    return score;
+}
+
+/*
+ * Fight only the battles missing for the score of chromosome to be based on
+ * nb_sample simulations (or FITNESS_MAX_SAMPLES), a child already dropped by
+ * a previous race is thus not fought again at the same rung.
+ */
+static float os_fleet_ga_race(void *rec, void *worker, void *chromosome, unsigned int nb_sample, float threshold,
+			      float *error)
+{
+    os_fleet_genetic_ctx_t *ctx = rec;
+    unsigned int deut_consumed, nb_sim;
+    apr_uint64_t wave_time_divider;
+    os_fleet_ga_memo_t memo;
+    os_fleet_t own;
+    float score = -FLT_MAX;
+
+    *error = 0.0f;
+    os_fleet_ga_expand(ctx, chromosome, &own);
+    if (!os_fleet_ga_invest(ctx, &own, &deut_consumed, &wave_time_divider)) {
+	os_fleet_ga_fold(&own, chromosome);
+	return -FLT_MAX;
+    }
+
+    nb_sample = MIN(nb_sample, FITNESS_MAX_SAMPLES);
+    memset(&memo, 0, sizeof(os_fleet_ga_memo_t));
+    if ((NULL != ctx->cache) && napr_cache_get(ctx->cache, own.initial_repartition, &memo)
+	&& (memo.rejected || (memo.nb_sample >= nb_sample))) {
+	*error = os_fleet_ga_memo_error(&memo);
+	score = os_fleet_ga_memo_restore(&memo, &own);
+    }
+    else {
+	/* Each batch goes on from the previous ones, the cache only sees them at the next sync */
+	do {
+	    nb_sim = MIN(nb_sample - memo.nb_sample, FITNESS_NB_SIM);
+	    score = os_fleet_ga_fight(ctx, worker, &own, nb_sim, &memo, threshold, error);
+	} while ((memo.nb_sample < nb_sample) && (-FLT_MAX != score) && (score + *error >= threshold));
+    }
+    os_fleet_ga_fold(&own, chromosome);
+
+    return score;
+}
+
+/*
+ * One round of an expected-value battle: the shots of each type (rapid fire
+ * included) are spread over the enemy types in proportion of their counts,
+ * shields absorb their share and the remaining damage destroys whole hulls.
+ */
+static void os_fleet_expected_fire(const os_fleet_t *shooter, const float *shooter_count, const os_fleet_t *target,
+				   const float *target_count, float *loss)
+{
+    float damage[ITEM_END], total = 0.0f, attack, chain, shots, hull_damage;
+    unsigned short int rf;
+    enum Item_enum i, j;
+
+    for (j = PT; j < ITEM_END; j++) {
+	total += target_count[j];
+	damage[j] = 0.0f;
+    }
+    if (total <= 0.0f)
+	return;
+
+    for (i = PT; i < ITEM_END; i++) {
+	if (shooter_count[i] <= 0.0f)
+	    continue;
+	attack = floorf(shooter->os_ship[i].attack_value * 10.0f) * 0.1f;
+	/* Probability to shoot again after a shot, a bounced shot ends the chain */
+	for (chain = 0.0f, j = PT; j < ITEM_END; j++) {
+	    rf = rapid_fire_const[j + i * (GB + 1)];
+	    if ((target_count[j] > 0.0f) && (0 != rf) && (1.0f <= (attack * target->os_ship[j].shield_points_percent)))
+		chain += (target_count[j] / total) * (1.0f - rf / 10000.0f);
+	}
+	shots = shooter_count[i] / (1.0f - chain);
+	for (j = PT; j < ITEM_END; j++) {
+	    if ((target_count[j] > 0.0f) && (1.0f <= (attack * target->os_ship[j].shield_points_percent)))
+		damage[j] += shots * (target_count[j] / total) * attack;
+	}
+    }
+
+    for (j = PT; j < ITEM_END; j++) {
+	hull_damage = damage[j] - target_count[j] * target->os_ship[j].shield_points;
+	if (hull_damage > 0.0f)
+	    loss[j] += MIN(target_count[j], hull_damage / target->os_ship[j].structure_points);
+    }
+}
 
-	    /* if we are here with acceptable loss else ... it is important for the following (1) */
-	    numerator =
-		META_RATIO * (metal_stolen - attacker->metl_lost) +
-		CRST_RATIO * (cristal_stolen - attacker->crst_lost) + DEUT_RATIO * (deut_stolen - attacker->deut_lost);
+/*
+ * Deterministic counterpart of os_fleet_onebattle, fractional counts of each
+ * type are kept between rounds.
+ */
+static void os_fleet_expected_battle(const os_fleet_t *attacker, const os_fleet_t *defender, float *atk_count,
+				    float *def_count)
+{
+    float atk_loss[ITEM_END], def_loss[ITEM_END], atk_total, def_total, damage;
+    unsigned int mit, nb_dest;
+    unsigned char round;
+    enum Item_enum i;
 
-	    /*DEBUG_DBG("numerator: %"APR_INT64_T_FMT", %"APR_UINT64_T_FMT" + %"APR_UINT64_T_FMT" + %lu", numerator, metal_stolen - attacker->metl_lost, cristal_stolen - attacker->crst_lost, 2 * deut_stolen - attacker->deut_lost); */
-	    /*
-	     * (1) if loss acceptable + perl output i'm pretty sure I was
-	     * invoked by a script that don't want to lose many ships.
-	     */
-	    if ((ctx->mode & OS_MODE_PERL) && (numerator < 0)) {
-		free(ctx_fleet.ships_hit_table);
-		return -FLT_MAX;
-	    }
+    for (i = PT; i < ITEM_END; i++) {
+	atk_count[i] = (i < attacker->limit) ? attacker->initial_repartition[i] : 0.0f;
+	def_count[i] = (i < defender->limit) ? defender->initial_repartition[i] : 0.0f;
+    }
+
+    /* Missiles are deterministic, same computation as os_fleet_launch_missile */
+    mit = defender->mit;
+    for (i = LM; i <= GB; i++) {
+	if (attacker->initial_repartition[i] > mit) {
+	    damage = (attacker->initial_repartition[i] - mit) * 12000.0f * (1.0f + attacker->attack / 10.0f);
+	    mit = 0UL;
+	    nb_dest = damage / defender->os_ship[i].structure_points;
+	    def_count[i] -= MIN(nb_dest, defender->initial_repartition[i]);
 	}
+    }
 
-	if ((own == defender) || ((numerator > 0.0f) && !(ctx->mode & OS_MODE_NO_INVEST))) {
-	    /* No need do divide if numerator is negative */
-	    divider = META_RATIO * own->ship_metal + CRST_RATIO * own->ship_cristal + DEUT_RATIO * own->ship_deut;
+    for (round = '\0'; round < MAX_ROUND_NUMBER; round++) {
+	for (atk_total = def_total = 0.0f, i = PT; i < ITEM_END; i++) {
+	    atk_total += atk_count[i];
+	    def_total += def_count[i];
 	}
-	else {
-	    divider = 1LLU;
+	if ((atk_total < 0.5f) || (def_total < 0.5f))
+	    break;
+
+	memset(atk_loss, 0, ITEM_END * sizeof(float));
+	memset(def_loss, 0, ITEM_END * sizeof(float));
+	os_fleet_expected_fire(attacker, atk_count, defender, def_count, def_loss);
+	os_fleet_expected_fire(defender, def_count, attacker, atk_count, atk_loss);
+	for (i = PT; i < ITEM_END; i++) {
+	    atk_count[i] -= atk_loss[i];
+	    def_count[i] -= def_loss[i];
 	}
-	divider *= wave_time_divider;
-	num_acc += numerator;
-	div_acc += divider;
     }
+}
 
-    own->metl_recycled /= FITNESS_NB_SIM;
-    own->crst_recycled /= FITNESS_NB_SIM;
+/*
+ * Predict the fitness without a single os_fleet_onebattle: the expected-value
+ * battle must be won and its survivors are scored as one sample.
+ */
+static float os_fleet_ga_estimate(void *rec, void *chromosome)
+{
+    os_fleet_genetic_ctx_t *ctx = rec;
+    os_fleet_t fleet, *own = &fleet;
+    float atk_count[ITEM_END], def_count[ITEM_END], *own_count, *adversary_count, own_total = 0.0f,
+	adversary_total = 0.0f;
+    unsigned int survivors[ITEM_END], deut_consumed;
+    apr_uint64_t wave_time_divider;
+    apr_int64_t numerator_sum;
+    apr_uint64_t divider_sum;
+    os_fleet_ga_memo_t memo;
+    int j;
 
-    own->metl_lost = metl_lost / FITNESS_NB_SIM;
-    own->crst_lost = crst_lost / FITNESS_NB_SIM;
-    own->deut_lost = deut_lost / FITNESS_NB_SIM;
+    /* The prediction is not kept in the individual */
+    os_fleet_ga_expand(ctx, chromosome, own);
+    if (!os_fleet_ga_invest(ctx, own, &deut_consumed, &wave_time_divider))
+	return -FLT_MAX;
+    /* A memoised score is a better prediction, and a cheaper one */
+    if ((NULL != ctx->cache) && napr_cache_get(ctx->cache, own->initial_repartition, &memo))
+	return memo.rejected ? -FLT_MAX : ((float) memo.numerator_sum / (float) memo.divider_sum);
 
-    if (!(ctx->mode & OS_MODE_NO_LOSS)) {
-	for (j = PT; j < ITEM_END; j++) {
-	    own->current_repartition[j] = current_repartition_avg[j] / FITNESS_NB_SIM;
-	}
+    if (ctx->fleet->type == ATK_FLT) {
+	os_fleet_expected_battle(ctx->fleet, own, atk_count, def_count);
+	own_count = def_count;
+	adversary_count = atk_count;
     }
+    else {
+	os_fleet_expected_battle(own, ctx->fleet, atk_count, def_count);
+	own_count = atk_count;
+	adversary_count = def_count;
+    }
+    /* Must not lose, ennemy must lose */
+    for (j = PT; j < ITEM_END; j++) {
+	own_total += own_count[j];
+	adversary_total += adversary_count[j];
+    }
+    if ((own_total < 0.5f) || (adversary_total >= 0.5f))
+	return -FLT_MAX;
+
+    for (j = PT; j < ITEM_END; j++)
+	survivors[j] = (own_count[j] > 0.0f) ? MIN(own->initial_repartition[j], (unsigned int) (own_count[j] + 0.5f)) : 0;
+    if ((ctx->fleet->type != ATK_FLT) && (ctx->mode & OS_MODE_NO_LOSS)) {
+	os_fleet_compute_losses(own, survivors);
+	if (1 != (own->metl_lost * own->crst_lost * own->deut_lost))
+	    return -FLT_MAX;
+    }
+    if (!os_fleet_ga_score_sums(ctx, own, survivors, 1, &numerator_sum, &divider_sum, NULL))
+	return -FLT_MAX;
 
-    divider *= FITNESS_NB_SIM;
-    ratio = ((float) num_acc / (float) div_acc);
-    /*DEBUG_DBG("Returning %.2f = %"APR_INT64_T_FMT" / %"APR_UINT64_T_FMT" pt:%lu\n", ratio, num_acc, div_acc, (apr_uint64_t) own->initial_repartition[PT]); */
-    free(ctx_fleet.ships_hit_table);
-
-    return ratio;
+    return ((float) numerator_sum / (float) divider_sum);
 }
 
 static void os_fleet_ga_allocat(void *rec, apr_pool_t *pool, void **chromosome)
 {
-    os_fleet_genetic_ctx_t *ctx = rec;
+    *chromosome = apr_pcalloc(pool, sizeof(os_fleet_ga_chrom_t));
+}
+
+/* Technologies of the guessed fleet, the individuals only hold its repartition */
+static os_fleet_t *os_fleet_ga_own_make(const os_fleet_genetic_ctx_t *ctx, apr_pool_t *pool)
+{
     os_fleet_t *fleet;
 
     if (ctx->fleet->type == ATK_FLT) {
@@ -1255,11 +2129,11 @@ static void os_fleet_ga_allocat(void *rec, apr_pool_t *pool, void **chromosome)
     /*} */
     os_fleet_parse(fleet, ctx->conf);
 
-    fleet->ships_hit_table = apr_palloc(pool, ctx->max_ship * sizeof(struct os_battle_ship_t));
-    *chromosome = fleet;
+    return fleet;
 }
 
-static inline void os_fleet_reduce_to_max(os_fleet_genetic_ctx_t *ctx, os_fleet_t *fleet, unsigned int max, float max_price)
+static inline void os_fleet_reduce_to_max(os_fleet_genetic_ctx_t *ctx, os_fleet_ga_chrom_t *fleet, unsigned int max,
+					  float max_price, unsigned int *seed)
 {
     unsigned int less;
     float divider_price, divider_nmb, divider;
@@ -1271,12 +2145,12 @@ static inline void os_fleet_reduce_to_max(os_fleet_genetic_ctx_t *ctx, os_fleet_
     fleet->ship_initial_count = 0;
 
     for (i = PT; i < PB; i++) {
-	divider_price = max_price / (fleet->os_ship[i].price * (float) fleet->initial_repartition[i]);	/* * (float) (LM - 6)); */
+	divider_price = max_price / (ctx->own->os_ship[i].price * (float) fleet->initial_repartition[i]);	/* * (float) (LM - 6)); */
 	divider = MIN(divider_price, divider_nmb);
 	if (divider < 1.0f) {
 	    fleet->initial_repartition[i] = (float) fleet->initial_repartition[i] * divider;
 	}
-	if ((ATK_FLT != fleet->type) || (i < LM)) {
+	if ((ATK_FLT != ctx->own->type) || (i < LM)) {
 	    fleet->ship_initial_count += fleet->initial_repartition[i];
 	}
 	else {
@@ -1288,7 +2162,7 @@ static inline void os_fleet_reduce_to_max(os_fleet_genetic_ctx_t *ctx, os_fleet_
 
     if (fleet->initial_repartition[PB] >= 1) {
 	fleet->initial_repartition[PB] = 1UL;
-	if (DEF_FLT == fleet->type) {
+	if (DEF_FLT == ctx->own->type) {
 	    fleet->ship_initial_count += 1;
 	}
 	else {
@@ -1297,7 +2171,7 @@ static inline void os_fleet_reduce_to_max(os_fleet_genetic_ctx_t *ctx, os_fleet_
     }
     if (fleet->initial_repartition[GB] >= 1) {
 	fleet->initial_repartition[GB] = 1UL;
-	if (DEF_FLT == fleet->type) {
+	if (DEF_FLT == ctx->own->type) {
 	    fleet->ship_initial_count += 1;
 	}
 	else {
@@ -1306,87 +2180,122 @@ static inline void os_fleet_reduce_to_max(os_fleet_genetic_ctx_t *ctx, os_fleet_
     }
 
     for (j = 0; fleet->ship_initial_count > max; j++) {
-	if (0 == fleet->initial_repartition[j % fleet->limit])
+	if (0 == fleet->initial_repartition[j % ctx->own->limit])
 	    continue;
-	less = my_rand(fleet->initial_repartition[j % fleet->limit]);
-	fleet->initial_repartition[j % fleet->limit] -= less;
+	less = os_fleet_ga_rand(seed, fleet->initial_repartition[j % ctx->own->limit]);
+	fleet->initial_repartition[j % ctx->own->limit] -= less;
 	fleet->ship_initial_count -= less;
     }
 }
 
-static void os_fleet_ga_randomz(void *rec, void *chromosome)
+/* A fleet of a previous guess, repaired against the constraints of this one: 0 if nothing is left of it */
+static int os_fleet_ga_repair(os_fleet_genetic_ctx_t *ctx, os_fleet_ga_chrom_t *fleet, const unsigned int *repartition,
+			      unsigned int *seed)
+{
+    enum Item_enum i;
+
+    fleet->ship_initial_count = 0;
+    for (i = PT; i < ITEM_END; i++) {
+	/* Forbidden types and no investment: only the ships of the fleet given by the user */
+	if ((item_bitmask[i] & ctx->buffer_fleet) || (ctx->mode & OS_MODE_NO_INVEST))
+	    fleet->initial_repartition[i] = MIN(repartition[i], ctx->initial_repartition[i]);
+	else
+	    fleet->initial_repartition[i] = repartition[i];
+
+	/* MIP don't count as ship */
+	if ((ATK_FLT != ctx->own->type) || (i < LM))
+	    fleet->ship_initial_count += fleet->initial_repartition[i];
+    }
+    if (0 == fleet->ship_initial_count) {
+	memset(fleet->initial_repartition, 0, ITEM_END * sizeof(unsigned int));
+	return 0;
+    }
+    os_fleet_reduce_to_max(ctx, fleet, ctx->max_ship, ctx->max_price, seed);
+
+    return 1;
+}
+
+/*
+ * The first nb_warm individuals are the fleets of a previous guess, the
+ * ITEM_END next ones are not random either: individual nb_warm + idx is
+ * the repartition given by the user, without its idx first ship types.
+ */
+static void os_fleet_ga_randomz(void *rec, void *chromosome, unsigned long idx, unsigned int *seed)
 {
     os_fleet_genetic_ctx_t *ctx = rec;
-    os_fleet_t *fleet = chromosome;
+    os_fleet_ga_chrom_t *fleet = chromosome;
     unsigned int max;
     enum Item_enum i;
 
-    if (ITEM_END > ctx->first_fleet_set) {
-	for (i = ctx->first_fleet_set; i < ITEM_END; i++) {
+    if (idx < ctx->nb_warm) {
+	if (os_fleet_ga_repair(ctx, fleet, ctx->warm + idx * ITEM_END, seed))
+	    return;
+	/* A random one replaces it */
+	idx = ITEM_END;
+    }
+    else {
+	idx -= ctx->nb_warm;
+    }
+
+    if (ITEM_END > idx) {
+	for (i = idx; i < ITEM_END; i++) {
 	    fleet->initial_repartition[i] = ctx->initial_repartition[i];
 	    /* MIP don't count as ship */
-	    if ((ATK_FLT != fleet->type) || (i < LM))
+	    if ((ATK_FLT != ctx->own->type) || (i < LM))
 		fleet->ship_initial_count += fleet->initial_repartition[i];
 	}
-	/*
-	 * XXX
-	 * an assignement of ctx in a chromosome function may break a
-	 * possibility of multithreading, but, we will begin by paralellizing
-	 * only fitness, so random is not an issue here
-	 */
-	ctx->first_fleet_set += 1;
     }
     else {
 	/* 1+ because it must not be 0 */
-	max = 1 + my_rand(ctx->max_ship);
+	max = 1 + os_fleet_ga_rand(seed, ctx->max_ship);
 	for (i = PT; i < ITEM_END; i++) {
 	    /* 2nd cond: We want to randomly try some fleet with no ship of one type */
-	    if ((item_bitmask[i] & ctx->buffer_fleet) || (my_randf() > 0.85f)) {
+	    if ((item_bitmask[i] & ctx->buffer_fleet) || (os_fleet_ga_randf(seed) > 0.85f)) {
 		fleet->initial_repartition[i] = 0UL;
 		continue;
 	    }
 	    /* If we are in no invest mode, only purpose sub fleet of ctx->initial_repartition */
 	    if (ctx->mode & OS_MODE_NO_INVEST) {
-		fleet->initial_repartition[i] = my_randf() * ctx->initial_repartition[i];
+		fleet->initial_repartition[i] = os_fleet_ga_randf(seed) * ctx->initial_repartition[i];
 	    }
 	    else {
-		fleet->initial_repartition[i] = my_rand(max);
+		fleet->initial_repartition[i] = os_fleet_ga_rand(seed, max);
 	    }
 
 	    /* MIP don't count as ship */
-	    if ((ATK_FLT != fleet->type) || (i < LM))
+	    if ((ATK_FLT != ctx->own->type) || (i < LM))
 		fleet->ship_initial_count += fleet->initial_repartition[i];
 	}
-	os_fleet_reduce_to_max(ctx, fleet, max, ctx->max_price);
+	os_fleet_reduce_to_max(ctx, fleet, max, ctx->max_price, seed);
     }
 }
 
-static void os_fleet_ga_crossvr(void *rec, float crossover_p, const void *father, void *mother)
+static void os_fleet_ga_crossvr(void *rec, float crossover_p, const void *father, void *mother, unsigned int *seed)
 {
-    const os_fleet_t *fleet1 = father;
-    os_fleet_t *fleet2 = mother;
+    const os_fleet_ga_chrom_t *fleet1 = father;
+    os_fleet_ga_chrom_t *fleet2 = mother;
     os_fleet_genetic_ctx_t *ctx = rec;
     enum Item_enum i;
 
     fleet2->ship_initial_count = 0;
     for (i = PT; i < ITEM_END; i++) {
-	if (crossover_p >= my_randf()) {
+	if (crossover_p >= os_fleet_ga_randf(seed)) {
 	    /* methods of crossover: take something between father value and mother value */
 	    float average;
 
-	    average = my_randf();
+	    average = os_fleet_ga_randf(seed);
 	    fleet2->initial_repartition[i] =
 		average * fleet2->initial_repartition[i] + (1.0f - average) * fleet1->initial_repartition[i];
 	}
-	if ((ATK_FLT != fleet2->type) || (i < LM))
+	if ((ATK_FLT != ctx->own->type) || (i < LM))
 	    fleet2->ship_initial_count += fleet2->initial_repartition[i];
     }
-    os_fleet_reduce_to_max(ctx, fleet2, ctx->max_ship, ctx->max_price);
+    os_fleet_reduce_to_max(ctx, fleet2, ctx->max_ship, ctx->max_price, seed);
 }
 
-static void os_fleet_ga_mutation(void *rec, float mutation_p, void *chromosome)
+static void os_fleet_ga_mutation(void *rec, float mutation_p, void *chromosome, unsigned int *seed)
 {
-    os_fleet_t *fleet = chromosome;
+    os_fleet_ga_chrom_t *fleet = chromosome;
     os_fleet_genetic_ctx_t *ctx = rec;
     float percentage, randval;
     enum Item_enum i;
@@ -1395,7 +2304,7 @@ static void os_fleet_ga_mutation(void *rec, float mutation_p, void *chromosome)
     for (i = PT; i < ITEM_END; i++) {
 	if (item_bitmask[i] & ctx->buffer_fleet)
 	    continue;
-	randval = (-1.0f + (2.0f * my_randf()));
+	randval = (-1.0f + (2.0f * os_fleet_ga_randf(seed)));
 	percentage = 1.0f + (mutation_p * randval);
 	if ((0 == fleet->initial_repartition[i]) && (randval > 1.9f)) {
 	    fleet->initial_repartition[i] = 1UL;
@@ -1407,22 +2316,22 @@ static void os_fleet_ga_mutation(void *rec, float mutation_p, void *chromosome)
 	    /* no modification possible */
 	    if (0 == fleet->initial_repartition[i])
 		continue;
-	    if (my_randf() > 0.5f) {
+	    if (os_fleet_ga_randf(seed) > 0.5f) {
 		/* 1 time / 2 this mutation affect 2 ship types */
 		float price_inc;
 		int rand_idx;
 
-		price_inc = fleet->os_ship[i].price * (float) fleet->initial_repartition[i];
+		price_inc = ctx->own->os_ship[i].price * (float) fleet->initial_repartition[i];
 		fleet->initial_repartition[i] = (float) fleet->initial_repartition[i] * percentage;
-		price_inc = (fleet->os_ship[i].price * (float) fleet->initial_repartition[i]) - price_inc;
+		price_inc = (ctx->own->os_ship[i].price * (float) fleet->initial_repartition[i]) - price_inc;
 		/* Report this mutation to another ship type */
-		for (rand_idx = my_rand((unsigned int) ITEM_END); item_bitmask[rand_idx] & ctx->buffer_fleet;
-		     rand_idx = my_rand((unsigned int) ITEM_END));
-		if (((float) fleet->initial_repartition[rand_idx] - (price_inc / fleet->os_ship[rand_idx].price)) < 0.0f)
+		for (rand_idx = os_fleet_ga_rand(seed, (unsigned int) ITEM_END); item_bitmask[rand_idx] & ctx->buffer_fleet;
+		     rand_idx = os_fleet_ga_rand(seed, (unsigned int) ITEM_END));
+		if (((float) fleet->initial_repartition[rand_idx] - (price_inc / ctx->own->os_ship[rand_idx].price)) < 0.0f)
 		    fleet->initial_repartition[rand_idx] = 0;
 		else
 		    fleet->initial_repartition[rand_idx] =
-			(float) fleet->initial_repartition[rand_idx] - (price_inc / fleet->os_ship[rand_idx].price);
+			(float) fleet->initial_repartition[rand_idx] - (price_inc / ctx->own->os_ship[rand_idx].price);
 	    }
 	    else {
 		/* 1 time / 2 this mutation affect only one ship types */
@@ -1430,11 +2339,11 @@ static void os_fleet_ga_mutation(void *rec, float mutation_p, void *chromosome)
 	    }
 	}
 
-	if ((ATK_FLT != fleet->type) || (i < LM))
+	if ((ATK_FLT != ctx->own->type) || (i < LM))
 	    fleet->ship_initial_count += fleet->initial_repartition[i];
     }
 
-    if (DEF_FLT == fleet->type) {
+    if (DEF_FLT == ctx->own->type) {
 	if (fleet->initial_repartition[PB] >= 1) {
 	    fleet->initial_repartition[PB] = 1UL;
 	    fleet->ship_initial_count += 1;
@@ -1445,7 +2354,367 @@ static void os_fleet_ga_mutation(void *rec, float mutation_p, void *chromosome)
 	}
     }
 
-    os_fleet_reduce_to_max(ctx, fleet, ctx->max_ship, ctx->max_price);
+    os_fleet_reduce_to_max(ctx, fleet, ctx->max_ship, ctx->max_price, seed);
+}
+
+static void os_fleet_ga_copy(void *rec, const void *src, void *dst)
+{
+    memcpy(dst, src, sizeof(os_fleet_ga_chrom_t));
+}
+
+/* Bytes of an individual in a checkpoint: its score, both repartitions, 8 counters and its number of ships */
+#define OS_FLEET_CHECKPOINT_MEMBER_SIZE (4 + 2 * 4 * ITEM_END + 8 * 8 + 4)
+/* Bytes of an improvement of the best score: its time and the score */
+#define OS_FLEET_CHECKPOINT_BEST_SIZE (8 + 4)
+
+/* Both fleets, the guessed side, what may be bought and how it is scored */
+static apr_uint64_t os_fleet_ga_fingerprint(const os_fleet_genetic_ctx_t *ctx, const os_fleet_t *attacker,
+					    const os_fleet_t *defender)
+{
+    unsigned char economy = ctx->mode & (OS_MODE_NO_LOSS | OS_MODE_NO_RECYCLING | OS_MODE_NO_INVEST);
+    apr_uint64_t hash;
+
+    hash = os_fleet_matchup_fingerprint(attacker, defender, 1);
+    hash = os_fleet_hash(hash, &(attacker->guess_mode), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->buffer_fleet), sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &(ctx->max_flight_time), sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &(ctx->wave_time), sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &economy, sizeof(unsigned char));
+
+    return hash;
+}
+
+static apr_status_t os_fleet_ga_checkpoint(void *rec, const napr_galife_state_t *state)
+{
+    const os_fleet_genetic_ctx_t *ctx = rec;
+    const os_fleet_ga_chrom_t *chrom;
+    unsigned char *buffer, *ptr;
+    apr_pool_t *pool;
+    apr_size_t size;
+    unsigned long l;
+    apr_status_t status;
+
+    size = 4 + 8 + 4 + 4 + 6 * 8 + 4 + 4 + state->nb_history * OS_FLEET_CHECKPOINT_BEST_SIZE + 4
+	+ state->nb_members * OS_FLEET_CHECKPOINT_MEMBER_SIZE;
+    /* Saved every minute during hours, the buffers don't pile up in the pool of the run */
+    apr_pool_create(&pool, ctx->pool);
+    buffer = ptr = apr_palloc(pool, size);
+
+    os_io_put_uint32(&ptr, ITEM_END);
+    os_io_put_uint64(&ptr, ctx->fingerprint);
+    os_io_put_uint32(&ptr, ctx->seed);
+    os_io_put_uint32(&ptr, state->seed);
+    os_io_put_uint64(&ptr, state->nb_ages);
+    os_io_put_uint64(&ptr, state->nb_evaluations);
+    os_io_put_uint64(&ptr, state->nb_dropped);
+    os_io_put_uint64(&ptr, state->nb_screened);
+    os_io_put_uint64(&ptr, state->run_time);
+    os_io_put_uint64(&ptr, state->best_time);
+    os_io_put_float(&ptr, state->best_score);
+    os_io_put_uint32(&ptr, state->nb_history);
+    for (l = 0; l < state->nb_history; l++) {
+	os_io_put_uint64(&ptr, state->history[l].time);
+	os_io_put_float(&ptr, state->history[l].score);
+    }
+    os_io_put_uint32(&ptr, state->nb_members);
+    for (l = 0; l < state->nb_members; l++) {
+	chrom = state->chromosomes[l];
+	os_io_put_float(&ptr, state->scores[l]);
+	os_io_put_uint32_array(&ptr, chrom->initial_repartition, ITEM_END);
+	os_io_put_uint32_array(&ptr, chrom->current_repartition, ITEM_END);
+	os_io_put_uint64(&ptr, chrom->metl_lost);
+	os_io_put_uint64(&ptr, chrom->crst_lost);
+	os_io_put_uint64(&ptr, chrom->deut_lost);
+	os_io_put_uint64(&ptr, chrom->metl_recycled);
+	os_io_put_uint64(&ptr, chrom->crst_recycled);
+	os_io_put_uint64(&ptr, chrom->ship_metal);
+	os_io_put_uint64(&ptr, chrom->ship_cristal);
+	os_io_put_uint64(&ptr, chrom->ship_deut);
+	os_io_put_uint32(&ptr, chrom->ship_initial_count);
+    }
+
+    status = os_io_write(ctx->checkpoint_file, OS_FLEET_CHECKPOINT_MAGIC, OS_FLEET_CHECKPOINT_VERSION, buffer,
+			 ptr - buffer, pool);
+    apr_pool_destroy(pool);
+
+    return status;
+}
+
+/* The best distinct fleets of the population, for the next guess of a similar target */
+static apr_status_t os_fleet_ga_write_warm(const os_fleet_genetic_ctx_t *ctx, napr_galife_t *ga,
+					   unsigned long nb_individuals, const char *filename, apr_pool_t *pool)
+{
+    const os_fleet_ga_chrom_t **kept, *chrom;
+    void **chromosomes;
+    float *scores;
+    unsigned char *buffer, *ptr;
+    unsigned long nb, nb_kept = 0UL, l, k;
+
+    chromosomes = apr_palloc(pool, nb_individuals * sizeof(void *));
+    scores = apr_palloc(pool, nb_individuals * sizeof(float));
+    kept = apr_palloc(pool, GA_WARM_INDIVIDUALS * sizeof(os_fleet_ga_chrom_t *));
+    nb = napr_galife_get_best(ga, nb_individuals, chromosomes, scores);
+    for (l = 0; (l < nb) && (nb_kept < GA_WARM_INDIVIDUALS) && (-FLT_MAX != scores[l]); l++) {
+	/* Clones of the best fill the population, each one is kept once */
+	chrom = chromosomes[l];
+	for (k = 0; k < nb_kept; k++)
+	    if (0 == memcmp(kept[k]->initial_repartition, chrom->initial_repartition, ITEM_END * sizeof(unsigned int)))
+		break;
+	if (k == nb_kept)
+	    kept[nb_kept++] = chrom;
+    }
+
+    buffer = ptr = apr_palloc(pool, 3 * 4 + nb_kept * ITEM_END * 4);
+    os_io_put_uint32(&ptr, ITEM_END);
+    os_io_put_uint32(&ptr, ctx->own->type);
+    os_io_put_uint32(&ptr, nb_kept);
+    for (l = 0; l < nb_kept; l++)
+	os_io_put_uint32_array(&ptr, kept[l]->initial_repartition, ITEM_END);
+
+    return os_io_write(filename, OS_FLEET_WARM_MAGIC, OS_FLEET_WARM_VERSION, buffer, ptr - buffer, pool);
+}
+
+/* Read the fleets written by os_fleet_ga_write_warm, nothing is read from a missing file */
+static apr_status_t os_fleet_ga_read_warm(os_fleet_genetic_ctx_t *ctx, const char *filename, apr_pool_t *pool)
+{
+    const unsigned char *ptr, *end;
+    apr_finfo_t finfo;
+    apr_size_t size;
+    apr_uint32_t nb_items = 0, type = 0, nb = 0;
+    unsigned long l;
+    apr_status_t status;
+
+    if (APR_STATUS_IS_ENOENT(apr_stat(&finfo, filename, APR_FINFO_TYPE, pool))) {
+	DEBUG_DBG("no fleets in %s yet", filename);
+	return APR_SUCCESS;
+    }
+    if (APR_SUCCESS != (status = os_io_read(filename, OS_FLEET_WARM_MAGIC, OS_FLEET_WARM_VERSION, &ptr, &size, pool)))
+	return status;
+    end = ptr + size;
+
+    if ((0 != os_io_get_uint32(&ptr, end, &nb_items)) || (ITEM_END != nb_items)) {
+	DEBUG_ERR("%s has been written with %u items instead of %u", filename, nb_items, ITEM_END);
+	return APR_EINVAL;
+    }
+    if ((0 != os_io_get_uint32(&ptr, end, &type)) || (0 != os_io_get_uint32(&ptr, end, &nb))
+	|| ((apr_size_t) (end - ptr) < (apr_size_t) nb * ITEM_END * 4)) {
+	DEBUG_ERR("%s is truncated", filename);
+	return APR_EINVAL;
+    }
+    if ((apr_uint32_t) ctx->own->type != type) {
+	DEBUG_ERR("%s holds fleets of the other side", filename);
+	return APR_EINVAL;
+    }
+
+    ctx->warm = apr_palloc(pool, (nb + 1) * ITEM_END * sizeof(unsigned int));
+    for (l = 0; l < nb; l++)
+	os_io_get_uint32_array(&ptr, end, ctx->warm + l * ITEM_END, ITEM_END);
+    ctx->nb_warm = nb;
+    DEBUG_DBG("%u fleets read from %s", nb, filename);
+
+    return APR_SUCCESS;
+}
+
+/* Relative difference of signature under which a solved guess answers another one */
+#define INDEX_MAX_DISTANCE 0.05f
+/* Share of its indexed score an answer may lose in its verification battles */
+#define INDEX_TOLERANCE 0.1f
+
+/* What must be equal for a solved guess to answer another one */
+static apr_uint64_t os_fleet_ga_index_key(const os_fleet_genetic_ctx_t *ctx)
+{
+    unsigned char economy = ctx->mode & (OS_MODE_NO_LOSS | OS_MODE_NO_RECYCLING | OS_MODE_NO_INVEST);
+    apr_uint64_t hash = 14695981039346656037ULL;
+
+    hash = os_fleet_hash(hash, &(ctx->fleet->type), sizeof(enum Fleet_enum));
+    hash = os_fleet_hash(hash, &(ctx->fleet->attack), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->fleet->shield), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->fleet->structr), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->attack), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->shield), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->structr), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->combustion), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->impulsion), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, &(ctx->hyperespace), sizeof(unsigned char));
+    hash = os_fleet_hash(hash, ctx->initial_repartition, ITEM_END * sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &(ctx->buffer_fleet), sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &(ctx->max_flight_time), sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &(ctx->wave_time), sizeof(unsigned int));
+    hash = os_fleet_hash(hash, &economy, sizeof(unsigned char));
+
+    return hash;
+}
+
+/* What may differ a little: the value of each type of the enemy fleet and the resources of the planet */
+static void os_fleet_ga_index_signature(const os_fleet_genetic_ctx_t *ctx, const os_fleet_t *defender,
+					float *signature)
+{
+    enum Item_enum i;
+
+    for (i = PT; i < ITEM_END; i++)
+	signature[i] = ctx->fleet->os_ship[i].price * (float) ctx->fleet->initial_repartition[i];
+    signature[ITEM_END] = defender->metal;
+    signature[ITEM_END + 1] = defender->cristal;
+    signature[ITEM_END + 2] = defender->deut;
+}
+
+/* Answer with the fleet of a solved guess close enough if it passes its battles here: 1 if it did */
+static int os_fleet_ga_index_answer(os_fleet_genetic_ctx_t *ctx, const os_index_t *index, apr_uint64_t key,
+				    const float *signature, float target_score, napr_galife_stats_t *stats)
+{
+    os_fleet_ga_chrom_t *chrom;
+    void *worker;
+    unsigned int solution[ITEM_END], seed = ctx->seed;
+    apr_time_t start = apr_time_now();
+    float indexed, score;
+
+    if (!os_index_lookup(index, key, signature, INDEX_MAX_DISTANCE, solution, &indexed))
+	return 0;
+    chrom = apr_pcalloc(ctx->pool, sizeof(os_fleet_ga_chrom_t));
+    if (!os_fleet_ga_repair(ctx, chrom, solution, &seed))
+	return 0;
+    os_fleet_ga_worker(ctx, ctx->pool, &worker);
+    score = os_fleet_ga_fitness(ctx, worker, chrom);
+    if ((-FLT_MAX == score) || (score < (indexed - INDEX_TOLERANCE * fabsf(indexed)))) {
+	DEBUG_DBG("indexed fleet scores %f instead of %f here, guessing anyway", score, indexed);
+	return 0;
+    }
+
+    if (!(ctx->mode & OS_MODE_QUIET)) {
+	fprintf(stdout, "[0 sec] best: score[%f]: ", score);
+	os_fleet_ga_display(ctx, chrom);
+    }
+    if (NULL != stats) {
+	memset(stats, 0, sizeof(napr_galife_stats_t));
+	stats->nb_evaluations = 1UL;
+	stats->best_score = score;
+	stats->target_time = (score >= target_score) ? 0 : -1;
+	stats->run_time = apr_time_now() - start;
+    }
+
+    return 1;
+}
+
+/* Print the best fleet kept when the guess was cancelled */
+static void os_fleet_ga_display_cancelled(os_fleet_genetic_ctx_t *ctx, napr_galife_t *ga, apr_pool_t *pool)
+{
+    napr_galife_stats_t ga_stats;
+    void *chromosome;
+    float score;
+
+    os_fleet_ga_allocat(ctx, pool, &chromosome);
+    if (-FLT_MAX == (score = napr_galife_get_best_so_far(ga, chromosome)))
+	return;
+    napr_galife_get_stats(ga, FLT_MAX, &ga_stats);
+    fprintf(stdout, "[%" APR_TIME_T_FMT " sec] cancelled, best: score[%f]: ", apr_time_sec(ga_stats.run_time), score);
+    os_fleet_ga_display(ctx, chromosome);
+}
+
+/* Record the best fleet found, in the index as it is now: other guesses may have been recorded meanwhile */
+static apr_status_t os_fleet_ga_index_record(napr_galife_t *ga, const char *filename, apr_uint64_t key,
+					     const float *signature, apr_pool_t *pool)
+{
+    os_index_t *index;
+    void *chromosome;
+    float score;
+
+    if ((1UL != napr_galife_get_best(ga, 1UL, &chromosome, &score)) || (-FLT_MAX == score))
+	return APR_SUCCESS;
+
+    /* os_index_write merges it with the entries of the file */
+    index = os_index_make(pool);
+    os_index_add(index, key, signature, ((const os_fleet_ga_chrom_t *) chromosome)->initial_repartition, score);
+
+    return os_index_write(index, filename, pool);
+}
+
+/* Read the state saved by os_fleet_ga_checkpoint, the seed of the battles goes back in ctx */
+static apr_status_t os_fleet_ga_read_checkpoint(os_fleet_genetic_ctx_t *ctx, napr_galife_state_t *state,
+						apr_pool_t *pool)
+{
+    const unsigned char *ptr, *end;
+    os_fleet_ga_chrom_t *chrom;
+    apr_size_t size;
+    apr_uint64_t fingerprint = 0ULL, counters[6];
+    apr_uint32_t nb_items = 0, seed, nb;
+    unsigned long l;
+    apr_status_t status;
+
+    if (APR_SUCCESS !=
+	(status = os_io_read(ctx->checkpoint_file, OS_FLEET_CHECKPOINT_MAGIC, OS_FLEET_CHECKPOINT_VERSION, &ptr, &size,
+			     pool)))
+	return status;
+    end = ptr + size;
+
+    if ((0 != os_io_get_uint32(&ptr, end, &nb_items)) || (ITEM_END != nb_items)) {
+	DEBUG_ERR("%s has been written with %u items instead of %u", ctx->checkpoint_file, nb_items, ITEM_END);
+	return APR_EINVAL;
+    }
+    if ((0 != os_io_get_uint64(&ptr, end, &fingerprint)) || (ctx->fingerprint != fingerprint)) {
+	DEBUG_ERR("%s has been written by another guess", ctx->checkpoint_file);
+	return APR_EINVAL;
+    }
+    if ((0 != os_io_get_uint32(&ptr, end, &(ctx->seed)))
+	|| (0 != os_io_get_uint32(&ptr, end, &seed))
+	|| (0 != os_io_get_uint64_array(&ptr, end, counters, 6))
+	|| (0 != os_io_get_float(&ptr, end, &(state->best_score)))
+	|| (0 != os_io_get_uint32(&ptr, end, &nb))
+	|| ((apr_size_t) (end - ptr) < (apr_size_t) nb * OS_FLEET_CHECKPOINT_BEST_SIZE)) {
+	DEBUG_ERR("%s is truncated", ctx->checkpoint_file);
+	return APR_EINVAL;
+    }
+    state->seed = seed;
+    state->nb_ages = counters[0];
+    state->nb_evaluations = counters[1];
+    state->nb_dropped = counters[2];
+    state->nb_screened = counters[3];
+    state->run_time = counters[4];
+    state->best_time = counters[5];
+
+    state->nb_history = nb;
+    state->history = apr_palloc(pool, (nb + 1) * sizeof(napr_galife_best_t));
+    for (l = 0; l < state->nb_history; l++) {
+	os_io_get_uint64(&ptr, end, counters);
+	state->history[l].time = counters[0];
+	os_io_get_float(&ptr, end, &(state->history[l].score));
+    }
+
+    if ((0 != os_io_get_uint32(&ptr, end, &nb))
+	|| ((apr_size_t) (end - ptr) < (apr_size_t) nb * OS_FLEET_CHECKPOINT_MEMBER_SIZE)) {
+	DEBUG_ERR("%s is truncated", ctx->checkpoint_file);
+	return APR_EINVAL;
+    }
+    state->nb_members = nb;
+    state->chromosomes = apr_palloc(pool, (nb + 1) * sizeof(void *));
+    state->scores = apr_palloc(pool, (nb + 1) * sizeof(float));
+    for (l = 0; l < state->nb_members; l++) {
+	state->chromosomes[l] = chrom = apr_palloc(pool, sizeof(os_fleet_ga_chrom_t));
+	os_io_get_float(&ptr, end, &(state->scores[l]));
+	os_io_get_uint32_array(&ptr, end, chrom->initial_repartition, ITEM_END);
+	os_io_get_uint32_array(&ptr, end, chrom->current_repartition, ITEM_END);
+	os_io_get_uint64(&ptr, end, &(chrom->metl_lost));
+	os_io_get_uint64(&ptr, end, &(chrom->crst_lost));
+	os_io_get_uint64(&ptr, end, &(chrom->deut_lost));
+	os_io_get_uint64(&ptr, end, &(chrom->metl_recycled));
+	os_io_get_uint64(&ptr, end, &(chrom->crst_recycled));
+	os_io_get_uint64(&ptr, end, &(chrom->ship_metal));
+	os_io_get_uint64(&ptr, end, &(chrom->ship_cristal));
+	os_io_get_uint64(&ptr, end, &(chrom->ship_deut));
+	os_io_get_uint32(&ptr, end, &(chrom->ship_initial_count));
+    }
+
+    return APR_SUCCESS;
+}
+
+/* Share of the maximum price spent on each type, the surrogate model of the genetic algorithm learns from it */
+static void os_fleet_ga_features(void *rec, const void *chromosome, float *features)
+{
+    const os_fleet_genetic_ctx_t *ctx = rec;
+    const os_fleet_ga_chrom_t *fleet = chromosome;
+    enum Item_enum i;
+
+    for (i = PT; i < ITEM_END; i++)
+	features[i] = ctx->own->os_ship[i].price * (float) fleet->initial_repartition[i] / ctx->max_price;
 }
 
 static enum Item_enum find_cheapest_ship(unsigned int *initial_repartition, unsigned int buffer_fleet_mask)
@@ -1454,26 +2723,19 @@ static enum Item_enum find_cheapest_ship(unsigned int *initial_repartition, unsi
     return i;
 }
 
-extern void os_fleet_find_cheapest_winner(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf,
-					  enum genetic_algorithm_mask mask, unsigned int inactivity_timeout,
-					  unsigned int fixed_timeout, unsigned int flight_time, unsigned int wave_time,
-					  unsigned char mode, unsigned int nb_cpu)
+static apr_status_t os_fleet_genetic_ctx_init(os_fleet_genetic_ctx_t *ctx, os_fleet_t *attacker, os_fleet_t *defender,
+					      const os_conf_t *conf, enum genetic_algorithm_mask mask,
+					      unsigned int flight_time, unsigned int wave_time, unsigned char mode,
+					      apr_pool_t *pool)
 {
-    os_fleet_genetic_ctx_t ctx;
     os_fleet_t *toguess, *tofight;
-    napr_galife_t *ga;
-    apr_pool_t *ga_pool;
-    FILE *meminfo;
-    unsigned int memfree = 0UL, our_nb_ships, nb_individuals;
+    unsigned int our_nb_ships;
     float defender_price, attacker_price, our_price;
     enum Item_enum i;
 
-    apr_pool_create(&ga_pool, attacker->pool);
-    my_srand();
-
-    ctx.max_flight_time = flight_time;
-    ctx.wave_time = wave_time;
-    memset(ctx.max_missiles, 0UL, ITEM_END);
+    memset(ctx, 0, sizeof(os_fleet_genetic_ctx_t));
+    ctx->max_flight_time = flight_time;
+    ctx->wave_time = wave_time;
     if (attacker->guess_mode) {
 	toguess = attacker;
 	tofight = defender;
@@ -1482,110 +2744,195 @@ extern void os_fleet_find_cheapest_winner(os_fleet_t *attacker, os_fleet_t *defe
 	toguess = defender;
 	tofight = attacker;
     }
-    ctx.mode = mode;
+    ctx->mode = mode;
     switch (mask) {
     case FULL:
 	if (toguess == defender)
-	    ctx.buffer_fleet = BUFFER_FLEET_DEF_FULL;
+	    ctx->buffer_fleet = BUFFER_FLEET_DEF_FULL;
 	else
-	    ctx.buffer_fleet = BUFFER_FLEET_ATK_FULL;
+	    ctx->buffer_fleet = BUFFER_FLEET_ATK_FULL;
 	break;
     case NO_MISSILE:
-	ctx.buffer_fleet = BUFFER_FLEET_ATK_NORMAL | BUFFER_FLEET_ATK_NOMISSILE;
+	ctx->buffer_fleet = BUFFER_FLEET_ATK_NORMAL | BUFFER_FLEET_ATK_NOMISSILE;
 	break;
     case SCRIPT:
-	ctx.buffer_fleet = BUFFER_FLEET_SCRIPT;
+	ctx->buffer_fleet = BUFFER_FLEET_SCRIPT;
 	break;
     case NORMAL:
 	if (toguess == defender)
-	    ctx.buffer_fleet = BUFFER_FLEET_DEF_NORMAL;
+	    ctx->buffer_fleet = BUFFER_FLEET_DEF_NORMAL;
 	else
-	    ctx.buffer_fleet = BUFFER_FLEET_ATK_NORMAL;
+	    ctx->buffer_fleet = BUFFER_FLEET_ATK_NORMAL;
 	break;
     case DEF:
 	if (toguess == defender) {
-	    ctx.buffer_fleet = BUFFER_FLEET_DEF_BIGDEF;
+	    ctx->buffer_fleet = BUFFER_FLEET_DEF_BIGDEF;
 	}
 	else {
 	    DEBUG_DBG("No meaning of the def mask in atk guess.");
-	    ctx.buffer_fleet = BUFFER_FLEET_ATK_NORMAL;
+	    ctx->buffer_fleet = BUFFER_FLEET_ATK_NORMAL;
 	}
 	break;
     }
 
     if (attacker->guess_mode) {
 	/* Evaluate price & recycling of the defending fleet */
-	ctx.metl_recycled = 0;
-	ctx.crst_recycled = 0;
+	ctx->metl_recycled = 0;
+	ctx->crst_recycled = 0;
 	for (i = PT, defender_price = 0.0f; i < ITEM_END; i++) {
 	    defender_price += defender->initial_repartition[i] * defender->os_ship[i].price;
 	    if (i < LM) {
-		ctx.metl_recycled += (defender->initial_repartition[i] * defender->os_ship[i].metl_price);
-		ctx.crst_recycled += (defender->initial_repartition[i] * defender->os_ship[i].crst_price);
+		ctx->metl_recycled += (defender->initial_repartition[i] * defender->os_ship[i].metl_price);
+		ctx->crst_recycled += (defender->initial_repartition[i] * defender->os_ship[i].crst_price);
 	    }
 	    else {
 		if (0UL != defender->initial_repartition[i]) {
-		    ctx.max_missiles[i] = defender->mit + ((defender->os_ship[i].structure_points * defender->initial_repartition[i])	/* Structure */
+		    ctx->max_missiles[i] = defender->mit + ((defender->os_ship[i].structure_points * defender->initial_repartition[i])	/* Structure */
 							   /(12000.0f *
 							     (1.0f +
 							      attacker->attack / 10.0f)) /* damage */ +0.99999999999999);
-		    DEBUG_DBG("%u missiles max to kill %u %s", ctx.max_missiles[i], defender->initial_repartition[i],
+		    DEBUG_DBG("%u missiles max to kill %u %s", ctx->max_missiles[i], defender->initial_repartition[i],
 			      (defender->os_ship)[i].shortname);
 		}
 		else {
-		    ctx.max_missiles[i] = 0UL;
+		    ctx->max_missiles[i] = 0UL;
 		}
 	    }
 	}
-	ctx.max_price = 3.5f * defender_price;
-	ctx.max_ship = (unsigned int) (ctx.max_price / defender->os_ship[CLE].price);
-	ctx.combustion = toguess->combustion;
-	ctx.impulsion = toguess->impulsion;
-	ctx.hyperespace = toguess->hyperespace;
+	ctx->max_price = 3.5f * defender_price;
+	ctx->max_ship = (unsigned int) (ctx->max_price / defender->os_ship[CLE].price);
+	ctx->combustion = toguess->combustion;
+	ctx->impulsion = toguess->impulsion;
+	ctx->hyperespace = toguess->hyperespace;
     }
     else if (defender->guess_mode) {
-	ctx.max_ship = attacker->ship_initial_count;
+	ctx->max_ship = attacker->ship_initial_count;
 	/* Evaluate price & recycling of the attacking fleet */
 	for (i = PT, attacker_price = 0.0f; i < LM; i++) {
 	    attacker_price += attacker->initial_repartition[i] * attacker->os_ship[i].price;
-	    ctx.metl_recycled += (attacker->initial_repartition[i] * attacker->os_ship[i].metl_price);
-	    ctx.crst_recycled += (attacker->initial_repartition[i] * attacker->os_ship[i].crst_price);
+	    ctx->metl_recycled += (attacker->initial_repartition[i] * attacker->os_ship[i].metl_price);
+	    ctx->crst_recycled += (attacker->initial_repartition[i] * attacker->os_ship[i].crst_price);
 	}
-	ctx.max_price = 1.5f * attacker_price;
-	ctx.max_ship = (unsigned int) (ctx.max_price / attacker->os_ship[LM].price);
+	ctx->max_price = 1.5f * attacker_price;
+	ctx->max_ship = (unsigned int) (ctx->max_price / attacker->os_ship[LM].price);
     }
     else {
 	DEBUG_ERR("Fleet repartition set for both player, mode not supported. RTFM.");
-	return;
+	return APR_EINVAL;
     }
 
     for (i = 0, our_nb_ships = 0, our_price = 0.0f; i < ITEM_END; i++) {
 	our_nb_ships += toguess->initial_repartition[i];
 	our_price += toguess->initial_repartition[i] * toguess->os_ship[i].price;
     }
-    ctx.max_ship = MAX(our_nb_ships, ctx.max_ship);
-    ctx.max_price = MAX(our_price, ctx.max_price);
-    ctx.fleet = tofight;
-    ctx.attack = toguess->attack;
-    ctx.shield = toguess->shield;
-    ctx.structr = toguess->structr;
-    if (0UL == (ctx.distance = os_fleet_distance(toguess->coord, tofight->coord))) {
+    ctx->max_ship = MAX(our_nb_ships, ctx->max_ship);
+    ctx->max_price = MAX(our_price, ctx->max_price);
+    ctx->fleet = tofight;
+    ctx->attack = toguess->attack;
+    ctx->shield = toguess->shield;
+    ctx->structr = toguess->structr;
+    if (0UL == (ctx->distance = os_fleet_distance(toguess->coord, tofight->coord))) {
 	DEBUG_ERR("Can't parse one of the coordinates: %s or %s", toguess->coord, tofight->coord);
-	return;
+	return APR_EINVAL;
+    }
+
+    ctx->metl_recycled *= 0.30f;
+    ctx->crst_recycled *= 0.30f;
+    memcpy(ctx->initial_repartition, toguess->initial_repartition, ITEM_END * sizeof(unsigned int));
+
+    if (0 == ctx->metl_recycled)
+	ctx->metl_recycled = 1;
+    if (0 == ctx->crst_recycled)
+	ctx->crst_recycled = 1;
+
+    ctx->conf = conf;
+    ctx->pool = pool;
+    ctx->seed = os_fleet_get_seed();
+
+    return APR_SUCCESS;
+}
+
+extern apr_status_t os_fleet_rescore(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf,
+				     const os_sample_t *sample, unsigned int flight_time, unsigned int wave_time,
+				     unsigned char mode)
+{
+    os_fleet_genetic_ctx_t ctx;
+    const unsigned int *own_survivors, *adversary_survivors;
+    os_fleet_t *own, *adversary;
+    unsigned int k, nb_sample, own_alive, adversary_alive;
+    float score;
+    enum Item_enum j;
+
+    if (os_sample_get_matchup(sample) != os_fleet_matchup_fingerprint(attacker, defender, 0)) {
+	DEBUG_ERR("the samples have not been computed with these fleets");
+	return APR_EINVAL;
+    }
+    if (APR_SUCCESS !=
+	os_fleet_genetic_ctx_init(&ctx, attacker, defender, conf, FULL, flight_time, wave_time, mode, attacker->pool)) {
+	DEBUG_ERR("error calling os_fleet_genetic_ctx_init");
+	return APR_EINVAL;
+    }
+
+    if (attacker->guess_mode) {
+	own = attacker;
+	adversary = defender;
+	own_survivors = os_sample_get_atk_repartitions(sample);
+	adversary_survivors = os_sample_get_def_repartitions(sample);
+    }
+    else {
+	own = defender;
+	adversary = attacker;
+	own_survivors = os_sample_get_def_repartitions(sample);
+	adversary_survivors = os_sample_get_atk_repartitions(sample);
     }
 
-    ctx.metl_recycled *= 0.30f;
-    ctx.crst_recycled *= 0.30f;
-    memcpy(ctx.initial_repartition, toguess->initial_repartition, ITEM_END * sizeof(unsigned int));
-    ctx.first_fleet_set = 0;
+    /* Same rule as os_fleet_ga_fitness: only won battles are scored */
+    nb_sample = os_sample_get_nb(sample);
+    for (k = 0, score = 0.0f; (k < nb_sample) && (-FLT_MAX != score); k++) {
+	for (j = PT, own_alive = 0; j < own->limit; j++)
+	    own_alive += own_survivors[k * ITEM_END + j];
+	for (j = PT, adversary_alive = 0; j < adversary->limit; j++)
+	    adversary_alive += adversary_survivors[k * ITEM_END + j];
+	if ((0 == own_alive) || (0 != adversary_alive))
+	    score = -FLT_MAX;
+    }
+    if (-FLT_MAX != score)
+	score = os_fleet_ga_score(&ctx, own, own_survivors, nb_sample);
+
+    fprintf(stdout, "score[%f]: ", score);
+    os_fleet_ga_display_fleet(&ctx, own);
+
+    return APR_SUCCESS;
+}
+
+extern void os_fleet_find_cheapest_winner(os_fleet_t *attacker, os_fleet_t *defender, const os_conf_t *conf,
+					  enum genetic_algorithm_mask mask, unsigned int inactivity_timeout,
+					  unsigned int fixed_timeout, unsigned int flight_time, unsigned int wave_time,
+					  unsigned char mode, unsigned int nb_cpu, unsigned int max_individuals,
+					  unsigned long max_ages, const napr_galife_tuning_t *tuning, float target_score,
+					  const char *checkpoint_file, int resume, const char *warm_file,
+					  const char *index_file, napr_galife_stats_t *stats)
+{
+    os_fleet_genetic_ctx_t ctx;
+    napr_galife_stats_t ga_stats;
+    napr_galife_state_t state, *resumed = NULL;
+    os_index_t *index;
+    apr_uint64_t index_key = 0ULL;
+    float signature[OS_INDEX_DIM];
+    apr_finfo_t finfo;
+    napr_galife_t *ga;
+    apr_pool_t *ga_pool;
+    FILE *meminfo;
+    unsigned int memfree = 0UL, nb_individuals;
+    unsigned long hit_tables, nb_workers;
 
-    if (0 == ctx.metl_recycled)
-	ctx.metl_recycled = 1;
-    if (0 == ctx.crst_recycled)
-	ctx.crst_recycled = 1;
+    apr_pool_create(&ga_pool, attacker->pool);
 
-    ctx.conf = conf;
-    ctx.pool = ga_pool;
+    if (APR_SUCCESS !=
+	os_fleet_genetic_ctx_init(&ctx, attacker, defender, conf, mask, flight_time, wave_time, mode, ga_pool)) {
+	apr_pool_destroy(ga_pool);
+	return;
+    }
 
     /* check memory usage to tune number of individuals */
     meminfo = fopen("/proc/meminfo", "r");
@@ -1610,36 +2957,141 @@ extern void os_fleet_find_cheapest_winner(os_fleet_t *attacker, os_fleet_t *defe
     }
     else {
 	DEBUG_ERR("Can't read meminfo MemTotal from meminfo");
+	apr_pool_destroy(ga_pool);
 	return;
     }
 
     if (!memfree) {
 	DEBUG_ERR("Can't read correctly memory infos.");
+	apr_pool_destroy(ga_pool);
 	return;
     }
     /* Computation of max number of individuals */
     /* Leave 10Mo for stack and other process :> */
     memfree -= (5UL * 1024UL);
-    DEBUG_DBG("memfree less 5Mo : %uko, sizeof an individual: %luko", memfree,
-	      (sizeof(struct os_fleet_t) + ctx.max_ship * sizeof(struct os_battle_ship_t)) / 1024UL);
-    nb_individuals = (1024UL * memfree) / (sizeof(struct os_fleet_t) + ctx.max_ship * sizeof(struct os_battle_ship_t));
-    nb_individuals = MIN(nb_individuals, 256UL);
+    /*
+     * Only the hit tables are big, each evaluating thread keeps its own (the
+     * ennemy's one included): the threadpool, whose threads lend theirs to
+     * the islands or the steady state workers, more of them only when there
+     * are more islands.
+     */
+    nb_workers = (NULL != tuning) ? MAX(nb_cpu, tuning->nb_islands) : nb_cpu;
+    hit_tables = nb_workers * (ctx.max_ship + ctx.fleet->ship_initial_count) * sizeof(struct os_battle_ship_t);
+    if ((1024UL * memfree) <= hit_tables) {
+	DEBUG_ERR("Not enough memory for %lu octets of hit tables", hit_tables);
+	apr_pool_destroy(ga_pool);
+	return;
+    }
+    DEBUG_DBG("memfree less 5Mo : %uko, hit tables: %luko, sizeof an individual: %luo", memfree, hit_tables / 1024UL,
+	      sizeof(os_fleet_ga_chrom_t));
+    nb_individuals = ((1024UL * memfree) - hit_tables) / sizeof(os_fleet_ga_chrom_t);
+    nb_individuals = MIN(nb_individuals, (0 == max_individuals) ? GA_DEFAULT_INDIVIDUALS : max_individuals);
     DEBUG_DBG("Plan to use %u individuals", nb_individuals);
     if (nb_individuals <= 3) {
 	DEBUG_ERR("Not enough memory...");
+	apr_pool_destroy(ga_pool);
 	return;
     }
 
+    ctx.own = os_fleet_ga_own_make(&ctx, ga_pool);
+
+    /* Big populations need room to memoise their children */
+    if (APR_SUCCESS != napr_cache_init(&(ctx.cache), MAX(FITNESS_CACHE_ENTRIES, 4UL * nb_individuals),
+					    ITEM_END * sizeof(unsigned int), sizeof(os_fleet_ga_memo_t), ga_pool)) {
+	DEBUG_ERR("error calling napr_cache_init, fitness won't be memoised");
+	ctx.cache = NULL;
+    }
+
+    if (NULL != index_file) {
+	index_key = os_fleet_ga_index_key(&ctx);
+	os_fleet_ga_index_signature(&ctx, defender, signature);
+	index = os_index_make(ga_pool);
+	if (APR_SUCCESS != os_index_open(index, index_file)) {
+	    DEBUG_ERR("error calling os_index_open, guessing without index");
+	}
+	else if (os_fleet_ga_index_answer(&ctx, index, index_key, signature, target_score, stats)) {
+	    apr_pool_destroy(ga_pool);
+	    return;
+	}
+    }
+
+    if ((NULL != warm_file) && (APR_SUCCESS != os_fleet_ga_read_warm(&ctx, warm_file, ga_pool)))
+	DEBUG_ERR("error calling os_fleet_ga_read_warm, starting from random fleets");
+
+    ctx.checkpoint_file = checkpoint_file;
+    ctx.fingerprint = os_fleet_ga_fingerprint(&ctx, attacker, defender);
+    /* Nothing saved yet is a fresh start, a file that can't be resumed stops the guess before overwriting it */
+    if (resume && (NULL != checkpoint_file)) {
+	if (APR_STATUS_IS_ENOENT(apr_stat(&finfo, checkpoint_file, APR_FINFO_TYPE, ga_pool))) {
+	    DEBUG_DBG("no checkpoint in %s yet, starting afresh", checkpoint_file);
+	}
+	else if (APR_SUCCESS != os_fleet_ga_read_checkpoint(&ctx, &state, ga_pool)) {
+	    DEBUG_ERR("error calling os_fleet_ga_read_checkpoint, can't resume from %s", checkpoint_file);
+	    apr_pool_destroy(ga_pool);
+	    return;
+	}
+	else {
+	    resumed = &state;
+	}
+    }
+
+    /*
+     * The guess can be cancelled from now on: the flag stops the evaluations
+     * of napr_galife_init, and as init resets the end of the run, a
+     * cancellation it missed is passed on once it returns.
+     */
+    os_fleet_guess_cancelled = 0;
+    os_fleet_guess_ga = &(ctx.ga);
     if (APR_SUCCESS ==
-	napr_galife_init(ga_pool, nb_individuals, 100000UL, inactivity_timeout, fixed_timeout, nb_cpu, &ctx,
-			 os_fleet_ga_allocat, os_fleet_ga_randomz, os_fleet_ga_display, os_fleet_ga_fitness, 0.95f,
-			 os_fleet_ga_crossvr, 0.5f, os_fleet_ga_mutation, &ga)) {
+	napr_galife_init(ga_pool, nb_individuals, (0UL == max_ages) ? GA_DEFAULT_AGES : max_ages, inactivity_timeout,
+			 fixed_timeout, nb_cpu, ctx.seed, &ctx,
+			 os_fleet_ga_allocat, os_fleet_ga_randomz, (mode & OS_MODE_QUIET) ? NULL : os_fleet_ga_display,
+			 os_fleet_ga_fitness, os_fleet_ga_worker, os_fleet_ga_copy, 0.95f, os_fleet_ga_crossvr, 0.5f, os_fleet_ga_mutation,
+			 resumed, &(ctx.ga))) {
+	ga = ctx.ga;
+	if (os_fleet_guess_cancelled)
+	    napr_galife_cancel(ga);
+	if ((NULL != tuning) && (APR_SUCCESS != napr_galife_set_tuning(ga, tuning)))
+	    DEBUG_ERR("error calling napr_galife_set_tuning, keeping the default tuning");
+	if (NULL != checkpoint_file)
+	    napr_galife_set_checkpoint(ga, GA_CHECKPOINT_INTERVAL, os_fleet_ga_checkpoint);
+	/* The evaluations only see the memos of the previous batches */
+	napr_galife_set_sync(ga, os_fleet_ga_sync);
+	/* Racing refines the memoised scores, without cache each batch would be scored alone */
+	if (NULL != ctx.cache)
+	    napr_galife_set_race(ga, os_fleet_ga_race);
+	napr_galife_set_estimate(ga, os_fleet_ga_estimate);
+	if (APR_SUCCESS != napr_galife_set_surrogate(ga, os_fleet_ga_features, ITEM_END))
+	    DEBUG_ERR("error calling napr_galife_set_surrogate, offspring won't be ranked");
+	if (APR_SUCCESS != napr_galife_keep_best(ga))
+	    DEBUG_ERR("error calling napr_galife_keep_best");
 	if (APR_SUCCESS != ga_run(ga))
 	    DEBUG_ERR("error calling ga_run");
+	os_fleet_guess_ga = NULL;
+	if (os_fleet_guess_cancelled && !(mode & OS_MODE_QUIET))
+	    os_fleet_ga_display_cancelled(&ctx, ga, ga_pool);
+	if ((NULL != warm_file) && (APR_SUCCESS != os_fleet_ga_write_warm(&ctx, ga, nb_individuals, warm_file, ga_pool)))
+	    DEBUG_ERR("error calling os_fleet_ga_write_warm");
+	/* A cancelled guess may be far from solved, it doesn't answer the next ones */
+	if ((NULL != index_file) && !os_fleet_guess_cancelled
+	    && (APR_SUCCESS != os_fleet_ga_index_record(ga, index_file, index_key, signature, ga_pool)))
+	    DEBUG_ERR("error calling os_fleet_ga_index_record");
+	napr_galife_get_stats(ga, target_score, &ga_stats);
+	DEBUG_DBG("surrogate: %lu children predicted, mean absolute error %f, correlation %f", ga_stats.nb_predicted,
+		  ga_stats.surrogate_error, ga_stats.surrogate_correlation);
+	if (NULL != stats)
+	    memcpy(stats, &ga_stats, sizeof(napr_galife_stats_t));
+	if (NULL != ctx.cache) {
+	    apr_uint64_t hits, misses;
+
+	    napr_cache_get_stats(ctx.cache, &hits, &misses);
+	    DEBUG_DBG("fitness cache: %" APR_UINT64_T_FMT " hits, %" APR_UINT64_T_FMT " misses", hits, misses);
+	}
     }
     else {
 	DEBUG_ERR("error calling napr_galife_init");
     }
+    os_fleet_guess_ga = NULL;
 
     apr_pool_destroy(ga_pool);
 }
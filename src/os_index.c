@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include <apr_file_info.h>
+#include <apr_file_io.h>
+#include <apr_strings.h>
+#include <apr_tables.h>
+
+#include "debug.h"
+#include "os_index.h"
+#include "os_io.h"
+
+#define OS_INDEX_MAGIC "OSIMIDX"
+
+/* Number of items, of signature numbers and of entries */
+#define OS_INDEX_HEADER_SIZE (3 * 4)
+/* Bytes of an entry in the file: key, signature, solution and score */
+#define OS_INDEX_ENTRY_SIZE (8 + 4 * OS_INDEX_DIM + 4 * ITEM_END + 4)
+
+typedef struct os_index_entry_t
+{
+    apr_uint64_t key;
+    float signature[OS_INDEX_DIM];
+    unsigned int solution[ITEM_END];
+    float score;
+} os_index_entry_t;
+
+struct os_index_t
+{
+    apr_pool_t *pool;
+    const unsigned char *entries;	/* nb_mapped entries of the file, sorted by key, NULL if none */
+    unsigned int nb_mapped;
+    apr_array_header_t *added;	/* os_index_entry_t not written yet */
+};
+
+extern os_index_t *os_index_make(apr_pool_t *pool)
+{
+    os_index_t *index;
+
+    if (NULL != (index = apr_pcalloc(pool, sizeof(struct os_index_t)))) {
+	index->pool = pool;
+	index->added = apr_array_make(pool, 8, sizeof(os_index_entry_t));
+    }
+
+    return index;
+}
+
+/* Map the entries of filename, verify checks the whole file first */
+static apr_status_t os_index_map(os_index_t *index, const char *filename, int verify)
+{
+    const unsigned char *ptr, *end;
+    apr_finfo_t finfo;
+    apr_size_t size;
+    apr_uint32_t nb_items = 0, dim = 0, nb = 0;
+    apr_status_t status;
+
+    if (APR_STATUS_IS_ENOENT(apr_stat(&finfo, filename, APR_FINFO_TYPE, index->pool)))
+	return APR_SUCCESS;
+    if (APR_SUCCESS != (status = os_io_map(filename, OS_INDEX_MAGIC, OS_INDEX_VERSION, &ptr, &size, index->pool)))
+	return status;
+    if (verify && (APR_SUCCESS != (status = os_io_verify(filename, ptr, size))))
+	return status;
+    end = ptr + size;
+
+    if ((0 != os_io_get_uint32(&ptr, end, &nb_items)) || (0 != os_io_get_uint32(&ptr, end, &dim))
+	|| (ITEM_END != nb_items) || (OS_INDEX_DIM != dim)) {
+	DEBUG_ERR("%s has been written with %u items and %u numbers by signature instead of %u and %u", filename,
+		  nb_items, dim, ITEM_END, OS_INDEX_DIM);
+	return APR_EINVAL;
+    }
+    if ((0 != os_io_get_uint32(&ptr, end, &nb)) || ((apr_size_t) (end - ptr) < (apr_size_t) nb * OS_INDEX_ENTRY_SIZE)) {
+	DEBUG_ERR("%s is truncated", filename);
+	return APR_EINVAL;
+    }
+    index->entries = ptr;
+    index->nb_mapped = nb;
+
+    return APR_SUCCESS;
+}
+
+extern apr_status_t os_index_open(os_index_t *index, const char *filename)
+{
+    /* A lookup only reads the entries of a key, the checksum would read them all */
+    return os_index_map(index, filename, 0);
+}
+
+static inline apr_uint64_t os_index_mapped_key(const os_index_t *index, unsigned int idx)
+{
+    const unsigned char *ptr = index->entries + (apr_size_t) idx * OS_INDEX_ENTRY_SIZE;
+    apr_uint64_t key;
+
+    os_io_get_uint64(&ptr, ptr + 8, &key);
+
+    return key;
+}
+
+static void os_index_mapped_entry(const os_index_t *index, unsigned int idx, os_index_entry_t *entry)
+{
+    const unsigned char *ptr = index->entries + (apr_size_t) idx * OS_INDEX_ENTRY_SIZE;
+    const unsigned char *end = ptr + OS_INDEX_ENTRY_SIZE;
+    unsigned int i;
+
+    os_io_get_uint64(&ptr, end, &(entry->key));
+    for (i = 0; i < OS_INDEX_DIM; i++)
+	os_io_get_float(&ptr, end, &(entry->signature[i]));
+    os_io_get_uint32_array(&ptr, end, entry->solution, ITEM_END);
+    os_io_get_float(&ptr, end, &(entry->score));
+}
+
+/* Sum of the absolute differences relative to the sum of both, 0 between two null signatures */
+static float os_index_distance(const float *a, const float *b)
+{
+    float diff = 0.0f, sum = 0.0f;
+    unsigned int i;
+
+    for (i = 0; i < OS_INDEX_DIM; i++) {
+	diff += fabsf(a[i] - b[i]);
+	sum += a[i] + b[i];
+    }
+
+    return (sum > 0.0f) ? diff / sum : 0.0f;
+}
+
+/* Keep entry if it is nearer than the best one so far */
+static inline int os_index_nearest(const os_index_entry_t *entry, const float *signature, float *best_distance,
+				   unsigned int *solution, float *score)
+{
+    float distance = os_index_distance(entry->signature, signature);
+
+    if (distance > *best_distance)
+	return 0;
+    *best_distance = distance;
+    memcpy(solution, entry->solution, ITEM_END * sizeof(unsigned int));
+    *score = entry->score;
+
+    return 1;
+}
+
+extern int os_index_lookup(const os_index_t *index, apr_uint64_t key, const float *signature, float max_distance,
+			   unsigned int *solution, float *score)
+{
+    const os_index_entry_t *added = (const os_index_entry_t *) index->added->elts;
+    os_index_entry_t entry;
+    float best_distance = max_distance;
+    unsigned int low = 0, high = index->nb_mapped, mid;
+    int i, found = 0;
+
+    /* The first entry of key, only the entries of the same key are decoded */
+    while (low < high) {
+	mid = low + (high - low) / 2;
+	if (os_index_mapped_key(index, mid) < key)
+	    low = mid + 1;
+	else
+	    high = mid;
+    }
+    for (; (low < index->nb_mapped) && (key == os_index_mapped_key(index, low)); low++) {
+	os_index_mapped_entry(index, low, &entry);
+	if (os_index_nearest(&entry, signature, &best_distance, solution, score))
+	    found = 1;
+    }
+    for (i = 0; i < index->added->nelts; i++)
+	if ((key == added[i].key) && os_index_nearest(&(added[i]), signature, &best_distance, solution, score))
+	    found = 1;
+
+    return found;
+}
+
+extern void os_index_add(os_index_t *index, apr_uint64_t key, const float *signature, const unsigned int *solution,
+			 float score)
+{
+    os_index_entry_t *entry;
+
+    entry = apr_array_push(index->added);
+    entry->key = key;
+    memcpy(entry->signature, signature, OS_INDEX_DIM * sizeof(float));
+    memcpy(entry->solution, solution, ITEM_END * sizeof(unsigned int));
+    entry->score = score;
+}
+
+extern unsigned int os_index_get_nb(const os_index_t *index)
+{
+    return index->nb_mapped + index->added->nelts;
+}
+
+static int os_index_entry_cmp(const void *a, const void *b)
+{
+    apr_uint64_t key_a = ((const os_index_entry_t *) a)->key, key_b = ((const os_index_entry_t *) b)->key;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+/* An entry added with the same key and signature replaces the mapped one */
+static int os_index_replaced(const os_index_t *index, const os_index_entry_t *entry)
+{
+    const os_index_entry_t *added = (const os_index_entry_t *) index->added->elts;
+    int i;
+
+    for (i = 0; i < index->added->nelts; i++)
+	if ((entry->key == added[i].key)
+	    && (0 == memcmp(entry->signature, added[i].signature, OS_INDEX_DIM * sizeof(float))))
+	    return 1;
+
+    return 0;
+}
+
+/* Merge the entries added to index with the ones of the file as it is now, the caller holds the lock */
+static apr_status_t os_index_merge(const os_index_t *index, const char *filename, apr_pool_t *pool)
+{
+    char errbuf[128];
+    os_index_t *current;
+    os_index_entry_t *entries;
+    unsigned char *buffer, *ptr;
+    const char *aside;
+    unsigned int nb = 0, l, i;
+    apr_status_t status;
+
+    current = os_index_make(pool);
+    status = os_index_map(current, filename, 1);
+    if (APR_EINVAL == status) {
+	/* The entries of the other guesses are lost, not their file */
+	aside = apr_pstrcat(pool, filename, ".corrupt", NULL);
+	DEBUG_ERR("%s is corrupted, it is moved to %s", filename, aside);
+	if (APR_SUCCESS != (status = apr_file_rename(filename, aside, pool))) {
+	    DEBUG_ERR("error calling apr_file_rename: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	current = os_index_make(pool);
+    }
+    else if (APR_SUCCESS != status) {
+	DEBUG_ERR("error calling os_index_map, %s is not written", filename);
+	return status;
+    }
+
+    entries = apr_palloc(pool, (current->nb_mapped + index->added->nelts + 1) * sizeof(os_index_entry_t));
+    for (l = 0; l < current->nb_mapped; l++) {
+	os_index_mapped_entry(current, l, &(entries[nb]));
+	if (!os_index_replaced(index, &(entries[nb])))
+	    nb++;
+    }
+    memcpy(entries + nb, index->added->elts, index->added->nelts * sizeof(os_index_entry_t));
+    nb += index->added->nelts;
+    /* Lookups binary search the first entry of a key */
+    qsort(entries, nb, sizeof(os_index_entry_t), os_index_entry_cmp);
+
+    buffer = ptr = apr_palloc(pool, OS_INDEX_HEADER_SIZE + (apr_size_t) nb * OS_INDEX_ENTRY_SIZE);
+    os_io_put_uint32(&ptr, ITEM_END);
+    os_io_put_uint32(&ptr, OS_INDEX_DIM);
+    os_io_put_uint32(&ptr, nb);
+    for (l = 0; l < nb; l++) {
+	os_io_put_uint64(&ptr, entries[l].key);
+	for (i = 0; i < OS_INDEX_DIM; i++)
+	    os_io_put_float(&ptr, entries[l].signature[i]);
+	os_io_put_uint32_array(&ptr, entries[l].solution, ITEM_END);
+	os_io_put_float(&ptr, entries[l].score);
+    }
+
+    return os_io_write(filename, OS_INDEX_MAGIC, OS_INDEX_VERSION, buffer, ptr - buffer, pool);
+}
+
+extern apr_status_t os_index_write(const os_index_t *index, const char *filename, apr_pool_t *pool)
+{
+    char errbuf[128];
+    const char *lockname;
+    apr_file_t *lock;
+    apr_status_t status;
+
+    /* The lock file outlives the writers: removing it would let two of them lock two files */
+    lockname = apr_pstrcat(pool, filename, ".lock", NULL);
+    if (APR_SUCCESS !=
+	(status = apr_file_open(&lock, lockname, APR_WRITE | APR_CREATE | APR_BINARY, APR_OS_DEFAULT, pool))) {
+	DEBUG_ERR("error calling apr_file_open: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_file_lock(lock, APR_FLOCK_EXCLUSIVE))) {
+	DEBUG_ERR("error calling apr_file_lock: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(lock);
+	return status;
+    }
+    status = os_index_merge(index, filename, pool);
+    apr_file_unlock(lock);
+    apr_file_close(lock);
+
+    return status;
+}
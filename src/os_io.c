@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <apr_atomic.h>
+#include <apr_file_io.h>
+#include <apr_mmap.h>
+#include <apr_strings.h>
+
+#include "debug.h"
+#include "os_io.h"
+
+/* FNV-1a, only there to detect truncated or corrupted files */
+static apr_uint64_t os_io_checksum(const unsigned char *data, apr_size_t len)
+{
+    apr_uint64_t hash = 14695981039346656037ULL;
+    apr_size_t i;
+
+    for (i = 0; i < len; i++) {
+	hash ^= data[i];
+	hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/* Numbers the temporary files of the threads of this process */
+static volatile apr_uint32_t os_io_nb_tmp = 0;
+
+extern apr_status_t os_io_write(const char *filename, const char *magic, apr_uint32_t version,
+				const unsigned char *payload, apr_size_t size, apr_pool_t *pool)
+{
+    char errbuf[128];
+    apr_finfo_t finfo;
+    unsigned char *buffer, *ptr;
+    char *tmpname;
+    apr_file_t *f;
+    apr_status_t status;
+
+    buffer = ptr = apr_palloc(pool, size + OS_IO_FRAME_SIZE);
+    memcpy(ptr, magic, OS_IO_MAGIC_LEN);
+    ptr += OS_IO_MAGIC_LEN;
+    os_io_put_uint32(&ptr, version);
+    memcpy(ptr, payload, size);
+    ptr += size;
+    os_io_put_uint64(&ptr, os_io_checksum(buffer, ptr - buffer));
+
+    /*
+     * Written aside then renamed, a killed process never leaves a truncated
+     * file behind; each writer has its own temporary file, and it is on the
+     * disk before the rename makes it the file. The temporary file is
+     * created with the default permissions (umask applied), a leftover of
+     * a killed process of the same pid is skipped; then it takes the ones of
+     * the file it replaces, if any.
+     */
+    do {
+	tmpname = apr_psprintf(pool, "%s.%ld.%u", filename, (long) getpid(), apr_atomic_inc32(&os_io_nb_tmp));
+	status = apr_file_open(&f, tmpname, APR_CREATE | APR_WRITE | APR_EXCL | APR_BINARY, APR_OS_DEFAULT, pool);
+    } while (APR_STATUS_IS_EEXIST(status));
+    if (APR_SUCCESS != status) {
+	DEBUG_ERR("error calling apr_file_open: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    if ((APR_SUCCESS == apr_stat(&finfo, filename, APR_FINFO_PROT, pool))
+	&& (APR_SUCCESS != (status = apr_file_perms_set(tmpname, finfo.protection)))) {
+	DEBUG_ERR("error calling apr_file_perms_set: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(f);
+	apr_file_remove(tmpname, pool);
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_file_write_full(f, buffer, ptr - buffer, NULL))) {
+	DEBUG_ERR("error calling apr_file_write_full: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(f);
+	apr_file_remove(tmpname, pool);
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_file_sync(f))) {
+	DEBUG_ERR("error calling apr_file_sync: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(f);
+	apr_file_remove(tmpname, pool);
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_file_close(f))) {
+	DEBUG_ERR("error calling apr_file_close: %s", apr_strerror(status, errbuf, 128));
+	apr_file_remove(tmpname, pool);
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_file_rename(tmpname, filename, pool))) {
+	DEBUG_ERR("error calling apr_file_rename: %s", apr_strerror(status, errbuf, 128));
+	apr_file_remove(tmpname, pool);
+	return status;
+    }
+
+    return APR_SUCCESS;
+}
+
+/* Check the checksum of a whole file */
+static apr_status_t os_io_check_sum(const char *filename, const unsigned char *buffer, apr_size_t len)
+{
+    const unsigned char *ptr;
+    apr_uint64_t checksum;
+
+    ptr = buffer + len - 8;
+    os_io_get_uint64(&ptr, buffer + len, &checksum);
+    if (checksum != os_io_checksum(buffer, len - 8)) {
+	DEBUG_ERR("%s is corrupted (bad checksum)", filename);
+	return APR_EINVAL;
+    }
+
+    return APR_SUCCESS;
+}
+
+/* Check the header of a whole file, the payload points inside buffer */
+static apr_status_t os_io_check_header(const char *filename, const char *magic, apr_uint32_t version,
+				       const unsigned char *buffer, apr_size_t len, const unsigned char **payload,
+				       apr_size_t *size)
+{
+    const unsigned char *ptr;
+    apr_uint32_t file_version = 0;
+
+    if (0 != memcmp(buffer, magic, OS_IO_MAGIC_LEN)) {
+	DEBUG_ERR("%s is not a %s file", filename, magic);
+	return APR_EINVAL;
+    }
+    ptr = buffer + OS_IO_MAGIC_LEN;
+    os_io_get_uint32(&ptr, buffer + len, &file_version);
+    if (version != file_version) {
+	DEBUG_ERR("%s has version %u, version %u expected", filename, file_version, version);
+	return APR_EINVAL;
+    }
+
+    *payload = ptr;
+    *size = len - OS_IO_FRAME_SIZE;
+
+    return APR_SUCCESS;
+}
+
+/* Open filename and get its size, it must be big enough to hold a frame */
+static apr_status_t os_io_open(const char *filename, apr_file_t **f, apr_size_t *len, apr_pool_t *pool)
+{
+    char errbuf[128];
+    apr_finfo_t finfo;
+    apr_status_t status;
+
+    if (APR_SUCCESS != (status = apr_file_open(f, filename, APR_READ | APR_BINARY, APR_OS_DEFAULT, pool))) {
+	DEBUG_ERR("error calling apr_file_open: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+    if (APR_SUCCESS != (status = apr_file_info_get(&finfo, APR_FINFO_SIZE, *f))) {
+	DEBUG_ERR("error calling apr_file_info_get: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(*f);
+	return status;
+    }
+    if (finfo.size < OS_IO_FRAME_SIZE) {
+	DEBUG_ERR("%s is too small to be an osim file", filename);
+	apr_file_close(*f);
+	return APR_EINVAL;
+    }
+    *len = finfo.size;
+
+    return APR_SUCCESS;
+}
+
+extern apr_status_t os_io_read(const char *filename, const char *magic, apr_uint32_t version,
+			       const unsigned char **payload, apr_size_t *size, apr_pool_t *pool)
+{
+    char errbuf[128];
+    unsigned char *buffer;
+    apr_file_t *f;
+    apr_size_t len;
+    apr_status_t status;
+
+    if (APR_SUCCESS != (status = os_io_open(filename, &f, &len, pool)))
+	return status;
+    buffer = apr_palloc(pool, len);
+    if (APR_SUCCESS != (status = apr_file_read_full(f, buffer, len, NULL))) {
+	DEBUG_ERR("error calling apr_file_read_full: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(f);
+	return status;
+    }
+    apr_file_close(f);
+
+    if (APR_SUCCESS != (status = os_io_check_sum(filename, buffer, len)))
+	return status;
+
+    return os_io_check_header(filename, magic, version, buffer, len, payload, size);
+}
+
+extern apr_status_t os_io_map(const char *filename, const char *magic, apr_uint32_t version,
+			      const unsigned char **payload, apr_size_t *size, apr_pool_t *pool)
+{
+    char errbuf[128];
+    apr_mmap_t *mm;
+    apr_file_t *f;
+    apr_size_t len;
+    apr_status_t status;
+
+    if (APR_SUCCESS != (status = os_io_open(filename, &f, &len, pool)))
+	return status;
+    /* The mapping outlives the file, it is deleted with the pool */
+    status = apr_mmap_create(&mm, f, 0, len, APR_MMAP_READ, pool);
+    apr_file_close(f);
+    if (APR_SUCCESS != status) {
+	DEBUG_ERR("error calling apr_mmap_create: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+
+    /* Only the header is checked, the pages of the payload are read when looked at */
+    return os_io_check_header(filename, magic, version, mm->mm, len, payload, size);
+}
+
+extern apr_status_t os_io_verify(const char *filename, const unsigned char *payload, apr_size_t size)
+{
+    return os_io_check_sum(filename, payload - (OS_IO_MAGIC_LEN + 4), size + OS_IO_FRAME_SIZE);
+}
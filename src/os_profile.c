@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "os_profile.h"
+
+int os_profile_enabled = 0;
+apr_uint64_t os_profile_ns[PRF_END];
+apr_uint64_t os_profile_calls[PRF_END];
+
+static const char *const profile_name[PRF_END] = {
+    "conf",
+    "report_parse",
+    "fleet_parse",
+    "missile",
+    "shield",
+    "shoot",
+    "compaction",
+    "stats",
+    "output"
+};
+
+static const char *const counter_name[PRF_COUNTER_END] = {
+    "cycles",
+    "instructions",
+    "llc_misses",
+    "branch_misses"
+};
+
+static apr_uint64_t counter_value[PRF_COUNTER_END];
+static int counter_fd[PRF_COUNTER_END] = { -1, -1, -1, -1 };
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static const apr_uint64_t counter_config[PRF_COUNTER_END] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int os_profile_counter_open(apr_uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(struct perf_event_attr));
+    attr.size = sizeof(struct perf_event_attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    /* this thread, any cpu */
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+extern void os_profile_enable(void)
+{
+    int i;
+
+    memset(os_profile_ns, 0, sizeof(os_profile_ns));
+    memset(os_profile_calls, 0, sizeof(os_profile_calls));
+    memset(counter_value, 0, sizeof(counter_value));
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    for (i = 0; i < PRF_COUNTER_END; i++) {
+	if (-1 == counter_fd[i]) {
+	    /* Not fatal, perf_event_paranoid or a virtual machine may forbid some of them */
+	    if (-1 == (counter_fd[i] = os_profile_counter_open(counter_config[i])))
+		DEBUG_DBG("hardware counter %s unavailable", counter_name[i]);
+	}
+    }
+#else
+    (void) i;
+#endif
+    os_profile_enabled = 1;
+}
+
+extern void os_profile_counters_start(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    int i;
+
+    if (!os_profile_enabled)
+	return;
+
+    for (i = 0; i < PRF_COUNTER_END; i++) {
+	if (-1 != counter_fd[i]) {
+	    ioctl(counter_fd[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(counter_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+#endif
+}
+
+extern void os_profile_counters_stop(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    apr_uint64_t value;
+    int i;
+
+    if (!os_profile_enabled)
+	return;
+
+    for (i = 0; i < PRF_COUNTER_END; i++) {
+	if (-1 != counter_fd[i]) {
+	    ioctl(counter_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+	    if (sizeof(apr_uint64_t) == read(counter_fd[i], &value, sizeof(apr_uint64_t)))
+		counter_value[i] += value;
+	}
+    }
+#endif
+}
+
+extern void os_profile_display(FILE *out)
+{
+    apr_uint64_t nb_simu, nb_round;
+    int i;
+
+    /* The missile phase runs once per simulation and the shield phase once per round */
+    nb_simu = os_profile_calls[PRF_MISSILE];
+    nb_round = os_profile_calls[PRF_SHIELD];
+
+    fprintf(out, "profile,phase,calls,total_ns,ns_per_call\n");
+    for (i = 0; i < PRF_END; i++)
+	fprintf(out, "profile,%s,%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%.1f\n", profile_name[i],
+		os_profile_calls[i], os_profile_ns[i],
+		(0 != os_profile_calls[i]) ? (double) os_profile_ns[i] / os_profile_calls[i] : 0.0);
+
+    fprintf(out, "profile,counter,total,per_simulation,per_round\n");
+    for (i = 0; i < PRF_COUNTER_END; i++) {
+	if (-1 == counter_fd[i]) {
+	    fprintf(out, "profile,%s,unavailable,,\n", counter_name[i]);
+	    continue;
+	}
+	fprintf(out, "profile,%s,%" APR_UINT64_T_FMT ",%.1f,%.1f\n", counter_name[i], counter_value[i],
+		(0 != nb_simu) ? (double) counter_value[i] / nb_simu : 0.0,
+		(0 != nb_round) ? (double) counter_value[i] / nb_round : 0.0);
+    }
+}
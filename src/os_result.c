@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <values.h>
+
+#include <apr_strings.h>
+
+#include "debug.h"
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_io.h"
+#include "os_result.h"
+
+#define OS_RESULT_MAGIC "OSIMRES"
+
+struct os_result_t
+{
+    apr_pool_t *pool;
+    char *atk_coord;
+    char *def_coord;
+    apr_uint64_t matchup;	/* fingerprint of the fleets, 0 until set */
+    unsigned int resources[RES_END];	/* Defender planet resources */
+    unsigned int deut_consumed;
+    float atk_value;		/* Fleet values before battle, used by sketches */
+    float def_value;
+
+    apr_uint64_t nb_simu;
+    apr_uint64_t nb_atk_vict;
+    apr_uint64_t nb_def_vict;
+    apr_uint64_t nb_round;
+    apr_uint64_t atk_sum[ITEM_END];	/* sum of survivors, divide by nb_simu to get the average */
+    apr_uint64_t def_sum[ITEM_END];
+    apr_uint64_t atk_sumsq[ITEM_END];	/* sum of squared survivors, for the variance */
+    apr_uint64_t def_sumsq[ITEM_END];
+    apr_uint64_t atk_loss[RES_END];
+    apr_uint64_t def_loss[RES_END];
+    apr_uint64_t recycled[RES_DEUT];	/* only metal and cristal go to the debris field */
+
+    /* Sketches: small histograms that can be summed when merging */
+    apr_uint64_t round_hist[MAX_ROUND_NUMBER + 1];
+    apr_uint64_t atk_sketch[OS_RESULT_SKETCH_BINS];
+    apr_uint64_t def_sketch[OS_RESULT_SKETCH_BINS];
+
+    /* Best / worst cases */
+    unsigned int atk_bst[ITEM_END];
+    unsigned int atk_wrst[ITEM_END];
+    unsigned int def_bst[ITEM_END];
+    unsigned int def_wrst[ITEM_END];
+    float atk_max_score;
+    float atk_min_score;
+    float def_max_score;
+    float def_min_score;
+};
+
+extern os_result_t *os_result_make(apr_pool_t *pool)
+{
+    os_result_t *result;
+
+    if (NULL != (result = apr_pcalloc(pool, sizeof(struct os_result_t)))) {
+	result->pool = pool;
+	result->atk_coord = "";
+	result->def_coord = "";
+	result->atk_min_score = result->def_min_score = UINT_MAX;
+    }
+
+    return result;
+}
+
+extern void os_result_set_matchup(os_result_t *result, apr_uint64_t matchup, const char *atk_coord,
+				  const char *def_coord, const unsigned int *resources, unsigned int deut_consumed,
+				  float atk_value, float def_value)
+{
+    result->matchup = matchup;
+    result->atk_coord = apr_pstrdup(result->pool, (NULL != atk_coord) ? atk_coord : "");
+    result->def_coord = apr_pstrdup(result->pool, (NULL != def_coord) ? def_coord : "");
+    memcpy(result->resources, resources, RES_END * sizeof(unsigned int));
+    result->deut_consumed = deut_consumed;
+    result->atk_value = atk_value;
+    result->def_value = def_value;
+}
+
+static inline unsigned int os_result_sketch_bin(float value, float initial_value)
+{
+    unsigned int bin;
+
+    if (initial_value <= 0.0f)
+	return OS_RESULT_SKETCH_BINS - 1;
+
+    bin = (unsigned int) ((value / initial_value) * OS_RESULT_SKETCH_BINS);
+
+    return (bin < OS_RESULT_SKETCH_BINS) ? bin : OS_RESULT_SKETCH_BINS - 1;
+}
+
+extern void os_result_add(os_result_t *result, unsigned char nb_round, const unsigned int *atk_repartition,
+			  float atk_value, const unsigned int *def_repartition, float def_value,
+			  const apr_uint64_t *atk_loss, const apr_uint64_t *def_loss, const apr_uint64_t *recycled)
+{
+    unsigned int atk_alive = 0, def_alive = 0;
+    int j;
+
+    result->nb_simu++;
+    result->nb_round += nb_round;
+    result->round_hist[(nb_round <= MAX_ROUND_NUMBER) ? nb_round : MAX_ROUND_NUMBER]++;
+
+    for (j = 0; j < ITEM_END; j++) {
+	result->atk_sum[j] += atk_repartition[j];
+	result->atk_sumsq[j] += (apr_uint64_t) atk_repartition[j] * (apr_uint64_t) atk_repartition[j];
+	result->def_sum[j] += def_repartition[j];
+	result->def_sumsq[j] += (apr_uint64_t) def_repartition[j] * (apr_uint64_t) def_repartition[j];
+	/* Missiles are not ships, they don't fight */
+	if (j < LM)
+	    atk_alive += atk_repartition[j];
+	def_alive += def_repartition[j];
+    }
+
+    if (0 == atk_alive)
+	result->nb_def_vict++;
+    else if (0 == def_alive)
+	result->nb_atk_vict++;
+
+    for (j = 0; j < RES_END; j++) {
+	result->atk_loss[j] += atk_loss[j];
+	result->def_loss[j] += def_loss[j];
+    }
+    result->recycled[RES_METAL] += recycled[RES_METAL];
+    result->recycled[RES_CRISTAL] += recycled[RES_CRISTAL];
+
+    result->atk_sketch[os_result_sketch_bin(atk_value, result->atk_value)]++;
+    result->def_sketch[os_result_sketch_bin(def_value, result->def_value)]++;
+
+    if (atk_value >= result->atk_max_score) {
+	memcpy(result->atk_bst, atk_repartition, LM * sizeof(unsigned int));
+	result->atk_max_score = atk_value;
+    }
+    if (atk_value <= result->atk_min_score) {
+	memcpy(result->atk_wrst, atk_repartition, LM * sizeof(unsigned int));
+	result->atk_min_score = atk_value;
+    }
+    if (def_value >= result->def_max_score) {
+	memcpy(result->def_bst, def_repartition, ITEM_END * sizeof(unsigned int));
+	result->def_max_score = def_value;
+    }
+    if (def_value <= result->def_min_score) {
+	memcpy(result->def_wrst, def_repartition, ITEM_END * sizeof(unsigned int));
+	result->def_min_score = def_value;
+    }
+}
+
+extern apr_status_t os_result_merge(os_result_t *result, const os_result_t *partial)
+{
+    int j;
+
+    if (0ULL == result->matchup) {
+	os_result_set_matchup(result, partial->matchup, partial->atk_coord, partial->def_coord, partial->resources,
+			      partial->deut_consumed, partial->atk_value, partial->def_value);
+    }
+    else if (result->matchup != partial->matchup) {
+	DEBUG_ERR("can't merge results of different matchups (%" APR_UINT64_T_FMT " vs %" APR_UINT64_T_FMT ")",
+		  result->matchup, partial->matchup);
+	return APR_EINVAL;
+    }
+
+    if (0ULL == partial->nb_simu)
+	return APR_SUCCESS;
+
+    result->nb_simu += partial->nb_simu;
+    result->nb_atk_vict += partial->nb_atk_vict;
+    result->nb_def_vict += partial->nb_def_vict;
+    result->nb_round += partial->nb_round;
+
+    for (j = 0; j < ITEM_END; j++) {
+	result->atk_sum[j] += partial->atk_sum[j];
+	result->def_sum[j] += partial->def_sum[j];
+	result->atk_sumsq[j] += partial->atk_sumsq[j];
+	result->def_sumsq[j] += partial->def_sumsq[j];
+    }
+    for (j = 0; j < RES_END; j++) {
+	result->atk_loss[j] += partial->atk_loss[j];
+	result->def_loss[j] += partial->def_loss[j];
+    }
+    result->recycled[RES_METAL] += partial->recycled[RES_METAL];
+    result->recycled[RES_CRISTAL] += partial->recycled[RES_CRISTAL];
+
+    for (j = 0; j <= MAX_ROUND_NUMBER; j++)
+	result->round_hist[j] += partial->round_hist[j];
+    for (j = 0; j < OS_RESULT_SKETCH_BINS; j++) {
+	result->atk_sketch[j] += partial->atk_sketch[j];
+	result->def_sketch[j] += partial->def_sketch[j];
+    }
+
+    if (partial->atk_max_score >= result->atk_max_score) {
+	memcpy(result->atk_bst, partial->atk_bst, ITEM_END * sizeof(unsigned int));
+	result->atk_max_score = partial->atk_max_score;
+    }
+    if (partial->atk_min_score <= result->atk_min_score) {
+	memcpy(result->atk_wrst, partial->atk_wrst, ITEM_END * sizeof(unsigned int));
+	result->atk_min_score = partial->atk_min_score;
+    }
+    if (partial->def_max_score >= result->def_max_score) {
+	memcpy(result->def_bst, partial->def_bst, ITEM_END * sizeof(unsigned int));
+	result->def_max_score = partial->def_max_score;
+    }
+    if (partial->def_min_score <= result->def_min_score) {
+	memcpy(result->def_wrst, partial->def_wrst, ITEM_END * sizeof(unsigned int));
+	result->def_min_score = partial->def_min_score;
+    }
+
+    return APR_SUCCESS;
+}
+
+extern apr_uint64_t os_result_get_nb_simu(const os_result_t *result)
+{
+    return result->nb_simu;
+}
+
+extern apr_uint64_t os_result_get_nb_round(const os_result_t *result, unsigned char nb_round)
+{
+    return (nb_round <= MAX_ROUND_NUMBER) ? result->round_hist[nb_round] : 0ULL;
+}
+
+#define OS_RESULT_NB_UINT64 (5 + 4 * ITEM_END + 2 * RES_END + RES_DEUT + MAX_ROUND_NUMBER + 1 + 2 * OS_RESULT_SKETCH_BINS)
+/* Strings are prefixed by their length, so there is 2 more uint32 than fields */
+#define OS_RESULT_NB_UINT32 (1 + 2 + RES_END + 1 + 2 + 4 * ITEM_END + 4)
+
+extern apr_status_t os_result_write(const os_result_t *result, const char *filename, apr_pool_t *pool)
+{
+    unsigned char *buffer, *ptr;
+    apr_size_t size;
+
+    size = 8 * OS_RESULT_NB_UINT64 + 4 * OS_RESULT_NB_UINT32 + strlen(result->atk_coord) + strlen(result->def_coord);
+    buffer = ptr = apr_palloc(pool, size);
+
+    os_io_put_uint32(&ptr, ITEM_END);
+    os_io_put_uint64(&ptr, result->matchup);
+    os_io_put_string(&ptr, result->atk_coord);
+    os_io_put_string(&ptr, result->def_coord);
+    os_io_put_uint32_array(&ptr, result->resources, RES_END);
+    os_io_put_uint32(&ptr, result->deut_consumed);
+    os_io_put_float(&ptr, result->atk_value);
+    os_io_put_float(&ptr, result->def_value);
+
+    os_io_put_uint64(&ptr, result->nb_simu);
+    os_io_put_uint64(&ptr, result->nb_atk_vict);
+    os_io_put_uint64(&ptr, result->nb_def_vict);
+    os_io_put_uint64(&ptr, result->nb_round);
+    os_io_put_uint64_array(&ptr, result->atk_sum, ITEM_END);
+    os_io_put_uint64_array(&ptr, result->def_sum, ITEM_END);
+    os_io_put_uint64_array(&ptr, result->atk_sumsq, ITEM_END);
+    os_io_put_uint64_array(&ptr, result->def_sumsq, ITEM_END);
+    os_io_put_uint64_array(&ptr, result->atk_loss, RES_END);
+    os_io_put_uint64_array(&ptr, result->def_loss, RES_END);
+    os_io_put_uint64_array(&ptr, result->recycled, RES_DEUT);
+    os_io_put_uint64_array(&ptr, result->round_hist, MAX_ROUND_NUMBER + 1);
+    os_io_put_uint64_array(&ptr, result->atk_sketch, OS_RESULT_SKETCH_BINS);
+    os_io_put_uint64_array(&ptr, result->def_sketch, OS_RESULT_SKETCH_BINS);
+
+    os_io_put_uint32_array(&ptr, result->atk_bst, ITEM_END);
+    os_io_put_uint32_array(&ptr, result->atk_wrst, ITEM_END);
+    os_io_put_uint32_array(&ptr, result->def_bst, ITEM_END);
+    os_io_put_uint32_array(&ptr, result->def_wrst, ITEM_END);
+    os_io_put_float(&ptr, result->atk_max_score);
+    os_io_put_float(&ptr, result->atk_min_score);
+    os_io_put_float(&ptr, result->def_max_score);
+    os_io_put_float(&ptr, result->def_min_score);
+
+    return os_io_write(filename, OS_RESULT_MAGIC, OS_RESULT_VERSION, buffer, ptr - buffer, pool);
+}
+
+extern apr_status_t os_result_read(os_result_t **result, const char *filename, apr_pool_t *pool)
+{
+    const unsigned char *ptr, *end;
+    apr_size_t size;
+    apr_uint32_t nb_items = 0;
+    apr_status_t status;
+    os_result_t *res;
+
+    if (APR_SUCCESS != (status = os_io_read(filename, OS_RESULT_MAGIC, OS_RESULT_VERSION, &ptr, &size, pool)))
+	return status;
+    end = ptr + size;
+
+    if ((0 != os_io_get_uint32(&ptr, end, &nb_items)) || (ITEM_END != nb_items)) {
+	DEBUG_ERR("%s has been written with %u items instead of %u", filename, nb_items, ITEM_END);
+	return APR_EINVAL;
+    }
+
+    res = os_result_make(pool);
+    if ((0 != os_io_get_uint64(&ptr, end, &(res->matchup)))
+	|| (0 != os_io_get_string(pool, &ptr, end, &(res->atk_coord)))
+	|| (0 != os_io_get_string(pool, &ptr, end, &(res->def_coord)))
+	|| (0 != os_io_get_uint32_array(&ptr, end, res->resources, RES_END))
+	|| (0 != os_io_get_uint32(&ptr, end, &(res->deut_consumed)))
+	|| (0 != os_io_get_float(&ptr, end, &(res->atk_value)))
+	|| (0 != os_io_get_float(&ptr, end, &(res->def_value)))
+	|| (0 != os_io_get_uint64(&ptr, end, &(res->nb_simu)))
+	|| (0 != os_io_get_uint64(&ptr, end, &(res->nb_atk_vict)))
+	|| (0 != os_io_get_uint64(&ptr, end, &(res->nb_def_vict)))
+	|| (0 != os_io_get_uint64(&ptr, end, &(res->nb_round)))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->atk_sum, ITEM_END))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->def_sum, ITEM_END))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->atk_sumsq, ITEM_END))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->def_sumsq, ITEM_END))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->atk_loss, RES_END))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->def_loss, RES_END))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->recycled, RES_DEUT))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->round_hist, MAX_ROUND_NUMBER + 1))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->atk_sketch, OS_RESULT_SKETCH_BINS))
+	|| (0 != os_io_get_uint64_array(&ptr, end, res->def_sketch, OS_RESULT_SKETCH_BINS))
+	|| (0 != os_io_get_uint32_array(&ptr, end, res->atk_bst, ITEM_END))
+	|| (0 != os_io_get_uint32_array(&ptr, end, res->atk_wrst, ITEM_END))
+	|| (0 != os_io_get_uint32_array(&ptr, end, res->def_bst, ITEM_END))
+	|| (0 != os_io_get_uint32_array(&ptr, end, res->def_wrst, ITEM_END))
+	|| (0 != os_io_get_float(&ptr, end, &(res->atk_max_score)))
+	|| (0 != os_io_get_float(&ptr, end, &(res->atk_min_score)))
+	|| (0 != os_io_get_float(&ptr, end, &(res->def_max_score)))
+	|| (0 != os_io_get_float(&ptr, end, &(res->def_min_score)))) {
+	DEBUG_ERR("%s is truncated", filename);
+	return APR_EINVAL;
+    }
+
+    *result = res;
+
+    return APR_SUCCESS;
+}
+
+static inline char *os_result_pct_str(apr_pool_t *pool, apr_uint64_t recycled, apr_uint64_t loss,
+				      const char *no_loss_str)
+{
+    return (0 == loss) ? apr_pstrdup(pool, no_loss_str) : apr_psprintf(pool, "%" APR_UINT64_T_FMT,
+								      100ULL * recycled / loss);
+}
+
+extern void os_result_display(const os_result_t *result, const os_conf_t *conf, unsigned char mode)
+{
+    char *pct_M_atk_str, *pct_C_atk_str, *pct_M_def_str, *pct_C_def_str;
+    apr_uint64_t nb_simu, nb_draw;
+    int j;
+
+    if (0ULL == (nb_simu = result->nb_simu)) {
+	DEBUG_ERR("No simulation to display");
+	return;
+    }
+    nb_draw = nb_simu - (result->nb_atk_vict + result->nb_def_vict);
+
+    pct_M_atk_str = os_result_pct_str(result->pool, result->recycled[RES_METAL], result->atk_loss[RES_METAL],
+				      "no-metal-loss");
+    pct_C_atk_str = os_result_pct_str(result->pool, result->recycled[RES_CRISTAL], result->atk_loss[RES_CRISTAL],
+				      "no-cristal-loss");
+    pct_M_def_str = os_result_pct_str(result->pool, result->recycled[RES_METAL], result->def_loss[RES_METAL],
+				      "no-metal-loss");
+    pct_C_def_str = os_result_pct_str(result->pool, result->recycled[RES_CRISTAL], result->def_loss[RES_CRISTAL],
+				      "no-cristal-loss");
+
+    if (mode & OS_MODE_HTML) {
+	fprintf(stdout, "<p>attacker,%s,", result->atk_coord);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%s (%" APR_UINT64_T_FMT "), ", os_conf_get_shortname(conf, j),
+		    result->atk_sum[j] / nb_simu);
+	}
+	fprintf(stdout, "%" APR_UINT64_T_FMT " victoires, %" APR_UINT64_T_FMT " nuls, %" APR_UINT64_T_FMT " round",
+		result->nb_atk_vict, nb_draw, result->nb_round / nb_simu);
+	fprintf(stdout,
+		", %" APR_UINT64_T_FMT " metal perdu, %" APR_UINT64_T_FMT " cristal perdu, %" APR_UINT64_T_FMT
+		" deut perdu, %u deut consommé</p><br />", result->atk_loss[RES_METAL] / nb_simu,
+		result->atk_loss[RES_CRISTAL] / nb_simu, result->atk_loss[RES_DEUT] / nb_simu, result->deut_consumed);
+
+	fprintf(stdout, "<p>defender,%s,%u,%u,%u,", result->def_coord, result->resources[RES_METAL],
+		result->resources[RES_CRISTAL], result->resources[RES_DEUT]);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%s (%" APR_UINT64_T_FMT "), ", os_conf_get_shortname(conf, j),
+		    result->def_sum[j] / nb_simu);
+	}
+	fprintf(stdout, "%" APR_UINT64_T_FMT " victoires, %" APR_UINT64_T_FMT " nuls, %" APR_UINT64_T_FMT " round",
+		result->nb_def_vict, nb_draw, result->nb_round / nb_simu);
+	fprintf(stdout,
+		", %" APR_UINT64_T_FMT " metal perdu, %" APR_UINT64_T_FMT " cristal perdu, %" APR_UINT64_T_FMT
+		" deut perdu</p><br />", result->def_loss[RES_METAL] / nb_simu, result->def_loss[RES_CRISTAL] / nb_simu,
+		result->def_loss[RES_DEUT] / nb_simu);
+
+	fprintf(stdout, "<p>Statistiques de recyclage (moyenne):</p><br />");
+	fprintf(stdout, "<p>%s, %" APR_UINT64_T_FMT " metal, %" APR_UINT64_T_FMT " cristal,", result->def_coord,
+		result->recycled[RES_METAL] / nb_simu, result->recycled[RES_CRISTAL] / nb_simu);
+	fprintf(stdout, "%s %%age_M_atk, %s %%age_C_atk, %s %%age_M_def, %s %%age_C_def, ", pct_M_atk_str, pct_C_atk_str,
+		pct_M_def_str, pct_C_def_str);
+	fprintf(stdout, "%" APR_UINT64_T_FMT " recycleurs</p><br />",
+		(result->recycled[RES_METAL] + result->recycled[RES_CRISTAL]) / (nb_simu *
+										 os_conf_get_ship_capacity(conf, REC)));
+    }
+    else {
+	fprintf(stdout, "\nplayer,coord,metal,cristal,deut,");
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%s,", os_conf_get_shortname(conf, j));
+	}
+	fprintf(stdout, "victory,draw,round,metal_loss,cristal_loss,deut_loss,deut_consumed");
+
+	fprintf(stdout, "\nattacker,%s,0,0,0,", result->atk_coord);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%" APR_UINT64_T_FMT ",", result->atk_sum[j] / nb_simu);
+	}
+	fprintf(stdout, "%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",", result->nb_atk_vict,
+		nb_draw, result->nb_round / nb_simu);
+	fprintf(stdout, "%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%u",
+		result->atk_loss[RES_METAL] / nb_simu, result->atk_loss[RES_CRISTAL] / nb_simu,
+		result->atk_loss[RES_DEUT] / nb_simu, result->deut_consumed);
+
+	fprintf(stdout, "\ndefender,%s,%u,%u,%u,", result->def_coord, result->resources[RES_METAL],
+		result->resources[RES_CRISTAL], result->resources[RES_DEUT]);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%" APR_UINT64_T_FMT ",", result->def_sum[j] / nb_simu);
+	}
+	fprintf(stdout, "%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",", result->nb_def_vict,
+		nb_draw, result->nb_round / nb_simu);
+	fprintf(stdout, "%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",0",
+		result->def_loss[RES_METAL] / nb_simu, result->def_loss[RES_CRISTAL] / nb_simu,
+		result->def_loss[RES_DEUT] / nb_simu);
+
+	fprintf(stdout, "\n\nRecycling statistics (average):");
+	fprintf(stdout, "\nrecycl,coord,metal,cristal,%%age_M_atk,%%age_C_atk,%%age_M_def,%%age_C_def,nb_recycler");
+	fprintf(stdout, "\nrecycl,%s,%" APR_UINT64_T_FMT ",%" APR_UINT64_T_FMT ",", result->def_coord,
+		result->recycled[RES_METAL] / nb_simu, result->recycled[RES_CRISTAL] / nb_simu);
+	fprintf(stdout, "%s,%s,%s,%s,", pct_M_atk_str, pct_C_atk_str, pct_M_def_str, pct_C_def_str);
+	fprintf(stdout, "%" APR_UINT64_T_FMT,
+		(result->recycled[RES_METAL] + result->recycled[RES_CRISTAL]) / (nb_simu *
+										 os_conf_get_ship_capacity(conf, REC)));
+
+	fprintf(stdout, "\n\nAdditional statistics Best/Worst:");
+	fprintf(stdout, "\nplayer,coord,metal,cristal,deut,");
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%s%s", os_conf_get_shortname(conf, j), ((ITEM_END - 1) == j) ? "" : ",");
+	}
+	fprintf(stdout, "\nbest_attacker,%s,0,0,0,", result->atk_coord);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%u%s", result->atk_bst[j], ((ITEM_END - 1) == j) ? "" : ",");
+	}
+	fprintf(stdout, "\nbest_defender,%s,%u,%u,%u,", result->def_coord, result->resources[RES_METAL],
+		result->resources[RES_CRISTAL], result->resources[RES_DEUT]);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%u%s", result->def_bst[j], ((ITEM_END - 1) == j) ? "" : ",");
+	}
+	fprintf(stdout, "\nworst_attacker,%s,0,0,0,", result->atk_coord);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%u%s", result->atk_wrst[j], ((ITEM_END - 1) == j) ? "" : ",");
+	}
+	fprintf(stdout, "\nworst_defender,%s,%u,%u,%u,", result->def_coord, result->resources[RES_METAL],
+		result->resources[RES_CRISTAL], result->resources[RES_DEUT]);
+	for (j = 0; j < ITEM_END; j++) {
+	    fprintf(stdout, "%u%s", result->def_wrst[j], ((ITEM_END - 1) == j) ? "" : ",");
+	}
+	fprintf(stdout, "\n");
+    }
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "os_conf.h"
+#include "os_io.h"
+#include "os_sample.h"
+
+#define OS_SAMPLE_MAGIC "OSIMSMP"
+
+/* Initial number of simulations allocated, doubled when full */
+#define OS_SAMPLE_INITIAL_SIZE 32
+
+struct os_sample_t
+{
+    apr_pool_t *pool;
+    apr_uint64_t matchup;
+    unsigned int nb;
+    unsigned int allocated;
+    unsigned char *nb_round;
+    unsigned int *atk_repartitions;	/* nb rows of ITEM_END surviving ships */
+    unsigned int *def_repartitions;
+};
+
+extern os_sample_t *os_sample_make(apr_pool_t *pool)
+{
+    os_sample_t *sample;
+
+    if (NULL != (sample = apr_pcalloc(pool, sizeof(struct os_sample_t))))
+	sample->pool = pool;
+
+    return sample;
+}
+
+extern void os_sample_set_matchup(os_sample_t *sample, apr_uint64_t matchup)
+{
+    sample->matchup = matchup;
+}
+
+extern apr_uint64_t os_sample_get_matchup(const os_sample_t *sample)
+{
+    return sample->matchup;
+}
+
+static void os_sample_reserve(os_sample_t *sample, unsigned int nb)
+{
+    unsigned char *nb_round;
+    unsigned int *atk_repartitions, *def_repartitions;
+    unsigned int allocated;
+
+    if (nb <= sample->allocated)
+	return;
+
+    allocated = (0 == sample->allocated) ? OS_SAMPLE_INITIAL_SIZE : sample->allocated;
+    while (allocated < nb)
+	allocated <<= 1;
+
+    nb_round = apr_palloc(sample->pool, allocated * sizeof(unsigned char));
+    atk_repartitions = apr_palloc(sample->pool, allocated * ITEM_END * sizeof(unsigned int));
+    def_repartitions = apr_palloc(sample->pool, allocated * ITEM_END * sizeof(unsigned int));
+    if (0 != sample->nb) {
+	memcpy(nb_round, sample->nb_round, sample->nb * sizeof(unsigned char));
+	memcpy(atk_repartitions, sample->atk_repartitions, sample->nb * ITEM_END * sizeof(unsigned int));
+	memcpy(def_repartitions, sample->def_repartitions, sample->nb * ITEM_END * sizeof(unsigned int));
+    }
+    sample->nb_round = nb_round;
+    sample->atk_repartitions = atk_repartitions;
+    sample->def_repartitions = def_repartitions;
+    sample->allocated = allocated;
+}
+
+extern void os_sample_add(os_sample_t *sample, unsigned char nb_round, const unsigned int *atk_repartition,
+			  const unsigned int *def_repartition)
+{
+    os_sample_reserve(sample, sample->nb + 1);
+
+    sample->nb_round[sample->nb] = nb_round;
+    memcpy(sample->atk_repartitions + sample->nb * ITEM_END, atk_repartition, ITEM_END * sizeof(unsigned int));
+    memcpy(sample->def_repartitions + sample->nb * ITEM_END, def_repartition, ITEM_END * sizeof(unsigned int));
+    sample->nb++;
+}
+
+extern unsigned int os_sample_get_nb(const os_sample_t *sample)
+{
+    return sample->nb;
+}
+
+extern unsigned char os_sample_get_nb_round(const os_sample_t *sample, unsigned int idx)
+{
+    return (idx < sample->nb) ? sample->nb_round[idx] : 0;
+}
+
+extern const unsigned int *os_sample_get_atk_repartitions(const os_sample_t *sample)
+{
+    return sample->atk_repartitions;
+}
+
+extern const unsigned int *os_sample_get_def_repartitions(const os_sample_t *sample)
+{
+    return sample->def_repartitions;
+}
+
+extern apr_status_t os_sample_write(const os_sample_t *sample, const char *filename, apr_pool_t *pool)
+{
+    unsigned char *buffer, *ptr;
+    unsigned int i;
+
+    buffer = ptr = apr_palloc(pool, 4 + 8 + 4 + sample->nb * (1 + 2 * 4 * ITEM_END));
+
+    os_io_put_uint32(&ptr, ITEM_END);
+    os_io_put_uint64(&ptr, sample->matchup);
+    os_io_put_uint32(&ptr, sample->nb);
+    for (i = 0; i < sample->nb; i++) {
+	*ptr++ = sample->nb_round[i];
+	os_io_put_uint32_array(&ptr, sample->atk_repartitions + i * ITEM_END, ITEM_END);
+	os_io_put_uint32_array(&ptr, sample->def_repartitions + i * ITEM_END, ITEM_END);
+    }
+
+    return os_io_write(filename, OS_SAMPLE_MAGIC, OS_SAMPLE_VERSION, buffer, ptr - buffer, pool);
+}
+
+extern apr_status_t os_sample_read(os_sample_t **sample, const char *filename, apr_pool_t *pool)
+{
+    const unsigned char *ptr, *end;
+    apr_size_t size;
+    apr_uint32_t nb_items = 0, nb;
+    apr_status_t status;
+    os_sample_t *smp;
+    unsigned int i;
+
+    if (APR_SUCCESS != (status = os_io_read(filename, OS_SAMPLE_MAGIC, OS_SAMPLE_VERSION, &ptr, &size, pool)))
+	return status;
+    end = ptr + size;
+
+    if ((0 != os_io_get_uint32(&ptr, end, &nb_items)) || (ITEM_END != nb_items)) {
+	DEBUG_ERR("%s has been written with %u items instead of %u", filename, nb_items, ITEM_END);
+	return APR_EINVAL;
+    }
+
+    smp = os_sample_make(pool);
+    if ((0 != os_io_get_uint64(&ptr, end, &(smp->matchup))) || (0 != os_io_get_uint32(&ptr, end, &nb))
+	|| ((apr_size_t) (end - ptr) != (apr_size_t) nb * (1 + 2 * 4 * ITEM_END))) {
+	DEBUG_ERR("%s is truncated", filename);
+	return APR_EINVAL;
+    }
+    os_sample_reserve(smp, nb);
+    for (i = 0; i < nb; i++) {
+	smp->nb_round[i] = *ptr++;
+	os_io_get_uint32_array(&ptr, end, smp->atk_repartitions + i * ITEM_END, ITEM_END);
+	os_io_get_uint32_array(&ptr, end, smp->def_repartitions + i * ITEM_END, ITEM_END);
+    }
+    smp->nb = nb;
+    *sample = smp;
+
+    return APR_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include "os_stat.h"
+
+#define OS_STAT_EPS 1e-15
+#define OS_STAT_MAX_ITER 500
+#define OS_STAT_MIN_BIN 10
+
+/* Regularized upper incomplete gamma Q(a, x), series or Lentz continued fraction */
+static double os_stat_gamma_q(double a, double x)
+{
+    double sum, term, b, c, d, h, an;
+    int i;
+
+    if (x <= 0.0)
+	return 1.0;
+
+    if (x < a + 1.0) {
+	for (i = 1, term = sum = 1.0 / a; i < OS_STAT_MAX_ITER; i++) {
+	    term *= x / (a + i);
+	    sum += term;
+	    if (fabs(term) < fabs(sum) * OS_STAT_EPS)
+		break;
+	}
+	return 1.0 - sum * exp(-x + a * log(x) - lgamma(a));
+    }
+
+    b = x + 1.0 - a;
+    c = 1.0 / DBL_MIN;
+    d = 1.0 / b;
+    h = d;
+    for (i = 1; i < OS_STAT_MAX_ITER; i++) {
+	an = -i * (i - a);
+	b += 2.0;
+	d = an * d + b;
+	if (fabs(d) < DBL_MIN)
+	    d = DBL_MIN;
+	c = b + an / c;
+	if (fabs(c) < DBL_MIN)
+	    c = DBL_MIN;
+	d = 1.0 / d;
+	h *= d * c;
+	if (fabs(d * c - 1.0) < OS_STAT_EPS)
+	    break;
+    }
+
+    return exp(-x + a * log(x) - lgamma(a)) * h;
+}
+
+extern double os_stat_chi2_pvalue(double chi2, unsigned int df)
+{
+    if (0 == df)
+	return 1.0;
+
+    return os_stat_gamma_q(df / 2.0, chi2 / 2.0);
+}
+
+static inline double os_stat_chi2_bin(double obs_a, double obs_b, double total_a, double total_b)
+{
+    double expected_a, expected_b;
+
+    expected_a = (obs_a + obs_b) * total_a / (total_a + total_b);
+    expected_b = (obs_a + obs_b) * total_b / (total_a + total_b);
+
+    return (obs_a - expected_a) * (obs_a - expected_a) / expected_a
+	+ (obs_b - expected_b) * (obs_b - expected_b) / expected_b;
+}
+
+extern double os_stat_chi2_homogeneity(const apr_uint64_t *a, const apr_uint64_t *b, unsigned int nb_bins)
+{
+    double chi2, total_a, total_b, obs_a, obs_b, last_a, last_b;
+    unsigned int i, k;
+
+    for (i = 0, total_a = total_b = 0.0; i < nb_bins; i++) {
+	total_a += a[i];
+	total_b += b[i];
+    }
+    if ((0.0 == total_a) || (0.0 == total_b))
+	return 1.0;
+
+    /* A merged bin is only accounted once the next one is complete, leftovers go in the last one */
+    for (i = 0, k = 0, chi2 = obs_a = obs_b = last_a = last_b = 0.0; i < nb_bins; i++) {
+	obs_a += a[i];
+	obs_b += b[i];
+	if (OS_STAT_MIN_BIN <= obs_a + obs_b) {
+	    if (0 < k)
+		chi2 += os_stat_chi2_bin(last_a, last_b, total_a, total_b);
+	    last_a = obs_a;
+	    last_b = obs_b;
+	    obs_a = obs_b = 0.0;
+	    k++;
+	}
+    }
+    if (k < 2)
+	return 1.0;
+    chi2 += os_stat_chi2_bin(last_a + obs_a, last_b + obs_b, total_a, total_b);
+
+    return os_stat_chi2_pvalue(chi2, k - 1);
+}
+
+static int os_stat_double_cmp(const void *p1, const void *p2)
+{
+    double d1 = *((const double *) p1), d2 = *((const double *) p2);
+
+    return (d1 > d2) - (d1 < d2);
+}
+
+extern double os_stat_ks_2samp(double *a, apr_size_t na, double *b, apr_size_t nb)
+{
+    double d = 0.0, cdf_a = 0.0, cdf_b = 0.0, value, ne, lambda, p, term;
+    apr_size_t i = 0, j = 0;
+    int k;
+
+    if ((0 == na) || (0 == nb))
+	return 1.0;
+
+    qsort(a, na, sizeof(double), os_stat_double_cmp);
+    qsort(b, nb, sizeof(double), os_stat_double_cmp);
+
+    /* Ties are consumed on both sides before comparing the empirical distributions */
+    while ((i < na) && (j < nb)) {
+	value = (a[i] <= b[j]) ? a[i] : b[j];
+	while ((i < na) && (a[i] == value))
+	    i++;
+	while ((j < nb) && (b[j] == value))
+	    j++;
+	cdf_a = (double) i / na;
+	cdf_b = (double) j / nb;
+	if (fabs(cdf_a - cdf_b) > d)
+	    d = fabs(cdf_a - cdf_b);
+    }
+
+    ne = sqrt((double) na * nb / (na + nb));
+    lambda = (ne + 0.12 + 0.11 / ne) * d;
+    if (lambda < 0.2)
+	return 1.0;
+
+    for (k = 1, p = 0.0; k <= 100; k++) {
+	term = 2.0 * ((k & 0x1) ? 1.0 : -1.0) * exp(-2.0 * k * k * lambda * lambda);
+	p += term;
+	if (fabs(term) < OS_STAT_EPS)
+	    break;
+    }
+
+    return (p < 0.0) ? 0.0 : ((p > 1.0) ? 1.0 : p);
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr_thread_mutex.h>
+
+#include "debug.h"
+#include "os_telemetry.h"
+
+#ifdef HAVE_TELEMETRY
+
+int os_telemetry_enabled = 0;
+__thread os_telemetry_t *os_telemetry_local = NULL;
+
+/* Blocks are never freed: threadpool workers keep their pointer for their whole life */
+static os_telemetry_t *registry = NULL;
+static apr_thread_mutex_t *registry_mutex = NULL;
+static apr_pool_t *registry_pool = NULL;
+
+extern os_telemetry_t *os_telemetry_register(void)
+{
+    os_telemetry_t *local;
+
+    if (NULL == (local = calloc(1, sizeof(struct os_telemetry_t)))) {
+	DEBUG_ERR("allocation error");
+	abort();
+    }
+
+    apr_thread_mutex_lock(registry_mutex);
+    local->next = registry;
+    registry = local;
+    apr_thread_mutex_unlock(registry_mutex);
+
+    return local;
+}
+
+extern apr_status_t os_telemetry_enable(void)
+{
+    char errbuf[128];
+    apr_status_t status;
+
+    if (NULL == registry_mutex) {
+	/* Own pool: the lock must outlive the pools of the callers */
+	if (APR_SUCCESS != (status = apr_pool_create(&registry_pool, NULL))) {
+	    DEBUG_ERR("error calling apr_pool_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	if (APR_SUCCESS != (status = apr_thread_mutex_create(&registry_mutex, APR_THREAD_MUTEX_DEFAULT, registry_pool))) {
+	    DEBUG_ERR("error calling apr_thread_mutex_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+    }
+    os_telemetry_enabled = 1;
+
+    return APR_SUCCESS;
+}
+
+extern void os_telemetry_reset(void)
+{
+    os_telemetry_t *ptr;
+
+    if (NULL == registry_mutex)
+	return;
+
+    apr_thread_mutex_lock(registry_mutex);
+    for (ptr = registry; NULL != ptr; ptr = ptr->next) {
+	memset(ptr->counter, 0, sizeof(ptr->counter));
+	memset(ptr->chain, 0, sizeof(ptr->chain));
+    }
+    apr_thread_mutex_unlock(registry_mutex);
+}
+
+extern void os_telemetry_aggregate(os_telemetry_t *total)
+{
+    os_telemetry_t *ptr;
+    int i;
+
+    memset(total, 0, sizeof(struct os_telemetry_t));
+    if (NULL == registry_mutex)
+	return;
+
+    apr_thread_mutex_lock(registry_mutex);
+    for (ptr = registry; NULL != ptr; ptr = ptr->next) {
+	for (i = 0; i < TLM_END; i++)
+	    total->counter[i] += ptr->counter[i];
+	for (i = 0; i < OS_TELEMETRY_CHAIN_BINS; i++)
+	    total->chain[i] += ptr->chain[i];
+    }
+    apr_thread_mutex_unlock(registry_mutex);
+}
+
+#else
+
+extern apr_status_t os_telemetry_enable(void)
+{
+    DEBUG_ERR("telemetry not compiled in, run ./configure --enable-telemetry");
+    return APR_ENOTIMPL;
+}
+
+extern void os_telemetry_reset(void)
+{
+}
+
+extern void os_telemetry_aggregate(os_telemetry_t *total)
+{
+    memset(total, 0, sizeof(struct os_telemetry_t));
+}
+
+#endif /* HAVE_TELEMETRY */
+
+static const char *const telemetry_name[TLM_END] = {
+    "shots",
+    "bounced_shots",
+    "explosions_structure",
+    "explosions_probabilistic",
+    "ships_compacted",
+    "rounds",
+    "battles"
+};
+
+extern void os_telemetry_display(FILE *out)
+{
+    os_telemetry_t total;
+    int i;
+
+    os_telemetry_aggregate(&total);
+
+    fprintf(out, "telemetry,begin,1\n");
+    for (i = 0; i < TLM_END; i++)
+	fprintf(out, "telemetry,%s,%" APR_UINT64_T_FMT "\n", telemetry_name[i], total.counter[i]);
+    for (i = 0; i < OS_TELEMETRY_CHAIN_BINS; i++)
+	fprintf(out, "telemetry,rapid_fire_chain_%d%s,%" APR_UINT64_T_FMT "\n", i + 1,
+		(OS_TELEMETRY_CHAIN_BINS - 1 == i) ? "+" : "", total.chain[i]);
+    fprintf(out, "telemetry,end,1\n");
+}
@@ -15,23 +15,39 @@
  */
 
 #include <stdlib.h>
-#include <time.h>
+#include <signal.h>
 
 #include <apr_getopt.h>
 #include <apr_file_io.h>
 #include <apr_pools.h>
+#include <apr_signal.h>
 #include <apr_strings.h>
 
 #include "debug.h"
 #include "os_conf.h"
 #include "os_fleet.h"
 #include "os_parse.h"
+#include "os_profile.h"
+#include "os_result.h"
+#include "os_sample.h"
+#include "os_telemetry.h"
+
+/* The first interrupt stops the guess and prints its best fleet, the next one (or one out of the guess) kills osim */
+static void osim_cancel(int signo)
+{
+    apr_signal(signo, SIG_DFL);
+    if (!os_fleet_cancel_guess())
+	raise(signo);
+}
 
 static void usage(const char *argv0)
 {
     fprintf(stderr,
-	    "Usage is: %s -a csv_attacker -d [stdin | csv_defender] [-g a|d [-m s|r|d|f [-i] [-l] [-y]] [-o h|p|x] [-t inactivity_timeout] [-f flight_timeout] [-w wave_timeout] [-x fixed_timeout]] [-c confdir] [-n nb_simu] [-p nb_cpu]\n",
+	    "Usage is: %s -a csv_attacker -d [stdin | csv_defender] [-g a|d [-m s|r|d|f [-i] [-l] [-y]] [-o h|p|x] [-t inactivity_timeout] [-f flight_timeout] [-w wave_timeout] [-x fixed_timeout] [-j nb_islands[:interval[:migrants[:r|n]]] | -v] [-T tournament_size] [-N nb_individuals] [-G nb_generations] [-R first[:max]] [-S percent] [-O surplus]] [-c confdir] [-n nb_simu] [-p nb_cpu] [-s shard_idx/nb_shards -u partial_file] [-k samples_file] [-b] [-z] [-D seed] [-C checkpoint_file [-E]] [-W warm_file] [-I index_file]\n",
+	    argv0);
+    fprintf(stderr, "   or: %s -a csv_attacker -d csv_defender -g a|d -q samples_file [-i] [-l] [-y] [-o h|p|x] [-w wave_timeout]\n",
 	    argv0);
+    fprintf(stderr, "   or: %s -e [-o h|p|x] [-c confdir] partial_file...\n", argv0);
     fprintf(stderr, "\tcsv_attacker is of the form:\n");
     fprintf(stderr,
 	    "\t\tdamage,shield,life,combustion,impulsion,hyperespace,coord,pt,gt,cle,clo,cr,vb,vc,rec,se,bb,0,dest,edlm,trac,mip_vs_ldm,mip_vs_alle,mip_vs_allo,mip_vs_cg,mip_vs_aai,mip_vs_lp,mip_vs_pb,mip_vs_gb\n");
@@ -49,6 +65,7 @@ static void usage(const char *argv0)
     fprintf(stderr, "\tyou have defined. This option is memory and CPU intensive and is EXPERIMENTAL.\n");
     fprintf(stderr, "\t\tdefault is off.\n");
     fprintf(stderr, "\t\tThe fleet you want to create must be technologically defined: damage,shield,life.\n");
+    fprintf(stderr, "\t\tAn interrupt (or SIGTERM) stops the guess and prints the best fleet found so far.\n");
     fprintf(stderr, "\tm indicate the mask of ship to apply (default is r):\n");
     fprintf(stderr, "\t\tr: remove PT,GT,VC,REC,SE,SAT,EDLM from attacking fleet (let EDLM for defending fleet).\n");
     fprintf(stderr,
@@ -75,6 +92,43 @@ static void usage(const char *argv0)
     fprintf(stderr, "\tnb_simu is optionnal to set the number of simulations run.\n");
     fprintf(stderr, "\t\tdefault is 100.\n");
     fprintf(stderr, "\tnb_cpu is optionnal to set the number of threads to run in genetic algo default is 1.\n");
+    fprintf(stderr, "\ts runs only the shard shard_idx (starting at 0) of nb_shards of the nb_simu simulations,\n");
+    fprintf(stderr, "\t\tthe partial result is written in partial_file (option u) instead of being displayed.\n");
+    fprintf(stderr, "\te merges the partial_file written by shards of the same battle and displays the result.\n");
+    fprintf(stderr, "\tk writes the outcome of each simulation in samples_file instead of displaying statistics.\n");
+    fprintf(stderr, "\tq scores the samples_file of the same fleets with the economic options (-i -l -y -w)\n");
+    fprintf(stderr, "\t\tand the resources of csv_defender, for the fleet given by -g, without running any battle.\n");
+    fprintf(stderr, "\tb prints the battle engine counters on stderr as telemetry,name,value lines,\n");
+    fprintf(stderr, "\t\tosim must have been configured with --enable-telemetry.\n");
+    fprintf(stderr, "\tz (--profile) prints on stderr the time spent in each phase of the simulations and, if the\n");
+    fprintf(stderr, "\t\tkernel allows it, hardware counters of the battle loop (not available in guess mode).\n");
+    fprintf(stderr, "\tj splits the population of guess mode into nb_islands bred by their own thread, the best\n");
+    fprintf(stderr, "\t\tmigrants (default 2) individuals of each island are copied every interval (default 10)\n");
+    fprintf(stderr, "\t\tgenerations to the next island (r, the default) or to a random one (n).\n");
+    fprintf(stderr, "\tv (--steady-state) replaces the generations of guess mode by nb_cpu threads breeding one child\n");
+    fprintf(stderr, "\t\teach without waiting for the others.\n");
+    fprintf(stderr, "\tT sets the selection pressure of guess mode: the best of tournament_size individuals is crossed\n");
+    fprintf(stderr, "\t\tinto the worst of tournament_size others, which is replaced by the child (default is 3).\n");
+    fprintf(stderr, "\tN sets the maximum number of individuals of guess mode (default is 256, less if memory is short:\n");
+    fprintf(stderr, "\t\tthe free memory first pays a hit table per evaluating thread, nb_cpu plus the islands or\n");
+    fprintf(stderr, "\t\tthe steady state workers).\n");
+    fprintf(stderr, "\tG sets the number of generations of guess mode (default is 100000, a timeout stops it first).\n");
+    fprintf(stderr, "\tR races the children of guess mode: each one first fights first battles (default 4), only those\n");
+    fprintf(stderr, "\t\twhich may beat the median of their parents double them, up to max (default 32), 0 disables it.\n");
+    fprintf(stderr, "\tS sets the percentage of the children of guess mode predicted to lose (or to score below the\n");
+    fprintf(stderr, "\t\tindividual they replace) evaluated anyway (default is 10), 100 disables the prediction.\n");
+    fprintf(stderr, "\tO sets the extra offspring of guess mode bred for each child, the one predicted to score best\n");
+    fprintf(stderr, "\t\tby a model learnt from the evaluations is kept (default is 3), 0 disables it.\n");
+    fprintf(stderr, "\tD (--seed) seeds the random numbers (default is the current time): simulations give the same\n");
+    fprintf(stderr, "\t\tresult (shards included), and guess mode finds the same best fleets until it timeouts, whatever\n");
+    fprintf(stderr, "\t\tnb_cpu; islands and steady state depend on the order their threads run in.\n");
+    fprintf(stderr, "\tC (--Checkpoint) saves the population of guess mode in checkpoint_file every minute and at the\n");
+    fprintf(stderr, "\t\tend, E (--rEsume) goes on from it if the guess is the same.\n");
+    fprintf(stderr, "\tW (--Warm-start) starts guess mode from the fleets of warm_file, repaired against this guess, and\n");
+    fprintf(stderr, "\t\treplaces them by the best ones found: a target guessed again converges sooner.\n");
+    fprintf(stderr, "\tI (--Index) answers guess mode at once with the fleet of a solved guess of index_file, if the\n");
+    fprintf(stderr, "\t\ttechnologies are the same, the fleets nearly, and it wins here too. Otherwise the best fleet\n");
+    fprintf(stderr, "\t\tfound is added to index_file.\n");
     fprintf(stderr, "Examples:\n");
     fprintf(stderr,
 	    "\t%s -a \"17,17,17,15,14,11,[3:432:9],4300,0,45000,15000,15000,10000,0,5500,0,7500,0,6700,0,0\" -d \"15,13,15,3:482:7,20615000,4934510,3363090,20,450,10000,1000,300,892,0,660,13,1000,0,1000,2,55,0,0,0,0,0,0,0,0,0\"\n",
@@ -122,22 +176,49 @@ int main(int argc, const char **argv)
 	{"wave-time", 'w', TRUE, "A fleet that overflow this time, will be penalized."},
 	{"fiXed-timeout", 'x', TRUE, "Fixed time limit for genetic algorithm."},
 	{"no-recYcling", 'y', FALSE, "Don't include recycling in rentability"},
+	{"shard", 's', TRUE, "Run only the shard i/n of the simulations"},
+	{"oUtput-partial", 'u', TRUE, "File receiving the partial result of the shard"},
+	{"mErge", 'e', FALSE, "Merge partial result files and display them"},
+	{"keep-samples", 'k', TRUE, "File receiving the outcome of each simulation"},
+	{"rescore", 'q', TRUE, "Score a samples file without running any battle"},
+	{"battle-telemetry", 'b', FALSE, "Print the battle engine counters"},
+	{"profile", 'z', FALSE, "Print the time spent in each phase of the simulations"},
+	{"islands", 'j', TRUE, "Breed the guess mode population on islands nb[:interval[:migrants[:r|n]]]"},
+	{"steady-state", 'v', FALSE, "Breed the guess mode population without generations"},
+	{"Tournament", 'T', TRUE, "Number of individuals drawn by each selection of guess mode"},
+	{"Number-individuals", 'N', TRUE, "Maximum population of guess mode"},
+	{"Generations", 'G', TRUE, "Number of generations of guess mode"},
+	{"Race", 'R', TRUE, "Battles given to the children of guess mode first[:max], 0 to fight 32 each"},
+	{"Screen", 'S', TRUE, "Percentage of the hopeless children of guess mode evaluated anyway"},
+	{"Offspring", 'O', TRUE, "Extra offspring of guess mode ranked by a surrogate model for each child"},
+	{"seed", 'D', TRUE, "Seed of the random numbers, the same seed gives the same results"},
+	{"Checkpoint", 'C', TRUE, "File receiving the state of guess mode every minute"},
+	{"rEsume", 'E', FALSE, "Continue guess mode from its checkpoint file"},
+	{"Warm-start", 'W', TRUE, "File of the best fleets of guess mode, read at start and written at the end"},
+	{"Index", 'I', TRUE, "Index of solved guesses, a close one answers guess mode at once"},
 	{NULL, 0, 0, NULL},	/* end (a.k.a. sentinel) */
     };
     char errbuf[128];
     char buffer[1024];
     const char *optarg;
-    char *conffile = NULL, *defstdin = NULL, *defline;
+    char *conffile = NULL, *defstdin = NULL, *defline, *partial_file = NULL, *endptr;
+    char *samples_file = NULL, *rescore_file = NULL, *checkpoint_file = NULL;
+    char *warm_file = NULL, *index_file = NULL;
     unsigned long nbsim = 100UL, nbcpu = 1, flight_time = 0UL, wave_time = 0UL, fixed_timeout = 0UL, timeout = 0UL;
+    unsigned long shard_idx = 0UL, shard_count = 0UL, nb_individuals = 0UL, nb_generations = 0UL, seed;
     apr_size_t readbytes, writtenbytes;
     apr_getopt_t *os;
     apr_file_t *f_stdin;
     apr_pool_t *pool;
     os_conf_t *conf;
     os_fleet_t *attacker, *defender;
-    int guessmode = 0, defender_from_stdin = 0;
+    os_result_t *result, *partial;
+    os_sample_t *sample;
+    napr_galife_tuning_t tuning;
+    int guessmode = 0, defender_from_stdin = 0, merge = 0, telemetry = 0, profile = 0, resume = 0;
     int optch;
     enum genetic_algorithm_mask mask = NORMAL;
+    apr_uint64_t start = 0;
     apr_status_t status;
     unsigned char mode;
 
@@ -146,8 +227,6 @@ int main(int argc, const char **argv)
 	return status;
     }
 
-    srand((unsigned int) time(NULL));
-
     if (1 == argc) {
 	usage(argv[0]);
 	return -1;
@@ -167,6 +246,7 @@ int main(int argc, const char **argv)
     attacker = os_fleet_make(pool, ATK_FLT);
     defender = os_fleet_make(pool, DEF_FLT);
     mode = OS_MODE_HUMAN;
+    napr_galife_tuning_default(&tuning);
 
     while (APR_SUCCESS == (status = apr_getopt_long(os, opt_option, &optch, &optarg))) {
 	switch (optch) {
@@ -292,6 +372,144 @@ int main(int argc, const char **argv)
 		return -1;
 	    }
 	    break;
+	case 'j':
+	    tuning.nb_islands = strtoul(optarg, &endptr, 10);
+	    if ((ULONG_MAX == tuning.nb_islands) || (0UL == tuning.nb_islands)) {
+		DEBUG_ERR("can't parse %s for islands", optarg);
+		return -1;
+	    }
+	    if (':' == *endptr) {
+		tuning.migration_interval = strtoul(endptr + 1, &endptr, 10);
+		if ((ULONG_MAX == tuning.migration_interval) || (0UL == tuning.migration_interval)) {
+		    DEBUG_ERR("can't parse %s for islands", optarg);
+		    return -1;
+		}
+	    }
+	    if (':' == *endptr) {
+		tuning.nb_migrants = strtoul(endptr + 1, &endptr, 10);
+		if (ULONG_MAX == tuning.nb_migrants) {
+		    DEBUG_ERR("can't parse %s for islands", optarg);
+		    return -1;
+		}
+	    }
+	    if (':' == *endptr) {
+		endptr++;
+		if ('n' == *endptr)
+		    tuning.topology = NAPR_GALIFE_RANDOM;
+		else if ('r' == *endptr)
+		    tuning.topology = NAPR_GALIFE_RING;
+		else {
+		    DEBUG_ERR("can't parse %s for islands", optarg);
+		    return -1;
+		}
+	    }
+	    break;
+	case 'v':
+	    tuning.steady_state = 1;
+	    break;
+	case 'T':
+	    tuning.tournament_size = strtoul(optarg, NULL, 10);
+	    if ((ULONG_MAX == tuning.tournament_size) || (0UL == tuning.tournament_size)) {
+		DEBUG_ERR("can't parse %s for tournament", optarg);
+		return -1;
+	    }
+	    break;
+	case 'N':
+	    nb_individuals = strtoul(optarg, NULL, 10);
+	    if ((ULONG_MAX == nb_individuals) || (4UL > nb_individuals) || (UINT_MAX < nb_individuals)) {
+		DEBUG_ERR("can't parse %s for individuals", optarg);
+		return -1;
+	    }
+	    break;
+	case 'G':
+	    nb_generations = strtoul(optarg, &endptr, 10);
+	    if (('\0' == *optarg) || ('\0' != *endptr) || (ULONG_MAX == nb_generations) || (0UL == nb_generations)) {
+		DEBUG_ERR("can't parse %s for generations", optarg);
+		return -1;
+	    }
+	    break;
+	case 'R':
+	    tuning.race_first_samples = strtoul(optarg, &endptr, 10);
+	    if (ULONG_MAX == tuning.race_first_samples) {
+		DEBUG_ERR("can't parse %s for race", optarg);
+		return -1;
+	    }
+	    if (':' == *endptr) {
+		tuning.race_max_samples = strtoul(endptr + 1, NULL, 10);
+		if ((ULONG_MAX == tuning.race_max_samples) || (tuning.race_max_samples < tuning.race_first_samples)) {
+		    DEBUG_ERR("can't parse %s for race", optarg);
+		    return -1;
+		}
+	    }
+	    break;
+	case 'S':
+	    tuning.screen_percent = strtoul(optarg, NULL, 10);
+	    if ((ULONG_MAX == tuning.screen_percent) || (100UL < tuning.screen_percent)) {
+		DEBUG_ERR("can't parse %s for screen", optarg);
+		return -1;
+	    }
+	    break;
+	case 'O':
+	    tuning.surrogate_surplus = strtoul(optarg, NULL, 10);
+	    if (ULONG_MAX == tuning.surrogate_surplus) {
+		DEBUG_ERR("can't parse %s for offspring", optarg);
+		return -1;
+	    }
+	    break;
+	case 'D':
+	    seed = strtoul(optarg, &endptr, 10);
+	    if (('\0' == *optarg) || ('\0' != *endptr) || (UINT_MAX < seed)) {
+		DEBUG_ERR("can't parse %s for seed", optarg);
+		return -1;
+	    }
+	    os_fleet_set_seed((unsigned int) seed);
+	    break;
+	case 's':
+	    shard_idx = strtoul(optarg, &endptr, 10);
+	    if ((ULONG_MAX == shard_idx) || ('/' != *endptr)) {
+		DEBUG_ERR("can't parse %s for shard", optarg);
+		return -1;
+	    }
+	    shard_count = strtoul(endptr + 1, NULL, 10);
+	    if ((ULONG_MAX == shard_count) || (0UL == shard_count) || (shard_idx >= shard_count)) {
+		DEBUG_ERR("can't parse %s for shard", optarg);
+		return -1;
+	    }
+	    break;
+	case 'u':
+	    partial_file = apr_pstrdup(pool, optarg);
+	    break;
+	case 'e':
+	    merge = 1;
+	    break;
+	case 'k':
+	    samples_file = apr_pstrdup(pool, optarg);
+	    break;
+	case 'q':
+	    rescore_file = apr_pstrdup(pool, optarg);
+	    break;
+	case 'C':
+	    checkpoint_file = apr_pstrdup(pool, optarg);
+	    break;
+	case 'E':
+	    resume = 1;
+	    break;
+	case 'W':
+	    warm_file = apr_pstrdup(pool, optarg);
+	    break;
+	case 'I':
+	    index_file = apr_pstrdup(pool, optarg);
+	    break;
+	case 'b':
+	    if (APR_SUCCESS != os_telemetry_enable()) {
+		usage(argv[0]);
+		return -1;
+	    }
+	    telemetry = 1;
+	    break;
+	case 'z':
+	    profile = 1;
+	    break;
 	case 'r':
 	    DEBUG_ERR("-r is deprecated, use -m instead\n");
 	    usage(argv[0]);
@@ -299,6 +517,53 @@ int main(int argc, const char **argv)
 	}
     }
 
+    if (merge) {
+	if (os->ind >= argc) {
+	    usage(argv[0]);
+	    return -1;
+	}
+	if (NULL == (conf = os_conf_make(pool, conffile))) {
+	    DEBUG_ERR("error calling os_conf_make");
+	    return -1;
+	}
+	result = os_result_make(pool);
+	for (; os->ind < argc; os->ind++) {
+	    if (APR_SUCCESS != os_result_read(&partial, os->argv[os->ind], pool)) {
+		DEBUG_ERR("error calling os_result_read on %s", os->argv[os->ind]);
+		return -1;
+	    }
+	    if (APR_SUCCESS != os_result_merge(result, partial)) {
+		DEBUG_ERR("error calling os_result_merge on %s", os->argv[os->ind]);
+		return -1;
+	    }
+	}
+	os_result_display(result, conf, mode);
+	apr_terminate();
+
+	return 0;
+    }
+
+    if ((0UL != shard_count) && ((NULL == partial_file) || guessmode)) {
+	DEBUG_ERR("shard mode needs a partial_file and is not available in guess mode");
+	usage(argv[0]);
+	return -1;
+    }
+
+    if (resume && (NULL == checkpoint_file)) {
+	DEBUG_ERR("resume needs a checkpoint_file");
+	usage(argv[0]);
+	return -1;
+    }
+
+    if (profile) {
+	if (guessmode) {
+	    DEBUG_ERR("profile is not available in guess mode");
+	    usage(argv[0]);
+	    return -1;
+	}
+	os_profile_enable();
+    }
+
     if (SCRIPT == mask) {
 	if (0UL == timeout)
 	    timeout = 30;
@@ -334,10 +599,12 @@ int main(int argc, const char **argv)
 		break;
 	}
 
+	OS_PROFILE_BEGIN(start);
 	if (NULL == (defline = os_parse(pool, defstdin))) {
 	    DEBUG_ERR("Can't parse stdin");
 	    return -1;
 	}
+	OS_PROFILE_END(PRF_REPORT_PARSE, start);
 
 	DEBUG_DBG("parsed line is [%s]", defline);
 
@@ -346,11 +613,14 @@ int main(int argc, const char **argv)
 	    return -1;
 	}
     }
+    OS_PROFILE_BEGIN(start);
     if (NULL == (conf = os_conf_make(pool, conffile))) {
 	DEBUG_ERR("error calling os_conf_make");
 	return -1;
     }
+    OS_PROFILE_END(PRF_CONF, start);
 
+    OS_PROFILE_BEGIN(start);
     if (APR_SUCCESS != os_fleet_parse(attacker, conf)) {
 	DEBUG_ERR("error calling os_fleet_parse");
 	return -1;
@@ -360,15 +630,62 @@ int main(int argc, const char **argv)
 	DEBUG_ERR("error calling os_fleet_parse");
 	return -1;
     }
+    OS_PROFILE_END(PRF_FLEET_PARSE, start);
 
-    if (1 == guessmode) {
+    if (NULL != rescore_file) {
+	if (APR_SUCCESS != os_sample_read(&sample, rescore_file, pool)) {
+	    DEBUG_ERR("error calling os_sample_read on %s", rescore_file);
+	    return -1;
+	}
+	if (APR_SUCCESS != os_fleet_rescore(attacker, defender, conf, sample, flight_time, wave_time, mode)) {
+	    DEBUG_ERR("error calling os_fleet_rescore");
+	    return -1;
+	}
+    }
+    else if (1 == guessmode) {
+	apr_signal(SIGINT, osim_cancel);
+	apr_signal(SIGTERM, osim_cancel);
 	os_fleet_find_cheapest_winner(attacker, defender, conf, mask, timeout, fixed_timeout, flight_time, wave_time, mode,
-				      nbcpu);
+				      nbcpu, nb_individuals, nb_generations, &tuning, 0.0f, checkpoint_file, resume,
+				      warm_file, index_file, NULL);
+	apr_signal(SIGINT, SIG_DFL);
+	apr_signal(SIGTERM, SIG_DFL);
+    }
+    else if (0UL != shard_count) {
+	result = os_result_make(pool);
+	if (APR_SUCCESS != os_fleet_battle_shard(attacker, defender, nbsim, shard_idx, shard_count, conf, result)) {
+	    DEBUG_ERR("error calling os_fleet_battle_shard");
+	    return -1;
+	}
+	OS_PROFILE_BEGIN(start);
+	if (APR_SUCCESS != (status = os_result_write(result, partial_file, pool))) {
+	    DEBUG_ERR("error calling os_result_write: %s", apr_strerror(status, errbuf, 128));
+	    return -1;
+	}
+	OS_PROFILE_END(PRF_OUTPUT, start);
+    }
+    else if (NULL != samples_file) {
+	sample = os_sample_make(pool);
+	if (APR_SUCCESS != os_fleet_battle_sample(attacker, defender, nbsim, conf, sample)) {
+	    DEBUG_ERR("error calling os_fleet_battle_sample");
+	    return -1;
+	}
+	OS_PROFILE_BEGIN(start);
+	if (APR_SUCCESS != (status = os_sample_write(sample, samples_file, pool))) {
+	    DEBUG_ERR("error calling os_sample_write: %s", apr_strerror(status, errbuf, 128));
+	    return -1;
+	}
+	OS_PROFILE_END(PRF_OUTPUT, start);
     }
     else {
 	os_fleet_battle(attacker, defender, nbsim, conf, mode);
     }
 
+    if (telemetry)
+	os_telemetry_display(stderr);
+    if (profile)
+	os_profile_display(stderr);
+
     apr_terminate();
 
     return 0;
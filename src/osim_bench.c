@@ -0,0 +1,664 @@
+/*
+ * Copyright (C) 2007 François Pesce : francois.pesce (at) gmail (dot) com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#include <apr_file_io.h>
+#include <apr_getopt.h>
+#include <apr_pools.h>
+#include <apr_strings.h>
+
+#include "debug.h"
+#include "napr_galife.h"
+#include "os_conf.h"
+#include "os_fleet.h"
+#include "os_profile.h"
+#include "os_result.h"
+#include "os_telemetry.h"
+
+#ifndef PACKAGE_VERSION
+#define PACKAGE_VERSION "unknown"
+#endif
+
+/*
+ * Fixed corpus of matchups, from the smallest to the biggest so that the
+ * peak RSS reported after each of them is meaningful. Never change a matchup
+ * in place: add a new one, otherwise old baselines can't be compared.
+ */
+typedef struct bench_matchup_t
+{
+    const char *name;
+    const char *attacker;
+    const char *defender;
+    unsigned int nb_simu;
+} bench_matchup_t;
+
+static const bench_matchup_t corpus[] = {
+    {"fleet_vs_fleet_100",
+     "15,15,15,15,13,10,[3:432:9],0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 1000},
+    {"fleet_vs_defense_1k",
+     "15,15,15,15,13,10,[3:432:9],0,0,0,0,300,100,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,0,0,0,0,0,0,0,0,0,0,0,0,300,200,60,20,15,5,0,0,0", 200},
+    {"missile_heavy_1k",
+     "15,15,15,15,13,10,[3:432:9],0,0,0,0,0,300,0,0,0,100,0,0,0,0,10,10,6,4,4,2,1,1",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,0,0,0,0,0,0,0,0,0,0,0,0,300,200,50,30,30,10,1,1,20", 200},
+    {"dome_heavy_1k",
+     "15,15,15,15,13,10,[3:432:9],0,0,0,0,0,200,0,0,0,150,0,50,0,0,0,0,0,0,0,0,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,148,150,200,100,1,1,0", 200},
+    {"fleet_vs_fleet_10k",
+     "15,15,15,15,13,10,[3:432:9],0,0,3000,1000,700,300,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,3000,1000,700,300,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 20},
+    {"fleet_vs_defense_100k",
+     "15,15,15,15,13,10,[3:432:9],0,0,0,0,0,20000,0,0,0,5000,0,5000,0,0,0,0,0,0,0,0,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,0,0,0,0,0,0,0,0,0,0,0,0,40000,20000,5000,3000,1000,1000,1,1,0", 2},
+    {"fleet_vs_fleet_1m",
+     "15,15,15,15,13,10,[3:432:9],0,0,400000,0,100000,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,400000,0,100000,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 1},
+    {NULL, NULL, NULL, 0}
+};
+
+/*
+ * Genetic algorithm runs, the attacker is in guess mode. The target score is
+ * reached in about a second, a change of the fitness that moves the score
+ * scale needs a new entry.
+ */
+typedef struct bench_guess_t
+{
+    const char *name;
+    const char *attacker;
+    const char *defender;
+    enum genetic_algorithm_mask mask;
+    unsigned int seconds;
+    float target_score;
+    int islands;		/* one island per cpu (at least 2) instead of a single population */
+    int steady_state;
+    int no_race;		/* every child fights the same number of battles */
+} bench_guess_t;
+
+static const bench_guess_t ga_corpus[] = {
+    {"guess_vs_fleet_100",
+     "15,16,15,15,13,10,[3:432:9],2000,1000,5000,2000,1000,500,0,300,0,300,0,100,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", NORMAL, 5, 60000.0f, 0, 0, 0},
+    {"guess_vs_fleet_100_islands",
+     "15,16,15,15,13,10,[3:432:9],2000,1000,5000,2000,1000,500,0,300,0,300,0,100,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", NORMAL, 5, 60000.0f, 1, 0, 0},
+    {"guess_vs_fleet_100_steady",
+     "15,16,15,15,13,10,[3:432:9],2000,1000,5000,2000,1000,500,0,300,0,300,0,100,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", NORMAL, 5, 60000.0f, 0, 1, 0},
+    {"guess_vs_fleet_100_no_race",
+     "15,16,15,15,13,10,[3:432:9],2000,1000,5000,2000,1000,500,0,300,0,300,0,100,0,0",
+     "14,14,14,[3:412:7],100000,100000,50000,0,0,40,0,10,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", NORMAL, 5, 60000.0f, 0, 0, 1},
+    {NULL, NULL, NULL, FULL, 0, 0.0f, 0, 0, 0}
+};
+
+/* A regression must exceed the noise of both runs, and at least this ratio */
+#define BENCH_DEFAULT_TOLERANCE 0.05
+
+typedef struct bench_compare_t
+{
+    char *baseline;		/* whole baseline report, NULL if no comparison */
+    double tolerance;
+    unsigned int nb_regression;
+} bench_compare_t;
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+	    "Usage is: %s [-c confdir] [-f filter] [-m max_units] [-r repeat] [-p nb_cpu] [-P] [-s seed] [-o report] [-B baseline [-t tolerance]]\n",
+	    argv0);
+    fprintf(stderr, "\tRuns the battle engine and the genetic algorithm on a fixed corpus of matchups and prints a JSON report on stdout.\n");
+    fprintf(stderr, "\tThe engine is built as osim is, ns per shot is only reported when configured with --enable-telemetry.\n");
+    fprintf(stderr, "\tconfdir is optionnal to redefine ship values.\n");
+    fprintf(stderr, "\tfilter only runs the matchups whose name contains it.\n");
+    fprintf(stderr, "\tmax_units skips the battle matchups with more units (ships and defenses of both sides).\n");
+    fprintf(stderr, "\trepeat is the number of timed runs of each matchup, the best is kept (default is 3).\n");
+    fprintf(stderr, "\tnb_cpu is the number of threads of the genetic algorithm (default is 1).\n");
+    fprintf(stderr, "\t-P pins the process on the first nb_cpu processors, so that runs are comparable.\n");
+    fprintf(stderr, "\tseed makes the results repeatable whatever nb_cpu, up to the timeout of the genetic algorithm\n");
+    fprintf(stderr, "\tmatchups; those on islands or in steady state also depend on the order their threads run in.\n");
+    fprintf(stderr, "\treport writes the JSON report in a file instead of stdout.\n");
+    fprintf(stderr, "\tbaseline is a previous report, every metric is compared on stderr and the exit code is 1 on regression.\n");
+    fprintf(stderr, "\ttolerance is the minimum relative slowdown reported as a regression (default is %.2f),\n",
+	    BENCH_DEFAULT_TOLERANCE);
+    fprintf(stderr, "\tthe threshold grows with the relative standard deviation of both runs.\n");
+}
+
+static os_fleet_t *bench_fleet(apr_pool_t *pool, const os_conf_t *conf, enum Fleet_enum type, const char *csv)
+{
+    os_fleet_t *fleet;
+
+    if (NULL == (fleet = os_fleet_make(pool, type))) {
+	DEBUG_ERR("error calling os_fleet_make");
+	return NULL;
+    }
+    if (APR_SUCCESS != os_fleet_set_conf(fleet, csv)) {
+	DEBUG_ERR("error calling os_fleet_set_conf");
+	return NULL;
+    }
+    if (APR_SUCCESS != os_fleet_parse(fleet, conf)) {
+	DEBUG_ERR("error calling os_fleet_parse");
+	return NULL;
+    }
+
+    return fleet;
+}
+
+static apr_status_t bench_simulate(os_fleet_t *attacker, os_fleet_t *defender, unsigned int nb_simu,
+				   const os_conf_t *conf, apr_pool_t *pool)
+{
+    os_result_t *result;
+
+    if (NULL == (result = os_result_make(pool))) {
+	DEBUG_ERR("error calling os_result_make");
+	return APR_ENOMEM;
+    }
+
+    return os_fleet_battle_shard(attacker, defender, nb_simu, 0, 1, conf, result);
+}
+
+/* Relative standard deviation of the samples, 0 if there is only one */
+static double bench_rsd(const double *sample, unsigned int nb)
+{
+    double mean = 0.0, var = 0.0;
+    unsigned int i;
+
+    if (nb < 2)
+	return 0.0;
+    for (i = 0; i < nb; i++)
+	mean += sample[i];
+    mean /= nb;
+    if (0.0 == mean)
+	return 0.0;
+    for (i = 0; i < nb; i++)
+	var += (sample[i] - mean) * (sample[i] - mean);
+
+    return sqrt(var / (nb - 1)) / mean;
+}
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *) a, db = *(const double *) b;
+
+    return (da > db) - (da < db);
+}
+
+/* Read the value of "key" on the line of the matchup name (the report writes one matchup per line) */
+static int bench_baseline_get(const char *baseline, const char *name, const char *key, double *value, apr_pool_t *pool)
+{
+    const char *line, *end, *field;
+    char *endptr;
+
+    if (NULL == (line = strstr(baseline, apr_psprintf(pool, "\"name\": \"%s\"", name))))
+	return 0;
+    if (NULL == (end = strchr(line, '\n')))
+	end = line + strlen(line);
+    line = apr_pstrndup(pool, line, end - line);
+    if (NULL == (field = strstr(line, apr_psprintf(pool, "\"%s\": ", key))))
+	return 0;
+    field += strlen(key) + 4;
+    *value = strtod(field, &endptr);
+
+    /* null if the metric could not be measured */
+    return (endptr != field);
+}
+
+/*
+ * Print a metric and its relative standard deviation in the report, then
+ * compare it against the baseline: a regression is a change in the wrong
+ * direction beyond 3 sigmas of the noise of both runs, and beyond the tolerance.
+ */
+static void bench_metric(FILE *out, bench_compare_t *cmp, const char *name, const char *key, int valid, double value,
+			 double rsd, int higher_is_better, apr_pool_t *pool)
+{
+    double base, base_rsd, threshold, slowdown;
+    const char *verdict;
+
+    if (valid)
+	fprintf(out, "\"%s\": %.3f, \"%s_rsd\": %.4f, ", key, value, key, rsd);
+    else
+	fprintf(out, "\"%s\": null, \"%s_rsd\": null, ", key, key);
+
+    if ((NULL == cmp->baseline) || !bench_baseline_get(cmp->baseline, name, key, &base, pool) || (0.0 == base))
+	return;
+    if (!bench_baseline_get(cmp->baseline, name, apr_pstrcat(pool, key, "_rsd", NULL), &base_rsd, pool))
+	base_rsd = 0.0;
+
+    threshold = 3.0 * sqrt(base_rsd * base_rsd + rsd * rsd);
+    if (threshold < cmp->tolerance)
+	threshold = cmp->tolerance;
+    if (!valid) {
+	fprintf(stderr, "compare,%s,%s,%.3f,null,,%.2f,regression\n", name, key, base, 100.0 * threshold);
+	cmp->nb_regression++;
+	return;
+    }
+    slowdown = (higher_is_better) ? (base - value) / base : (value - base) / base;
+    if (slowdown > threshold) {
+	verdict = "regression";
+	cmp->nb_regression++;
+    }
+    else if (slowdown < -threshold)
+	verdict = "improvement";
+    else
+	verdict = "ok";
+    fprintf(stderr, "compare,%s,%s,%.3f,%.3f,%.2f,%.2f,%s\n", name, key, base, value, 100.0 * slowdown,
+	    100.0 * threshold, verdict);
+}
+
+static apr_status_t bench_run(const bench_matchup_t *matchup, const os_conf_t *conf, unsigned int max_units,
+			      unsigned int repeat, int *first, FILE *out, bench_compare_t *cmp, apr_pool_t *pool)
+{
+    os_telemetry_t total;
+    struct rusage usage;
+    os_fleet_t *attacker, *defender;
+    apr_uint64_t start, elapsed, best = 0ULL;
+    double *sample;
+    unsigned int units, i;
+    double seconds, rsd;
+
+    if ((NULL == (attacker = bench_fleet(pool, conf, ATK_FLT, matchup->attacker)))
+	|| (NULL == (defender = bench_fleet(pool, conf, DEF_FLT, matchup->defender)))) {
+	DEBUG_ERR("invalid matchup %s", matchup->name);
+	return APR_EINVAL;
+    }
+    units = os_fleet_get_nb_units(attacker) + os_fleet_get_nb_units(defender);
+    if ((0 != max_units) && (units > max_units))
+	return APR_SUCCESS;
+
+    sample = apr_palloc(pool, repeat * sizeof(double));
+    for (i = 0; i < repeat; i++) {
+	start = os_profile_clock();
+	if (APR_SUCCESS != bench_simulate(attacker, defender, matchup->nb_simu, conf, pool)) {
+	    DEBUG_ERR("error simulating %s", matchup->name);
+	    return APR_EGENERAL;
+	}
+	elapsed = os_profile_clock() - start;
+	sample[i] = (double) elapsed;
+	if ((0 == i) || (elapsed < best))
+	    best = elapsed;
+    }
+    /* Both metrics are derived from the same timings, they share the noise */
+    rsd = bench_rsd(sample, repeat);
+
+    /*
+     * Shots are counted in an untimed run (of the same battles if seeded) so
+     * that the timed ones only pay the test of the disabled telemetry; the
+     * engine is timed as osim builds it, without telemetry by default, and
+     * ns_per_shot is then null.
+     */
+    memset(&total, 0, sizeof(os_telemetry_t));
+#ifdef HAVE_TELEMETRY
+    os_telemetry_reset();
+    os_telemetry_enabled = 1;
+    if (APR_SUCCESS != bench_simulate(attacker, defender, matchup->nb_simu, conf, pool)) {
+	DEBUG_ERR("error simulating %s", matchup->name);
+	return APR_EGENERAL;
+    }
+    os_telemetry_enabled = 0;
+    os_telemetry_aggregate(&total);
+#endif
+
+    getrusage(RUSAGE_SELF, &usage);
+    seconds = best / 1e9;
+
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"units\": %u, \"nb_simu\": %u, \"seconds\": %.6f, ", (*first) ? "" : ",",
+	    matchup->name, units, matchup->nb_simu, seconds);
+    bench_metric(out, cmp, matchup->name, "simulations_per_second", (0ULL != best),
+		 (0ULL != best) ? matchup->nb_simu / seconds : 0.0, rsd, 1, pool);
+    if (0ULL != total.counter[TLM_SHOT])
+	fprintf(out, "\"shots\": %" APR_UINT64_T_FMT ", ", total.counter[TLM_SHOT]);
+    else
+	fprintf(out, "\"shots\": null, ");
+    bench_metric(out, cmp, matchup->name, "ns_per_shot", (0ULL != total.counter[TLM_SHOT]),
+		 (0ULL != total.counter[TLM_SHOT]) ? (double) best / total.counter[TLM_SHOT] : 0.0, rsd, 0, pool);
+    fprintf(out, "\"peak_rss_kb\": %ld}", usage.ru_maxrss);
+    fflush(out);
+    *first = 0;
+
+    return APR_SUCCESS;
+}
+
+static apr_status_t bench_guess(const bench_guess_t *guess, const os_conf_t *conf, unsigned int repeat,
+				unsigned int nb_cpu, int *first, FILE *out, bench_compare_t *cmp, apr_pool_t *pool)
+{
+    napr_galife_stats_t stats;
+    napr_galife_tuning_t tuning;
+    apr_pool_t *subpool;
+    os_fleet_t *attacker, *defender;
+    double *evaluation, *target;
+    double best_evaluation = 0.0;
+    float best_score = 0.0f;
+    unsigned int i, nb_reached = 0;
+    apr_status_t status;
+    char errbuf[128];
+
+    napr_galife_tuning_default(&tuning);
+    if (guess->islands)
+	tuning.nb_islands = (nb_cpu > 1) ? nb_cpu : 2;
+    tuning.steady_state = guess->steady_state;
+    if (guess->no_race)
+	tuning.race_first_samples = 0UL;
+
+    evaluation = apr_palloc(pool, repeat * sizeof(double));
+    target = apr_palloc(pool, repeat * sizeof(double));
+    for (i = 0; i < repeat; i++) {
+	/* The genetic algorithm works on the fleets, each run starts from fresh ones */
+	if (APR_SUCCESS != (status = apr_pool_create(&subpool, pool))) {
+	    DEBUG_ERR("error calling apr_pool_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	if ((NULL == (attacker = bench_fleet(subpool, conf, ATK_FLT, guess->attacker)))
+	    || (NULL == (defender = bench_fleet(subpool, conf, DEF_FLT, guess->defender)))) {
+	    DEBUG_ERR("invalid matchup %s", guess->name);
+	    return APR_EINVAL;
+	}
+	os_fleet_to_guess(attacker);
+
+	memset(&stats, 0, sizeof(napr_galife_stats_t));
+	os_fleet_find_cheapest_winner(attacker, defender, conf, guess->mask, 0, guess->seconds, 0, 0,
+				      OS_MODE_HUMAN | OS_MODE_QUIET, nb_cpu, 0, 0UL, &tuning, guess->target_score, NULL, 0,
+				      NULL, NULL, &stats);
+	if (0 == stats.run_time) {
+	    DEBUG_ERR("error running the genetic algorithm on %s", guess->name);
+	    return APR_EGENERAL;
+	}
+	evaluation[i] = stats.nb_evaluations / (stats.run_time / 1e6);
+	if (evaluation[i] > best_evaluation)
+	    best_evaluation = evaluation[i];
+	if ((0 == i) || (stats.best_score > best_score))
+	    best_score = stats.best_score;
+	if (stats.target_time >= 0)
+	    target[nb_reached++] = stats.target_time / 1e6;
+	apr_pool_destroy(subpool);
+    }
+
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"nb_cpu\": %u, \"nb_islands\": %lu, \"steady_state\": %s, \"race_first_samples\": %lu, \"surrogate_surplus\": %lu, \"seconds\": %u, \"target_score\": %.1f, \"best_score\": %.1f, ",
+	    (*first) ? "" : ",", guess->name, nb_cpu, tuning.nb_islands,
+	    tuning.steady_state ? "true" : "false", tuning.race_first_samples, tuning.surrogate_surplus, guess->seconds,
+	    guess->target_score, best_score);
+    bench_metric(out, cmp, guess->name, "evaluations_per_second", 1, best_evaluation,
+		 bench_rsd(evaluation, repeat), 1, pool);
+    /* Median over the runs, a run that never reached the target counts as the slowest */
+    qsort(target, nb_reached, sizeof(double), bench_cmp_double);
+    bench_metric(out, cmp, guess->name, "time_to_target", (2 * nb_reached > repeat),
+		 (2 * nb_reached > repeat) ? target[repeat / 2] : 0.0, bench_rsd(target, nb_reached), 0, pool);
+    fprintf(out, "\"target_reached\": %u}", nb_reached);
+    fflush(out);
+    *first = 0;
+
+    return APR_SUCCESS;
+}
+
+/* Keep the process, and the threads it will start, on the first nb_cpu allowed processors */
+static apr_status_t bench_pin(unsigned int nb_cpu)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+    cpu_set_t allowed, pinned;
+    unsigned int cpu, nb = 0;
+
+    if (0 != sched_getaffinity(0, sizeof(cpu_set_t), &allowed)) {
+	DEBUG_ERR("error calling sched_getaffinity");
+	return APR_EGENERAL;
+    }
+    CPU_ZERO(&pinned);
+    for (cpu = 0; (cpu < CPU_SETSIZE) && (nb < nb_cpu); cpu++) {
+	if (CPU_ISSET(cpu, &allowed)) {
+	    CPU_SET(cpu, &pinned);
+	    nb++;
+	}
+    }
+    if (0 != sched_setaffinity(0, sizeof(cpu_set_t), &pinned)) {
+	DEBUG_ERR("error calling sched_setaffinity");
+	return APR_EGENERAL;
+    }
+
+    return APR_SUCCESS;
+#else
+    DEBUG_ERR("processor pinning is not supported on this system");
+    return APR_ENOTIMPL;
+#endif
+}
+
+static char *bench_baseline_read(const char *filename, apr_pool_t *pool)
+{
+    char errbuf[128];
+    apr_file_t *f;
+    apr_finfo_t finfo;
+    char *buffer;
+    apr_status_t status;
+
+    if (APR_SUCCESS != (status = apr_file_open(&f, filename, APR_READ, APR_OS_DEFAULT, pool))) {
+	DEBUG_ERR("error calling apr_file_open: %s", apr_strerror(status, errbuf, 128));
+	return NULL;
+    }
+    if (APR_SUCCESS != (status = apr_file_info_get(&finfo, APR_FINFO_SIZE, f))) {
+	DEBUG_ERR("error calling apr_file_info_get: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(f);
+	return NULL;
+    }
+    buffer = apr_palloc(pool, finfo.size + 1);
+    if (APR_SUCCESS != (status = apr_file_read_full(f, buffer, finfo.size, NULL))) {
+	DEBUG_ERR("error calling apr_file_read_full: %s", apr_strerror(status, errbuf, 128));
+	apr_file_close(f);
+	return NULL;
+    }
+    apr_file_close(f);
+    buffer[finfo.size] = '\0';
+
+    return buffer;
+}
+
+int main(int argc, const char **argv)
+{
+    static const apr_getopt_option_t opt_option[] = {
+	/* long-option, short-option, has-arg flag, description */
+	{"baseline", 'B', TRUE, "Compare against a previous report"},
+	{"confdir", 'c', TRUE, "Configuration directory"},
+	{"filter", 'f', TRUE, "Only run the matchups whose name contains filter"},
+	{"help", 'h', FALSE, "Help"},
+	{"max-units", 'm', TRUE, "Skip the matchups with more units"},
+	{"output", 'o', TRUE, "Write the report in a file"},
+	{"nb-cpu", 'p', TRUE, "Number of threads of the genetic algorithm"},
+	{"pin", 'P', FALSE, "Pin the process on the first nb_cpu processors"},
+	{"seed", 's', TRUE, "Seed of the random numbers"},
+	{"repeat", 'r', TRUE, "Number of timed runs of each matchup"},
+	{"tolerance", 't', TRUE, "Minimum relative slowdown reported as a regression"},
+	{NULL, 0, 0, NULL},	/* end (a.k.a. sentinel) */
+    };
+    char errbuf[128];
+    const char *optarg;
+    char *conffile = NULL, *filter = NULL, *baseline = NULL, *output = NULL, *endptr;
+    unsigned long max_units = 0UL, repeat = 3UL, nb_cpu = 1UL, seed = 0UL;
+    bench_compare_t cmp;
+    apr_getopt_t *os;
+    apr_pool_t *pool, *subpool;
+    os_conf_t *conf;
+    FILE *out = stdout;
+    int optch, first = 1, pin = 0, seeded = 0;
+    apr_status_t status;
+    unsigned int i;
+
+    cmp.baseline = NULL;
+    cmp.tolerance = BENCH_DEFAULT_TOLERANCE;
+    cmp.nb_regression = 0;
+
+    if (APR_SUCCESS != (status = apr_initialize())) {
+	DEBUG_ERR("error calling apr_initialize: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+
+    if (APR_SUCCESS != (status = apr_pool_create(&pool, NULL))) {
+	DEBUG_ERR("error calling apr_pool_create: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+
+    if (APR_SUCCESS != (status = apr_getopt_init(&os, pool, argc, argv))) {
+	DEBUG_ERR("error calling apr_getopt_init: %s", apr_strerror(status, errbuf, 128));
+	return status;
+    }
+
+    while (APR_SUCCESS == (status = apr_getopt_long(os, opt_option, &optch, &optarg))) {
+	switch (optch) {
+	case 'B':
+	    baseline = apr_pstrdup(pool, optarg);
+	    break;
+	case 'c':
+	    conffile = apr_pstrdup(pool, optarg);
+	    break;
+	case 'f':
+	    filter = apr_pstrdup(pool, optarg);
+	    break;
+	case 'h':
+	    usage(argv[0]);
+	    return 0;
+	case 'm':
+	    max_units = strtoul(optarg, &endptr, 10);
+	    if (('\0' == *optarg) || ('\0' != *endptr)) {
+		DEBUG_ERR("can't parse %s for max_units", optarg);
+		return -1;
+	    }
+	    break;
+	case 'o':
+	    output = apr_pstrdup(pool, optarg);
+	    break;
+	case 'p':
+	    nb_cpu = strtoul(optarg, &endptr, 10);
+	    if (('\0' == *optarg) || ('\0' != *endptr) || (0UL == nb_cpu)) {
+		DEBUG_ERR("can't parse %s for nb_cpu", optarg);
+		return -1;
+	    }
+	    break;
+	case 'P':
+	    pin = 1;
+	    break;
+	case 'r':
+	    repeat = strtoul(optarg, &endptr, 10);
+	    if (('\0' == *optarg) || ('\0' != *endptr) || (0UL == repeat)) {
+		DEBUG_ERR("can't parse %s for repeat", optarg);
+		return -1;
+	    }
+	    break;
+	case 's':
+	    seed = strtoul(optarg, &endptr, 10);
+	    if (('\0' == *optarg) || ('\0' != *endptr) || (UINT_MAX < seed)) {
+		DEBUG_ERR("can't parse %s for seed", optarg);
+		return -1;
+	    }
+	    os_fleet_set_seed((unsigned int) seed);
+	    seeded = 1;
+	    break;
+	case 't':
+	    cmp.tolerance = strtod(optarg, &endptr);
+	    if (('\0' == *optarg) || ('\0' != *endptr) || (cmp.tolerance < 0.0)) {
+		DEBUG_ERR("can't parse %s for tolerance", optarg);
+		return -1;
+	    }
+	    break;
+	}
+    }
+    if (APR_EOF != status) {
+	usage(argv[0]);
+	return -1;
+    }
+
+    if (NULL == (conf = os_conf_make(pool, conffile))) {
+	DEBUG_ERR("error calling os_conf_make");
+	return -1;
+    }
+
+    if ((NULL != baseline) && (NULL == (cmp.baseline = bench_baseline_read(baseline, pool)))) {
+	DEBUG_ERR("can't read baseline %s", baseline);
+	return -1;
+    }
+
+    if (pin && (APR_SUCCESS != bench_pin(nb_cpu))) {
+	DEBUG_ERR("error calling bench_pin");
+	return -1;
+    }
+
+    if ((NULL != output) && (NULL == (out = fopen(output, "w")))) {
+	DEBUG_ERR("can't open %s for writing", output);
+	return -1;
+    }
+
+#ifdef HAVE_TELEMETRY
+    if (APR_SUCCESS != os_telemetry_enable()) {
+	DEBUG_ERR("error calling os_telemetry_enable");
+	return -1;
+    }
+    /* Only the untimed runs count */
+    os_telemetry_enabled = 0;
+#endif
+
+    if (NULL != cmp.baseline)
+	fprintf(stderr, "compare,matchup,metric,baseline,current,slowdown_pct,threshold_pct,verdict\n");
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"seed\": ", PACKAGE_VERSION);
+    if (seeded)
+	fprintf(out, "%lu", seed);
+    else
+	fprintf(out, "null");
+    fprintf(out, ",\n  \"repeat\": %lu,\n  \"pinned\": %s,\n  \"matchups\": [", repeat, pin ? "true" : "false");
+    for (i = 0; NULL != corpus[i].name; i++) {
+	if ((NULL != filter) && (NULL == strstr(corpus[i].name, filter)))
+	    continue;
+
+	if (APR_SUCCESS != (status = apr_pool_create(&subpool, pool))) {
+	    DEBUG_ERR("error calling apr_pool_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	if (APR_SUCCESS != bench_run(&(corpus[i]), conf, max_units, repeat, &first, out, &cmp, subpool))
+	    return -1;
+	apr_pool_destroy(subpool);
+    }
+    fprintf(out, "\n  ],\n  \"ga\": [");
+    first = 1;
+    for (i = 0; NULL != ga_corpus[i].name; i++) {
+	if ((NULL != filter) && (NULL == strstr(ga_corpus[i].name, filter)))
+	    continue;
+
+	if (APR_SUCCESS != (status = apr_pool_create(&subpool, pool))) {
+	    DEBUG_ERR("error calling apr_pool_create: %s", apr_strerror(status, errbuf, 128));
+	    return status;
+	}
+	if (APR_SUCCESS != bench_guess(&(ga_corpus[i]), conf, repeat, nb_cpu, &first, out, &cmp, subpool))
+	    return -1;
+	apr_pool_destroy(subpool);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if ((stdout != out) && (0 != fclose(out))) {
+	DEBUG_ERR("can't close %s", output);
+	return -1;
+    }
+
+    apr_terminate();
+
+    if (0 != cmp.nb_regression) {
+	fprintf(stderr, "%u regression(s) against %s\n", cmp.nb_regression, baseline);
+	return 1;
+    }
+
+    return 0;
+}